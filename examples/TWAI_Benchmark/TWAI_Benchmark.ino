@@ -0,0 +1,272 @@
+/**
+ * @file TWAI_Benchmark.ino
+ * @brief Micro-benchmarks of the TWAI_Object hot paths
+ * @details Measures, on the target, the cost of:
+ * - Software filter evaluation (32 mixed filters)
+ * - ID dispatch lookup
+ * - Event ring vs FreeRTOS queue enqueue/dequeue
+ * - Filter reconfiguration (apply_hardware_filters)
+ * - Signal decoding: compile-time codec vs naive per-signal decode
+ * - RX interrupt path (from get_stats() after a traffic window)
+ * - Consumer wake-ups per received frame with RX moderation
+ *
+ * Results are printed as one JSON object per line so they can be collected
+ * by a script and compared between releases.
+ */
+
+ #include <Arduino.h>
+ #include <TWAI_Object.h>
+ #include <TWAI_Signal.h>
+ #include <esp_timer.h>
+
+ static const uint32_t ITERATIONS = 100000;  ///< Operations per benchmark
+ static const uint16_t RX_MODERATION_FRAMES = 16;   ///< Wake the consumer every N frames (0 = every interrupt)
+ static const uint32_t RX_MODERATION_US = 2000;     ///< ... or this long after the first pending frame
+
+ volatile uint32_t sink; ///< Keeps results alive
+
+ /**
+  * @brief Print one benchmark result as a JSON line
+  * @param name Benchmark name
+  * @param ops Operations performed
+  * @param elapsed_us Total time in microseconds
+  */
+ void report(const char* name, uint32_t ops, int64_t elapsed_us) {
+     Serial.printf("{\"bench\":\"%s\",\"ops\":%u,\"total_us\":%lld,\"ns_per_op\":%.1f,\"ops_per_s\":%.0f}\n",
+                   name, ops, elapsed_us,
+                   elapsed_us * 1000.0 / ops,
+                   ops * 1000000.0 / (elapsed_us ? elapsed_us : 1));
+ }
+
+ /**
+  * @brief Filter engine with a realistic mixed filter set
+  */
+ void bench_filter() {
+     static TWAI_FilterEngine engine;
+     engine.reset();
+     for (uint32_t i = 0; i < 16; ++i) {
+         engine.add_range(0x100 + i * 0x20, 0x10F + i * 0x20, false);
+         engine.add_range(0x18DA0000 + (i << 8), 0x18DA00FF + (i << 8), true);
+     }
+     engine.finalize();
+
+     int64_t start = esp_timer_get_time();
+     uint32_t hits = 0;
+     for (uint32_t i = 0; i < ITERATIONS; ++i) {
+         hits += engine.matches(i & 0x7FF, false);
+         hits += engine.matches(0x18DA0000 + (i & 0x1FFF), true);
+     }
+     report("filter_match", ITERATIONS * 2, esp_timer_get_time() - start);
+     sink = hits;
+ }
+
+ /** @brief No-op subscription target */
+ void dummy_handler(const TWAI_Object::can_event_t&, void*) {}
+
+ /**
+  * @brief Dispatch table lookup
+  */
+ void bench_dispatch() {
+     static TWAI_Dispatch dispatch;
+     for (uint32_t i = 0; i < 24; ++i) {
+         dispatch.add(0x100 + i * 8, 0x100 + i * 8, false, false, 0, (void*) dummy_handler, nullptr);
+     }
+     for (uint32_t i = 0; i < 6; ++i) {
+         dispatch.add(0x18DA00F1 + (i << 8), 0x18DA00F1 + (i << 8), false, true, 0, (void*) dummy_handler, nullptr);
+     }
+
+     int64_t start = esp_timer_get_time();
+     uint32_t hits = 0;
+     for (uint32_t i = 0; i < ITERATIONS; ++i) {
+         hits += dispatch.lookup(i & 0x7FF, false) != 0;
+         hits += dispatch.lookup(0x18DA00F1 + ((i & 7) << 8), true) != 0;
+     }
+     report("dispatch_lookup", ITERATIONS * 2, esp_timer_get_time() - start);
+     sink = hits;
+ }
+
+ /**
+  * @brief Event ring vs FreeRTOS queue, 8 events per drain
+  */
+ void bench_queues() {
+     static TWAI_EventRing<TWAI_Object::can_event_packed_t, 64> ring;
+     TWAI_Object::can_event_packed_t packed = {};
+     TWAI_Object::can_event_packed_t batch[8];
+
+     int64_t start = esp_timer_get_time();
+     for (uint32_t i = 0; i < ITERATIONS; i += 8) {
+         for (int k = 0; k < 8; ++k) ring.push(packed);
+         ring.pop_batch(batch, 8);
+     }
+     report("ring_push_pop", ITERATIONS, esp_timer_get_time() - start);
+
+     QueueHandle_t queue = xQueueCreate(64, sizeof(TWAI_Object::can_event_t));
+     TWAI_Object::can_event_t event = {};
+     start = esp_timer_get_time();
+     for (uint32_t i = 0; i < ITERATIONS; i += 8) {
+         for (int k = 0; k < 8; ++k) xQueueSend(queue, &event, 0);
+         for (int k = 0; k < 8; ++k) xQueueReceive(queue, &event, 0);
+     }
+     report("queue_send_receive", ITERATIONS, esp_timer_get_time() - start);
+     vQueueDelete(queue);
+ }
+
+ /** Engine frame used by the signal benchmark */
+ typedef TWAI_Signal<0, 16, TWAI_BYTE_ORDER_INTEL, false, std::ratio<1, 4>> EngineSpeed;
+ typedef TWAI_Signal<16, 8, TWAI_BYTE_ORDER_INTEL, false, std::ratio<1>, std::ratio<-40>> CoolantTemp;
+ typedef TWAI_Signal<31, 12, TWAI_BYTE_ORDER_MOTOROLA, true, std::ratio<1, 2>> Torque;
+ typedef TWAI_Signal<56, 1> BrakeSwitch;
+ typedef TWAI_MessageCodec<EngineSpeed, CoolantTemp, Torque, BrakeSwitch> EngineFrame;
+
+ /**
+  * @brief Runtime signal decode, one bit at a time (DBC semantics)
+  * @param data Payload
+  * @param start DBC start bit
+  * @param length Bit length
+  * @param motorola Big endian signal
+  * @param is_signed Two's complement
+  * @param factor Scale
+  * @param offset Offset
+  * @return Physical value
+  */
+ float naive_decode(const uint8_t* data, uint8_t start, uint8_t length, bool motorola,
+                    bool is_signed, float factor, float offset) {
+     uint64_t raw = 0;
+     int bit = start;
+     for (uint8_t i = 0; i < length; ++i) {
+         uint64_t value = (data[bit / 8] >> (bit % 8)) & 1;
+         if (motorola) {
+             raw = (raw << 1) | value;
+             bit = (bit % 8 == 0) ? bit + 15 : bit - 1;
+         } else {
+             raw |= value << i;
+             ++bit;
+         }
+     }
+     int64_t signed_raw = (int64_t) raw;
+     if (is_signed && (raw >> (length - 1)) & 1) signed_raw -= (int64_t) 1 << length;
+     return signed_raw * factor + offset;
+ }
+
+ /**
+  * @brief Decode a batch of engine frames with both methods
+  */
+ void bench_signals() {
+     static TWAI_Object::can_event_t events[32];
+     static EngineFrame::values_t values[32];
+     for (uint32_t i = 0; i < 32; ++i) {
+         events[i] = {};
+         events[i].message.identifier = 0x0CF;
+         events[i].message.data_length_code = 8;
+         EngineFrame::encode(events[i].message.data,
+                             EngineFrame::values_t(800.0f + i * 10, 90.0f - i, -100.0f + i * 7, float(i & 1)));
+     }
+     const uint32_t rounds = ITERATIONS / 32;
+
+     int64_t start = esp_timer_get_time();
+     float acc = 0;
+     for (uint32_t r = 0; r < rounds; ++r) {
+         for (uint32_t i = 0; i < 32; ++i) {
+             const uint8_t* d = events[i].message.data;
+             acc += naive_decode(d, 0, 16, false, false, 0.25f, 0);
+             acc += naive_decode(d, 16, 8, false, false, 1, -40);
+             acc += naive_decode(d, 31, 12, true, true, 0.5f, 0);
+             acc += naive_decode(d, 56, 1, false, false, 1, 0);
+         }
+     }
+     report("signal_decode_naive", rounds * 32, esp_timer_get_time() - start);
+
+     start = esp_timer_get_time();
+     for (uint32_t r = 0; r < rounds; ++r) {
+         size_t n = EngineFrame::decode_batch(events, 32, 0x0CF, false, values, 32);
+         for (size_t i = 0; i < n; ++i) {
+             acc += std::get<0>(values[i]) + std::get<1>(values[i]) + std::get<2>(values[i]) + std::get<3>(values[i]);
+         }
+     }
+     report("signal_decode_batch", rounds * 32, esp_timer_get_time() - start);
+     sink = (uint32_t) acc;
+ }
+
+ /**
+  * @brief Cost of a filter change that keeps and that changes the hardware filter
+  */
+ void bench_apply_filters() {
+     TWAI_Object::twai_user_filter_t filters[2] = {
+         { 0x100, 0x10F, TWAI_Object::TWAI_FILTER_TYPE_RANGE, false },
+         { 0x108, 0x108, TWAI_Object::TWAI_FILTER_TYPE_LIST, false }
+     };
+     const uint32_t runs = 20;
+
+     // Same hardware filter: only the software engine is recompiled
+     TWAI_Object::twai.set_filters(filters, 2);
+     int64_t start = esp_timer_get_time();
+     for (uint32_t i = 0; i < runs; ++i) {
+         TWAI_Object::twai.set_filters(filters, 1 + (i & 1));
+     }
+     report("apply_filters_soft", runs, esp_timer_get_time() - start);
+
+     // Different hardware filter on every call: driver reinstall
+     start = esp_timer_get_time();
+     for (uint32_t i = 0; i < runs; ++i) {
+         filters[0].id = (i & 1) ? 0x100 : 0x200;
+         filters[0].mask_or_end_id = filters[0].id + 0x0F;
+         TWAI_Object::twai.set_filters(filters, 1);
+     }
+     report("apply_filters_reinstall", runs, esp_timer_get_time() - start);
+     TWAI_Object::twai.clear_filters();
+ }
+
+ /**
+  * @brief RX interrupt cost and consumer wake-ups measured during a traffic window
+  */
+ void report_isr() {
+     TWAI_Object::stats_t stats = TWAI_Object::twai.get_stats(true);
+     Serial.printf("{\"bench\":\"rx_isr\",\"isr_count\":%u,\"rx_frames\":%u,\"isr_min_us\":%u,\"isr_avg_us\":%u,\"isr_max_us\":%u}\n",
+                   stats.counters.isr_count, stats.counters.rx_frames,
+                   stats.counters.isr_min_us, stats.counters.isr_avg_us, stats.counters.isr_max_us);
+     Serial.printf("{\"bench\":\"rx_wakes\",\"moderation\":%u,\"rx_wakes\":%u,\"frames_per_wake\":%.1f,\"latency_max_us\":%u}\n",
+                   RX_MODERATION_FRAMES, stats.counters.rx_wakes,
+                   stats.counters.rx_frames / (stats.counters.rx_wakes ? float(stats.counters.rx_wakes) : 1.0f),
+                   stats.counters.latency_max_us);
+ }
+
+ /**
+  * @brief Drain the event ring in batches
+  * @param arg Unused
+  */
+ void rx_consumer(void* arg) {
+     TWAI_Object::can_event_packed_t batch[32];
+     while (true) {
+         sink = TWAI_Object::twai.receive_batch(batch, 32);
+     }
+ }
+
+ /**
+  * @brief Run all benchmarks once
+  */
+ void setup() {
+     Serial.begin(115200);
+
+     bench_filter();
+     bench_dispatch();
+     bench_queues();
+     bench_signals();
+
+     TWAI_Object::twai.enable_event_ring(true);
+     TWAI_Object::twai.set_rx_moderation(RX_MODERATION_FRAMES, RX_MODERATION_US);
+     if (TWAI_Object::twai.begin(GPIO_NUM_5, GPIO_NUM_4, 500000)) {
+         bench_apply_filters();
+         xTaskCreate(rx_consumer, "rx_consumer", 4096, nullptr, 5, nullptr);
+         TWAI_Object::twai.get_stats(true);
+     } else {
+         Serial.println("{\"error\":\"begin failed\"}");
+     }
+ }
+
+ /**
+  * @brief Report RX interrupt cost every 10 s of bus traffic
+  */
+ void loop() {
+     delay(10000);
+     report_isr();
+ }
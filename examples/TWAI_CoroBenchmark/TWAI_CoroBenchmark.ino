@@ -0,0 +1,211 @@
+/**
+ * @file TWAI_CoroBenchmark.ino
+ * @brief Request/response flows as coroutines vs one task per flow
+ * @details Demonstrates and measures:
+ * - TWAI_CoTask flows using co_receive(), co_send() and sleep() on one
+ *   TWAI_CoExecutor, with the reply wait armed before the request is sent
+ * - RAM per concurrent flow: coroutine frame plus wait slots, against the
+ *   stack, TCB and queue of a task per flow
+ * - Resume latency: frame matched to coroutine resumed, against queue
+ *   send to task woken
+ *
+ * The flows run against a responder on a TWAI_VirtualBus, so the loop
+ * advances the bus and calls run(); on the peripheral start() runs the
+ * executor in its own task. The loop waits a real millisecond per virtual
+ * one because the executor timeouts and sleeps follow esp_timer. Results are printed as JSON lines like
+ * TWAI_Benchmark. Needs C++20 coroutines (e.g. -std=gnu++20).
+ */
+
+ #include <Arduino.h>
+ #include <TWAI_Object.h>
+ #include <TWAI_Coro.h>
+ #include <esp_timer.h>
+ #include <atomic>
+
+#if TWAI_COROUTINES
+
+ static const int FLOWS = 100;              ///< Concurrent coroutine flows
+ static const int ROUNDS = 20;              ///< Requests per flow
+ static const int TASK_FLOWS = 8;           ///< Flows of the task-per-flow baseline (4 KB stack each)
+ static const uint32_t TASK_STACK = 4096;   ///< Stack of a flow task, as can_receive_task
+ static const UBaseType_t TASK_QUEUE_LEN = 4;   ///< Queue depth of a flow task
+ static const uint64_t RUN_MS = 3000;       ///< Run time limit
+
+ TWAI_VirtualBus bus(500000);               ///< Simulated bus
+ TWAI_Object dut;                           ///< Device running the flows
+ TWAI_CoExecutor executor(dut);             ///< Executor of the flows
+ int responder;                             ///< Node answering the requests
+ twai_message_t pending_replies[FLOWS];     ///< Replies to send on the next millisecond
+ int pending_count = 0;                     ///< Entries in pending_replies
+ int completed = 0;                         ///< Requests answered in time
+ int timed_out = 0;                         ///< Requests without a reply
+ int finished = 0;                          ///< Flows that returned
+ uint32_t peak_frame_bytes = 0;             ///< Coroutine frame bytes with every flow alive
+
+ /**
+  * @brief Responder: answer request 0x600 + n with 0x700 + n
+  * @param msg Frame seen on the bus
+  * @param timestamp_us End of the frame
+  * @param context Unused
+  */
+ void on_bus_frame(const twai_message_t& msg, uint64_t timestamp_us, void* context) {
+     if (msg.identifier < 0x600 || msg.identifier >= 0x600 + FLOWS || pending_count >= FLOWS) return;
+     twai_message_t reply = msg;
+     reply.identifier = msg.identifier + 0x100;
+     pending_replies[pending_count++] = reply;
+ }
+
+ /**
+  * @brief One request/response conversation
+  * @param index Flow number
+  */
+ TWAI_CoTask flow(int index) {
+     TWAI_Object::twai_user_filter_t reply_id = { uint32_t(0x700 + index), 0, TWAI_Object::TWAI_FILTER_TYPE_LIST, false };
+     twai_message_t request = {};
+     request.identifier = 0x600 + index;
+     request.data_length_code = 2;
+
+     // Staggered start: a hundred requests at once would overflow the TX queue
+     co_await executor.sleep(pdMS_TO_TICKS(index / 2));
+     for (int round = 0; round < ROUNDS; ++round) {
+         request.data[0] = uint8_t(round);
+         // Armed before sending: the reply cannot slip in before the co_await
+         TWAI_CoReceive reply = dut.co_receive(reply_id, pdMS_TO_TICKS(50));
+         if (co_await dut.co_send(request) != TWAI_TX_SUCCESS) {
+             ++timed_out;
+             continue;
+         }
+         TWAI_CoExecutor::rx_result_t rx = co_await reply;
+         if (rx.received && rx.event.message.data[0] == uint8_t(round)) ++completed;
+         else ++timed_out;
+         co_await executor.sleep(pdMS_TO_TICKS(50 + index % 13));
+     }
+     ++finished;
+ }
+
+ /**
+  * @brief Print one benchmark result as a JSON line
+  * @param name Approach
+  * @param flows Concurrent flows
+  * @param ram_per_flow Bytes per flow
+  * @param resume_avg_us Average resume latency
+  * @param resume_max_us Longest resume latency
+  */
+ void report(const char* name, int flows, uint32_t ram_per_flow, uint32_t resume_avg_us, uint32_t resume_max_us) {
+     Serial.printf("{\"bench\":\"%s\",\"flows\":%d,\"ram_per_flow\":%u,\"resume_avg_us\":%u,\"resume_max_us\":%u}\n",
+                   name, flows, ram_per_flow, resume_avg_us, resume_max_us);
+ }
+
+ /**
+  * @brief Run the coroutine flows on the virtual bus
+  */
+ void bench_coroutines() {
+     responder = bus.add_node(on_bus_frame, nullptr, nullptr);
+     bus.start(responder);
+     dut.attach_virtual_bus(bus);
+     if (!dut.begin(GPIO_NUM_5, GPIO_NUM_4, 500000)) {
+         Serial.println("DUT begin failed");
+         return;
+     }
+     TWAI_Object::twai_user_filter_t replies = { 0x700, 0x700 + FLOWS - 1, TWAI_Object::TWAI_FILTER_TYPE_RANGE, false };
+     executor.listen(replies);
+
+     for (int i = 0; i < FLOWS; ++i) {
+         if (!executor.spawn(flow(i))) Serial.printf("Flow %d not started\n", i);
+     }
+     peak_frame_bytes = TWAI_CoTask::frame_bytes();
+
+     for (uint64_t ms = 1; ms <= RUN_MS && finished < FLOWS; ++ms) {
+         bus.run_until(ms * 1000);
+         executor.run();
+         for (int i = 0; i < pending_count; ++i) bus.transmit(responder, pending_replies[i]);
+         pending_count = 0;
+         delay(1);
+     }
+
+     // Each flow holds its reply wait plus a send or sleep wait at a time
+     TWAI_CoExecutor::stats_t stats = executor.get_stats();
+     uint32_t slot_bytes = TWAI_CoExecutor::wait_slot_bytes();
+     report("coroutine", FLOWS, peak_frame_bytes / FLOWS + 2 * slot_bytes,
+            stats.resume_latency_avg_us, stats.resume_latency_max_us);
+     Serial.printf("  %d answered, %d timed out, frame %u B, wait slot %u B, peak slots %u, unclaimed %u\n",
+                   completed, timed_out, peak_frame_bytes / FLOWS, slot_bytes, stats.waits_peak, stats.unclaimed);
+ }
+
+ QueueHandle_t task_queues[TASK_FLOWS];     ///< Queue of each flow task
+ volatile int64_t sent_us[TASK_FLOWS];      ///< Time the last item was queued to each task
+ std::atomic<uint32_t> task_latency_total{0};   ///< Sum of task wake latencies
+ std::atomic<uint32_t> task_latency_max{0};     ///< Longest task wake latency
+ std::atomic<int> task_wakes{0};            ///< Items received by the tasks
+
+ /**
+  * @brief Task-per-flow baseline: block on a queue, as can_receive_task
+  * @param arg Flow index
+  */
+ void flow_task(void* arg) {
+     int index = int(intptr_t(arg));
+     TWAI_Object::can_event_t event;
+     for (int round = 0; round < ROUNDS; ++round) {
+         if (xQueueReceive(task_queues[index], &event, portMAX_DELAY) != pdTRUE) continue;
+         uint32_t latency = uint32_t(esp_timer_get_time() - sent_us[index]);
+         task_latency_total.fetch_add(latency);
+         uint32_t max = task_latency_max.load();
+         while (latency > max && !task_latency_max.compare_exchange_weak(max, latency)) {}
+         task_wakes.fetch_add(1);
+     }
+     vTaskDelete(nullptr);
+ }
+
+ /**
+  * @brief Run the task-per-flow baseline
+  */
+ void bench_tasks() {
+     for (int i = 0; i < TASK_FLOWS; ++i) {
+         task_queues[i] = xQueueCreate(TASK_QUEUE_LEN, sizeof(TWAI_Object::can_event_t));
+         xTaskCreate(flow_task, "FLOW", TASK_STACK, (void*) intptr_t(i), tskIDLE_PRIORITY + 5, nullptr);
+     }
+     delay(10);
+
+     TWAI_Object::can_event_t event = {};
+     for (int round = 0; round < ROUNDS; ++round) {
+         for (int i = 0; i < TASK_FLOWS; ++i) {
+             sent_us[i] = esp_timer_get_time();
+             xQueueSend(task_queues[i], &event, portMAX_DELAY);
+         }
+         delay(5);
+     }
+     while (task_wakes.load() < TASK_FLOWS * ROUNDS) delay(1);
+
+     uint32_t ram = TASK_STACK + sizeof(StaticTask_t) + sizeof(StaticQueue_t)
+                  + TASK_QUEUE_LEN * sizeof(TWAI_Object::can_event_t);
+     report("task_per_flow", TASK_FLOWS, ram, task_latency_total.load() / (TASK_FLOWS * ROUNDS),
+            task_latency_max.load());
+ }
+
+ /**
+  * @brief Run both benchmarks
+  */
+ void setup() {
+     Serial.begin(115200);
+     bench_coroutines();
+     bench_tasks();
+ }
+
+#else
+
+ /**
+  * @brief Report the missing language support
+  */
+ void setup() {
+     Serial.begin(115200);
+     Serial.println("This example needs C++20 coroutines (build with -std=gnu++20)");
+ }
+
+#endif  // TWAI_COROUTINES
+
+ /**
+  * @brief Nothing to do: the benchmarks run once in setup()
+  */
+ void loop() {
+     delay(1000);
+ }
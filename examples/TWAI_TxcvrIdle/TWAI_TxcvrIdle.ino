@@ -0,0 +1,100 @@
+/**
+ * @file TWAI_TxcvrIdle.ino
+ * @brief Transceiver standby while the bus is idle, with wake latency
+ * @details Demonstrates:
+ * - set_txcvr_idle_policy() putting a linked TJA1050 in standby
+ * - Wakes caused by a peer frame and by send()
+ * - Wake to first-frame latency and the share of time spent in standby
+ * - start_diagnostic() reporting through a callback instead of spin-waiting
+ *
+ * Runs on a TWAI_VirtualBus, so poll_txcvr_idle() is called by the loop;
+ * on the peripheral the service task calls it. The simulated bus does not
+ * model the transceiver wake time, so the latency shown is the frame time.
+ */
+
+ #include <Arduino.h>
+ #include <TWAI_Object.h>
+
+ static const uint64_t RUN_MS = 8000;       ///< Virtual run time
+ static const uint32_t IDLE_MS = 50;        ///< Inactivity before standby
+ static const uint32_t DIAGNOSTIC_MS = 500; ///< Diagnostic period while in standby
+
+ TWAI_VirtualBus bus(500000);               ///< Simulated bus
+ TWAI_Object dut;                           ///< Device under test
+ TWAI_Txcvr txcvr;                          ///< Transceiver linked to the device
+ TWAI_Txcvr::Config txcvr_config(TWAI_Txcvr::Type::TJA1050, GPIO_NUM_15);   ///< STBY on GPIO 15
+ int peer;                                  ///< Node sending the occasional request
+
+ /**
+  * @brief Print the result of the diagnostic
+  * @param connected True if the transceiver responded
+  * @param context Unused
+  */
+ void on_diagnostic(bool connected, void* context) {
+     Serial.printf("Diagnostic: transceiver %s\n", connected ? "connected" : "not connected");
+ }
+
+ /**
+  * @brief Build the bus, run the simulation and print the report
+  */
+ void setup() {
+     Serial.begin(115200);
+
+     peer = bus.add_node(nullptr, nullptr, nullptr);
+     bus.start(peer);
+
+     if (!txcvr.begin(txcvr_config)) {
+         Serial.println("Transceiver begin failed");
+         return;
+     }
+     dut.attach_virtual_bus(bus);
+     dut.link_transceiver(txcvr);
+     dut.enable_tx_scheduler(true);
+     dut.set_txcvr_idle_policy(IDLE_MS, DIAGNOSTIC_MS);
+     if (!dut.begin(GPIO_NUM_5, GPIO_NUM_4, 500000)) {
+         Serial.println("DUT begin failed");
+         return;
+     }
+
+     twai_message_t report = {};
+     report.identifier = 0x180;
+     report.data_length_code = 8;
+     twai_message_t request = {};
+     request.identifier = 0x600;
+     request.data_length_code = 2;
+     TWAI_Object::can_event_packed_t events[32];
+
+     for (uint64_t ms = 1; ms <= RUN_MS; ++ms) {
+         // A burst of reports every second, a peer request every 2.5 s
+         if (ms % 1000 < 20 && ms % 5 == 0) dut.send(report, 0);
+         if (ms % 2500 == 0) bus.transmit(peer, request);
+         bus.run_until(ms * 1000);
+         while (dut.receive_batch(events, 32, 0) > 0) {}
+         dut.poll_txcvr_idle();
+         // Virtual time runs far ahead of the real-time diagnostic delays:
+         // let a diagnostic finish before the simulation moves on
+         while (txcvr.get_diagnostic() == TWAI_Txcvr::Diagnostic::RUNNING) delay(1);
+     }
+
+     TWAI_Object::txcvr_power_stats_t power = dut.get_txcvr_power_stats();
+     Serial.printf("Standby entries %u, woken by RX %u, by TX %u\n",
+                   power.sleeps, power.wakes_rx, power.wakes_tx);
+     Serial.printf("Wake to first frame: avg %u us, max %u us\n",
+                   power.wake_latency_avg_us, power.wake_latency_max_us);
+     Serial.printf("Standby %.1f%% of the run, asleep now: %s\n",
+                   power.standby_us * 100.0f / (RUN_MS * 1000), power.asleep ? "yes" : "no");
+     Serial.printf("Failed periodic diagnostics: %u\n", power.diagnostics_failed);
+
+     // On-demand diagnostic: the result arrives through the callback
+     dut.set_txcvr_idle_policy(0);
+     if (txcvr.start_diagnostic(on_diagnostic)) {
+         while (txcvr.get_diagnostic() == TWAI_Txcvr::Diagnostic::RUNNING) delay(1);
+     }
+ }
+
+ /**
+  * @brief Nothing to do: the simulation runs once in setup()
+  */
+ void loop() {
+     delay(1000);
+ }
@@ -0,0 +1,128 @@
+/**
+ * @file TWAI_VirtualBus.ino
+ * @brief Stress test of a TWAI_Object on a simulated 30-node bus
+ * @details Demonstrates:
+ * - Attaching a TWAI_Object to a TWAI_VirtualBus instead of the peripheral
+ * - 29 generator nodes loading a 500 kbit/s bus to about 90%
+ * - Random error injection and a forced bus-off
+ * - Transmit completions of low priority frames with a deadline
+ * - Drop, queue depth and TX latency report after 10 s of virtual time
+ *
+ * The whole run takes a fraction of the simulated time and gives the same
+ * numbers every time.
+ */
+
+ #include <Arduino.h>
+ #include <TWAI_Object.h>
+
+ static const int GENERATORS = 29;          ///< Simulated nodes besides the device under test
+ static const uint32_t PERIOD_MS = 8;       ///< Period of each generator frame
+ static const uint64_t RUN_MS = 10000;      ///< Virtual run time
+
+ TWAI_VirtualBus bus(500000);               ///< Simulated bus
+ TWAI_Object dut;                           ///< Device under test
+ int generator_node[GENERATORS];            ///< Bus node index of each generator
+ uint32_t tx_results[3];                    ///< DUT completions per twai_tx_result_t
+
+ /**
+  * @brief Count the outcome of each DUT transmission
+  * @param completion Finished frame
+  * @param context Unused
+  */
+ void on_tx_complete(const TWAI_Object::tx_completion_t& completion, void* context) {
+     ++tx_results[completion.result];
+ }
+
+ /**
+  * @brief Queue the frames of every generator that is due
+  * @param now_ms Virtual time in milliseconds
+  */
+ void run_generators(uint64_t now_ms) {
+     for (int i = 0; i < GENERATORS; ++i) {
+         if ((now_ms + i) % PERIOD_MS != 0) continue;
+
+         twai_message_t msg = {};
+         msg.identifier = 0x100 + i * 8;
+         msg.data_length_code = 8;
+         memcpy(msg.data, &now_ms, sizeof(now_ms));
+         bus.transmit(generator_node[i], msg);
+     }
+ }
+
+ /**
+  * @brief Build the bus, run the simulation and print the report
+  */
+ void setup() {
+     Serial.begin(115200);
+
+     for (int i = 0; i < GENERATORS; ++i) {
+         generator_node[i] = bus.add_node(nullptr, nullptr, nullptr);
+         bus.start(generator_node[i]);
+     }
+     bus.set_error_rate(200, 42);
+
+     // Device under test: slow consumer of the event ring
+     dut.attach_virtual_bus(bus);
+     dut.enable_event_ring(true);
+     dut.set_overflow_policy(TWAI_Object::TWAI_OVERFLOW_DROP_OLDEST);
+     dut.set_tx_complete_handler(on_tx_complete);
+     TWAI_Object::twai_user_filter_t ids = { 0x100, 0x17F, TWAI_Object::TWAI_FILTER_TYPE_RANGE, false };
+     dut.set_filters(&ids, 1);
+     if (!dut.begin(GPIO_NUM_5, GPIO_NUM_4, 500000)) {
+         Serial.println("DUT begin failed");
+         return;
+     }
+
+     TWAI_Object::can_event_packed_t events[16];
+     twai_message_t status = {};
+     status.identifier = 0x050;
+     status.data_length_code = 4;
+     // Low priority diagnostics: worthless if not sent within 2 ms
+     twai_message_t diag = {};
+     diag.identifier = 0x7F0;
+     diag.data_length_code = 8;
+     TWAI_Object::tx_options_t diag_options = {};
+     diag_options.deadline_us = 2000;
+
+     for (uint64_t ms = 1; ms <= RUN_MS; ++ms) {
+         run_generators(ms);
+         if (ms % 10 == 0) dut.send(status, 0);
+         if (ms % 10 == 5) dut.send(diag, diag_options, 0);
+         if (ms == RUN_MS / 2) bus.force_bus_off(generator_node[0]);
+         bus.run_until(ms * 1000);
+         // Slow consumer: drain every 5 ms
+         if (ms % 5 == 0) dut.receive_batch(events, 16, 0);
+     }
+
+     TWAI_VirtualBus::bus_stats_t load = bus.get_bus_stats();
+     Serial.printf("Bus: load %.1f%%, %u frames, %u error frames\n",
+                   load.load * 100.0f, load.frames, load.errors);
+
+     TWAI_Object::drop_stats_t drops = dut.get_drop_stats();
+     TWAI_Object::stats_t stats = dut.get_stats();
+     Serial.printf("DUT RX: %u frames, %u filtered, %u dropped at the ring, ring peak %u\n",
+                   stats.counters.rx_frames, drops.filtered, drops.queue_full, stats.counters.queue_peak);
+     Serial.printf("DUT TX: %u frames, latency max %u us, arbitration lost %u, TEC %u\n",
+                   stats.counters.tx_frames, stats.counters.tx_latency_max_us,
+                   stats.arb_lost, stats.tx_error_counter);
+     Serial.printf("DUT TX completions: %u sent, %u failed, %u expired\n",
+                   tx_results[TWAI_TX_SUCCESS], tx_results[TWAI_TX_FAILED], tx_results[TWAI_TX_EXPIRED]);
+     Serial.print("DUT TX latency histogram (log2 us):");
+     for (int i = 0; i < TWAI_LATENCY_BUCKETS; ++i) Serial.printf(" %u", stats.counters.tx_latency_hist[i]);
+     Serial.println();
+
+     for (int i = 0; i < GENERATORS; ++i) {
+         TWAI_VirtualBus::node_stats_t node;
+         bus.get_node_stats(generator_node[i], node);
+         Serial.printf("Node %2d ID 0x%03X: sent %u, failed %u, pending peak %u, latency avg/max %u/%u us, bus-off %u\n",
+                       i, 0x100 + i * 8, node.tx_frames, node.tx_failed, node.tx_pending_peak,
+                       node.tx_latency_avg_us, node.tx_latency_max_us, node.bus_off_count);
+     }
+ }
+
+ /**
+  * @brief Nothing to do: the simulation runs once in setup()
+  */
+ void loop() {
+     delay(1000);
+ }
@@ -0,0 +1,412 @@
+// Host benchmark: one JSON object per line on stdout
+//   {"bench":"<name>","ops":N,"total_us":T,"ns_per_op":X,"ops_per_s":Y}
+// Usage: twai_bench [--quick] [filter]   (filter = substring of the bench name)
+// Scenario benches add their measurements as extra fields on the same line.
+//
+// Numbers come from the host CPU and the stub driver in host/stubs: they
+// compare variants and catch regressions, they are not ESP32 timings.
+#include "coro_flows.h"
+#include "host_hooks.h"
+#include "iso_tp_loopback.h"
+#include "TWAI_Dispatch.h"
+#include "TWAI_EventRing.h"
+#include "TWAI_FilterEngine.h"
+#include "TWAI_HwFilter.h"
+#include "TWAI_Object.h"
+#include "TWAI_TxQueue.h"
+#include "virtual_bus_scenario.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <thread>
+
+namespace {
+
+bool quick = false;
+const char* only = nullptr;
+
+// Escala el número de operaciones en la pasada rápida
+uint64_t ops(uint64_t full) { return quick ? (full / 50 ? full / 50 : 1) : full; }
+
+bool selected(const char* name) { return !only || std::strstr(name, only); }
+
+// extra: campos adicionales ya formateados (",\"clave\":valor...")
+void report(const char* name, uint64_t count, double total_us, const char* extra = "") {
+    double ns = count ? total_us * 1000.0 / double(count) : 0.0;
+    double per_s = total_us > 0 ? double(count) * 1e6 / total_us : 0.0;
+    std::printf("{\"bench\":\"%s\",\"ops\":%llu,\"total_us\":%.1f,\"ns_per_op\":%.2f,\"ops_per_s\":%.0f%s}\n",
+                name, (unsigned long long) count, total_us, ns, per_s, extra);
+    std::fflush(stdout);
+}
+
+double elapsed_us(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+/** @brief Time body(count) and report it as count operations */
+template <typename F>
+void run(const char* name, uint64_t count, F body) {
+    if (!selected(name)) return;
+    auto start = std::chrono::steady_clock::now();
+    body(count);
+    report(name, count, elapsed_us(start));
+}
+
+// Evita que el compilador descarte resultados
+volatile uint32_t sink;
+
+twai_message_t frame(uint32_t id, bool extended = false) {
+    twai_message_t msg = {};
+    msg.identifier = id;
+    msg.extd = extended;
+    msg.data_length_code = 8;
+    return msg;
+}
+
+// Reglas mezcladas: IDs sueltos, rangos estándar, intervalos y máscaras extendidas
+void load_rules(TWAI_FilterEngine& engine) {
+    for (uint32_t id = 0x100; id < 0x180; id += 4) engine.add_id(id, false);
+    engine.add_range(0x600, 0x6FF, false);
+    for (uint32_t i = 0; i < 8; ++i) engine.add_range(0x18DA0000 + i * 0x1000, 0x18DA00FF + i * 0x1000, true);
+    engine.add_mask(0x0CF00400, 0x1FFFFF00, true);
+    engine.finalize();
+}
+
+void bench_filter() {
+    static TWAI_FilterEngine engine;
+    load_rules(engine);
+    std::mt19937 rng(1);
+    static uint32_t ids[4096];
+    static bool ext[4096];
+    for (size_t i = 0; i < 4096; ++i) {
+        ext[i] = rng() & 1;
+        ids[i] = ext[i] ? (0x18DA0000 + (rng() & 0xFFFF)) : (rng() & 0x7FF);
+    }
+    run("filter_match_mixed", ops(20000000), [&](uint64_t n) {
+        uint32_t hits = 0;
+        for (uint64_t i = 0; i < n; ++i) hits += engine.matches(ids[i & 4095], ext[i & 4095]);
+        sink = hits;
+    });
+    // Coste por trama frente al número de filtros: bitmap O(1), intervalos O(log n)
+    static TWAI_FilterEngine scaled;
+    for (uint32_t rules : { 1u, 8u, 32u }) {
+        scaled.reset();
+        for (uint32_t i = 0; i < rules; ++i) {
+            scaled.add_id(0x100 + i * 8, false);
+            scaled.add_range(0x10000000 + i * 0x10000, 0x100000FF + i * 0x10000, true);
+        }
+        scaled.finalize();
+        char name[48];
+        std::snprintf(name, sizeof(name), "filter_match_%u_rules", rules);
+        run(name, ops(20000000), [&](uint64_t n) {
+            uint32_t hits = 0;
+            for (uint64_t i = 0; i < n; ++i) {
+                uint32_t k = uint32_t(i & 4095);
+                hits += scaled.matches(ext[k] ? 0x10000000 + ((ids[k] & 0xFFFF) << 8) : ids[k], ext[k]);
+            }
+            sink = hits;
+        });
+    }
+    run("hw_filter_synthesize", ops(20000), [&](uint64_t n) {
+        uint32_t acc = 0;
+        for (uint64_t i = 0; i < n; ++i) acc ^= TWAI_HwFilter::synthesize(engine).acceptance_code;
+        sink = acc;
+    });
+}
+
+void bench_dispatch() {
+    static TWAI_Dispatch dispatch;
+    static int dummy;
+    for (uint32_t i = 0; i < 16; ++i) dispatch.add(0x100 + i * 0x40, 0x11F + i * 0x40, false, false, 0, &dummy, nullptr);
+    dispatch.add(0x18DA0000, 0x18DAFFFF, false, true, 0, &dummy, nullptr);
+    std::mt19937 rng(2);
+    static uint32_t ids[4096];
+    for (size_t i = 0; i < 4096; ++i) ids[i] = rng() & 0x7FF;
+    run("dispatch_lookup_std", ops(20000000), [&](uint64_t n) {
+        uint32_t acc = 0;
+        for (uint64_t i = 0; i < n; ++i) acc |= dispatch.lookup(ids[i & 4095], false);
+        sink = acc;
+    });
+}
+
+void bench_tx_queue() {
+    static TWAI_TxQueue queue;
+    std::mt19937 rng(3);
+    static twai_message_t frames[256];
+    for (size_t i = 0; i < 256; ++i) frames[i] = frame(rng() & 0x7FF);
+    // Cola medio llena: cada operación es un push y un pop
+    run("txqueue_push_pop", ops(5000000), [&](uint64_t n) {
+        TWAI_TxQueue::entry_t e;
+        for (size_t i = 0; i < MAX_TX_PENDING / 2; ++i) queue.push(frames[i & 255], 0);
+        uint32_t acc = 0;
+        for (uint64_t i = 0; i < n; ++i) {
+            queue.push(frames[i & 255], i);
+            queue.pop(e);
+            acc += e.msg.identifier;
+        }
+        while (queue.pop(e)) {}
+        sink = acc;
+    });
+}
+
+void bench_event_ring() {
+    static TWAI_EventRing<TWAI_Object::can_event_packed_t, 256> ring;
+    run("event_ring_push_pop_batch16", ops(20000000), [&](uint64_t n) {
+        TWAI_Object::can_event_packed_t item = {}, out[16];
+        uint32_t acc = 0;
+        for (uint64_t i = 0; i < n; i += 16) {
+            for (uint32_t k = 0; k < 16; ++k) {
+                item.identifier = uint32_t(i + k);
+                ring.push(item);
+            }
+            size_t got = ring.pop_batch(out, 16);
+            acc += out[got - 1].identifier;
+        }
+        sink = acc;
+    });
+}
+
+// Camino de interrupción completo: FIFO del controlador falso, ISR, filtro y cola
+void bench_isr_path() {
+    {
+        TWAI_Object can;
+        can.begin();
+        QueueHandle_t queue = can.get_event_queue();
+        run("isr_path_queue_per_frame", ops(2000000), [&](uint64_t n) {
+            TWAI_Object::queue_event_t event;
+            for (uint64_t i = 0; i < n; ++i) {
+                host_twai_push_rx(0, frame(0x100 + (i & 0xFF)));
+                host_twai_raise_interrupt(0);
+                xQueueReceive(queue, &event, 0);
+            }
+        });
+        can.end();
+    }
+    {
+        TWAI_Object can;
+        can.enable_event_ring(true);
+        can.begin();
+        run("isr_path_ring_per_frame", ops(2000000), [&](uint64_t n) {
+            TWAI_Object::can_event_packed_t batch[16];
+            for (uint64_t i = 0; i < n; ++i) {
+                host_twai_push_rx(0, frame(0x100 + (i & 0xFF)));
+                host_twai_raise_interrupt(0);
+                if ((i & 15) == 15) can.receive_batch(batch, 16, 0);
+            }
+            can.receive_batch(batch, 16, 0);
+        });
+        can.end();
+    }
+}
+
+// Productor (ISR) y consumidor en hilos distintos: ráfagas de burst tramas,
+// una interrupción por trama, y espera hasta que el consumidor las vacía,
+// como una tarea que va al ritmo del bus. Cola FreeRTOS frente a anillo + lote.
+void rx_consumer_run(const char* name, bool use_ring, uint32_t burst, uint64_t frames) {
+    if (!selected(name)) return;
+    TWAI_Object can;
+    can.enable_event_ring(use_ring);
+    can.begin();
+    std::atomic<uint64_t> consumed{0};
+    std::thread consumer([&] {
+        TWAI_Object::queue_event_t event;
+        TWAI_Object::can_event_packed_t batch[TWAI_EVENT_RING_SIZE];
+        while (consumed.load(std::memory_order_relaxed) < frames) {
+            if (use_ring) {
+                consumed.fetch_add(can.receive_batch(batch, TWAI_EVENT_RING_SIZE, pdMS_TO_TICKS(10)));
+            } else if (xQueueReceive(can.get_event_queue(), &event, pdMS_TO_TICKS(10)) == pdTRUE) {
+                consumed.fetch_add(1);
+            }
+        }
+    });
+    run(name, frames, [&](uint64_t n) {
+        for (uint64_t sent = 0; sent < n;) {
+            for (uint32_t k = 0; k < burst && sent < n; ++k, ++sent) {
+                host_twai_push_rx(0, frame(0x100 + (sent & 0xFF)));
+                host_twai_raise_interrupt(0);
+            }
+            while (consumed.load(std::memory_order_relaxed) < sent) std::this_thread::yield();
+        }
+    });
+    consumer.join();
+    can.end();
+}
+
+void bench_rx_consumer() {
+    // La cola tiene MAX_EVENT_QUEUE_ITEMS huecos; el anillo admite ráfagas mayores
+    rx_consumer_run("rx_consumer_queue_burst8", false, MAX_EVENT_QUEUE_ITEMS, ops(200000));
+    rx_consumer_run("rx_consumer_ring_burst8", true, MAX_EVENT_QUEUE_ITEMS, ops(200000));
+    rx_consumer_run("rx_consumer_ring_burst32", true, 32, ops(200000));
+}
+
+// Bus virtual de 30 nodos al ~90%: ops = tramas simuladas, más las medidas del DUT
+void bench_virtual_bus() {
+    const char* name = "virtual_bus_30_nodes_90pct";
+    if (!selected(name)) return;
+    uint64_t run_ms = quick ? 1000 : 10000;
+    auto start = std::chrono::steady_clock::now();
+    auto r = run_scenario<virtual_bus_scenario_t>(30, 8, run_ms);
+    double wall_us = elapsed_us(start);
+    TWAI_VirtualBus::bus_stats_t bus = r->bus.get_bus_stats();
+    char extra[512];
+    std::snprintf(extra, sizeof(extra),
+                  ",\"virtual_ms\":%llu,\"speedup\":%.0f,\"bus_load\":%.3f,\"error_frames\":%u"
+                  ",\"dut_rx\":%u,\"dut_filtered\":%u,\"dut_dropped\":%u,\"ring_peak\":%u"
+                  ",\"dut_tx\":%u,\"dut_tx_expired\":%u,\"dut_tx_latency_max_us\":%u"
+                  ",\"generator_latency_max_us\":%u",
+                  (unsigned long long) run_ms, run_ms * 1000.0 / wall_us, bus.load, bus.errors,
+                  r->stats.counters.rx_frames, r->drops.filtered, r->drops.queue_full, r->stats.counters.queue_peak,
+                  r->stats.counters.tx_frames, r->tx_results[TWAI_TX_EXPIRED], r->stats.counters.tx_latency_max_us,
+                  r->generator_latency_max_us);
+    report(name, bus.frames, wall_us, extra);
+}
+
+// ISO-TP sobre el bus virtual: ops = mensajes de 4095 bytes; bytes/s y latencias en tiempo virtual
+void iso_tp_run(const char* name, uint8_t block_size, uint8_t st_min) {
+    if (!selected(name)) return;
+    int transfers = quick ? 2 : 20;
+    auto start = std::chrono::steady_clock::now();
+    auto r = run_scenario<iso_tp_loopback_t>(transfers, block_size, st_min);
+    double wall_us = elapsed_us(start);
+    TWAI_IsoTp::stats_t tester = r->tester.get_stats(), ecu = r->ecu.get_stats();
+    char extra[384];
+    std::snprintf(extra, sizeof(extra),
+                  ",\"received\":%d,\"virtual_us\":%llu,\"bytes_per_s\":%.0f,\"latency_max_us\":%u"
+                  ",\"rx_latency_max_us\":%u,\"tx_aborted\":%u,\"rx_aborted\":%u,\"bus_load\":%.3f",
+                  r->received, (unsigned long long) r->virtual_us, r->bytes_per_s(), r->latency_max_us,
+                  ecu.rx_latency_max_us, tester.tx_aborted, ecu.rx_aborted, r->bus.get_bus_stats().load);
+    report(name, uint64_t(transfers), wall_us, extra);
+}
+
+void bench_iso_tp() {
+    iso_tp_run("iso_tp_loopback_bs0", 0, 0);
+    iso_tp_run("iso_tp_loopback_bs8", 8, 0);
+    iso_tp_run("iso_tp_loopback_bs8_stmin1ms", 8, 1);
+}
+
+// Flujos petición/respuesta como corrutinas: RAM por flujo (marco + dos huecos de espera)
+// y latencia de reanudación; ops = corrutinas reanudadas
+void bench_coro_flows() {
+    const char* name = "coro_flows_100";
+    if (!selected(name)) return;
+    auto start = std::chrono::steady_clock::now();
+    auto r = run_scenario<coro_flows_t>(100, quick ? 3 : 20);
+    double wall_us = elapsed_us(start);
+    char extra[384];
+    std::snprintf(extra, sizeof(extra),
+                  ",\"flows\":%d,\"completed\":%d,\"timed_out\":%d,\"ram_per_flow\":%u,\"frame_bytes\":%u"
+                  ",\"wait_slot_bytes\":%u,\"resume_avg_us\":%u,\"resume_max_us\":%u",
+                  r->flows, r->completed, r->timed_out, r->ram_per_flow(), r->frame_bytes_per_flow,
+                  uint32_t(TWAI_CoExecutor::wait_slot_bytes()), r->stats.resume_latency_avg_us,
+                  r->stats.resume_latency_max_us);
+    report(name, r->stats.resumes, wall_us, extra);
+}
+
+// Referencia: una tarea por flujo bloqueada en su cola, como can_receive_task
+constexpr int TASK_FLOWS = 8;
+constexpr uint32_t TASK_STACK = 4096;
+constexpr UBaseType_t TASK_QUEUE_LEN = 4;
+
+struct task_flows_t {
+    QueueHandle_t queues[TASK_FLOWS];
+    std::atomic<int64_t> sent_us[TASK_FLOWS];
+    std::atomic<uint64_t> latency_total{0};
+    std::atomic<uint32_t> latency_max{0};
+    std::atomic<int> wakes{0};
+    int rounds = 0;
+};
+
+task_flows_t* task_flows = nullptr;
+
+void flow_task(void* arg) {
+    int index = int(intptr_t(arg));
+    task_flows_t& t = *task_flows;
+    TWAI_Object::can_event_t event;
+    for (int round = 0; round < t.rounds; ++round) {
+        if (xQueueReceive(t.queues[index], &event, portMAX_DELAY) != pdTRUE) continue;
+        uint32_t latency = uint32_t(esp_timer_get_time() - t.sent_us[index].load());
+        t.latency_total.fetch_add(latency);
+        uint32_t max = t.latency_max.load();
+        while (latency > max && !t.latency_max.compare_exchange_weak(max, latency)) {}
+        t.wakes.fetch_add(1);
+    }
+    vTaskDelete(nullptr);
+}
+
+void bench_task_flows() {
+    const char* name = "task_per_flow_8";
+    if (!selected(name)) return;
+    std::unique_ptr<task_flows_t> owner(new task_flows_t());
+    task_flows = owner.get();
+    task_flows_t& t = *owner;
+    t.rounds = quick ? 3 : 20;
+    for (int i = 0; i < TASK_FLOWS; ++i) {
+        t.queues[i] = xQueueCreate(TASK_QUEUE_LEN, sizeof(TWAI_Object::can_event_t));
+        xTaskCreate(flow_task, "FLOW", TASK_STACK, (void*) intptr_t(i), tskIDLE_PRIORITY + 5, nullptr);
+    }
+    vTaskDelay(pdMS_TO_TICKS(10));
+
+    auto start = std::chrono::steady_clock::now();
+    TWAI_Object::can_event_t event = {};
+    for (int round = 0; round < t.rounds; ++round) {
+        for (int i = 0; i < TASK_FLOWS; ++i) {
+            t.sent_us[i].store(esp_timer_get_time());
+            xQueueSend(t.queues[i], &event, portMAX_DELAY);
+        }
+        vTaskDelay(pdMS_TO_TICKS(5));
+    }
+    while (t.wakes.load() < TASK_FLOWS * t.rounds) vTaskDelay(1);
+    double wall_us = elapsed_us(start);
+    vTaskDelay(pdMS_TO_TICKS(10));      // Las tareas terminan antes de borrar las colas
+    for (int i = 0; i < TASK_FLOWS; ++i) vQueueDelete(t.queues[i]);
+
+    // Pila y almacenamiento de la cola; TCB y bloque de control no incluidos
+    uint32_t ram = TASK_STACK + TASK_QUEUE_LEN * sizeof(TWAI_Object::can_event_t);
+    uint32_t wakes = uint32_t(t.wakes.load());
+    char extra[256];
+    std::snprintf(extra, sizeof(extra), ",\"flows\":%d,\"ram_per_flow\":%u,\"resume_avg_us\":%u,\"resume_max_us\":%u",
+                  TASK_FLOWS, ram, uint32_t(t.latency_total.load() / wakes), t.latency_max.load());
+    report(name, wakes, wall_us, extra);
+    task_flows = nullptr;
+}
+
+// Recompilar filtros y reprogramar el controlador (reinstala el driver falso)
+void bench_apply_filters() {
+    TWAI_Object can;
+    can.begin();
+    static TWAI_Object::twai_user_filter_t filters[MAX_USER_FILTERS];
+    for (uint8_t i = 0; i < MAX_USER_FILTERS; ++i) {
+        filters[i] = { 0x100u + i * 0x10u, 0x100u + i * 0x10u + 3, TWAI_Object::TWAI_FILTER_TYPE_RANGE, false };
+    }
+    run("apply_hardware_filters", ops(20000), [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            filters[0].mask_or_end_id = 0x103 + (i & 7);    // Plan distinto en cada vuelta
+            can.set_filters(filters, MAX_USER_FILTERS);
+        }
+    });
+    can.end();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--quick")) quick = true;
+        else only = argv[i];
+    }
+    bench_filter();
+    bench_dispatch();
+    bench_tx_queue();
+    bench_event_ring();
+    bench_isr_path();
+    bench_rx_consumer();
+    bench_apply_filters();
+    bench_virtual_bus();
+    bench_iso_tp();
+    bench_coro_flows();
+    bench_task_flows();
+    return 0;
+}
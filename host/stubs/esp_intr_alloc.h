@@ -0,0 +1,19 @@
+#pragma once
+// Host build: interrupt sources are raised by the test through host_hooks.h
+#include "esp_err.h"
+
+#define ETS_TWAI_INTR_SOURCE    0
+#define ETS_TWAI0_INTR_SOURCE   0
+#define ETS_TWAI1_INTR_SOURCE   1
+#define ETS_TWAI2_INTR_SOURCE   2
+
+#define ESP_INTR_FLAG_LEVEL1    (1 << 1)
+#define ESP_INTR_FLAG_IRAM      (1 << 10)
+
+typedef void (*intr_handler_t)(void* arg);
+typedef struct host_intr* intr_handle_t;
+
+esp_err_t esp_intr_alloc(int source, int flags, intr_handler_t handler, void* arg, intr_handle_t* ret_handle);
+esp_err_t esp_intr_free(intr_handle_t handle);
+esp_err_t esp_intr_enable(intr_handle_t handle);
+esp_err_t esp_intr_disable(intr_handle_t handle);
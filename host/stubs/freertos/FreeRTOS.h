@@ -0,0 +1,66 @@
+#pragma once
+// Host build: FreeRTOS types and critical sections; tasks are std::threads (host_fakes.cpp)
+#include <stddef.h>
+#include <stdint.h>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint8_t StackType_t;
+
+#define pdFALSE             ((BaseType_t) 0)
+#define pdTRUE              ((BaseType_t) 1)
+#define pdPASS              (pdTRUE)
+#define pdFAIL              (pdFALSE)
+#define portMAX_DELAY       ((TickType_t) 0xFFFFFFFF)
+#define configTICK_RATE_HZ  1000
+#define portTICK_PERIOD_MS  ((TickType_t) 1000 / configTICK_RATE_HZ)
+#define pdMS_TO_TICKS(ms)   ((TickType_t) (((TickType_t) (ms) * (TickType_t) configTICK_RATE_HZ) / (TickType_t) 1000U))
+#define configSTACK_DEPTH_TYPE uint32_t
+#define tskNO_AFFINITY      ((BaseType_t) 0x7FFFFFFF)
+#define tskIDLE_PRIORITY    ((UBaseType_t) 0U)
+#define IRAM_ATTR
+
+/**
+ * Spinlock of the critical sections. Like the ESP32 port it is recursive
+ * for its owner, so an "ISR" raised from inside a task critical section
+ * on the same thread does not deadlock, while other threads (the other
+ * core) spin until it is released.
+ */
+typedef struct {
+    uint32_t owner;     ///< Owner thread tag (0 = free)
+    uint32_t count;     ///< Nesting depth of the owner
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED { 0, 0 }
+
+void vPortEnterCritical(portMUX_TYPE* mux);
+void vPortExitCritical(portMUX_TYPE* mux);
+void vPortYieldFromISR(void);
+void vPortYield(void);
+
+#define portENTER_CRITICAL(mux)         vPortEnterCritical(mux)
+#define portEXIT_CRITICAL(mux)          vPortExitCritical(mux)
+#define portENTER_CRITICAL_ISR(mux)     vPortEnterCritical(mux)
+#define portEXIT_CRITICAL_ISR(mux)      vPortExitCritical(mux)
+#define portENTER_CRITICAL_SAFE(mux)    vPortEnterCritical(mux)
+#define portEXIT_CRITICAL_SAFE(mux)     vPortExitCritical(mux)
+#define portYIELD_FROM_ISR()            vPortYieldFromISR()
+#define taskYIELD()                     vPortYield()
+
+typedef struct tskTaskControlBlock* TaskHandle_t;
+typedef void (*TaskFunction_t)(void* arg);
+
+/** Storage of a static queue (the host queue lives on the heap) */
+typedef struct {
+    void* queue;
+} StaticQueue_t;
+
+/** Storage of a static task (the host task lives on the heap) */
+typedef struct {
+    void* task;
+} StaticTask_t;
+
+BaseType_t xPortGetCoreID(void);
+
+#include "freertos/task.h"
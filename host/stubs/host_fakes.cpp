@@ -0,0 +1,846 @@
+// Host build: ESP-IDF and FreeRTOS services on std::thread, for tests and benchmarks
+#include "host_hooks.h"
+#include <esp_intr_alloc.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+#include <soc/soc_caps.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+const clock_type::time_point start_time = clock_type::now();
+
+// Lanzada en el punto de bloqueo de una tarea borrada
+struct task_deleted {};
+
+thread_local bool in_isr = false;
+
+}  // namespace
+
+// ---------------------------------------------------------------- Tareas
+
+struct tskTaskControlBlock {
+    std::mutex lock;
+    std::condition_variable cv;
+    uint32_t notify = 0;
+    std::atomic<bool> deleted{false};
+    std::thread thread;
+};
+
+namespace {
+
+thread_local tskTaskControlBlock* current_task = nullptr;
+thread_local std::unique_ptr<tskTaskControlBlock> adopted_task;
+
+tskTaskControlBlock* self_task() {
+    if (!current_task) {
+        // Hilo no creado con xTaskCreate (main, hilos de prueba)
+        adopted_task.reset(new tskTaskControlBlock);
+        current_task = adopted_task.get();
+    }
+    return current_task;
+}
+
+void check_deleted() {
+    if (current_task && current_task->deleted.load(std::memory_order_acquire)) throw task_deleted();
+}
+
+// Esperar a pred() como mucho ticks; una tarea borrada sale de aquí
+template <typename Pred>
+bool block(std::unique_lock<std::mutex>& lock, std::condition_variable& cv, TickType_t ticks, Pred pred) {
+    const auto deadline = clock_type::now() + std::chrono::milliseconds(ticks);
+    while (!pred()) {
+        check_deleted();
+        if (ticks == 0 || in_isr) return false;
+        auto now = clock_type::now();
+        if (ticks != portMAX_DELAY && now >= deadline) return false;
+        auto wake = now + std::chrono::milliseconds(1);
+        cv.wait_until(lock, ticks != portMAX_DELAY && deadline < wake ? deadline : wake);
+    }
+    return true;
+}
+
+BaseType_t spawn(TaskFunction_t task, void* arg, TaskHandle_t* created_task) {
+    tskTaskControlBlock* tcb = new tskTaskControlBlock;
+    if (created_task) *created_task = tcb;
+    tcb->thread = std::thread([tcb, task, arg] {
+        current_task = tcb;
+        try {
+            task(arg);
+        } catch (const task_deleted&) {
+        }
+    });
+    return pdPASS;
+}
+
+}  // namespace
+
+BaseType_t xPortGetCoreID(void) { return 0; }
+
+BaseType_t xTaskCreate(TaskFunction_t task, const char*, configSTACK_DEPTH_TYPE, void* arg, UBaseType_t,
+                       TaskHandle_t* created_task) {
+    return spawn(task, arg, created_task);
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t task, const char*, configSTACK_DEPTH_TYPE, void* arg,
+                                   UBaseType_t, TaskHandle_t* created_task, BaseType_t) {
+    return spawn(task, arg, created_task);
+}
+
+TaskHandle_t xTaskCreateStaticPinnedToCore(TaskFunction_t task, const char*, uint32_t, void* arg, UBaseType_t,
+                                           StackType_t*, StaticTask_t* task_buffer, BaseType_t) {
+    TaskHandle_t handle = nullptr;
+    spawn(task, arg, &handle);
+    if (task_buffer) task_buffer->task = handle;
+    return handle;
+}
+
+void vTaskDelete(TaskHandle_t task) {
+    if (!task || task == current_task) throw task_deleted();
+    {
+        std::lock_guard<std::mutex> guard(task->lock);
+        task->deleted.store(true, std::memory_order_release);
+    }
+    task->cv.notify_all();
+    if (task->thread.joinable()) task->thread.join();
+    delete task;
+}
+
+void vTaskDelay(TickType_t ticks) {
+    tskTaskControlBlock* tcb = self_task();
+    if (ticks == 0) {
+        check_deleted();
+        std::this_thread::yield();
+        return;
+    }
+    std::unique_lock<std::mutex> lock(tcb->lock);
+    block(lock, tcb->cv, ticks, [] { return false; });
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void) { return self_task(); }
+
+TickType_t xTaskGetTickCount(void) {
+    return TickType_t(std::chrono::duration_cast<std::chrono::milliseconds>(clock_type::now() - start_time).count()
+                      / portTICK_PERIOD_MS);
+}
+
+TickType_t xTaskGetTickCountFromISR(void) { return xTaskGetTickCount(); }
+
+void xTaskNotifyGive(TaskHandle_t task) {
+    {
+        std::lock_guard<std::mutex> guard(task->lock);
+        ++task->notify;
+    }
+    task->cv.notify_all();
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t* higher_priority_task_woken) {
+    xTaskNotifyGive(task);
+    if (higher_priority_task_woken) *higher_priority_task_woken = pdTRUE;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks_to_wait) {
+    tskTaskControlBlock* tcb = self_task();
+    std::unique_lock<std::mutex> lock(tcb->lock);
+    block(lock, tcb->cv, ticks_to_wait, [tcb] { return tcb->notify > 0; });
+    uint32_t value = tcb->notify;
+    if (value) tcb->notify = clear_on_exit ? 0 : value - 1;
+    return value;
+}
+
+// ---------------------------------------------------- Secciones críticas
+
+namespace {
+
+uint32_t thread_tag() {
+    static std::atomic<uint32_t> next{1};
+    thread_local uint32_t tag = next.fetch_add(1);
+    return tag;
+}
+
+}  // namespace
+
+void vPortEnterCritical(portMUX_TYPE* mux) {
+    const uint32_t me = thread_tag();
+    if (__atomic_load_n(&mux->owner, __ATOMIC_RELAXED) == me) {
+        ++mux->count;
+        return;
+    }
+    uint32_t expected = 0;
+    while (!__atomic_compare_exchange_n(&mux->owner, &expected, me, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        expected = 0;
+        std::this_thread::yield();
+    }
+    mux->count = 1;
+}
+
+void vPortExitCritical(portMUX_TYPE* mux) {
+    if (--mux->count == 0) __atomic_store_n(&mux->owner, 0, __ATOMIC_RELEASE);
+}
+
+void vPortYieldFromISR(void) {}
+
+void vPortYield(void) { std::this_thread::yield(); }
+
+// ----------------------------------------------------------------- Colas
+
+struct QueueDefinition {
+    std::mutex lock;
+    std::condition_variable cv;
+    uint8_t* storage;
+    bool owns_storage;
+    size_t length;
+    size_t item_size;
+    size_t head = 0;
+    size_t count = 0;
+};
+
+QueueHandle_t xQueueCreateStatic(UBaseType_t length, UBaseType_t item_size, uint8_t* storage,
+                                 StaticQueue_t* queue_buffer) {
+    if (length == 0 || item_size == 0) return nullptr;
+    QueueDefinition* queue = new QueueDefinition;
+    queue->owns_storage = storage == nullptr;
+    queue->storage = storage ? storage : new uint8_t[length * item_size];
+    queue->length = length;
+    queue->item_size = item_size;
+    if (queue_buffer) queue_buffer->queue = queue;
+    return queue;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size) {
+    return xQueueCreateStatic(length, item_size, nullptr, nullptr);
+}
+
+void vQueueDelete(QueueHandle_t queue) {
+    if (!queue) return;
+    if (queue->owns_storage) delete[] queue->storage;
+    delete queue;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t ticks_to_wait) {
+    std::unique_lock<std::mutex> lock(queue->lock);
+    if (!block(lock, queue->cv, ticks_to_wait, [queue] { return queue->count < queue->length; })) return pdFALSE;
+    size_t tail = (queue->head + queue->count) % queue->length;
+    memcpy(queue->storage + tail * queue->item_size, item, queue->item_size);
+    ++queue->count;
+    queue->cv.notify_all();
+    return pdTRUE;
+}
+
+BaseType_t xQueueSendToBack(QueueHandle_t queue, const void* item, TickType_t ticks_to_wait) {
+    return xQueueSend(queue, item, ticks_to_wait);
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t queue, const void* item, BaseType_t* higher_priority_task_woken) {
+    BaseType_t sent = xQueueSend(queue, item, 0);
+    if (sent && higher_priority_task_woken) *higher_priority_task_woken = pdTRUE;
+    return sent;
+}
+
+BaseType_t xQueueOverwrite(QueueHandle_t queue, const void* item) {
+    std::lock_guard<std::mutex> guard(queue->lock);
+    queue->head = 0;
+    queue->count = 1;
+    memcpy(queue->storage, item, queue->item_size);
+    queue->cv.notify_all();
+    return pdTRUE;
+}
+
+namespace {
+
+BaseType_t queue_take(QueueHandle_t queue, void* buffer, TickType_t ticks_to_wait, bool remove) {
+    std::unique_lock<std::mutex> lock(queue->lock);
+    if (!block(lock, queue->cv, ticks_to_wait, [queue] { return queue->count > 0; })) return pdFALSE;
+    memcpy(buffer, queue->storage + queue->head * queue->item_size, queue->item_size);
+    if (remove) {
+        queue->head = (queue->head + 1) % queue->length;
+        --queue->count;
+        queue->cv.notify_all();
+    }
+    return pdTRUE;
+}
+
+}  // namespace
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void* buffer, TickType_t ticks_to_wait) {
+    return queue_take(queue, buffer, ticks_to_wait, true);
+}
+
+BaseType_t xQueueReceiveFromISR(QueueHandle_t queue, void* buffer, BaseType_t*) {
+    return queue_take(queue, buffer, 0, true);
+}
+
+BaseType_t xQueuePeek(QueueHandle_t queue, void* buffer, TickType_t ticks_to_wait) {
+    return queue_take(queue, buffer, ticks_to_wait, false);
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+    std::lock_guard<std::mutex> guard(queue->lock);
+    return UBaseType_t(queue->count);
+}
+
+UBaseType_t uxQueueMessagesWaitingFromISR(QueueHandle_t queue) { return uxQueueMessagesWaiting(queue); }
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t queue) {
+    std::lock_guard<std::mutex> guard(queue->lock);
+    return UBaseType_t(queue->length - queue->count);
+}
+
+BaseType_t xQueueReset(QueueHandle_t queue) {
+    std::lock_guard<std::mutex> guard(queue->lock);
+    queue->head = queue->count = 0;
+    queue->cv.notify_all();
+    return pdPASS;
+}
+
+// ------------------------------------------------------------- esp_timer
+
+struct esp_timer {
+    esp_timer_cb_t callback;
+    void* arg;
+    int64_t due_us = -1;        // -1 = parado
+    uint64_t period_us = 0;
+};
+
+namespace {
+
+// Hilo único de despacho, como la tarea de esp_timer
+struct timer_service_t {
+    std::mutex lock;
+    std::condition_variable cv;
+    std::vector<esp_timer*> timers;
+    bool started = false;
+
+    void run() {
+        std::unique_lock<std::mutex> guard(lock);
+        while (true) {
+            esp_timer* next = nullptr;
+            for (esp_timer* t : timers) {
+                if (t->due_us >= 0 && (!next || t->due_us < next->due_us)) next = t;
+            }
+            if (!next) {
+                cv.wait(guard);
+                continue;
+            }
+            int64_t now = esp_timer_get_time();
+            if (next->due_us > now) {
+                cv.wait_for(guard, std::chrono::microseconds(next->due_us - now));
+                continue;
+            }
+            next->due_us = next->period_us ? next->due_us + int64_t(next->period_us) : -1;
+            esp_timer_cb_t callback = next->callback;
+            void* arg = next->arg;
+            guard.unlock();
+            callback(arg);
+            guard.lock();
+        }
+    }
+};
+
+timer_service_t& timer_service() {
+    // Nunca se destruye: el hilo sigue vivo hasta el final del proceso
+    static timer_service_t* service = new timer_service_t;
+    return *service;
+}
+
+esp_err_t timer_start(esp_timer_handle_t timer, uint64_t delay_us, uint64_t period_us) {
+    timer_service_t& service = timer_service();
+    std::lock_guard<std::mutex> guard(service.lock);
+    if (timer->due_us >= 0) return ESP_ERR_INVALID_STATE;
+    timer->due_us = esp_timer_get_time() + int64_t(delay_us);
+    timer->period_us = period_us;
+    service.cv.notify_all();
+    return ESP_OK;
+}
+
+}  // namespace
+
+int64_t esp_timer_get_time(void) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(clock_type::now() - start_time).count();
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t* create_args, esp_timer_handle_t* out_handle) {
+    if (!create_args || !create_args->callback || !out_handle) return ESP_ERR_INVALID_ARG;
+    timer_service_t& service = timer_service();
+    std::lock_guard<std::mutex> guard(service.lock);
+    if (!service.started) {
+        std::thread([&service] { service.run(); }).detach();
+        service.started = true;
+    }
+    esp_timer* timer = new esp_timer;
+    timer->callback = create_args->callback;
+    timer->arg = create_args->arg;
+    service.timers.push_back(timer);
+    *out_handle = timer;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us) {
+    return timer_start(timer, timeout_us, 0);
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period) {
+    return timer_start(timer, period, period);
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+    timer_service_t& service = timer_service();
+    std::lock_guard<std::mutex> guard(service.lock);
+    if (timer->due_us < 0) return ESP_ERR_INVALID_STATE;
+    timer->due_us = -1;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer) {
+    if (!timer) return ESP_ERR_INVALID_ARG;
+    timer_service_t& service = timer_service();
+    std::lock_guard<std::mutex> guard(service.lock);
+    if (timer->due_us >= 0) return ESP_ERR_INVALID_STATE;
+    service.timers.erase(std::remove(service.timers.begin(), service.timers.end(), timer), service.timers.end());
+    delete timer;
+    return ESP_OK;
+}
+
+bool esp_timer_is_active(esp_timer_handle_t timer) {
+    timer_service_t& service = timer_service();
+    std::lock_guard<std::mutex> guard(service.lock);
+    return timer->due_us >= 0;
+}
+
+// ------------------------------------------------------------ Interrupciones
+
+struct host_intr {
+    std::recursive_mutex lock;      // Una ejecución del manejador a la vez por fuente
+    intr_handler_t handler;
+    void* arg;
+    bool enabled;
+};
+
+namespace {
+
+constexpr int INTR_SOURCES = 8;
+std::mutex intr_table_lock;
+host_intr* intr_table[INTR_SOURCES] = {};
+
+}  // namespace
+
+esp_err_t esp_intr_alloc(int source, int, intr_handler_t handler, void* arg, intr_handle_t* ret_handle) {
+    if (source < 0 || source >= INTR_SOURCES || !handler) return ESP_ERR_INVALID_ARG;
+    std::lock_guard<std::mutex> guard(intr_table_lock);
+    if (intr_table[source]) return ESP_ERR_NOT_FOUND;
+    host_intr* intr = new host_intr;
+    intr->handler = handler;
+    intr->arg = arg;
+    intr->enabled = true;
+    intr_table[source] = intr;
+    if (ret_handle) *ret_handle = intr;
+    return ESP_OK;
+}
+
+esp_err_t esp_intr_free(intr_handle_t handle) {
+    if (!handle) return ESP_ERR_INVALID_ARG;
+    {
+        std::lock_guard<std::mutex> guard(intr_table_lock);
+        for (host_intr*& slot : intr_table) {
+            if (slot == handle) slot = nullptr;
+        }
+    }
+    // Esperar a que termine un manejador en curso
+    handle->lock.lock();
+    handle->lock.unlock();
+    delete handle;
+    return ESP_OK;
+}
+
+esp_err_t esp_intr_enable(intr_handle_t handle) {
+    if (!handle) return ESP_ERR_INVALID_ARG;
+    std::lock_guard<std::recursive_mutex> guard(handle->lock);
+    handle->enabled = true;
+    return ESP_OK;
+}
+
+esp_err_t esp_intr_disable(intr_handle_t handle) {
+    if (!handle) return ESP_ERR_INVALID_ARG;
+    std::lock_guard<std::recursive_mutex> guard(handle->lock);
+    handle->enabled = false;
+    return ESP_OK;
+}
+
+void host_raise_interrupt(int source) {
+    if (source < 0 || source >= INTR_SOURCES) return;
+    host_intr* intr;
+    {
+        std::lock_guard<std::mutex> guard(intr_table_lock);
+        intr = intr_table[source];
+        if (!intr) return;
+        intr->lock.lock();
+    }
+    if (intr->enabled) {
+        bool nested = in_isr;
+        in_isr = true;
+        intr->handler(intr->arg);
+        in_isr = nested;
+    }
+    intr->lock.unlock();
+}
+
+bool host_in_isr() { return in_isr; }
+
+// ------------------------------------------------------------------ GPIO
+
+namespace {
+
+std::atomic<int> gpio_levels[GPIO_NUM_MAX];
+std::atomic<uint32_t> gpio_isr_writes{0};
+
+bool valid_pin(gpio_num_t pin) { return pin >= 0 && pin < GPIO_NUM_MAX; }
+
+}  // namespace
+
+esp_err_t gpio_reset_pin(gpio_num_t gpio_num) {
+    if (!valid_pin(gpio_num)) return ESP_ERR_INVALID_ARG;
+    gpio_levels[gpio_num].store(0);
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_direction(gpio_num_t gpio_num, gpio_mode_t) {
+    return valid_pin(gpio_num) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t gpio_set_level(gpio_num_t gpio_num, uint32_t level) {
+    if (!valid_pin(gpio_num)) return ESP_ERR_INVALID_ARG;
+    if (in_isr) gpio_isr_writes.fetch_add(1);
+    gpio_levels[gpio_num].store(level ? 1 : 0);
+    return ESP_OK;
+}
+
+int gpio_get_level(gpio_num_t gpio_num) {
+    return valid_pin(gpio_num) ? gpio_levels[gpio_num].load() : 0;
+}
+
+esp_err_t gpio_set_pull_mode(gpio_num_t gpio_num, gpio_pull_mode_t) {
+    return valid_pin(gpio_num) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+int host_gpio_level(gpio_num_t pin) { return gpio_get_level(pin); }
+
+void host_gpio_drive(gpio_num_t pin, int level) {
+    if (valid_pin(pin)) gpio_levels[pin].store(level ? 1 : 0);
+}
+
+uint32_t host_gpio_isr_writes() { return gpio_isr_writes.load(); }
+
+// ------------------------------------------------------------- Driver TWAI
+
+struct twai_obj_t {
+    std::mutex lock;
+    std::condition_variable cv;
+    int controller = 0;
+    bool installed = false;
+    bool auto_tx = false;
+    uint32_t installs = 0;
+    twai_general_config_t general = {};
+    twai_filter_config_t filter = {};
+    twai_status_info_t status = {};
+    uint32_t alerts = 0;
+    std::deque<twai_message_t> rx;
+    std::deque<twai_message_t> tx;
+    std::deque<twai_message_t> bus;
+};
+
+namespace {
+
+twai_obj_t controllers[SOC_TWAI_CONTROLLER_NUM];
+
+twai_obj_t* controller_at(int controller) {
+    return controller >= 0 && controller < SOC_TWAI_CONTROLLER_NUM ? &controllers[controller] : nullptr;
+}
+
+// Filtro de aceptación sobre los bits de identificador (1 en la máscara = libre)
+bool filter_passes(const twai_filter_config_t& f, const twai_message_t& msg) {
+    const uint32_t care = ~f.acceptance_mask;
+    if (f.single_filter) {
+        uint32_t value = msg.extd ? (msg.identifier & TWAI_EXTD_ID_MASK) << 3 : (msg.identifier & TWAI_STD_ID_MASK) << 21;
+        uint32_t bits = msg.extd ? 0xFFFFFFF8 : 0xFFE00000;
+        return ((value ^ f.acceptance_code) & care & bits) == 0;
+    }
+    uint32_t value = msg.extd ? (msg.identifier >> 13) & 0xFFF0 : (msg.identifier << 5) & 0xFFE0;
+    uint32_t bits = msg.extd ? 0xFFF0 : 0xFFE0;
+    return ((value ^ (f.acceptance_code >> 16)) & (care >> 16) & bits) == 0 ||
+           ((value ^ f.acceptance_code) & care & bits) == 0;
+}
+
+void set_alerts(twai_obj_t& c, uint32_t alerts) {
+    c.alerts |= alerts;
+    c.cv.notify_all();
+}
+
+esp_err_t install(int controller, const twai_general_config_t* g_config, const twai_filter_config_t* f_config,
+                  twai_handle_t* ret_twai) {
+    twai_obj_t* c = controller_at(controller);
+    if (!c || !g_config || !f_config) return ESP_ERR_INVALID_ARG;
+    std::lock_guard<std::mutex> guard(c->lock);
+    if (c->installed) return ESP_ERR_INVALID_STATE;
+    c->controller = controller;
+    c->installed = true;
+    ++c->installs;
+    c->general = *g_config;
+    c->filter = *f_config;
+    c->status = {};
+    c->status.state = TWAI_STATE_STOPPED;
+    c->alerts = 0;
+    c->rx.clear();
+    c->tx.clear();
+    if (ret_twai) *ret_twai = c;
+    return ESP_OK;
+}
+
+}  // namespace
+
+esp_err_t twai_driver_install_v2(const twai_general_config_t* g_config, const twai_timing_config_t*,
+                                 const twai_filter_config_t* f_config, twai_handle_t* ret_twai) {
+    return install(g_config ? g_config->controller_id : -1, g_config, f_config, ret_twai);
+}
+
+esp_err_t twai_driver_uninstall_v2(twai_handle_t handle) {
+    if (!handle) return ESP_ERR_INVALID_STATE;
+    std::lock_guard<std::mutex> guard(handle->lock);
+    if (!handle->installed || handle->status.state == TWAI_STATE_RUNNING) return ESP_ERR_INVALID_STATE;
+    handle->installed = false;
+    handle->rx.clear();
+    handle->tx.clear();
+    return ESP_OK;
+}
+
+esp_err_t twai_start_v2(twai_handle_t handle) {
+    if (!handle) return ESP_ERR_INVALID_STATE;
+    std::lock_guard<std::mutex> guard(handle->lock);
+    if (!handle->installed || handle->status.state != TWAI_STATE_STOPPED) return ESP_ERR_INVALID_STATE;
+    handle->status.state = TWAI_STATE_RUNNING;
+    return ESP_OK;
+}
+
+esp_err_t twai_stop_v2(twai_handle_t handle) {
+    if (!handle) return ESP_ERR_INVALID_STATE;
+    std::lock_guard<std::mutex> guard(handle->lock);
+    if (!handle->installed || handle->status.state != TWAI_STATE_RUNNING) return ESP_ERR_INVALID_STATE;
+    handle->status.state = TWAI_STATE_STOPPED;
+    handle->tx.clear();     // Las tramas pendientes se descartan
+    return ESP_OK;
+}
+
+esp_err_t twai_transmit_v2(twai_handle_t handle, const twai_message_t* message, TickType_t ticks_to_wait) {
+    if (!handle || !message) return ESP_ERR_INVALID_ARG;
+    std::unique_lock<std::mutex> lock(handle->lock);
+    if (!handle->installed || handle->status.state != TWAI_STATE_RUNNING) return ESP_ERR_INVALID_STATE;
+    if (handle->auto_tx) {
+        handle->bus.push_back(*message);
+        set_alerts(*handle, TWAI_ALERT_TX_SUCCESS | TWAI_ALERT_TX_IDLE);
+        return ESP_OK;
+    }
+    // Búfer de transmisión del hardware más la cola del driver
+    const size_t capacity = handle->general.tx_queue_len + 1;
+    if (!block(lock, handle->cv, ticks_to_wait, [handle, capacity] { return handle->tx.size() < capacity; })) {
+        return handle->general.tx_queue_len ? ESP_ERR_TIMEOUT : ESP_FAIL;
+    }
+    handle->tx.push_back(*message);
+    return ESP_OK;
+}
+
+esp_err_t twai_receive_v2(twai_handle_t handle, twai_message_t* message, TickType_t ticks_to_wait) {
+    if (!handle || !message) return ESP_ERR_INVALID_ARG;
+    std::unique_lock<std::mutex> lock(handle->lock);
+    if (!handle->installed) return ESP_ERR_INVALID_STATE;
+    if (!block(lock, handle->cv, ticks_to_wait, [handle] { return !handle->rx.empty(); })) return ESP_ERR_TIMEOUT;
+    *message = handle->rx.front();
+    handle->rx.pop_front();
+    return ESP_OK;
+}
+
+esp_err_t twai_read_alerts_v2(twai_handle_t handle, uint32_t* alerts, TickType_t ticks_to_wait) {
+    if (!handle || !alerts) return ESP_ERR_INVALID_ARG;
+    std::unique_lock<std::mutex> lock(handle->lock);
+    if (!handle->installed) return ESP_ERR_INVALID_STATE;
+    bool raised = block(lock, handle->cv, ticks_to_wait,
+                        [handle] { return (handle->alerts & handle->general.alerts_enabled) != 0; });
+    *alerts = handle->alerts & handle->general.alerts_enabled;
+    handle->alerts = 0;
+    return raised ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
+esp_err_t twai_reconfigure_alerts_v2(twai_handle_t handle, uint32_t alerts_enabled, uint32_t* current_alerts) {
+    if (!handle) return ESP_ERR_INVALID_STATE;
+    std::lock_guard<std::mutex> guard(handle->lock);
+    if (current_alerts) *current_alerts = handle->alerts;
+    handle->general.alerts_enabled = alerts_enabled;
+    handle->alerts = 0;
+    return ESP_OK;
+}
+
+esp_err_t twai_initiate_recovery_v2(twai_handle_t handle) {
+    if (!handle) return ESP_ERR_INVALID_STATE;
+    std::lock_guard<std::mutex> guard(handle->lock);
+    if (!handle->installed || handle->status.state != TWAI_STATE_BUS_OFF) return ESP_ERR_INVALID_STATE;
+    handle->status.state = TWAI_STATE_RECOVERING;
+    return ESP_OK;
+}
+
+esp_err_t twai_get_status_info_v2(twai_handle_t handle, twai_status_info_t* status_info) {
+    if (!handle || !status_info) return ESP_ERR_INVALID_ARG;
+    std::lock_guard<std::mutex> guard(handle->lock);
+    if (!handle->installed) return ESP_ERR_INVALID_STATE;
+    *status_info = handle->status;
+    status_info->msgs_to_tx = uint32_t(handle->tx.size());
+    status_info->msgs_to_rx = uint32_t(handle->rx.size());
+    return ESP_OK;
+}
+
+esp_err_t twai_clear_transmit_queue_v2(twai_handle_t handle) {
+    if (!handle) return ESP_ERR_INVALID_STATE;
+    std::lock_guard<std::mutex> guard(handle->lock);
+    // La trama que ya está en el hardware no se retira
+    while (handle->tx.size() > 1) handle->tx.pop_back();
+    return ESP_OK;
+}
+
+// API clásica: controlador 0
+esp_err_t twai_driver_install(const twai_general_config_t* g_config, const twai_timing_config_t*,
+                              const twai_filter_config_t* f_config) {
+    return install(0, g_config, f_config, nullptr);
+}
+esp_err_t twai_driver_uninstall(void) { return twai_driver_uninstall_v2(&controllers[0]); }
+esp_err_t twai_start(void) { return twai_start_v2(&controllers[0]); }
+esp_err_t twai_stop(void) { return twai_stop_v2(&controllers[0]); }
+esp_err_t twai_transmit(const twai_message_t* message, TickType_t ticks_to_wait) {
+    return twai_transmit_v2(&controllers[0], message, ticks_to_wait);
+}
+esp_err_t twai_receive(twai_message_t* message, TickType_t ticks_to_wait) {
+    return twai_receive_v2(&controllers[0], message, ticks_to_wait);
+}
+esp_err_t twai_read_alerts(uint32_t* alerts, TickType_t ticks_to_wait) {
+    return twai_read_alerts_v2(&controllers[0], alerts, ticks_to_wait);
+}
+esp_err_t twai_reconfigure_alerts(uint32_t alerts_enabled, uint32_t* current_alerts) {
+    return twai_reconfigure_alerts_v2(&controllers[0], alerts_enabled, current_alerts);
+}
+esp_err_t twai_initiate_recovery(void) { return twai_initiate_recovery_v2(&controllers[0]); }
+esp_err_t twai_get_status_info(twai_status_info_t* status_info) {
+    return twai_get_status_info_v2(&controllers[0], status_info);
+}
+esp_err_t twai_clear_transmit_queue(void) { return twai_clear_transmit_queue_v2(&controllers[0]); }
+
+// ------------------------------------------------------- Ganchos de prueba
+
+bool host_twai_push_rx(int controller, const twai_message_t& msg) {
+    twai_obj_t* c = controller_at(controller);
+    if (!c) return false;
+    std::lock_guard<std::mutex> guard(c->lock);
+    if (!c->installed || c->status.state != TWAI_STATE_RUNNING || !filter_passes(c->filter, msg)) return false;
+    if (c->rx.size() >= c->general.rx_queue_len) {
+        ++c->status.rx_missed_count;
+        set_alerts(*c, TWAI_ALERT_RX_QUEUE_FULL);
+        return false;
+    }
+    c->rx.push_back(msg);
+    set_alerts(*c, TWAI_ALERT_RX_DATA);
+    return true;
+}
+
+void host_twai_raise_interrupt(int controller) {
+    host_raise_interrupt(ETS_TWAI0_INTR_SOURCE + controller);
+}
+
+bool host_twai_complete_tx(int controller, bool success) {
+    twai_obj_t* c = controller_at(controller);
+    if (!c) return false;
+    {
+        std::lock_guard<std::mutex> guard(c->lock);
+        if (c->tx.empty()) return false;
+        twai_message_t msg = c->tx.front();
+        c->tx.pop_front();
+        if (success) {
+            c->bus.push_back(msg);
+        } else {
+            ++c->status.tx_failed_count;
+        }
+        set_alerts(*c, (success ? TWAI_ALERT_TX_SUCCESS : TWAI_ALERT_TX_FAILED)
+                       | (c->tx.empty() ? TWAI_ALERT_TX_IDLE : 0));
+    }
+    host_twai_raise_interrupt(controller);
+    return true;
+}
+
+void host_twai_set_auto_tx(int controller, bool enable) {
+    twai_obj_t* c = controller_at(controller);
+    if (!c) return;
+    std::lock_guard<std::mutex> guard(c->lock);
+    c->auto_tx = enable;
+}
+
+bool host_twai_pop_bus(int controller, twai_message_t& msg) {
+    twai_obj_t* c = controller_at(controller);
+    if (!c) return false;
+    std::lock_guard<std::mutex> guard(c->lock);
+    if (c->bus.empty()) return false;
+    msg = c->bus.front();
+    c->bus.pop_front();
+    return true;
+}
+
+size_t host_twai_tx_pending(int controller) {
+    twai_obj_t* c = controller_at(controller);
+    if (!c) return 0;
+    std::lock_guard<std::mutex> guard(c->lock);
+    return c->tx.size();
+}
+
+void host_twai_set_state(int controller, twai_state_t state, uint32_t tec, uint32_t rec) {
+    twai_obj_t* c = controller_at(controller);
+    if (!c) return;
+    std::lock_guard<std::mutex> guard(c->lock);
+    twai_state_t previous = c->status.state;
+    c->status.state = state;
+    c->status.tx_error_counter = tec;
+    c->status.rx_error_counter = rec;
+    uint32_t alerts = 0;
+    if (state == TWAI_STATE_BUS_OFF) {
+        alerts |= TWAI_ALERT_BUS_OFF;
+        c->tx.clear();
+    } else if (previous == TWAI_STATE_RECOVERING && state == TWAI_STATE_STOPPED) {
+        alerts |= TWAI_ALERT_BUS_RECOVERED;
+    } else if (tec >= 128 || rec >= 128) {
+        alerts |= TWAI_ALERT_ERR_PASS;
+    } else if (tec >= 96 || rec >= 96) {
+        alerts |= TWAI_ALERT_ABOVE_ERR_WARN;
+    } else {
+        alerts |= TWAI_ALERT_ERR_ACTIVE;
+    }
+    set_alerts(*c, alerts);
+}
+
+twai_filter_config_t host_twai_filter(int controller) {
+    twai_obj_t* c = controller_at(controller);
+    if (!c) return {};
+    std::lock_guard<std::mutex> guard(c->lock);
+    return c->filter;
+}
+
+uint32_t host_twai_installs(int controller) {
+    twai_obj_t* c = controller_at(controller);
+    if (!c) return 0;
+    std::lock_guard<std::mutex> guard(c->lock);
+    return c->installs;
+}
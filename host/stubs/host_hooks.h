@@ -0,0 +1,60 @@
+#pragma once
+// Host build: test side of the fake controllers, interrupts and GPIOs (host_fakes.cpp)
+#include <driver/gpio.h>
+#include <driver/twai.h>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Put a frame in the RX FIFO of a controller
+ * @details The frame goes through the installed acceptance filter (single
+ * and dual filter, identifier bits only) like on the hardware. No
+ * interrupt is raised: call host_twai_raise_interrupt() afterwards.
+ * @return False if the controller is not running, the filter rejected
+ * the frame or the FIFO is full (counted as missed)
+ */
+bool host_twai_push_rx(int controller, const twai_message_t& msg);
+
+/** @brief Run the interrupt handler of a controller on the calling thread */
+void host_twai_raise_interrupt(int controller);
+
+/**
+ * @brief Finish the frame the controller is transmitting
+ * @details Moves it to the bus log on success, sets the TX alerts and
+ * raises the interrupt
+ * @return False if nothing was being transmitted
+ */
+bool host_twai_complete_tx(int controller, bool success);
+
+/** @brief Complete every transmission immediately, without interrupt */
+void host_twai_set_auto_tx(int controller, bool enable);
+
+/** @brief Take the oldest frame put on the bus by a controller */
+bool host_twai_pop_bus(int controller, twai_message_t& msg);
+
+/** @brief Frames waiting to be transmitted (including the one in progress) */
+size_t host_twai_tx_pending(int controller);
+
+/** @brief Force the controller state and error counters (sets the matching alerts) */
+void host_twai_set_state(int controller, twai_state_t state, uint32_t tec, uint32_t rec);
+
+/** @brief Filter passed to the last driver install */
+twai_filter_config_t host_twai_filter(int controller);
+
+/** @brief Number of driver installs since program start */
+uint32_t host_twai_installs(int controller);
+
+/** @brief Run the handler allocated for an interrupt source, if enabled */
+void host_raise_interrupt(int source);
+
+/** @brief True while the calling thread runs an interrupt handler */
+bool host_in_isr();
+
+/** @brief Current level of a pin (written or driven) */
+int host_gpio_level(gpio_num_t pin);
+
+/** @brief Drive an input pin from outside */
+void host_gpio_drive(gpio_num_t pin, int level);
+
+/** @brief gpio_set_level() calls made from interrupt handlers */
+uint32_t host_gpio_isr_writes();
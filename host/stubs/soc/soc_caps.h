@@ -0,0 +1,6 @@
+#pragma once
+// Host build: two controllers, like the ESP32-C6, so multi-controller paths are exercised
+
+#ifndef SOC_TWAI_CONTROLLER_NUM
+#define SOC_TWAI_CONTROLLER_NUM 2
+#endif
@@ -0,0 +1,89 @@
+#pragma once
+// Request/response flows of examples/TWAI_CoroBenchmark: N TWAI_CoTask
+// flows on one TWAI_CoExecutor against a responder node on the virtual bus.
+#include "TWAI_Coro.h"
+#include "virtual_bus_harness.h"
+
+struct coro_flows_t : virtual_bus_harness_t {
+    static constexpr int MAX_FLOWS = 100;
+    TWAI_Object dut;
+    TWAI_CoExecutor executor{dut};
+    int responder = -1;
+    int flows = 0;
+    int rounds = 0;
+    twai_message_t pending_replies[MAX_FLOWS];  ///< Replies sent on the next millisecond
+    int pending_count = 0;
+    int spawned = 0;                    ///< Flows accepted by the executor
+    int completed = 0;                  ///< Requests answered in time
+    int timed_out = 0;                  ///< Requests without a reply
+    int finished = 0;                   ///< Flows that returned
+    uint32_t frame_bytes_per_flow = 0;  ///< Coroutine frame with every flow alive
+    TWAI_CoExecutor::stats_t stats = {};    ///< Executor counters (resume latency: ready to resumed)
+
+    /** @brief Frame plus two wait slots (reply wait and send or sleep) */
+    uint32_t ram_per_flow() const { return frame_bytes_per_flow + 2 * uint32_t(TWAI_CoExecutor::wait_slot_bytes()); }
+
+    // Responder: la petición 0x600 + n se contesta con 0x700 + n
+    static void on_bus_frame(const twai_message_t& msg, uint64_t, void* context) {
+        coro_flows_t* f = static_cast<coro_flows_t*>(context);
+        if (msg.identifier < 0x600 || msg.identifier >= 0x600u + f->flows || f->pending_count >= MAX_FLOWS) return;
+        twai_message_t reply = msg;
+        reply.identifier = msg.identifier + 0x100;
+        f->pending_replies[f->pending_count++] = reply;
+    }
+
+    /** @brief One request/response conversation, reply wait armed before the request */
+    static TWAI_CoTask flow(coro_flows_t& f, int index) {
+        TWAI_Object::twai_user_filter_t reply_id = { uint32_t(0x700 + index), 0, TWAI_Object::TWAI_FILTER_TYPE_LIST, false };
+        twai_message_t request = {};
+        request.identifier = 0x600 + index;
+        request.data_length_code = 2;
+
+        co_await f.executor.sleep(pdMS_TO_TICKS(index / 2));   // Arranque escalonado
+        for (int round = 0; round < f.rounds; ++round) {
+            request.data[0] = uint8_t(round);
+            TWAI_CoReceive reply = f.dut.co_receive(reply_id, pdMS_TO_TICKS(50));
+            if (co_await f.dut.co_send(request) != TWAI_TX_SUCCESS) {
+                ++f.timed_out;
+                continue;
+            }
+            TWAI_CoExecutor::rx_result_t rx = co_await reply;
+            if (rx.received && rx.event.message.data[0] == uint8_t(round)) ++f.completed;
+            else ++f.timed_out;
+            co_await f.executor.sleep(pdMS_TO_TICKS(50 + index % 13));
+        }
+        ++f.finished;
+    }
+
+    /**
+     * @brief Run @p flow_count flows of @p round_count requests each
+     * @details The executor timeouts and sleeps follow the tick count, so the
+     * loop waits one real millisecond per virtual one
+     */
+    void run(int flow_count, int round_count, uint64_t limit_ms = 5000) {
+        flows = flow_count < MAX_FLOWS ? flow_count : MAX_FLOWS;
+        rounds = round_count;
+        responder = add_started_node(on_bus_frame, this);
+        dut.attach_virtual_bus(bus);
+        if (!dut.begin(GPIO_NUM_5, GPIO_NUM_4, 500000)) return;
+        TWAI_Object::twai_user_filter_t replies = { 0x700, uint32_t(0x700 + flows - 1), TWAI_Object::TWAI_FILTER_TYPE_RANGE, false };
+        executor.listen(replies);
+
+        uint32_t frame_bytes_before = TWAI_CoTask::frame_bytes();
+        for (int i = 0; i < flows; ++i) spawned += executor.spawn(flow(*this, i)) ? 1 : 0;
+        uint32_t frame_bytes = TWAI_CoTask::frame_bytes() - frame_bytes_before;
+        frame_bytes_per_flow = spawned ? frame_bytes / spawned : 0;
+
+        for (uint64_t ms = 1; ms <= limit_ms && finished < spawned; ++ms) {
+            bus.run_until(ms * 1000);
+            executor.run();
+            for (int i = 0; i < pending_count; ++i) bus.transmit(responder, pending_replies[i]);
+            pending_count = 0;
+            vTaskDelay(1);
+        }
+
+        stats = executor.get_stats();
+        executor.stop();
+        dut.end();
+    }
+};
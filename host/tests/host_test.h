@@ -0,0 +1,36 @@
+#pragma once
+// Host tests: minimal checks, every failure is printed and counted
+#include <cstdio>
+
+inline int host_test_failures = 0;
+
+#define CHECK(cond)                                                                     \
+    do {                                                                                \
+        if (!(cond)) {                                                                  \
+            std::printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond);        \
+            ++host_test_failures;                                                       \
+        }                                                                               \
+    } while (0)
+
+#define CHECK_EQ(a, b)                                                                  \
+    do {                                                                                \
+        long long va_ = (long long) (a), vb_ = (long long) (b);                         \
+        if (va_ != vb_) {                                                               \
+            std::printf("%s:%d: CHECK_EQ(%s, %s) failed: %lld != %lld\n",               \
+                        __FILE__, __LINE__, #a, #b, va_, vb_);                          \
+            ++host_test_failures;                                                       \
+        }                                                                               \
+    } while (0)
+
+#define RUN_TEST(test)                                                                  \
+    do {                                                                                \
+        int before_ = host_test_failures;                                               \
+        test();                                                                         \
+        std::printf("%s %s\n", host_test_failures == before_ ? "[ OK ]" : "[FAIL]", #test); \
+    } while (0)
+
+/** @brief Process exit code: 0 if every check passed */
+inline int host_test_result() {
+    if (host_test_failures) std::printf("%d check(s) failed\n", host_test_failures);
+    return host_test_failures ? 1 : 0;
+}
@@ -0,0 +1,92 @@
+// TWAI_BusLoad: the estimate of examples/TWAI_BusLoad against the load the virtual bus measures
+#include "host_test.h"
+#include "TWAI_Object.h"
+#include <cmath>
+#include <memory>
+
+namespace {
+
+constexpr int GENERATORS = 12;
+constexpr uint64_t RUN_MS = 10000;
+
+uint32_t rng = 12345;
+
+uint32_t next_random() {
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return rng;
+}
+
+// El nodo i envía cada (i + 1) ms; el último envía cada ms entre 4 y 5 s
+void run_generators(TWAI_VirtualBus& bus, const int* nodes, uint64_t now_ms) {
+    for (int i = 0; i < GENERATORS; ++i) {
+        uint32_t period = (now_ms >= 4000 && now_ms < 5000 && i == GENERATORS - 1) ? 1 : i + 1;
+        if (now_ms % period != 0) continue;
+        twai_message_t msg = {};
+        msg.identifier = 0x100 + i * 0x10;
+        msg.data_length_code = 1 + next_random() % 8;
+        for (int b = 0; b < msg.data_length_code; ++b) msg.data[b] = uint8_t(next_random());
+        bus.transmit(nodes[i], msg);
+    }
+}
+
+void test_estimate_matches_bus() {
+    std::unique_ptr<TWAI_VirtualBus> owner(new TWAI_VirtualBus(500000));
+    TWAI_VirtualBus& bus = *owner;
+    int nodes[GENERATORS];
+    for (int i = 0; i < GENERATORS; ++i) {
+        nodes[i] = bus.add_node(nullptr, nullptr, nullptr);
+        bus.start(nodes[i]);
+    }
+    TWAI_Object exact, worst;
+    exact.attach_virtual_bus(bus);
+    exact.enable_bus_load(TWAI_STUFFING_ACTUAL);
+    worst.attach_virtual_bus(bus);
+    worst.enable_bus_load(TWAI_STUFFING_WORST_CASE);
+    CHECK(exact.begin(GPIO_NUM_5, GPIO_NUM_4, 500000));
+    CHECK(worst.begin(GPIO_NUM_5, GPIO_NUM_4, 500000));
+
+    twai_message_t heartbeat = {};
+    heartbeat.identifier = 0x050;
+    heartbeat.data_length_code = 8;
+    TWAI_Object::can_event_packed_t events[32];
+    float max_error = 0, min_ratio = 10, max_ratio = 0, peak_bus = 0;
+    for (uint64_t ms = 1; ms <= RUN_MS; ++ms) {
+        run_generators(bus, nodes, ms);
+        if (ms % 10 == 0) exact.send(heartbeat, 0);
+        bus.run_until(ms * 1000);
+        while (exact.receive_batch(events, 32, 0) > 0) {}
+        while (worst.receive_batch(events, 32, 0) > 0) {}
+        if (ms % 1000 != 0) continue;
+
+        // Ventana de 1 s contra la carga del bus en ese mismo segundo
+        float reference = bus.get_bus_stats(true).load;
+        TWAI_BusLoad::load_t a = exact.get_bus_load();
+        TWAI_BusLoad::load_t w = worst.get_bus_load();
+        max_error = std::fmax(max_error, std::fabs(a.load_1s - reference));
+        min_ratio = std::fmin(min_ratio, w.load_1s / reference);
+        max_ratio = std::fmax(max_ratio, w.load_1s / reference);
+        peak_bus = std::fmax(peak_bus, reference);
+    }
+    CHECK(max_error <= 0.001f);
+    CHECK(min_ratio > 1.05f && max_ratio < 1.25f);
+
+    TWAI_BusLoad::load_t load = exact.get_bus_load();
+    CHECK(std::fabs(load.peak_load_slot - peak_bus) < 0.05f);
+
+    // El nodo 0 (cada ms) es el que más ancho de banda ocupa
+    TWAI_BusLoad::id_share_t ids[3];
+    CHECK(exact.get_bus_load_ids(ids, 3) == 3);
+    CHECK_EQ(ids[0].id, 0x100);
+    CHECK(ids[0].share > ids[1].share && ids[1].share >= ids[2].share);
+    exact.end();
+    worst.end();
+}
+
+}  // namespace
+
+int main() {
+    RUN_TEST(test_estimate_matches_bus);
+    return host_test_result();
+}
@@ -0,0 +1,30 @@
+// TWAI_CoExecutor: request/response coroutine flows on a virtual bus, RAM per flow
+#include "host_test.h"
+#include "coro_flows.h"
+
+namespace {
+
+void test_flows_complete() {
+    constexpr int FLOWS = 40, ROUNDS = 3;
+    uint32_t frames_before = TWAI_CoTask::frames();
+    auto r = run_scenario<coro_flows_t>(FLOWS, ROUNDS);
+    CHECK_EQ(r->finished, FLOWS);
+    CHECK_EQ(r->completed, FLOWS * ROUNDS);
+    CHECK_EQ(r->timed_out, 0);
+    CHECK_EQ(r->stats.waits_full, 0);
+    CHECK_EQ(r->stats.unclaimed, 0);
+    CHECK(r->stats.waits_peak >= uint32_t(FLOWS));
+    CHECK(r->stats.resumes >= uint32_t(FLOWS * ROUNDS * 3));
+    CHECK_EQ(TWAI_CoTask::frames(), frames_before);     // Cada flujo liberó su marco
+
+    // Un flujo cuesta su marco y dos huecos de espera, muy por debajo de una pila de tarea de 4 KB
+    CHECK(r->frame_bytes_per_flow > 0);
+    CHECK(r->ram_per_flow() < 1024);
+}
+
+}  // namespace
+
+int main() {
+    RUN_TEST(test_flows_complete);
+    return host_test_result();
+}
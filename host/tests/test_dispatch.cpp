@@ -0,0 +1,116 @@
+// TWAI_Dispatch: ID to subscriber slots for single IDs, ranges and masks
+#include "host_test.h"
+#include "TWAI_Dispatch.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace {
+
+int target;     // Dirección cualquiera como destino
+
+void test_standard_routes() {
+    TWAI_Dispatch dispatch;
+    CHECK(dispatch.empty());
+    int a = dispatch.add(0x100, 0x100, false, false, 1, &target, nullptr);
+    int b = dispatch.add(0x100, 0x1FF, false, false, 2, &target, nullptr);
+    int c = dispatch.add(0x120, 0x7F0, true, false, 3, &target, nullptr);   // 0x120..0x12F
+    CHECK(a >= 0 && b >= 0 && c >= 0);
+    CHECK(!dispatch.empty());
+    CHECK_EQ(dispatch.lookup(0x100, false), (1u << a) | (1u << b));
+    CHECK_EQ(dispatch.lookup(0x125, false), (1u << b) | (1u << c));
+    CHECK_EQ(dispatch.lookup(0x1FF, false), 1u << b);
+    CHECK_EQ(dispatch.lookup(0x200, false), 0);
+    CHECK_EQ(dispatch.lookup(0x100, true), 0);
+    CHECK_EQ(dispatch.entry(c).kind, 3);
+
+    CHECK(dispatch.remove(b));
+    CHECK(!dispatch.remove(b));
+    CHECK_EQ(dispatch.lookup(0x100, false), 1u << a);
+    CHECK_EQ(dispatch.lookup(0x150, false), 0);
+}
+
+void test_extended_routes() {
+    TWAI_Dispatch dispatch;
+    int exact = dispatch.add(0x18FF0001, 0x18FF0001, false, true, 1, &target, nullptr);
+    int range = dispatch.add(0x18FF0000, 0x18FF00FF, false, true, 2, &target, nullptr);
+    int wide = dispatch.add(0x00000005, 0x0000000F, true, true, 3, &target, nullptr);
+    CHECK(exact >= 0 && range >= 0);
+    CHECK_EQ(dispatch.lookup(0x18FF0001, true), (1u << exact) | (1u << range));
+    CHECK_EQ(dispatch.lookup(0x18FF0002, true), 1u << range);
+    CHECK_EQ(dispatch.lookup(0x18FF0100, true), 0);
+    if (wide >= 0) {
+        CHECK_EQ(dispatch.lookup(0x18FF0005, true), (1u << range) | (1u << wide));
+        CHECK_EQ(dispatch.lookup(0x12345675, true), 1u << wide);
+    }
+}
+
+void test_capacity() {
+    TWAI_Dispatch dispatch;
+    int handles[MAX_SUBSCRIPTIONS];
+    for (int i = 0; i < MAX_SUBSCRIPTIONS; ++i) {
+        handles[i] = dispatch.add(0x10 + i, 0x10 + i, false, false, 0, &target, nullptr);
+        CHECK(handles[i] >= 0);
+    }
+    CHECK_EQ(dispatch.add(0x400, 0x400, false, false, 0, &target, nullptr), -1);
+    for (int i = 0; i < MAX_SUBSCRIPTIONS; ++i) CHECK_EQ(dispatch.lookup(0x10 + i, false), 1u << handles[i]);
+    CHECK(dispatch.remove(handles[3]));
+    CHECK(dispatch.add(0x400, 0x400, false, false, 0, &target, nullptr) >= 0);
+}
+
+// Un lector tipo ISR frente a altas y bajas continuas: un hueco reutilizado
+// nunca se ve a medias y un suscriptor dado de baja ya no recibe nada
+void test_slot_reuse_under_reader() {
+    constexpr int ROUNDS = 3000;
+    static TWAI_Dispatch dispatch;
+    std::vector<std::atomic<int>> state(ROUNDS);    // 0 = sin usar, 1 = suscrito, 2 = dado de baja
+    int fixed = dispatch.add(0x000, 0x7FF, false, false, 0, &target, nullptr);   // Mantiene ocupado el hueco 0
+    CHECK(fixed == 0);
+    std::atomic<bool> done{false};
+    std::atomic<uint32_t> stale{0}, torn{0}, lookups{0};
+
+    std::thread reader([&] {
+        while (!done.load()) {
+            for (uint32_t id = 0x100; id < 0x108; ++id) {
+                TWAI_Dispatch::reader_t subscribers(dispatch);
+                uint32_t slots = subscribers.lookup(id, false) & ~1u;
+                while (slots) {
+                    uint8_t slot = __builtin_ctz(slots);
+                    slots &= slots - 1;
+                    const TWAI_Dispatch::entry_t& e = subscribers.entry(slot);
+                    std::atomic<int>* owner = static_cast<std::atomic<int>*>(e.context);
+                    long round = owner - state.data();
+                    if (round < 0 || round >= ROUNDS || 0x100 + round % 8 != id) torn.fetch_add(1);
+                    else if (owner->load() != 1) stale.fetch_add(1);
+                }
+                lookups.fetch_add(1);
+            }
+        }
+    });
+
+    // Cada ronda reutiliza el mismo hueco con otro ID y otro destino
+    for (int round = 0; round < ROUNDS; ++round) {
+        uint32_t id = 0x100 + round % 8;
+        state[round].store(1);
+        int handle = dispatch.add(id, id, false, false, 0, &target, &state[round]);
+        CHECK(handle == 1);
+        if (round % 4 == 0) std::this_thread::yield();
+        CHECK(dispatch.remove(handle));
+        state[round].store(2);
+    }
+    done.store(true);
+    reader.join();
+    CHECK_EQ(torn.load(), 0);
+    CHECK_EQ(stale.load(), 0);
+    CHECK(lookups.load() > 0);
+}
+
+}  // namespace
+
+int main() {
+    RUN_TEST(test_standard_routes);
+    RUN_TEST(test_extended_routes);
+    RUN_TEST(test_capacity);
+    RUN_TEST(test_slot_reuse_under_reader);
+    return host_test_result();
+}
@@ -0,0 +1,61 @@
+// TWAI_DoubleBuffer: readers never see the copy being rebuilt
+#include "host_test.h"
+#include "TWAI_DoubleBuffer.h"
+#include "TWAI_FilterEngine.h"
+#include <atomic>
+#include <thread>
+
+namespace {
+
+void test_publish_swaps() {
+    TWAI_DoubleBuffer<int> buffer;
+    buffer.back() = 7;
+    CHECK_EQ(buffer.front(), 0);
+    buffer.publish();
+    CHECK_EQ(buffer.front(), 7);
+    TWAI_DoubleBuffer<int>::reader_t reader(buffer);
+    CHECK_EQ(*reader, 7);
+}
+
+// Motor de filtros rotando entre tres conjuntos, como compile_software_filters():
+// dentro de una lectura se ve siempre el mismo conjunto, nunca la tabla a medio hacer
+void test_filter_engine_republish() {
+    static TWAI_DoubleBuffer<TWAI_FilterEngine> engines;
+    engines.back().add_id(0x100, false);
+    engines.back().finalize();
+    engines.publish();
+    std::atomic<bool> done{false};
+    std::atomic<uint32_t> torn{0}, reads{0};
+
+    std::thread reader([&] {
+        while (!done.load()) {
+            TWAI_DoubleBuffer<TWAI_FilterEngine>::reader_t engine(engines);
+            int seen = engine->matches(0x100, false) + 2 * engine->matches(0x200, false) + 4 * engine->matches(0x300, false);
+            std::this_thread::yield();  // Dar ocasión al escritor de publicar entretanto
+            int again = engine->matches(0x100, false) + 2 * engine->matches(0x200, false) + 4 * engine->matches(0x300, false);
+            if ((seen != 1 && seen != 2 && seen != 4) || again != seen) torn.fetch_add(1);
+            reads.fetch_add(1);
+        }
+    });
+    while (reads.load() == 0) std::this_thread::yield();
+    for (int round = 0; round < 2000; ++round) {
+        TWAI_FilterEngine& next = engines.back();
+        next.reset();
+        next.add_id(0x100 * (1 + round % 3), false);   // Tres conjuntos: no se repiten cada dos copias
+        next.finalize();
+        engines.publish();
+        if (round & 1) std::this_thread::yield();   // Dos publicaciones por turno del lector
+    }
+    done.store(true);
+    reader.join();
+    CHECK_EQ(torn.load(), 0);
+    CHECK(reads.load() > 0);
+}
+
+}  // namespace
+
+int main() {
+    RUN_TEST(test_publish_swaps);
+    RUN_TEST(test_filter_engine_republish);
+    return host_test_result();
+}
@@ -0,0 +1,77 @@
+// TWAI_EventRing: order, capacity, eviction and one producer/one consumer thread
+#include "host_test.h"
+#include "TWAI_EventRing.h"
+#include <thread>
+
+namespace {
+
+void test_fifo_order() {
+    TWAI_EventRing<uint32_t, 8> ring;
+    uint32_t out[8];
+    CHECK(ring.empty());
+    for (uint32_t i = 0; i < 8; ++i) CHECK(ring.push(i));
+    CHECK(!ring.push(99));
+    CHECK_EQ(ring.size(), 8);
+    CHECK_EQ(ring.pop_batch(out, 3), 3);
+    CHECK_EQ(out[0], 0);
+    CHECK_EQ(out[2], 2);
+    // Índices libres: dar varias vueltas al anillo
+    for (uint32_t round = 0; round < 100; ++round) {
+        CHECK(ring.push(100 + round));
+        CHECK_EQ(ring.pop_batch(out, 1), 1);
+    }
+    CHECK_EQ(ring.size(), 5);
+    CHECK_EQ(ring.pop_batch(out, 8), 5);
+    CHECK_EQ(out[4], 199);
+    CHECK_EQ(ring.pop_batch(out, 8), 0);
+}
+
+void test_evict_oldest() {
+    TWAI_EventRing<uint32_t, 4> ring;
+    uint32_t out[4];
+    CHECK(!ring.evict_oldest());
+    for (uint32_t i = 0; i < 4; ++i) ring.push(i);
+    CHECK(ring.evict_oldest());
+    CHECK(ring.push(4));
+    CHECK_EQ(ring.pop_batch(out, 4), 4);
+    CHECK_EQ(out[0], 1);
+    CHECK_EQ(out[3], 4);
+}
+
+void test_spsc_threads() {
+    // Productor con descarte del más antiguo, como el ISR con DROP_OLDEST
+    static TWAI_EventRing<uint32_t, 64> ring;
+    constexpr uint32_t ITEMS = 200000;
+    uint32_t evicted = 0;
+    std::thread producer([&] {
+        for (uint32_t i = 1; i <= ITEMS; ++i) {
+            while (!ring.push(i)) {
+                if (ring.evict_oldest()) ++evicted;
+            }
+        }
+    });
+
+    uint32_t received = 0, last = 0;
+    bool ordered = true;
+    uint32_t out[16];
+    while (last != ITEMS) {
+        size_t n = ring.pop_batch(out, 16);
+        for (size_t i = 0; i < n; ++i) {
+            if (out[i] <= last) ordered = false;
+            last = out[i];
+        }
+        received += n;
+    }
+    producer.join();
+    CHECK(ordered);
+    CHECK_EQ(received + evicted, ITEMS);
+}
+
+}  // namespace
+
+int main() {
+    RUN_TEST(test_fifo_order);
+    RUN_TEST(test_evict_oldest);
+    RUN_TEST(test_spsc_threads);
+    return host_test_result();
+}
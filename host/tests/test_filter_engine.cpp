@@ -0,0 +1,156 @@
+// TWAI_FilterEngine: list, range and mask rules on both ID formats
+#include "host_test.h"
+#include "TWAI_FilterEngine.h"
+#include <random>
+#include <vector>
+
+namespace {
+
+void test_accept_all() {
+    TWAI_FilterEngine engine;
+    engine.finalize();
+    CHECK(engine.accepts_all());
+    CHECK(engine.matches(0x123, false));
+    CHECK(engine.matches(0x1ABCDEF0, true));
+}
+
+void test_standard_rules() {
+    TWAI_FilterEngine engine;
+    CHECK(engine.add_id(0x100, false));
+    CHECK(engine.add_range(0x200, 0x20F, false));
+    CHECK(engine.add_mask(0x300, 0x7F0, false));   // 0x300..0x30F
+    engine.finalize();
+    CHECK(!engine.accepts_all());
+    CHECK(engine.matches(0x100, false));
+    CHECK(!engine.matches(0x101, false));
+    CHECK(engine.matches(0x200, false));
+    CHECK(engine.matches(0x20F, false));
+    CHECK(!engine.matches(0x210, false));
+    CHECK(engine.matches(0x30A, false));
+    CHECK(!engine.matches(0x310, false));
+    CHECK_EQ(engine.std_count(), 1 + 16 + 16);
+    // Un ID estándar no abre el mismo número extendido
+    CHECK(!engine.matches(0x100, true));
+}
+
+void test_extended_rules() {
+    TWAI_FilterEngine engine;
+    CHECK(engine.add_id(0x18FF0001, true));
+    CHECK(engine.add_range(0x100000, 0x1FFFFF, true));
+    CHECK(engine.add_range(0x180000, 0x2FFFFF, true));  // Solapado: se funde
+    CHECK(engine.add_mask(0x0CF00400, 0x1FFFFF00, true));
+    CHECK(engine.add_mask(0x00000005, 0x0000000F, true));  // Demasiado amplia para intervalos
+    engine.finalize();
+    size_t intervals;
+    engine.ext_intervals(intervals);
+    size_t masks;
+    engine.ext_masks(masks);
+    CHECK_EQ(masks, 1);
+    CHECK(engine.matches(0x18FF0001, true));
+    CHECK(!engine.matches(0x18FF0002, true));
+    CHECK(engine.matches(0x100000, true));
+    CHECK(engine.matches(0x2FFFFF, true));
+    CHECK(!engine.matches(0x300000, true));
+    CHECK(engine.matches(0x0CF004FE, true));
+    CHECK(!engine.matches(0x0CF00500, true));
+    CHECK(engine.matches(0x1ABCDEF5, true));
+    CHECK(!engine.matches(0x1ABCDEF6, true));
+    CHECK(!engine.matches(0x100, false));
+}
+
+void test_reset() {
+    TWAI_FilterEngine engine;
+    engine.add_id(0x10, false);
+    engine.finalize();
+    CHECK(!engine.matches(0x11, false));
+    engine.reset();
+    engine.finalize();
+    CHECK(engine.matches(0x11, false));
+}
+
+// Referencia: recorrer todas las reglas
+struct rule_t {
+    uint32_t a, b;
+    bool is_mask, extended;
+};
+
+bool reference_matches(const std::vector<rule_t>& rules, uint32_t id, bool extended) {
+    if (rules.empty()) return true;
+    for (const rule_t& r : rules) {
+        if (r.extended != extended) continue;
+        if (r.is_mask ? (id & r.b) == (r.a & r.b) : (id >= r.a && id <= r.b)) return true;
+    }
+    return false;
+}
+
+// Máscara con densidad de bits de cuidado variable y a veces bits libres bajos contiguos
+uint32_t random_mask(std::mt19937& rng, uint32_t width) {
+    uint32_t mask = 0;
+    uint32_t density = rng() % 4;
+    for (uint32_t bit = 0; bit < 32; ++bit) {
+        if (rng() % 4 >= density) mask |= 1u << bit;
+    }
+    if (rng() & 1) mask &= ~((1u << (rng() % 12)) - 1);
+    return mask & width;
+}
+
+void test_randomized_against_reference() {
+    std::mt19937 rng(12345);
+    static TWAI_FilterEngine engine;
+    for (int round = 0; round < 300; ++round) {
+        std::vector<rule_t> rules;
+        engine.reset();
+        bool ok = true;
+        // Rangos e IDs antes que máscaras: las máscaras caen a la lista si la tabla se llena
+        uint32_t count = rng() % 24;
+        for (uint32_t i = 0; i < count; ++i) {
+            bool extended = rng() & 1;
+            uint32_t width = extended ? TWAI_FilterEngine::EXT_ID_MASK : TWAI_FilterEngine::STD_ID_MASK;
+            uint32_t first = rng() & width;
+            uint32_t span = (rng() & 1) ? 0 : (rng() % (extended ? 0x100000 : 0x80));
+            uint32_t last = first + span > width ? width : first + span;
+            ok &= span ? engine.add_range(first, last, extended) : engine.add_id(first, extended);
+            rules.push_back({ first, last, false, extended });
+        }
+        uint32_t masks = rng() % 8;
+        for (uint32_t i = 0; i < masks; ++i) {
+            bool extended = rng() & 1;
+            uint32_t width = extended ? TWAI_FilterEngine::EXT_ID_MASK : TWAI_FilterEngine::STD_ID_MASK;
+            uint32_t code = rng() & width, mask = random_mask(rng, width);
+            ok &= engine.add_mask(code, mask, extended);
+            rules.push_back({ code, mask, true, extended });
+        }
+        engine.finalize();
+        CHECK(ok);
+
+        // Todo el espacio estándar
+        uint32_t std_errors = 0;
+        for (uint32_t id = 0; id <= TWAI_FilterEngine::STD_ID_MASK; ++id) {
+            std_errors += engine.matches(id, false) != reference_matches(rules, id, false);
+        }
+        CHECK_EQ(std_errors, 0);
+
+        // Extendidos: bordes de cada regla y IDs aleatorios
+        std::vector<uint32_t> probes;
+        for (const rule_t& r : rules) {
+            for (uint32_t id : { r.a - 1, r.a, r.a + 1, r.b - 1, r.b, r.b + 1, r.a ^ (1u << (rng() % 29)) }) {
+                probes.push_back(id & TWAI_FilterEngine::EXT_ID_MASK);
+            }
+        }
+        for (int i = 0; i < 2000; ++i) probes.push_back(rng() & TWAI_FilterEngine::EXT_ID_MASK);
+        uint32_t ext_errors = 0;
+        for (uint32_t id : probes) ext_errors += engine.matches(id, true) != reference_matches(rules, id, true);
+        CHECK_EQ(ext_errors, 0);
+    }
+}
+
+}  // namespace
+
+int main() {
+    RUN_TEST(test_accept_all);
+    RUN_TEST(test_standard_rules);
+    RUN_TEST(test_extended_rules);
+    RUN_TEST(test_reset);
+    RUN_TEST(test_randomized_against_reference);
+    return host_test_result();
+}
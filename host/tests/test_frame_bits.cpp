@@ -0,0 +1,102 @@
+// TWAI_FrameBits: stuffed frame length against a bit-level reference encoder
+#include "host_test.h"
+#include "TWAI_FrameBits.h"
+#include <cstdlib>
+#include <vector>
+
+namespace {
+
+// Codificador de referencia: construye la trama, calcula el CRC por
+// división polinómica e inserta de verdad los bits de relleno
+uint32_t reference_bits(const twai_message_t& msg) {
+    std::vector<int> bits;
+    auto put = [&bits](uint32_t value, int width) {
+        for (int i = width - 1; i >= 0; --i) bits.push_back((value >> i) & 1);
+    };
+    uint8_t dlc = msg.data_length_code & 0x0F;
+    uint8_t length = msg.rtr ? 0 : (dlc > 8 ? 8 : dlc);
+    put(0, 1);
+    if (msg.extd) {
+        put(msg.identifier >> 18, 11);
+        put(3, 2);
+        put(msg.identifier & 0x3FFFF, 18);
+        put(msg.rtr, 1);
+        put(0, 2);
+    } else {
+        put(msg.identifier, 11);
+        put(msg.rtr, 1);
+        put(0, 2);
+    }
+    put(dlc, 4);
+    for (int i = 0; i < length; ++i) put(msg.data[i], 8);
+
+    std::vector<int> dividend = bits;
+    dividend.resize(bits.size() + 15, 0);
+    const int poly[16] = { 1, 1, 0, 0, 0, 1, 0, 1, 1, 0, 0, 1, 1, 0, 0, 1 };   // x^15+x^14+x^10+x^8+x^7+x^4+x^3+1
+    for (size_t i = 0; i + 15 < dividend.size(); ++i) {
+        if (!dividend[i]) continue;
+        for (int j = 0; j < 16; ++j) dividend[i + j] ^= poly[j];
+    }
+    for (size_t i = bits.size(); i < dividend.size(); ++i) bits.push_back(dividend[i]);
+
+    std::vector<int> stuffed;
+    int run = 0, last = -1;
+    for (int b : bits) {
+        stuffed.push_back(b);
+        run = b == last ? run + 1 : 1;
+        last = b;
+        if (run == 5) {
+            stuffed.push_back(!b);
+            last = !b;
+            run = 1;
+        }
+    }
+    return uint32_t(stuffed.size()) + TWAI_FrameBits::FIXED_TAIL_BITS;
+}
+
+void test_unstuffed_minimum() {
+    // 0x555 alterna bits; la longitud sin relleno de 8 bytes es 108
+    twai_message_t msg = {};
+    msg.identifier = 0x555;
+    msg.data_length_code = 8;
+    for (int i = 0; i < 8; ++i) msg.data[i] = 0x55;
+    CHECK(TWAI_FrameBits::frame_bits(msg) >= 108);
+    CHECK_EQ(TWAI_FrameBits::frame_bits(msg), reference_bits(msg));
+}
+
+void test_random_frames() {
+    srand(3);
+    uint32_t mismatches = 0, over_max = 0;
+    for (int i = 0; i < 20000; ++i) {
+        twai_message_t msg = {};
+        msg.extd = rand() & 1;
+        msg.rtr = (rand() % 8) == 0;
+        msg.identifier = msg.extd ? uint32_t(rand()) & 0x1FFFFFFF : uint32_t(rand()) & 0x7FF;
+        msg.data_length_code = rand() % 9;
+        // Muchos ceros y unos seguidos para forzar relleno
+        for (int b = 0; b < 8; ++b) msg.data[b] = (rand() & 1) ? uint8_t(rand()) : (rand() & 1 ? 0x00 : 0xFF);
+        uint32_t bits = TWAI_FrameBits::frame_bits(msg);
+        if (bits != reference_bits(msg)) ++mismatches;
+        if (bits > TWAI_FrameBits::max_frame_bits(msg.extd, msg.rtr ? 0 : msg.data_length_code)) ++over_max;
+    }
+    CHECK_EQ(mismatches, 0);
+    CHECK_EQ(over_max, 0);
+}
+
+void test_frame_time() {
+    twai_message_t msg = {};
+    msg.identifier = 0x555;
+    msg.data_length_code = 0;
+    // Bits más intermisión a 500 kbit/s: 2 us por bit
+    CHECK_EQ(TWAI_FrameBits::frame_time_ns(msg, 500000),
+             (TWAI_FrameBits::frame_bits(msg) + TWAI_FrameBits::INTERMISSION_BITS) * 2000);
+}
+
+}  // namespace
+
+int main() {
+    RUN_TEST(test_unstuffed_minimum);
+    RUN_TEST(test_random_frames);
+    RUN_TEST(test_frame_time);
+    return host_test_result();
+}
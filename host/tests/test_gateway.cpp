@@ -0,0 +1,134 @@
+// TWAI_Gateway: the bridge of examples/TWAI_Gateway between two virtual segments
+#include "host_test.h"
+#include "TWAI_Gateway.h"
+#include <cstring>
+#include <memory>
+
+namespace {
+
+constexpr int GENERATORS_A = 4;         // 0x100 + 16 * i
+constexpr int GENERATORS_B = 3;         // 0x200 + 16 * i
+constexpr uint32_t PERIOD_MS = 2;
+constexpr uint32_t DIAG_PERIOD_MS = 5;
+constexpr uint32_t DIAG_LIMIT = 50;
+constexpr uint64_t RUN_MS = 4000;
+constexpr uint64_t STEP_US = 100;
+
+// Escucha de un segmento: tramas reenviadas que llegan al otro lado
+struct listener_t {
+    uint32_t cyclic = 0;        // 0x1xx en B
+    uint32_t diag = 0;          // 0x7DF en B
+    uint32_t rewritten = 0;     // 0x6xx en A
+    uint32_t other = 0;         // 0x2xx en A (reescritura fallida)
+};
+
+void listen(const twai_message_t& msg, uint64_t, void* context) {
+    listener_t* l = static_cast<listener_t*>(context);
+    uint32_t id = msg.identifier;
+    if (id == 0x7DF) ++l->diag;
+    else if ((id & 0x700) == 0x100) ++l->cyclic;
+    else if ((id & 0x700) == 0x600) ++l->rewritten;
+    else if ((id & 0x700) == 0x200) ++l->other;
+}
+
+void generate(TWAI_VirtualBus& bus, int node, uint32_t id, uint64_t ms) {
+    twai_message_t msg = {};
+    msg.identifier = id;
+    msg.data_length_code = 8;
+    memcpy(msg.data, &ms, sizeof(ms));
+    bus.transmit(node, msg);
+}
+
+void test_bridge_two_segments() {
+    std::unique_ptr<TWAI_VirtualBus> bus_a(new TWAI_VirtualBus(500000));
+    std::unique_ptr<TWAI_VirtualBus> bus_b(new TWAI_VirtualBus(500000));
+    int nodes_a[GENERATORS_A + 1], nodes_b[GENERATORS_B];
+    for (int i = 0; i <= GENERATORS_A; ++i) {
+        nodes_a[i] = bus_a->add_node(nullptr, nullptr, nullptr);
+        bus_a->start(nodes_a[i]);
+    }
+    for (int i = 0; i < GENERATORS_B; ++i) {
+        nodes_b[i] = bus_b->add_node(nullptr, nullptr, nullptr);
+        bus_b->start(nodes_b[i]);
+    }
+    listener_t on_a, on_b;
+    bus_a->start(bus_a->add_node(listen, nullptr, &on_a, true));
+    bus_b->start(bus_b->add_node(listen, nullptr, &on_b, true));
+
+    TWAI_Object can_a, can_b;
+    can_a.attach_virtual_bus(*bus_a);
+    can_b.attach_virtual_bus(*bus_b);
+    CHECK(can_a.begin(GPIO_NUM_5, GPIO_NUM_4, 500000));
+    CHECK(can_b.begin(GPIO_NUM_21, GPIO_NUM_22, 500000));
+    TWAI_Gateway a_to_b(can_a, can_b), b_to_a(can_b, can_a);
+
+    TWAI_Gateway::route_t cyclic = {};
+    cyclic.ids = { 0x100, 0x1FF, TWAI_Object::TWAI_FILTER_TYPE_RANGE, false };
+    int cyclic_route = a_to_b.add_route(cyclic);
+    TWAI_Gateway::route_t diag = {};
+    diag.ids = { 0x7DF, 0x7DF, TWAI_Object::TWAI_FILTER_TYPE_LIST, false };
+    diag.rate_limit = DIAG_LIMIT;
+    diag.burst = 2;
+    int diag_route = a_to_b.add_route(diag);
+    TWAI_Gateway::route_t rewritten = {};
+    rewritten.ids = { 0x200, 0x2FF, TWAI_Object::TWAI_FILTER_TYPE_RANGE, false };
+    rewritten.rewrite_mask = 0x700;
+    rewritten.rewrite_id = 0x600;
+    CHECK(b_to_a.add_route(rewritten) >= 0);
+    CHECK(cyclic_route >= 0 && diag_route >= 0);
+
+    for (uint64_t us = STEP_US; us <= RUN_MS * 1000; us += STEP_US) {
+        if (us % 1000 == 0) {
+            uint64_t ms = us / 1000;
+            for (int i = 0; i < GENERATORS_A; ++i) {
+                if ((ms + i) % PERIOD_MS == 0) generate(*bus_a, nodes_a[i], 0x100 + 16 * i, ms);
+            }
+            if (ms % DIAG_PERIOD_MS == 0) generate(*bus_a, nodes_a[GENERATORS_A], 0x7DF, ms);
+            for (int i = 0; i < GENERATORS_B; ++i) {
+                if ((ms + i) % PERIOD_MS == 0) generate(*bus_b, nodes_b[i], 0x200 + 16 * i, ms);
+            }
+        }
+        bus_a->run_until(us);
+        bus_b->run_until(us);
+        a_to_b.service();
+        b_to_a.service();
+    }
+    // Vaciar lo que quede en vuelo
+    for (uint64_t us = RUN_MS * 1000 + STEP_US; us <= (RUN_MS + 5) * 1000; us += STEP_US) {
+        bus_a->run_until(us);
+        bus_b->run_until(us);
+        a_to_b.service();
+        b_to_a.service();
+    }
+
+    TWAI_Gateway::stats_t ab = a_to_b.get_stats(), ba = b_to_a.get_stats();
+    uint32_t cyclic_sent = uint32_t(RUN_MS / PERIOD_MS * GENERATORS_A);
+    uint32_t diag_sent = uint32_t(RUN_MS / DIAG_PERIOD_MS);
+    uint32_t b_sent = uint32_t(RUN_MS / PERIOD_MS * GENERATORS_B);
+    CHECK_EQ(ab.ring_full + ab.tx_refused + ba.ring_full + ba.tx_refused, 0);
+    CHECK_EQ(on_b.cyclic, cyclic_sent);
+    CHECK_EQ(on_a.rewritten, b_sent);
+    CHECK_EQ(on_a.other, 0);
+
+    // 0x7DF cada 5 ms (200/s) limitado a 50/s con ráfaga de 2
+    uint32_t forwarded, limited;
+    CHECK(a_to_b.get_route_stats(diag_route, forwarded, limited));
+    CHECK_EQ(forwarded + limited, diag_sent);
+    CHECK(forwarded >= DIAG_LIMIT * RUN_MS / 1000 && forwarded <= DIAG_LIMIT * RUN_MS / 1000 + 2);
+    CHECK_EQ(on_b.diag, forwarded);
+    CHECK_EQ(ab.forwarded, cyclic_sent + forwarded);
+
+    // Cada segmento cerca del 90% con el tráfico reenviado
+    float load_a = bus_a->get_bus_stats().load, load_b = bus_b->get_bus_stats().load;
+    CHECK(load_a > 0.8f && load_a < 0.98f);
+    CHECK(load_b > 0.8f && load_b < 0.98f);
+    can_a.end();
+    can_b.end();
+}
+
+}  // namespace
+
+int main() {
+    RUN_TEST(test_bridge_two_segments);
+    return host_test_result();
+}
@@ -0,0 +1,93 @@
+// TWAI_HwFilter: the synthesized register values never block an accepted ID
+#include "host_test.h"
+#include "TWAI_HwFilter.h"
+
+namespace {
+
+// Sin falsos negativos sobre todo el espacio estándar y una muestra del extendido
+void check_superset(const TWAI_FilterEngine& engine, const TWAI_HwFilter::plan_t& plan) {
+    uint32_t missed = 0;
+    for (uint32_t id = 0; id <= TWAI_FilterEngine::STD_ID_MASK; ++id) {
+        if (engine.matches(id, false) && !TWAI_HwFilter::passes(plan, id, false)) ++missed;
+    }
+    for (uint32_t id = 0; id <= TWAI_FilterEngine::EXT_ID_MASK; id += 0x1FFF) {
+        if (engine.matches(id, true) && !TWAI_HwFilter::passes(plan, id, true)) ++missed;
+    }
+    CHECK_EQ(missed, 0);
+}
+
+void test_accept_all() {
+    TWAI_FilterEngine engine;
+    engine.finalize();
+    TWAI_HwFilter::plan_t plan = TWAI_HwFilter::synthesize(engine);
+    CHECK(plan.single_filter);
+    CHECK_EQ(plan.acceptance_mask, 0xFFFFFFFF);
+    CHECK(TWAI_HwFilter::passes(plan, 0x7FF, false));
+}
+
+void test_single_id_exact() {
+    TWAI_FilterEngine engine;
+    engine.add_id(0x123, false);
+    engine.finalize();
+    TWAI_HwFilter::plan_t plan = TWAI_HwFilter::synthesize(engine);
+    CHECK(TWAI_HwFilter::passes(plan, 0x123, false));
+    CHECK(!TWAI_HwFilter::passes(plan, 0x124, false));
+    // El registro no distingue el formato: solo deja pasar además extendidos
+    uint32_t std_passed = 0;
+    for (uint32_t id = 0; id <= TWAI_FilterEngine::STD_ID_MASK; ++id) std_passed += TWAI_HwFilter::passes(plan, id, false);
+    CHECK_EQ(std_passed, 1);
+    check_superset(engine, plan);
+}
+
+void test_two_groups_use_dual() {
+    // Dos bloques estándar lejanos: el filtro dual los separa sin falsos positivos
+    TWAI_FilterEngine engine;
+    engine.add_range(0x100, 0x10F, false);
+    engine.add_range(0x700, 0x70F, false);
+    engine.finalize();
+    TWAI_HwFilter::plan_t plan = TWAI_HwFilter::synthesize(engine);
+    CHECK(!plan.single_filter);
+    CHECK_EQ(plan.accepted_ids, 32);
+    CHECK(!TWAI_HwFilter::passes(plan, 0x400, false));
+    check_superset(engine, plan);
+}
+
+void test_mixed_formats() {
+    TWAI_FilterEngine engine;
+    engine.add_id(0x7DF, false);
+    engine.add_range(0x18DA0000, 0x18DAFFFF, true);
+    engine.add_mask(0x0CF00400, 0x1FFFFF00, true);
+    engine.finalize();
+    TWAI_HwFilter::plan_t plan = TWAI_HwFilter::synthesize(engine);
+    check_superset(engine, plan);
+    CHECK(TWAI_HwFilter::passes(plan, 0x18DA10F1, true));
+    CHECK(plan.passed_ids >= plan.accepted_ids);
+}
+
+void test_traffic_ranking() {
+    // El tráfico rechazado cae en los IDs que un plan sin historial dejaría pasar
+    TWAI_FilterEngine engine;
+    engine.add_id(0x100, false);
+    engine.add_id(0x101, false);
+    engine.add_id(0x300, false);
+    engine.finalize();
+    TWAI_HwFilter::plan_t blind = TWAI_HwFilter::synthesize(engine);
+    TWAI_IdHistogram::entry_t traffic[] = {
+        { 0x102, false, 5000 },
+        { 0x301, false, 8000 },
+    };
+    TWAI_HwFilter::plan_t tuned = TWAI_HwFilter::synthesize(engine, traffic, 2);
+    check_superset(engine, tuned);
+    CHECK(TWAI_HwFilter::traffic_passed(tuned, traffic, 2) <= TWAI_HwFilter::traffic_passed(blind, traffic, 2));
+}
+
+}  // namespace
+
+int main() {
+    RUN_TEST(test_accept_all);
+    RUN_TEST(test_single_id_exact);
+    RUN_TEST(test_two_groups_use_dual);
+    RUN_TEST(test_mixed_formats);
+    RUN_TEST(test_traffic_ranking);
+    return host_test_result();
+}
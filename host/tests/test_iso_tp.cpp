@@ -0,0 +1,164 @@
+// TWAI_IsoTp: segmentation and reassembly between two protocol cores
+#include "host_test.h"
+#include "TWAI_IsoTp.h"
+#include "iso_tp_loopback.h"
+#include <cstring>
+#include <deque>
+
+namespace {
+
+// Canal de una dirección: las tramas de un extremo llegan al otro
+struct link_t {
+    std::deque<twai_message_t> frames;
+};
+
+bool output(const twai_message_t& msg, void* context) {
+    static_cast<link_t*>(context)->frames.push_back(msg);
+    return true;
+}
+
+struct received_t {
+    uint8_t data[TWAI_IsoTp::MAX_PAYLOAD];
+    size_t length = 0;
+    int messages = 0;
+};
+
+void on_receive(int, const uint8_t* data, size_t length, void* context) {
+    received_t* r = static_cast<received_t*>(context);
+    memcpy(r->data, data, length);
+    r->length = length;
+    ++r->messages;
+}
+
+struct sent_t {
+    int ok = 0;
+    int failed = 0;
+};
+
+void on_sent(int, bool success, void* context) {
+    sent_t* s = static_cast<sent_t*>(context);
+    success ? ++s->ok : ++s->failed;
+}
+
+// Bucle de transporte con reloj simulado
+void pump(TWAI_IsoTp& a, link_t& a_out, TWAI_IsoTp& b, link_t& b_out, uint64_t& now, uint64_t limit_us) {
+    for (uint64_t end = now + limit_us; now < end; now += 100) {
+        while (!a_out.frames.empty()) {
+            b.on_frame(a_out.frames.front(), now);
+            a_out.frames.pop_front();
+        }
+        while (!b_out.frames.empty()) {
+            a.on_frame(b_out.frames.front(), now);
+            b_out.frames.pop_front();
+        }
+        a.poll(now);
+        b.poll(now);
+    }
+}
+
+TWAI_IsoTp tester, ecu;
+link_t tester_out, ecu_out;
+received_t ecu_rx;
+sent_t tester_tx;
+int tester_session, ecu_session;
+
+void setup(uint8_t block_size, uint8_t st_min) {
+    tester.close(tester_session);
+    ecu.close(ecu_session);
+    tester.set_output(output, &tester_out);
+    ecu.set_output(output, &ecu_out);
+
+    TWAI_IsoTp::session_config_t config = {};
+    config.tx_id = 0x7E0;
+    config.rx_id = 0x7E8;
+    config.padding = 0xCC;
+    config.on_sent = on_sent;
+    config.context = &tester_tx;
+    tester_session = tester.open(config);
+
+    config = {};
+    config.tx_id = 0x7E8;
+    config.rx_id = 0x7E0;
+    config.block_size = block_size;
+    config.st_min = st_min;
+    config.padding = 0xCC;
+    config.on_receive = on_receive;
+    config.context = &ecu_rx;
+    ecu_session = ecu.open(config);
+    ecu_rx = received_t();
+    tester_tx = sent_t();
+}
+
+void test_single_frame() {
+    setup(0, 0);
+    uint64_t now = 0;
+    uint8_t payload[5] = { 0x22, 0xF1, 0x90, 0x01, 0x02 };
+    CHECK(tester.send(tester_session, payload, sizeof(payload), now));
+    pump(tester, tester_out, ecu, ecu_out, now, 1000);
+    CHECK_EQ(ecu_rx.messages, 1);
+    CHECK_EQ(ecu_rx.length, 5);
+    CHECK(memcmp(ecu_rx.data, payload, 5) == 0);
+    CHECK_EQ(tester_tx.ok, 1);
+}
+
+void test_multi_frame_flow_control() {
+    static uint8_t payload[TWAI_IsoTp::MAX_PAYLOAD];
+    for (size_t i = 0; i < sizeof(payload); ++i) payload[i] = uint8_t(i * 7 + 3);
+    const uint8_t block_sizes[] = { 0, 1, 8 };
+    for (uint8_t bs : block_sizes) {
+        setup(bs, 0xF1);    // STmin 100 us
+        uint64_t now = 0;
+        CHECK(tester.send(tester_session, payload, sizeof(payload), now));
+        CHECK(tester.tx_busy(tester_session));
+        pump(tester, tester_out, ecu, ecu_out, now, 2000000);
+        CHECK_EQ(ecu_rx.messages, 1);
+        CHECK_EQ(ecu_rx.length, sizeof(payload));
+        CHECK(memcmp(ecu_rx.data, payload, sizeof(payload)) == 0);
+        CHECK_EQ(tester_tx.ok, 1);
+        CHECK(!tester.tx_busy(tester_session));
+    }
+    TWAI_IsoTp::stats_t stats = ecu.get_stats();
+    CHECK_EQ(stats.rx_aborted, 0);
+}
+
+void test_timeout_without_receiver() {
+    setup(0, 0);
+    ecu.close(ecu_session);     // Nadie responde al primer fragmento
+    uint64_t now = 0;
+    uint8_t payload[100] = {};
+    CHECK(tester.send(tester_session, payload, sizeof(payload), now));
+    pump(tester, tester_out, ecu, ecu_out, now, 1500000);
+    CHECK_EQ(tester_tx.failed, 1);
+    CHECK_EQ(tester.get_stats().tx_aborted, 1);
+}
+
+void test_loopback_throughput() {
+    // Techo a 500 kbit/s: 7 bytes por trama de 111 bits sin relleno, ~31.5 kB/s
+    auto open = run_scenario<iso_tp_loopback_t>(10, 0, 0);
+    CHECK_EQ(open->received, 10);
+    CHECK_EQ(open->tester.get_stats().tx_aborted + open->ecu.get_stats().rx_aborted, 0);
+    CHECK(open->bytes_per_s() > 25000 && open->bytes_per_s() < 31600);
+    CHECK(open->latency_max_us >= open->ecu.get_stats().rx_latency_max_us);
+    CHECK(open->latency_max_us < 160000);
+
+    // Cada bloque de 8 espera un control de flujo; STmin de 1 ms entre las tramas
+    // de un bloque deja 56 bytes cada ~7.5 ms
+    auto blocks = run_scenario<iso_tp_loopback_t>(10, 8, 0);
+    CHECK_EQ(blocks->received, 10);
+    CHECK(blocks->bytes_per_s() < open->bytes_per_s());
+    auto paced = run_scenario<iso_tp_loopback_t>(10, 8, 1);
+    CHECK_EQ(paced->received, 10);
+    CHECK(paced->bytes_per_s() > 7000 && paced->bytes_per_s() < 8000);
+    CHECK(paced->latency_max_us > 4095 / 7 * 1000 * 9 / 10);
+}
+
+}  // namespace
+
+int main() {
+    tester_session = ecu_session = -1;
+    RUN_TEST(test_single_frame);
+    RUN_TEST(test_multi_frame_flow_control);
+    RUN_TEST(test_timeout_without_receiver);
+    RUN_TEST(test_loopback_throughput);
+    return host_test_result();
+}
@@ -0,0 +1,117 @@
+// Two TWAI_Object instances on controllers 0 and 1: separate drivers, interrupts and pipelines
+#include "host_test.h"
+#include "host_hooks.h"
+#include "TWAI_Object.h"
+#include <atomic>
+#include <cstring>
+#include <thread>
+
+namespace {
+
+constexpr uint32_t BURSTS = 2000;
+constexpr uint32_t BURST = 8;
+
+struct pipeline_t {
+    TWAI_Object can;
+    std::atomic<bool> producing{true};
+    uint32_t sent = 0;              // Aceptadas por la FIFO del controlador
+    uint32_t received = 0;
+    uint32_t foreign = 0;           // Eventos con índice o carga de otro controlador
+    bool ordered = true;
+};
+
+twai_message_t frame(int controller, uint32_t seq) {
+    twai_message_t msg = {};
+    msg.identifier = 0x100 + controller;
+    msg.data_length_code = 5;
+    msg.data[0] = uint8_t(controller);
+    memcpy(msg.data + 1, &seq, sizeof(seq));
+    return msg;
+}
+
+// Ráfagas de 8 sin esperar al consumidor; la FIFO falsa tiene 5 huecos
+void produce(pipeline_t& p, int controller) {
+    uint32_t seq = 0;
+    for (uint32_t b = 0; b < BURSTS; ++b) {
+        for (uint32_t k = 0; k < BURST; ++k) {
+            if (host_twai_push_rx(controller, frame(controller, seq++))) ++p.sent;
+            host_twai_raise_interrupt(controller);
+        }
+    }
+    p.producing.store(false);
+}
+
+void consume(pipeline_t& p, int controller) {
+    TWAI_Object::can_event_packed_t batch[32];
+    int64_t last = -1;
+    while (true) {
+        bool done = !p.producing.load();
+        size_t n = p.can.receive_batch(batch, 32, pdMS_TO_TICKS(5));
+        for (size_t i = 0; i < n; ++i) {
+            const TWAI_Object::can_event_packed_t& e = batch[i];
+            int index = int((e.flags_dlc >> TWAI_Object::PACKED_CTRL_SHIFT) & 0x0F);
+            if (index != controller || e.data[0] != controller || e.identifier != 0x100u + controller) ++p.foreign;
+            uint32_t seq;
+            memcpy(&seq, e.data + 1, sizeof(seq));
+            if (int64_t(seq) <= last) p.ordered = false;
+            last = seq;
+        }
+        p.received += uint32_t(n);
+        if (done && n == 0) break;
+    }
+}
+
+void test_parallel_controllers() {
+    pipeline_t pipes[2];
+    for (int c = 0; c < 2; ++c) {
+        pipes[c].can.enable_event_ring(true);
+        CHECK(pipes[c].can.begin(GPIO_NUM_5, GPIO_NUM_4, 500000, TWAI_MODE_NORMAL, c));
+    }
+    std::thread threads[4] = {
+        std::thread(consume, std::ref(pipes[0]), 0), std::thread(consume, std::ref(pipes[1]), 1),
+        std::thread(produce, std::ref(pipes[0]), 0), std::thread(produce, std::ref(pipes[1]), 1),
+    };
+    for (std::thread& t : threads) t.join();
+
+    for (int c = 0; c < 2; ++c) {
+        pipeline_t& p = pipes[c];
+        TWAI_Object::drop_stats_t drops = p.can.get_drop_stats();
+        CHECK(p.sent > 0);
+        CHECK_EQ(p.foreign, 0);
+        CHECK(p.ordered);
+        CHECK_EQ(p.received + drops.queue_full, p.sent);
+        CHECK_EQ(p.can.get_stats().counters.rx_frames, p.sent);
+        p.can.end();
+    }
+}
+
+void test_filters_per_controller() {
+    // El filtro de una instancia no toca el controlador de la otra
+    TWAI_Object a, b;
+    CHECK(a.begin(GPIO_NUM_5, GPIO_NUM_4, 500000, TWAI_MODE_NORMAL, 0));
+    CHECK(b.begin(GPIO_NUM_21, GPIO_NUM_22, 500000, TWAI_MODE_NORMAL, 1));
+    uint32_t installs_b = host_twai_installs(1);
+    TWAI_Object::twai_user_filter_t only = { 0x300, 0x300, TWAI_Object::TWAI_FILTER_TYPE_LIST, false };
+    CHECK(a.add_filter(only));
+    CHECK_EQ(host_twai_installs(1), installs_b);
+    CHECK(!host_twai_push_rx(0, frame(0, 1)));
+    CHECK(host_twai_push_rx(1, frame(1, 1)));
+    host_twai_raise_interrupt(1);
+    CHECK_EQ(uxQueueMessagesWaiting(b.get_event_queue()), 1);
+    CHECK_EQ(uxQueueMessagesWaiting(a.get_event_queue()), 0);
+
+    CHECK(a.send(frame(0, 2), 0));
+    CHECK_EQ(host_twai_tx_pending(0), 1);
+    CHECK_EQ(host_twai_tx_pending(1), 0);
+    CHECK(host_twai_complete_tx(0, true));
+    a.end();
+    b.end();
+}
+
+}  // namespace
+
+int main() {
+    RUN_TEST(test_parallel_controllers);
+    RUN_TEST(test_filters_per_controller);
+    return host_test_result();
+}
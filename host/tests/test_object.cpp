@@ -0,0 +1,235 @@
+// TWAI_Object over the host driver: RX interrupt path, filters, subscriptions and TX
+#include "host_test.h"
+#include "host_hooks.h"
+#include "TWAI_Object.h"
+#include <atomic>
+#include <thread>
+
+namespace {
+
+twai_message_t frame(uint32_t id, uint8_t first_byte = 0, bool extended = false) {
+    twai_message_t msg = {};
+    msg.identifier = id;
+    msg.extd = extended;
+    msg.data_length_code = 1;
+    msg.data[0] = first_byte;
+    return msg;
+}
+
+// Trama recibida por el controlador 0 y su interrupción
+bool receive(uint32_t id, uint8_t first_byte = 0) {
+    bool accepted = host_twai_push_rx(0, frame(id, first_byte));
+    host_twai_raise_interrupt(0);
+    return accepted;
+}
+
+TWAI_Object::drop_stats_t drops(TWAI_Object& can) { return can.get_drop_stats(true); }
+
+void test_rx_to_event_queue() {
+    TWAI_Object can;
+    CHECK(can.begin());
+    CHECK(receive(0x123, 7));
+    TWAI_Object::can_event_t event;
+    CHECK(xQueueReceive(can.get_event_queue(), &event, 0) == pdTRUE);
+    CHECK_EQ(event.message.identifier, 0x123);
+    CHECK_EQ(event.message.data[0], 7);
+    CHECK(!event.is_error);
+    CHECK(xQueueReceive(can.get_event_queue(), &event, 0) == pdFALSE);
+    can.end();
+}
+
+void test_filters_reach_hardware() {
+    TWAI_Object can;
+    CHECK(can.begin());
+    uint32_t installs = host_twai_installs(0);
+    TWAI_Object::twai_user_filter_t filter = { 0x100, 0x100, TWAI_Object::TWAI_FILTER_TYPE_LIST, false };
+    CHECK(can.add_filter(filter));
+    CHECK_EQ(host_twai_installs(0), installs + 1);     // Driver reinstalado con el filtro nuevo
+    CHECK(receive(0x100));
+    CHECK(!receive(0x200));     // Bloqueado por el filtro hardware
+
+    // Un filtro hardware amplio deja pasar lo que el software rechaza
+    filter = { 0x101, 0x101, TWAI_Object::TWAI_FILTER_TYPE_LIST, false };
+    CHECK(can.add_filter(filter));
+    CHECK(receive(0x101));
+    UBaseType_t queued = uxQueueMessagesWaiting(can.get_event_queue());
+    CHECK_EQ(queued, 2);
+    can.end();
+}
+
+void test_software_filter_drop() {
+    TWAI_Object can;
+    TWAI_Object::twai_user_filter_t filters[] = {
+        { 0x100, 0x100, TWAI_Object::TWAI_FILTER_TYPE_LIST, false },
+        { 0x111, 0x111, TWAI_Object::TWAI_FILTER_TYPE_LIST, false },
+        { 0x222, 0x222, TWAI_Object::TWAI_FILTER_TYPE_LIST, false },
+        { 0x333, 0x333, TWAI_Object::TWAI_FILTER_TYPE_LIST, false },
+    };
+    CHECK(can.set_filters(filters, 4));
+    CHECK(can.begin());
+
+    // Un ID que pasa el registro hardware pero ningún filtro de usuario
+    TWAI_FilterEngine wanted;
+    for (const TWAI_Object::twai_user_filter_t& f : filters) wanted.add_id(f.id, false);
+    wanted.finalize();
+    uint32_t leak = 0;
+    while (leak <= 0x7FF && (wanted.matches(leak, false) || !receive(leak))) ++leak;
+    CHECK(leak <= 0x7FF);
+
+    receive(0x100);
+    receive(0x333);
+    TWAI_Object::drop_stats_t d = drops(can);
+    CHECK_EQ(uxQueueMessagesWaiting(can.get_event_queue()), 2);
+    CHECK_EQ(d.filtered, 1);
+    can.end();
+}
+
+void test_mask_filter_semantics() {
+    TWAI_Object can;
+    CHECK(can.begin());
+    // MASK: bits a 1 no importan (registro de aceptación); CARE_MASK: bits a 1 deben coincidir
+    TWAI_Object::twai_user_filter_t filters[] = {
+        { 0x100, 0x00F, TWAI_Object::TWAI_FILTER_TYPE_MASK, false },
+        { 0x200, 0x7F0, TWAI_Object::TWAI_FILTER_TYPE_CARE_MASK, false },
+    };
+    CHECK(can.set_filters(filters, 2));
+    for (uint32_t id : { 0x100u, 0x10Fu, 0x110u, 0x200u, 0x20Fu, 0x210u, 0x300u }) receive(id);
+    TWAI_Object::can_event_t event;
+    uint32_t got[8], n = 0;
+    while (n < 8 && xQueueReceive(can.get_event_queue(), &event, 0) == pdTRUE) got[n++] = event.message.identifier;
+    CHECK_EQ(n, 4);
+    CHECK(n == 4 && got[0] == 0x100 && got[1] == 0x10F && got[2] == 0x200 && got[3] == 0x20F);
+
+    // set_filter_mode() sigue el mismo convenio que el registro
+    CHECK(can.set_filter_mode(0x300, 0x0FF, false));
+    CHECK(receive(0x3AB));
+    CHECK(!receive(0x4AB));
+    CHECK(xQueueReceive(can.get_event_queue(), &event, 0) == pdTRUE);
+    CHECK_EQ(event.message.identifier, 0x3AB);
+    can.end();
+}
+
+struct counter_t {
+    int frames = 0;
+    uint32_t last_id = 0;
+};
+
+void count_frame(const TWAI_Object::can_event_t& event, void* context) {
+    counter_t* c = static_cast<counter_t*>(context);
+    ++c->frames;
+    c->last_id = event.message.identifier;
+}
+
+void test_subscription_and_ring() {
+    TWAI_Object can;
+    can.enable_event_ring(true);
+    CHECK(can.begin());
+    counter_t counter;
+    TWAI_Object::twai_user_filter_t ids = { 0x300, 0x30F, TWAI_Object::TWAI_FILTER_TYPE_RANGE, false };
+    int handle = can.subscribe(ids, count_frame, &counter);
+    CHECK(handle >= 0);
+    receive(0x305);
+    receive(0x400);
+    CHECK_EQ(counter.frames, 1);
+    CHECK_EQ(counter.last_id, 0x305);
+
+    TWAI_Object::can_event_packed_t batch[4];
+    CHECK_EQ(can.receive_batch(batch, 4, 0), 1);
+    CHECK_EQ(batch[0].identifier, 0x400);
+    CHECK(can.unsubscribe(handle));
+    receive(0x305);
+    CHECK_EQ(counter.frames, 1);
+    CHECK_EQ(can.receive_batch(batch, 4, 0), 1);
+    can.end();
+}
+
+// ISR y consumidor en hilos distintos: nada se pierde ni se desordena
+void rx_consumer_threads(bool use_ring) {
+    constexpr uint32_t FRAMES = 20000;
+    TWAI_Object can;
+    can.enable_event_ring(use_ring);
+    CHECK(can.begin());
+    std::atomic<uint32_t> consumed{0};
+    bool ordered = true;
+    std::thread consumer([&] {
+        TWAI_Object::can_event_t event;
+        TWAI_Object::can_event_packed_t batch[TWAI_EVENT_RING_SIZE];
+        uint32_t expected = 0;
+        while (consumed.load() < FRAMES) {
+            size_t n = 0;
+            if (use_ring) {
+                n = can.receive_batch(batch, TWAI_EVENT_RING_SIZE, pdMS_TO_TICKS(10));
+                for (size_t i = 0; i < n; ++i) ordered &= batch[i].identifier == (expected++ & 0x7FF);
+            } else if (xQueueReceive(can.get_event_queue(), &event, pdMS_TO_TICKS(10)) == pdTRUE) {
+                n = 1;
+                ordered &= event.message.identifier == (expected++ & 0x7FF);
+            }
+            consumed.fetch_add(uint32_t(n));
+        }
+    });
+    // Ráfagas que caben en la cola; el productor espera al consumidor entre ellas
+    for (uint32_t sent = 0; sent < FRAMES;) {
+        for (uint32_t k = 0; k < MAX_EVENT_QUEUE_ITEMS; ++k, ++sent) receive(sent & 0x7FF);
+        while (consumed.load() < sent) std::this_thread::yield();
+    }
+    consumer.join();
+    CHECK(ordered);
+    CHECK_EQ(consumed.load(), FRAMES);
+    CHECK_EQ(drops(can).queue_full, 0);
+    can.end();
+}
+
+void test_rx_consumer_queue() { rx_consumer_threads(false); }
+
+void test_rx_consumer_ring() { rx_consumer_threads(true); }
+
+void test_transmit() {
+    TWAI_Object can;
+    CHECK(can.begin());
+    CHECK(can.send(frame(0x55, 1), 0));
+    CHECK_EQ(host_twai_tx_pending(0), 1);
+    CHECK(host_twai_complete_tx(0, true));
+    twai_message_t sent;
+    CHECK(host_twai_pop_bus(0, sent));
+    CHECK_EQ(sent.identifier, 0x55);
+    CHECK_EQ(can.get_stats().counters.tx_frames, 1);
+    can.end();
+}
+
+void test_periodic_same_tick() {
+    // Más mensajes con la misma fase que los que run_periodic() vence por pasada
+    constexpr int COUNT = 12;
+    TWAI_Object can;
+    host_twai_set_auto_tx(0, true);
+    CHECK(can.begin());
+    int handles[COUNT];
+    for (int i = 0; i < COUNT; ++i) {
+        handles[i] = can.schedule_periodic(frame(0x500 + i), 10, 0);
+        CHECK(handles[i] >= 0);
+    }
+    vTaskDelay(pdMS_TO_TICKS(65));
+    for (int i = 0; i < COUNT; ++i) {
+        TWAI_Object::periodic_stats_t stats;
+        CHECK(can.get_periodic_stats(handles[i], stats));
+        CHECK(stats.sent + stats.send_failures >= 3);
+    }
+    can.end();
+    host_twai_set_auto_tx(0, false);
+    twai_message_t sent;
+    while (host_twai_pop_bus(0, sent)) {}
+}
+
+}  // namespace
+
+int main() {
+    RUN_TEST(test_rx_to_event_queue);
+    RUN_TEST(test_filters_reach_hardware);
+    RUN_TEST(test_software_filter_drop);
+    RUN_TEST(test_mask_filter_semantics);
+    RUN_TEST(test_subscription_and_ring);
+    RUN_TEST(test_rx_consumer_queue);
+    RUN_TEST(test_rx_consumer_ring);
+    RUN_TEST(test_transmit);
+    RUN_TEST(test_periodic_same_tick);
+    return host_test_result();
+}
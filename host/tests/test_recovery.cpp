@@ -0,0 +1,67 @@
+// Automatic bus-off recovery: the error bursts of examples/TWAI_BusOffRecovery on a virtual bus
+#include "host_test.h"
+#include "TWAI_Object.h"
+#include <memory>
+
+namespace {
+
+constexpr uint64_t RUN_MS = 6000;
+constexpr uint64_t FAULTS_MS[] = { 1000, 1100, 1250, 4000 };
+constexpr uint64_t FAULT_LENGTH_MS = 10;
+
+bool in_fault(uint64_t now_ms) {
+    for (uint64_t start : FAULTS_MS) {
+        if (now_ms >= start && now_ms < start + FAULT_LENGTH_MS) return true;
+    }
+    return false;
+}
+
+void test_backoff_and_downtime() {
+    std::unique_ptr<TWAI_VirtualBus> owner(new TWAI_VirtualBus(500000));
+    TWAI_VirtualBus& bus = *owner;
+    bus.start(bus.add_node(nullptr, nullptr, nullptr));     // Confirma las tramas
+
+    TWAI_Object dut;
+    dut.attach_virtual_bus(bus);
+    dut.enable_auto_recovery(true, 10, 1000);
+    CHECK(dut.begin(GPIO_NUM_5, GPIO_NUM_4, 500000));
+
+    twai_message_t heartbeat = {};
+    heartbeat.identifier = 0x080;
+    heartbeat.data_length_code = 8;
+    for (uint64_t ms = 1; ms <= RUN_MS; ++ms) {
+        bus.set_error_rate(in_fault(ms) ? 1000000 : 0, uint32_t(ms));
+        dut.send(heartbeat, 0);
+        bus.run_until(ms * 1000);
+        dut.poll_recovery();
+    }
+
+    TWAI_Object::recovery_stats_t stats = dut.get_recovery_stats();
+    TWAI_Object::recovery_incident_t incidents[MAX_RECOVERY_INCIDENTS];
+    size_t n = dut.get_recovery_incidents(incidents, MAX_RECOVERY_INCIDENTS);
+    CHECK_EQ(stats.bus_offs, 4);
+    CHECK_EQ(stats.recoveries, 4);
+    CHECK_EQ(stats.error_level, TWAI_Object::TWAI_ERROR_ACTIVE);
+    CHECK_EQ(stats.state, TWAI_Object::TWAI_RECOVERY_IDLE);
+    CHECK_EQ(n, 4);
+
+    // 128 secuencias de 11 bits recesivos a 500 kbit/s: 2816 us, más hasta 1 ms de
+    // sondeo al detectar el bus-off y otro al rearrancar
+    constexpr uint32_t RECESSIVE_US = 128 * 11 * 2;
+    const uint32_t backoffs[] = { 0, 10, 20, 0 };   // Serie de tres y uno aislado
+    for (size_t i = 0; i < n && i < 4; ++i) {
+        CHECK_EQ(incidents[i].backoff_ms, backoffs[i]);
+        CHECK_EQ(incidents[i].txcvr_cycles, 0);
+        CHECK(incidents[i].downtime_us >= backoffs[i] * 1000 + RECESSIVE_US);
+        CHECK(incidents[i].downtime_us <= backoffs[i] * 1000 + RECESSIVE_US + 2000);
+    }
+    CHECK_EQ(stats.last_downtime_us, incidents[3].downtime_us);
+    dut.end();
+}
+
+}  // namespace
+
+int main() {
+    RUN_TEST(test_backoff_and_downtime);
+    return host_test_result();
+}
@@ -0,0 +1,123 @@
+// TWAI_TimerWheel: expiry on the due tick across both levels
+#include "host_test.h"
+#include "TWAI_TimerWheel.h"
+#include <cstdlib>
+
+namespace {
+
+void test_expiry_ticks() {
+    TWAI_TimerWheel wheel;
+    wheel.reset(1000);
+    wheel.insert(0, 1005);
+    wheel.insert(1, 1300);      // Nivel 1
+    wheel.insert(2, 1000 + 20000);  // Más allá de la rueda
+    CHECK_EQ(wheel.ticks_to_next(100), 5);
+
+    uint16_t expired[4];
+    CHECK_EQ(wheel.advance(1004, expired, 4), 0);
+    CHECK_EQ(wheel.advance(1005, expired, 4), 1);
+    CHECK_EQ(expired[0], 0);
+    CHECK_EQ(wheel.advance(1299, expired, 4), 0);
+    CHECK_EQ(wheel.advance(1300, expired, 4), 1);
+    CHECK_EQ(expired[0], 1);
+    CHECK_EQ(wheel.advance(20999, expired, 4), 0);
+    CHECK_EQ(wheel.advance(21000, expired, 4), 1);
+    CHECK_EQ(expired[0], 2);
+    CHECK_EQ(wheel.now(), 21000);
+}
+
+void test_past_due() {
+    TWAI_TimerWheel wheel;
+    wheel.reset(50);
+    wheel.insert(7, 10);
+    uint16_t expired[2];
+    CHECK_EQ(wheel.advance(51, expired, 2), 1);
+    CHECK_EQ(expired[0], 7);
+}
+
+void test_cascade_last_tick_of_block() {
+    // Entradas de nivel 1 que vencen en el último tick de su bloque (due % 256 == 255)
+    TWAI_TimerWheel wheel;
+    wheel.reset(0);
+    const uint32_t due[] = { 511, 767, 16383, 16384 + 255 };
+    for (uint16_t id = 0; id < 4; ++id) wheel.insert(id, due[id]);
+    uint16_t expired[4];
+    uint32_t fired[4] = {};
+    for (uint32_t t = 1; t <= 20000; ++t) {
+        size_t n = wheel.advance(t, expired, 4);
+        for (size_t i = 0; i < n; ++i) fired[expired[i]] = t;
+    }
+    for (uint16_t id = 0; id < 4; ++id) CHECK_EQ(fired[id], due[id]);
+}
+
+void test_random_schedule() {
+    // Cada entrada vence exactamente en su tick, en cualquier orden de llegada
+    TWAI_TimerWheel wheel;
+    uint32_t due[MAX_PERIODIC_MSGS];
+    srand(11);
+    wheel.reset(0xFFFFF000);    // Cruza el desbordamiento de 32 bits
+    for (uint16_t id = 0; id < MAX_PERIODIC_MSGS; ++id) {
+        due[id] = 0xFFFFF000 + 1 + rand() % 40000;
+        wheel.insert(id, due[id]);
+    }
+    uint16_t expired[MAX_PERIODIC_MSGS];
+    uint32_t seen = 0, wrong = 0;
+    for (uint32_t t = 0xFFFFF001; t != 0xFFFFF000 + 40001; ++t) {
+        size_t n = wheel.advance(t, expired, MAX_PERIODIC_MSGS);
+        for (size_t i = 0; i < n; ++i) {
+            if (due[expired[i]] != t) ++wrong;
+        }
+        seen += n;
+    }
+    CHECK_EQ(seen, MAX_PERIODIC_MSGS);
+    CHECK_EQ(wrong, 0);
+}
+
+void test_more_due_than_output() {
+    // 20 entradas en el mismo tick con salida de 8: ninguna se pierde ni bloquea la rueda
+    TWAI_TimerWheel wheel;
+    wheel.reset(100);
+    for (uint16_t id = 0; id < 20; ++id) wheel.insert(id, 110);
+    wheel.insert(20, 111);
+    wheel.insert(21, 400);      // Nivel 1, detrás del tick saturado
+
+    uint16_t expired[8];
+    bool seen[22] = {};
+    CHECK_EQ(wheel.advance(500, expired, 8), 8);
+    CHECK_EQ(wheel.now(), 109);     // Parado antes del tick con entradas pendientes
+    for (int i = 0; i < 8; ++i) seen[expired[i]] = true;
+    CHECK_EQ(wheel.ticks_to_next(100), 1);
+    CHECK_EQ(wheel.advance(500, expired, 8), 8);
+    for (int i = 0; i < 8; ++i) seen[expired[i]] = true;
+    // Quedan 4 del tick 110, luego 111 y 400 en la misma llamada
+    size_t n = wheel.advance(500, expired, 8);
+    CHECK_EQ(n, 6);
+    for (size_t i = 0; i < n; ++i) seen[expired[i]] = true;
+    CHECK(n == 6 && expired[4] == 20 && expired[5] == 21);
+    CHECK_EQ(wheel.now(), 500);
+    for (bool s : seen) CHECK(s);
+}
+
+void test_full_table_on_one_tick() {
+    // Todas las entradas en el mismo tick, salida mínima
+    TWAI_TimerWheel wheel;
+    wheel.reset(0);
+    for (uint16_t id = 0; id < MAX_PERIODIC_MSGS; ++id) wheel.insert(id, 1);
+    uint16_t expired[1];
+    uint32_t total = 0;
+    for (int call = 0; call < MAX_PERIODIC_MSGS + 1; ++call) total += wheel.advance(5, expired, 1);
+    CHECK_EQ(total, MAX_PERIODIC_MSGS);
+    CHECK_EQ(wheel.now(), 5);
+}
+
+}  // namespace
+
+int main() {
+    RUN_TEST(test_expiry_ticks);
+    RUN_TEST(test_past_due);
+    RUN_TEST(test_cascade_last_tick_of_block);
+    RUN_TEST(test_random_schedule);
+    RUN_TEST(test_more_due_than_output);
+    RUN_TEST(test_full_table_on_one_tick);
+    return host_test_result();
+}
@@ -0,0 +1,82 @@
+// TWAI_TxQueue: arbitration order, FIFO on ties and deadlines
+#include "host_test.h"
+#include "TWAI_TxQueue.h"
+
+namespace {
+
+twai_message_t frame(uint32_t id, bool extended = false, bool rtr = false) {
+    twai_message_t msg = {};
+    msg.identifier = id;
+    msg.extd = extended;
+    msg.rtr = rtr;
+    return msg;
+}
+
+void test_arbitration_order() {
+    TWAI_TxQueue queue;
+    queue.push(frame(0x300), 0);
+    queue.push(frame(0x100, false, true), 0);   // Remota pierde ante datos
+    queue.push(frame(0x100), 0);
+    queue.push(frame(0x100 << 18, true), 0);    // Extendida pierde ante estándar de igual base
+    queue.push(frame(0x050), 0);
+
+    TWAI_TxQueue::entry_t e;
+    uint32_t order[5];
+    bool rtr[5], extd[5];
+    for (int i = 0; i < 5; ++i) {
+        CHECK(queue.pop(e));
+        order[i] = e.msg.identifier;
+        rtr[i] = e.msg.rtr;
+        extd[i] = e.msg.extd;
+    }
+    CHECK(!queue.pop(e));
+    CHECK_EQ(order[0], 0x050);
+    CHECK(order[1] == 0x100 && !rtr[1]);
+    CHECK(order[2] == 0x100 && rtr[2]);
+    CHECK(extd[3]);
+    CHECK_EQ(order[4], 0x300);
+}
+
+void test_fifo_on_ties_and_requeue() {
+    TWAI_TxQueue queue;
+    for (uint32_t tag = 0; tag < 5; ++tag) queue.push(frame(0x200), 0, 0, tag);
+    TWAI_TxQueue::entry_t first;
+    CHECK(queue.pop(first));
+    CHECK_EQ(first.tag, 0);
+    CHECK(queue.requeue(first));    // Vuelve delante de las de igual clave
+    TWAI_TxQueue::entry_t e;
+    for (uint32_t tag = 0; tag < 5; ++tag) {
+        CHECK(queue.pop(e));
+        CHECK_EQ(e.tag, tag);
+    }
+}
+
+void test_capacity_and_deadlines() {
+    TWAI_TxQueue queue;
+    for (uint32_t i = 0; i < MAX_TX_PENDING; ++i) {
+        CHECK(queue.push(frame(i), 0, i % 2 ? 1000 + i : 0, i));
+    }
+    CHECK(queue.full());
+    CHECK(!queue.push(frame(0x7FF), 0));
+
+    TWAI_TxQueue::entry_t expired[MAX_TX_PENDING];
+    CHECK_EQ(queue.remove_expired(999, expired, MAX_TX_PENDING), 0);
+    size_t total = 0, n;
+    do {
+        n = queue.remove_expired(5000, expired, 4);
+        for (size_t i = 0; i < n; ++i) CHECK(expired[i].deadline_us != 0);
+        total += n;
+    } while (n == 4);
+    CHECK_EQ(total, MAX_TX_PENDING / 2);
+    CHECK_EQ(queue.size(), MAX_TX_PENDING / 2);
+    CHECK_EQ(queue.top()->msg.identifier, 0);
+}
+
+}  // namespace
+
+int main() {
+    RUN_TEST(test_arbitration_order);
+    RUN_TEST(test_fifo_on_ties_and_requeue);
+    RUN_TEST(test_capacity_and_deadlines);
+    return host_test_result();
+}
@@ -0,0 +1,90 @@
+// Transceiver idle policy: standby on a quiet bus, wake by reception without GPIO writes in the ISR
+#include "host_test.h"
+#include "host_hooks.h"
+#include "TWAI_Object.h"
+#include <chrono>
+#include <memory>
+#include <thread>
+
+namespace {
+
+constexpr gpio_num_t STBY_PIN = GPIO_NUM_15;
+
+// Espera a que el pin STBY llegue a level (la tarea de servicio lo mueve)
+bool wait_stby(int level, int timeout_ms) {
+    auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    while (host_gpio_level(STBY_PIN) != level) {
+        if (std::chrono::steady_clock::now() > end) return false;
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    return true;
+}
+
+void test_rx_wake_leaves_pins_to_service_task() {
+    TWAI_Txcvr txcvr;
+    TWAI_Txcvr::Config config(TWAI_Txcvr::Type::TJA1050, STBY_PIN);
+    CHECK(txcvr.begin(config));
+    TWAI_Object can;
+    CHECK(can.link_transceiver(txcvr));
+    can.set_txcvr_idle_policy(5);
+    CHECK(can.begin());
+    CHECK(wait_stby(1, 1000));      // Standby tras 5 ms sin tráfico
+    CHECK(can.get_txcvr_power_stats().asleep);
+
+    uint32_t isr_writes = host_gpio_isr_writes();
+    twai_message_t msg = {};
+    msg.identifier = 0x123;
+    msg.data_length_code = 1;
+    CHECK(host_twai_push_rx(0, msg));
+    host_twai_raise_interrupt(0);
+    CHECK_EQ(host_gpio_isr_writes(), isr_writes);
+    CHECK(wait_stby(0, 100));       // La tarea de servicio aplica el despertar
+    TWAI_Object::txcvr_power_stats_t stats = can.get_txcvr_power_stats();
+    CHECK_EQ(stats.wakes_rx, 1);
+    CHECK_EQ(stats.wakes_tx, 0);
+    CHECK_EQ(uxQueueMessagesWaiting(can.get_event_queue()), 1);
+
+    CHECK(wait_stby(1, 1000));      // Y vuelve a standby
+    can.end();
+    CHECK_EQ(host_gpio_level(STBY_PIN), 0);
+    CHECK_EQ(host_gpio_isr_writes(), isr_writes);
+}
+
+void test_virtual_rx_wake_applied_by_poll() {
+    // En el bus virtual la recepción tampoco toca los pines: lo hace poll_txcvr_idle()
+    std::unique_ptr<TWAI_VirtualBus> owner(new TWAI_VirtualBus(500000));
+    TWAI_VirtualBus& bus = *owner;
+    int peer = bus.add_node(nullptr, nullptr, nullptr);
+    bus.start(peer);
+    TWAI_Txcvr txcvr;
+    TWAI_Txcvr::Config config(TWAI_Txcvr::Type::TJA1050, STBY_PIN);
+    CHECK(txcvr.begin(config));
+    TWAI_Object can;
+    can.attach_virtual_bus(bus);
+    CHECK(can.link_transceiver(txcvr));
+    can.set_txcvr_idle_policy(5);
+    CHECK(can.begin());
+
+    bus.run_until(10000);
+    CHECK(can.poll_txcvr_idle());
+    CHECK_EQ(host_gpio_level(STBY_PIN), 1);
+    twai_message_t msg = {};
+    msg.identifier = 0x600;
+    msg.data_length_code = 2;
+    bus.transmit(peer, msg);
+    bus.run_until(11000);
+    CHECK(!can.get_txcvr_power_stats().asleep);
+    CHECK_EQ(host_gpio_level(STBY_PIN), 1);      // Anotado, pines sin cambiar
+    CHECK(!can.poll_txcvr_idle());
+    CHECK_EQ(host_gpio_level(STBY_PIN), 0);
+    CHECK_EQ(can.get_txcvr_power_stats().wakes_rx, 1);
+    can.end();
+}
+
+}  // namespace
+
+int main() {
+    RUN_TEST(test_rx_wake_leaves_pins_to_service_task);
+    RUN_TEST(test_virtual_rx_wake_applied_by_poll);
+    return host_test_result();
+}
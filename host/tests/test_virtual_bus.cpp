@@ -0,0 +1,58 @@
+// TWAI_VirtualBus with a TWAI_Object node: 30 nodes at about 90% load
+#include "host_test.h"
+#include "virtual_bus_scenario.h"
+
+namespace {
+
+void test_thirty_nodes_ninety_percent() {
+    auto r = run_scenario<virtual_bus_scenario_t>(30, 8, 2000);
+    TWAI_VirtualBus::bus_stats_t bus = r->bus.get_bus_stats();
+    CHECK(bus.load > 0.85f && bus.load < 0.95f);
+    CHECK(bus.errors > 0);
+    CHECK_EQ(r->generator_bus_off, 1);
+
+    // Generadores 0..15 dentro del filtro (0x100..0x178); el filtro hardware
+    // descarta exactamente el resto
+    CHECK(r->stats.counters.rx_frames > r->generator_sent / 2);
+    CHECK(r->stats.counters.rx_frames < r->generator_sent * 6 / 10);
+    CHECK_EQ(r->drops.filtered, 0);
+    // El consumidor (16 eventos cada 5 ms) va por delante de ~2 tramas/ms
+    CHECK_EQ(r->drops.queue_full, 0);
+    CHECK(r->stats.counters.queue_peak <= 16);
+
+    // Todas las tramas del DUT terminan: enviadas, fallidas o caducadas
+    uint32_t submitted = 2000 / 10 * 2;
+    uint32_t done = r->tx_results[TWAI_TX_SUCCESS] + r->tx_results[TWAI_TX_FAILED] + r->tx_results[TWAI_TX_EXPIRED];
+    CHECK(done <= submitted && done + MAX_TX_PENDING >= submitted);
+    CHECK(r->tx_results[TWAI_TX_SUCCESS] > 0);
+    CHECK(r->stats.counters.tx_latency_max_us > 0);
+}
+
+void test_slow_consumer_drops_oldest() {
+    // Vaciando cada 50 ms el anillo desborda y se descartan los más antiguos
+    auto r = run_scenario<virtual_bus_scenario_t>(30, 8, 1000, 50);
+    CHECK(r->drops.queue_full > 0);
+    CHECK_EQ(r->stats.counters.queue_peak, TWAI_EVENT_RING_SIZE);
+}
+
+void test_deterministic() {
+    auto a = run_scenario<virtual_bus_scenario_t>(30, 8, 500);
+    auto b = run_scenario<virtual_bus_scenario_t>(30, 8, 500);
+    TWAI_VirtualBus::bus_stats_t bus_a = a->bus.get_bus_stats(), bus_b = b->bus.get_bus_stats();
+    CHECK_EQ(bus_a.frames, bus_b.frames);
+    CHECK_EQ(bus_a.errors, bus_b.errors);
+    CHECK_EQ(bus_a.busy_us, bus_b.busy_us);
+    CHECK_EQ(a->stats.counters.rx_frames, b->stats.counters.rx_frames);
+    CHECK_EQ(a->drops.queue_full, b->drops.queue_full);
+    CHECK_EQ(a->stats.counters.tx_latency_max_us, b->stats.counters.tx_latency_max_us);
+    CHECK_EQ(a->generator_latency_max_us, b->generator_latency_max_us);
+}
+
+}  // namespace
+
+int main() {
+    RUN_TEST(test_thirty_nodes_ninety_percent);
+    RUN_TEST(test_slow_consumer_drops_oldest);
+    RUN_TEST(test_deterministic);
+    return host_test_result();
+}
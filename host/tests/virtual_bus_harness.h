@@ -0,0 +1,30 @@
+#pragma once
+// Common fixture of the host scenarios on a TWAI_VirtualBus. A scenario
+// derives from virtual_bus_harness_t, adds its nodes and keeps its results
+// as members; host tests and twai_bench build it with run_scenario() and
+// read those members.
+#include "TWAI_VirtualBus.h"
+#include <memory>
+#include <utility>
+
+struct virtual_bus_harness_t {
+    TWAI_VirtualBus bus{500000};
+
+    /** @brief Add a node and start it (error active) */
+    int add_started_node(TWAI_VirtualBus::rx_handler_t on_rx = nullptr, void* context = nullptr) {
+        int node = bus.add_node(on_rx, nullptr, context);
+        if (node >= 0) bus.start(node);
+        return node;
+    }
+};
+
+/**
+ * @brief Build a scenario on the heap and run it with @p args
+ * @details The bus and the scenario buffers do not fit on a task stack
+ */
+template <typename Scenario, typename... Args>
+std::unique_ptr<Scenario> run_scenario(Args&&... args) {
+    std::unique_ptr<Scenario> scenario(new Scenario());
+    scenario->run(std::forward<Args>(args)...);
+    return scenario;
+}
@@ -0,0 +1,81 @@
+#pragma once
+// 30-node scenario of examples/TWAI_VirtualBus: 29 generators load the bus
+// to about 90% and one TWAI_Object is the device under test (periodic event
+// ring consumer, half of the generator IDs filtered, TX with deadlines,
+// random errors and a forced bus-off halfway).
+#include "TWAI_Object.h"
+#include "virtual_bus_harness.h"
+#include <cstring>
+
+struct virtual_bus_scenario_t : virtual_bus_harness_t {
+    TWAI_Object dut;
+    int generators = 0;
+    int generator_node[MAX_VIRTUAL_NODES];
+    uint32_t tx_results[3] = {};                ///< DUT completions per twai_tx_result_t
+    TWAI_Object::drop_stats_t drops = {};
+    TWAI_Object::stats_t stats = {};
+    uint32_t generator_sent = 0;                ///< Frames sent by all generators
+    uint32_t generator_latency_max_us = 0;      ///< Worst generator TX latency
+    uint32_t generator_bus_off = 0;             ///< Generator bus-off entries
+
+    static void count_tx(const TWAI_Object::tx_completion_t& completion, void* context) {
+        ++static_cast<virtual_bus_scenario_t*>(context)->tx_results[completion.result];
+    }
+
+    /**
+     * @brief Run the scenario for @p run_ms of virtual time
+     * @param nodes Nodes on the bus, device under test included
+     * @param period_ms Period of each generator frame
+     * @param drain_ms Period of the event ring consumer (16 events per pass)
+     */
+    void run(int nodes, uint32_t period_ms, uint64_t run_ms, uint32_t drain_ms = 5) {
+        generators = nodes - 1;
+        for (int i = 0; i < generators; ++i) generator_node[i] = add_started_node();
+        bus.set_error_rate(200, 42);
+
+        dut.attach_virtual_bus(bus);
+        dut.enable_event_ring(true);
+        dut.set_overflow_policy(TWAI_Object::TWAI_OVERFLOW_DROP_OLDEST);
+        dut.set_tx_complete_handler(count_tx, this);
+        TWAI_Object::twai_user_filter_t ids = { 0x100, 0x17F, TWAI_Object::TWAI_FILTER_TYPE_RANGE, false };
+        dut.set_filters(&ids, 1);
+        if (!dut.begin(GPIO_NUM_5, GPIO_NUM_4, 500000)) return;
+
+        TWAI_Object::can_event_packed_t events[16];
+        twai_message_t status = {};
+        status.identifier = 0x050;
+        status.data_length_code = 4;
+        twai_message_t diag = {};       // Baja prioridad: sin valor pasados 2 ms
+        diag.identifier = 0x7F0;
+        diag.data_length_code = 8;
+        TWAI_Object::tx_options_t diag_options = {};
+        diag_options.deadline_us = 2000;
+
+        for (uint64_t ms = 1; ms <= run_ms; ++ms) {
+            for (int i = 0; i < generators; ++i) {
+                if ((ms + i) % period_ms != 0) continue;
+                twai_message_t msg = {};
+                msg.identifier = 0x100 + i * 8;
+                msg.data_length_code = 8;
+                memcpy(msg.data, &ms, sizeof(ms));
+                bus.transmit(generator_node[i], msg);
+            }
+            if (ms % 10 == 0) dut.send(status, 0);
+            if (ms % 10 == 5) dut.send(diag, diag_options, 0);
+            if (ms == run_ms / 2) bus.force_bus_off(generator_node[0]);
+            bus.run_until(ms * 1000);
+            if (ms % drain_ms == 0) dut.receive_batch(events, 16, 0);  // Consumidor lento
+        }
+
+        drops = dut.get_drop_stats();
+        stats = dut.get_stats();
+        for (int i = 0; i < generators; ++i) {
+            TWAI_VirtualBus::node_stats_t node;
+            bus.get_node_stats(generator_node[i], node);
+            generator_sent += node.tx_frames;
+            generator_bus_off += node.bus_off_count;
+            if (node.tx_latency_max_us > generator_latency_max_us) generator_latency_max_us = node.tx_latency_max_us;
+        }
+        dut.end();
+    }
+};
@@ -0,0 +1,143 @@
+#include "TWAI_BusLoad.h"
+#include "TWAI_FrameBits.h"
+
+namespace {
+
+constexpr uint64_t SLOT_US = uint64_t(TWAI_BUSLOAD_SLOT_MS) * 1000;
+
+}  // namespace
+
+void TWAI_BusLoad::configure(uint32_t baud_rate, twai_stuffing_t stuffing_mode, uint64_t now_us) {
+    portENTER_CRITICAL_SAFE(&lock);
+    baud = baud_rate;
+    stuffing = stuffing_mode;
+    slot_index = now_us / SLOT_US;
+    open_bits = open_frames = 0;
+    for (uint32_t i = 0; i < TWAI_BUSLOAD_SLOTS; ++i) slot_bits[i] = slot_frames[i] = 0;
+    bits_1s = frames_1s = 0;
+    bits_all = 0;
+    peak_bits = peak_frames = frames = closed_slots = 0;
+    id_bits.clear();
+    id_bits_total = 0;
+    portEXIT_CRITICAL_SAFE(&lock);
+}
+
+uint32_t TWAI_BusLoad::frame_bits(const twai_message_t& msg) const {
+    uint32_t bits = stuffing == TWAI_STUFFING_ACTUAL
+        ? TWAI_FrameBits::frame_bits(msg)
+        : TWAI_FrameBits::max_frame_bits(msg.extd, msg.rtr ? 0 : msg.data_length_code);
+    return bits + TWAI_FrameBits::INTERMISSION_BITS;
+}
+
+void TWAI_BusLoad::on_frame(const twai_message_t& msg, uint64_t end_us) {
+    if (!baud) return;
+    // La longitud se calcula fuera de la sección crítica
+    uint32_t bits = frame_bits(msg);
+
+    portENTER_CRITICAL_SAFE(&lock);
+    advance(end_us);
+    open_bits += bits;
+    ++open_frames;
+    ++frames;
+    id_bits.record(msg.identifier, msg.extd, bits);
+    id_bits_total += bits;
+    portEXIT_CRITICAL_SAFE(&lock);
+}
+
+void TWAI_BusLoad::advance(uint64_t now_us) {
+    uint64_t index = now_us / SLOT_US;
+    if (index <= slot_index) return;   // Tramas con sello algo anterior van al hueco abierto
+
+    // Más de una ventana en silencio: todo a cero de una vez
+    if (index - slot_index > TWAI_BUSLOAD_SLOTS) {
+        close_slot();
+        for (uint32_t i = 0; i < TWAI_BUSLOAD_SLOTS; ++i) slot_bits[i] = slot_frames[i] = 0;
+        bits_1s = frames_1s = 0;
+        bits_all = 0;
+        closed_slots = TWAI_BUSLOAD_SLOTS;
+        id_bits.clear();
+        id_bits_total = 0;
+        slot_index = index;
+        return;
+    }
+    while (slot_index < index) close_slot();
+}
+
+void TWAI_BusLoad::close_slot() {
+    uint32_t i = uint32_t(slot_index % TWAI_BUSLOAD_SLOTS);
+    uint32_t old_1s = uint32_t((slot_index + TWAI_BUSLOAD_SLOTS - SLOTS_1S) % TWAI_BUSLOAD_SLOTS);
+
+    // La ranura i guarda el hueco de hace TWAI_BUSLOAD_SLOTS; la de old_1s sale de la ventana de 1 s
+    bits_all += open_bits;
+    bits_all -= slot_bits[i];
+    bits_1s += open_bits;
+    frames_1s += open_frames;
+    bits_1s -= slot_bits[old_1s];
+    frames_1s -= slot_frames[old_1s];
+    slot_bits[i] = open_bits;
+    slot_frames[i] = open_frames;
+    if (open_bits > peak_bits) peak_bits = open_bits;
+    if (open_frames > peak_frames) peak_frames = open_frames;
+    if (closed_slots < TWAI_BUSLOAD_SLOTS) ++closed_slots;
+
+    // Reparto por ID: media exponencial de unos segundos
+    if ((slot_index + 1) % SLOTS_1S == 0) {
+        id_bits.decay();
+        id_bits_total /= 2;
+    }
+
+    open_bits = open_frames = 0;
+    ++slot_index;
+}
+
+TWAI_BusLoad::load_t TWAI_BusLoad::read(uint64_t now_us, bool reset) {
+    load_t result = {};
+    if (!baud) return result;
+
+    portENTER_CRITICAL_SAFE(&lock);
+    advance(now_us);
+    const float slot_capacity = float(baud) * TWAI_BUSLOAD_SLOT_MS / 1000.0f;
+    uint32_t last = uint32_t((slot_index + TWAI_BUSLOAD_SLOTS - 1) % TWAI_BUSLOAD_SLOTS);
+    uint32_t slots_1s = closed_slots < SLOTS_1S ? closed_slots : SLOTS_1S;
+    if (closed_slots) {
+        result.load_slot = float(slot_bits[last]) / slot_capacity;
+        result.load_1s = float(bits_1s) / (slot_capacity * slots_1s);
+        result.load_10s = float(bits_all) / (slot_capacity * closed_slots);
+        result.frames_per_s = uint32_t(uint64_t(frames_1s) * 1000 / (uint64_t(slots_1s) * TWAI_BUSLOAD_SLOT_MS));
+    }
+    result.peak_load_slot = float(peak_bits) / slot_capacity;
+    result.peak_frames_per_s = peak_frames * 1000 / TWAI_BUSLOAD_SLOT_MS;
+    result.frames = frames;
+    if (reset) peak_bits = peak_frames = frames = 0;
+    portEXIT_CRITICAL_SAFE(&lock);
+    return result;
+}
+
+size_t TWAI_BusLoad::top_ids(id_share_t* out, size_t max) {
+    if (!out || !max || !baud) return 0;
+
+    TWAI_IdHistogram::entry_t entries[TWAI_ID_HISTOGRAM_SIZE];
+    portENTER_CRITICAL_SAFE(&lock);
+    size_t count = id_bits.snapshot(entries, TWAI_ID_HISTOGRAM_SIZE);
+    uint32_t total = id_bits_total;
+    uint32_t slots_1s = closed_slots < SLOTS_1S ? closed_slots : SLOTS_1S;
+    float load_1s = slots_1s ? float(bits_1s) / (float(baud) * TWAI_BUSLOAD_SLOT_MS / 1000.0f * slots_1s) : 0.0f;
+    portEXIT_CRITICAL_SAFE(&lock);
+
+    // Selección parcial: solo hacen falta los max primeros
+    size_t n = count < max ? count : max;
+    for (size_t i = 0; i < n; ++i) {
+        size_t best = i;
+        for (size_t j = i + 1; j < count; ++j) {
+            if (entries[j].count > entries[best].count) best = j;
+        }
+        TWAI_IdHistogram::entry_t e = entries[best];
+        entries[best] = entries[i];
+        out[i].id = e.id;
+        out[i].is_extended = e.is_extended;
+        out[i].share = total ? float(e.count) / float(total) : 0.0f;
+        if (out[i].share > 1.0f) out[i].share = 1.0f;
+        out[i].load = out[i].share * load_1s;
+    }
+    return n;
+}
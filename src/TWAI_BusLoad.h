@@ -0,0 +1,135 @@
+#pragma once
+#include <driver/twai.h>
+#include <freertos/FreeRTOS.h>
+#include <cstddef>
+#include <cstdint>
+#include "TWAI_IdHistogram.h"
+
+#ifndef TWAI_BUSLOAD_SLOT_MS
+/**Length of one bus load slot (the shortest window)*/
+#define TWAI_BUSLOAD_SLOT_MS (100)
+#endif  // TWAI_BUSLOAD_SLOT_MS
+
+#ifndef TWAI_BUSLOAD_SLOTS
+/**Slots kept (TWAI_BUSLOAD_SLOTS * TWAI_BUSLOAD_SLOT_MS is the longest window)*/
+#define TWAI_BUSLOAD_SLOTS (100)
+#endif  // TWAI_BUSLOAD_SLOTS
+
+/**
+ * @enum twai_stuffing_t
+ * @brief How stuff bits are counted in frame lengths
+ */
+typedef enum {
+    TWAI_STUFFING_ACTUAL,       ///< Stuff bits of the real ID and payload (CRC computed per frame)
+    TWAI_STUFFING_WORST_CASE    ///< Worst-case stuffing for the format and DLC (constant time)
+} twai_stuffing_t;
+
+/**
+ * @class TWAI_BusLoad
+ * @brief Rolling bus utilization from the frames seen by one controller
+ *
+ * @details Each frame adds its on-wire length (TWAI_FrameBits, plus
+ * intermission) to the open slot; when a slot closes it enters running
+ * sums over the last second and over all slots, so reading every window
+ * is O(1) and a frame costs one length computation, a few additions and a
+ * histogram update under a spinlock (ISR or task). Per-ID bandwidth is
+ * counted in a TWAI_IdHistogram weighted by bits and halved every second.
+ *
+ * Only frames that reach the controller are counted: the load is exact
+ * for the whole bus when the acceptance filter passes every ID, and
+ * error frames and retransmissions are never included.
+ */
+class TWAI_BusLoad {
+public:
+    /**
+     * @struct load_t
+     * @brief Utilization over the standard windows
+     */
+    typedef struct {
+        float load_slot;            ///< Last complete slot (100 ms by default), 0..1
+        float load_1s;              ///< Last second of complete slots, 0..1
+        float load_10s;             ///< All TWAI_BUSLOAD_SLOTS complete slots (10 s by default), 0..1
+        float peak_load_slot;       ///< Highest single-slot load since reset
+        uint32_t frames_per_s;      ///< Frame rate over the last second of complete slots
+        uint32_t peak_frames_per_s; ///< Highest frame rate of a single slot since reset
+        uint32_t frames;            ///< Frames counted since reset
+    } load_t;
+
+    /**
+     * @struct id_share_t
+     * @brief Bandwidth used by one ID
+     */
+    typedef struct {
+        uint32_t id;        ///< Frame identifier
+        bool is_extended;   ///< 29-bit identifier
+        float share;        ///< Fraction of the counted bits (recent seconds), 0..1
+        float load;         ///< Fraction of the bus capacity, 0..1
+    } id_share_t;
+
+    /**
+     * @brief Start measuring
+     * @param baud_rate Bus speed in bps
+     * @param stuffing How stuff bits are counted
+     * @param now_us Current time
+     */
+    void configure(uint32_t baud_rate, twai_stuffing_t stuffing, uint64_t now_us);
+
+    /** @brief True once configure() was called with a non-zero baud rate */
+    bool enabled() const { return baud != 0; }
+
+    /**
+     * @brief Count one frame seen on the bus (ISR or task)
+     * @param msg Received or transmitted frame
+     * @param end_us Time the frame ended
+     */
+    void on_frame(const twai_message_t& msg, uint64_t end_us);
+
+    /**
+     * @brief Read the utilization windows
+     * @param now_us Current time (closes the slots that ended, idle or not)
+     * @param reset True to clear peaks and the frame count
+     */
+    load_t read(uint64_t now_us, bool reset = false);
+
+    /**
+     * @brief IDs using the most bandwidth, busiest first
+     * @param out Destination
+     * @param max Capacity of @p out
+     * @return Entries written
+     */
+    size_t top_ids(id_share_t* out, size_t max);
+
+    /**
+     * @brief On-wire bits counted for a frame, intermission included
+     * @param msg Frame
+     */
+    uint32_t frame_bits(const twai_message_t& msg) const;
+
+private:
+    static constexpr uint32_t SLOTS_1S = 1000 / TWAI_BUSLOAD_SLOT_MS;   ///< Slots in the 1 s window
+    static_assert(SLOTS_1S >= 1 && SLOTS_1S <= TWAI_BUSLOAD_SLOTS, "1 s window must fit in the slots");
+
+    portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;  ///< Protects everything below
+    uint32_t baud = 0;                          ///< Bus speed (0 = not configured)
+    twai_stuffing_t stuffing = TWAI_STUFFING_ACTUAL; ///< Stuff bit counting
+    uint64_t slot_index = 0;                    ///< Index (time / slot length) of the open slot
+    uint32_t open_bits = 0;                     ///< Bits of the open slot
+    uint32_t open_frames = 0;                   ///< Frames of the open slot
+    uint32_t slot_bits[TWAI_BUSLOAD_SLOTS] = {};    ///< Bits of each closed slot
+    uint32_t slot_frames[TWAI_BUSLOAD_SLOTS] = {};  ///< Frames of each closed slot
+    uint32_t bits_1s = 0;                       ///< Sum over the last SLOTS_1S closed slots
+    uint32_t frames_1s = 0;                     ///< Frames over the last SLOTS_1S closed slots
+    uint64_t bits_all = 0;                      ///< Sum over all closed slots
+    uint32_t peak_bits = 0;                     ///< Busiest closed slot
+    uint32_t peak_frames = 0;                   ///< Most frames in a closed slot
+    uint32_t frames = 0;                        ///< Frames since reset
+    uint32_t closed_slots = 0;                  ///< Slots closed since configure() (saturates)
+    TWAI_IdHistogram id_bits;                   ///< Bits per ID (decayed every second)
+    uint32_t id_bits_total = 0;                 ///< Bits recorded in id_bits (decayed with it)
+
+    /** @brief Close the slots that ended before @p now_us (lock held) */
+    void advance(uint64_t now_us);
+
+    /** @brief Close the open slot (lock held) */
+    void close_slot();
+};
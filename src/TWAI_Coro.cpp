@@ -0,0 +1,494 @@
+#include "TWAI_Coro.h"
+
+#if TWAI_COROUTINES
+#include <cstdlib>
+
+std::atomic<uint32_t> TWAI_CoTask::live_frames{0};
+std::atomic<uint32_t> TWAI_CoTask::live_bytes{0};
+
+void TWAI_CoTask::promise_type::unhandled_exception() noexcept {
+    abort();
+}
+
+void* TWAI_CoTask::promise_type::operator new(size_t size) noexcept {
+    void* frame = malloc(size);
+    if (frame) {
+        live_frames.fetch_add(1, std::memory_order_relaxed);
+        live_bytes.fetch_add(uint32_t(size), std::memory_order_relaxed);
+    }
+    return frame;
+}
+
+void TWAI_CoTask::promise_type::operator delete(void* frame, size_t size) noexcept {
+    if (!frame) return;
+    live_frames.fetch_sub(1, std::memory_order_relaxed);
+    live_bytes.fetch_sub(uint32_t(size), std::memory_order_relaxed);
+    free(frame);
+}
+
+TWAI_CoReceive TWAI_Object::co_receive(const twai_user_filter_t& ids, TickType_t timeout) {
+    return TWAI_CoReceive(co_executor, co_executor ? co_executor->arm_rx(ids, timeout) : -1);
+}
+
+TWAI_CoSend TWAI_Object::co_send(const twai_message_t& msg, TickType_t timeout) {
+    return TWAI_CoSend(co_executor, co_executor ? co_executor->arm_tx(msg, timeout) : -1);
+}
+
+TWAI_CoExecutor::TWAI_CoExecutor(TWAI_Object& controller) : controller(controller) {
+    for (uint16_t i = 0; i < MAX_CO_WAITS; ++i) {
+        waits[i] = {};
+        waits[i].kind = WAIT_FREE;
+        waits[i].next = i + 1 < MAX_CO_WAITS ? i + 1 : NONE;
+    }
+    free_head = 0;
+    for (uint32_t i = 0; i < TWAI_CO_BUCKETS; ++i) buckets[i] = bucket_tails[i] = NONE;
+    for (int& handle : subscriptions) handle = -1;
+    controller.attach_executor(this);
+    controller.set_tx_complete_handler(tx_complete, this);
+}
+
+TWAI_CoExecutor::~TWAI_CoExecutor() {
+    stop();
+    for (int i = 0; i < MAX_SUBSCRIPTIONS; ++i) unlisten(i);
+    controller.set_tx_complete_handler(user_tx_handler, user_tx_context);
+    controller.attach_executor(nullptr);
+
+    // Destruir los flujos suspendidos, fuera del cerrojo: liberan sus esperas
+    for (wait_t& w : waits) {
+        portENTER_CRITICAL_SAFE(&lock);
+        std::coroutine_handle<> handle = w.handle;
+        w.handle = nullptr;
+        portEXIT_CRITICAL_SAFE(&lock);
+        if (handle) handle.destroy();
+    }
+}
+
+int TWAI_CoExecutor::listen(const TWAI_Object::twai_user_filter_t& ids) {
+    for (int i = 0; i < MAX_SUBSCRIPTIONS; ++i) {
+        if (subscriptions[i] >= 0) continue;
+        subscriptions[i] = controller.subscribe_executor(ids, this);
+        return subscriptions[i] >= 0 ? i : -1;
+    }
+    return -1;
+}
+
+bool TWAI_CoExecutor::unlisten(int handle) {
+    if (handle < 0 || handle >= MAX_SUBSCRIPTIONS || subscriptions[handle] < 0) return false;
+    controller.unsubscribe(subscriptions[handle]);
+    subscriptions[handle] = -1;
+    return true;
+}
+
+bool TWAI_CoExecutor::spawn(TWAI_CoTask task) {
+    if (!task.valid()) return false;
+
+    portENTER_CRITICAL_SAFE(&lock);
+    uint16_t slot = alloc(WAIT_SPAWN);
+    if (slot != NONE) {
+        waits[slot].handle = task.handle;
+        task.handle = nullptr;
+        complete(slot);
+    }
+    portEXIT_CRITICAL_SAFE(&lock);
+    if (slot == NONE) return false;
+    notify();
+    return true;
+}
+
+TWAI_CoSleep TWAI_CoExecutor::sleep(TickType_t ticks) {
+    return TWAI_CoSleep(this, arm_sleep(ticks));
+}
+
+bool TWAI_CoExecutor::start(UBaseType_t priority, BaseType_t core) {
+    if (task) return true;
+    return xTaskCreatePinnedToCore(executor_task, "TWAI_CO", TWAI_CO_STACK_SIZE, this,
+                                   priority, &task, core) == pdPASS;
+}
+
+void TWAI_CoExecutor::stop() {
+    if (!task) return;
+    vTaskDelete(task);
+    task = nullptr;
+    waiter.store(nullptr, std::memory_order_release);
+}
+
+void TWAI_CoExecutor::executor_task(void* arg) {
+    TWAI_CoExecutor* self = static_cast<TWAI_CoExecutor*>(arg);
+    while (true) {
+        self->run(portMAX_DELAY);
+    }
+}
+
+size_t TWAI_CoExecutor::run(TickType_t wait) {
+    if (wait > 0) {
+        portENTER_CRITICAL_SAFE(&lock);
+        uint64_t next = next_deadline_us;
+        bool idle = ready_head == NONE;
+        portEXIT_CRITICAL_SAFE(&lock);
+
+        // Dormir como mucho hasta el próximo plazo
+        uint64_t now = controller.now_us();
+        if (next != NO_DEADLINE) {
+            uint64_t ticks = next > now ? (next - now) / (1000ULL * portTICK_PERIOD_MS) + 1 : 0;
+            if (ticks < wait) wait = TickType_t(ticks);
+        }
+        if (idle && wait > 0) {
+            // Registrarse antes de volver a mirar, para no perder la notificación
+            waiter.store(xTaskGetCurrentTaskHandle(), std::memory_order_release);
+            portENTER_CRITICAL_SAFE(&lock);
+            idle = ready_head == NONE;
+            portEXIT_CRITICAL_SAFE(&lock);
+            if (idle) ulTaskNotifyTake(pdTRUE, wait);
+            waiter.store(nullptr, std::memory_order_release);
+        }
+    }
+    wake_pending.store(false, std::memory_order_release);
+    expire(controller.now_us());
+
+    size_t resumed = 0;
+    while (true) {
+        std::coroutine_handle<> handle;
+        portENTER_CRITICAL_SAFE(&lock);
+        uint16_t slot = ready_head;
+        if (slot != NONE) {
+            wait_t& w = waits[slot];
+            ready_head = w.ready_next;
+            if (ready_head == NONE) ready_tail = NONE;
+            w.queued = false;
+            handle = w.handle;
+            w.handle = nullptr;
+            if (w.kind == WAIT_SPAWN) {
+                free_slot(slot);
+            } else {
+                uint32_t latency = uint32_t(esp_timer_get_time()) - w.ready_stamp;
+                if (latency >= 0x80000000u) latency = 0;
+                latency_total_us += latency;
+                ++latency_count;
+                if (latency > latency_max_us) latency_max_us = latency;
+            }
+            ++resumes;
+        }
+        portEXIT_CRITICAL_SAFE(&lock);
+        if (slot == NONE) break;
+
+        // La espera la libera el awaitable al destruirse tras await_resume()
+        handle.resume();
+        ++resumed;
+    }
+    return resumed;
+}
+
+void TWAI_CoExecutor::set_tx_complete_handler(TWAI_Object::tx_complete_handler_t handler, void* context) {
+    user_tx_handler = handler;
+    user_tx_context = context;
+}
+
+TWAI_CoExecutor::stats_t TWAI_CoExecutor::get_stats(bool reset) {
+    stats_t s = {};
+    s.tasks = TWAI_CoTask::frames();
+    s.frame_bytes = TWAI_CoTask::frame_bytes();
+    s.unclaimed = reset ? unclaimed.exchange(0, std::memory_order_relaxed)
+                        : unclaimed.load(std::memory_order_relaxed);
+
+    portENTER_CRITICAL_SAFE(&lock);
+    s.waits = waits_used;
+    s.waits_peak = waits_peak;
+    s.waits_full = waits_full;
+    s.resumes = resumes;
+    s.timeouts = timeouts;
+    s.resume_latency_avg_us = latency_count ? uint32_t(latency_total_us / latency_count) : 0;
+    s.resume_latency_max_us = latency_max_us;
+    if (reset) {
+        waits_peak = waits_used;
+        waits_full = resumes = timeouts = 0;
+        latency_total_us = 0;
+        latency_count = latency_max_us = 0;
+    }
+    portEXIT_CRITICAL_SAFE(&lock);
+    return s;
+}
+
+void IRAM_ATTR TWAI_CoExecutor::on_frame(const TWAI_Object::can_event_t& event, BaseType_t* woken) {
+    const twai_message_t& msg = event.message;
+    bool is_extended = msg.extd;
+
+    portENTER_CRITICAL_SAFE(&lock);
+    // Primero las esperas de un solo ID (tabla hash), después rangos y máscaras
+    uint16_t slot = buckets[bucket(msg.identifier, is_extended)];
+    while (slot != NONE && (waits[slot].ids.id != msg.identifier || waits[slot].ids.is_extended != is_extended)) {
+        slot = waits[slot].next;
+    }
+    if (slot == NONE) {
+        slot = general_head;
+        while (slot != NONE && !matches(waits[slot].ids, msg)) slot = waits[slot].next;
+    }
+    bool wake = false;
+    if (slot != NONE) {
+        unlink_rx(slot);
+        waits[slot].rx.received = true;
+        waits[slot].rx.event = event;
+        complete(slot);
+        wake = waits[slot].queued;
+    }
+    portEXIT_CRITICAL_SAFE(&lock);
+
+    if (slot == NONE) {
+        unclaimed.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    // Una sola notificación por vaciado de la lista de listos
+    TaskHandle_t executor = waiter.load(std::memory_order_acquire);
+    if (wake && executor && !wake_pending.exchange(true, std::memory_order_acq_rel)) {
+        vTaskNotifyGiveFromISR(executor, woken);
+    }
+}
+
+uint16_t TWAI_CoExecutor::alloc(wait_kind_t kind) {
+    uint16_t slot = free_head;
+    if (slot == NONE) {
+        ++waits_full;
+        return NONE;
+    }
+    wait_t& w = waits[slot];
+    free_head = w.next;
+    w.kind = kind;
+    w.done = false;
+    w.queued = false;
+    w.bucketed = false;
+    w.prev = w.next = w.ready_next = NONE;
+    ++w.generation;
+    w.deadline_us = NO_DEADLINE;
+    w.handle = nullptr;
+    w.rx = {};
+    w.tx = TWAI_TX_FAILED;
+    if (++waits_used > waits_peak) waits_peak = waits_used;
+    return slot;
+}
+
+void TWAI_CoExecutor::free_slot(uint16_t slot) {
+    wait_t& w = waits[slot];
+    w.kind = WAIT_FREE;
+    w.handle = nullptr;
+    w.next = free_head;
+    free_head = slot;
+    --waits_used;
+}
+
+int TWAI_CoExecutor::arm_rx(const TWAI_Object::twai_user_filter_t& ids, TickType_t timeout) {
+    uint64_t due = deadline(timeout);
+    portENTER_CRITICAL_SAFE(&lock);
+    uint16_t slot = alloc(WAIT_RX);
+    if (slot != NONE) {
+        waits[slot].ids = ids;
+        waits[slot].deadline_us = due;
+        link_rx(slot);
+        if (due < next_deadline_us) next_deadline_us = due;
+    }
+    portEXIT_CRITICAL_SAFE(&lock);
+    return slot == NONE ? -1 : slot;
+}
+
+int TWAI_CoExecutor::arm_tx(const twai_message_t& msg, TickType_t timeout) {
+    // Margen tras el plazo para que llegue el TWAI_TX_EXPIRED de la cola
+    uint64_t due = deadline(timeout);
+    if (due != NO_DEADLINE) due += 2000ULL * TWAI_SERVICE_PERIOD_MS;
+
+    portENTER_CRITICAL_SAFE(&lock);
+    uint16_t slot = alloc(WAIT_TX);
+    uint16_t generation = 0;
+    if (slot != NONE) {
+        waits[slot].deadline_us = due;
+        generation = waits[slot].generation;
+        if (due < next_deadline_us) next_deadline_us = due;
+    }
+    portEXIT_CRITICAL_SAFE(&lock);
+    if (slot == NONE) return -1;
+
+    TWAI_Object::tx_options_t options = {};
+    options.deadline_us = timeout == portMAX_DELAY ? 0 : uint64_t(timeout) * portTICK_PERIOD_MS * 1000;
+    options.tag = CO_TAG | (uint32_t(generation & 0x7FFF) << 16) | slot;
+    if (!controller.send(msg, options, 0)) {
+        // Cola llena: resultado TWAI_TX_FAILED inmediato
+        portENTER_CRITICAL_SAFE(&lock);
+        complete(slot);
+        portEXIT_CRITICAL_SAFE(&lock);
+    }
+    return slot;
+}
+
+int TWAI_CoExecutor::arm_sleep(TickType_t ticks) {
+    uint64_t due = deadline(ticks);
+    portENTER_CRITICAL_SAFE(&lock);
+    uint16_t slot = alloc(WAIT_SLEEP);
+    if (slot != NONE) {
+        waits[slot].deadline_us = due;
+        if (due < next_deadline_us) next_deadline_us = due;
+    }
+    portEXIT_CRITICAL_SAFE(&lock);
+    return slot == NONE ? -1 : slot;
+}
+
+void TWAI_CoExecutor::link_rx(uint16_t slot) {
+    wait_t& w = waits[slot];
+    w.bucketed = w.ids.type == TWAI_Object::TWAI_FILTER_TYPE_LIST;
+    uint32_t b = bucket(w.ids.id, w.ids.is_extended);
+    uint16_t& head = w.bucketed ? buckets[b] : general_head;
+    uint16_t& tail = w.bucketed ? bucket_tails[b] : general_tail;
+
+    w.prev = tail;
+    w.next = NONE;
+    if (tail != NONE) waits[tail].next = slot;
+    else head = slot;
+    tail = slot;
+}
+
+void TWAI_CoExecutor::unlink_rx(uint16_t slot) {
+    wait_t& w = waits[slot];
+    uint32_t b = bucket(w.ids.id, w.ids.is_extended);
+    uint16_t& head = w.bucketed ? buckets[b] : general_head;
+    uint16_t& tail = w.bucketed ? bucket_tails[b] : general_tail;
+
+    if (w.prev != NONE) waits[w.prev].next = w.next;
+    else head = w.next;
+    if (w.next != NONE) waits[w.next].prev = w.prev;
+    else tail = w.prev;
+    w.prev = w.next = NONE;
+}
+
+void IRAM_ATTR TWAI_CoExecutor::complete(uint16_t slot) {
+    wait_t& w = waits[slot];
+    w.done = true;
+    if (!w.handle || w.queued) return;
+
+    w.queued = true;
+    w.ready_next = NONE;
+    w.ready_stamp = uint32_t(esp_timer_get_time());
+    if (ready_tail != NONE) waits[ready_tail].ready_next = slot;
+    else ready_head = slot;
+    ready_tail = slot;
+}
+
+void TWAI_CoExecutor::expire(uint64_t now_us) {
+    portENTER_CRITICAL_SAFE(&lock);
+    if (now_us >= next_deadline_us) {
+        // Recorrer las esperas solo cuando vence la más próxima
+        uint64_t next = NO_DEADLINE;
+        for (uint16_t i = 0; i < MAX_CO_WAITS; ++i) {
+            wait_t& w = waits[i];
+            if (w.kind < WAIT_RX || w.done || w.deadline_us == NO_DEADLINE) continue;
+            if (w.deadline_us > now_us) {
+                if (w.deadline_us < next) next = w.deadline_us;
+                continue;
+            }
+            if (w.kind == WAIT_RX) unlink_rx(i);
+            if (w.kind == WAIT_TX) w.tx = TWAI_TX_EXPIRED;
+            if (w.kind != WAIT_SLEEP) ++timeouts;
+            complete(i);
+        }
+        next_deadline_us = next;
+    }
+    portEXIT_CRITICAL_SAFE(&lock);
+}
+
+void TWAI_CoExecutor::notify() {
+    TaskHandle_t executor = waiter.load(std::memory_order_acquire);
+    if (executor && !wake_pending.exchange(true, std::memory_order_acq_rel)) xTaskNotifyGive(executor);
+}
+
+uint64_t TWAI_CoExecutor::deadline(TickType_t timeout) const {
+    if (timeout == portMAX_DELAY) return NO_DEADLINE;
+    return controller.now_us() + uint64_t(timeout) * portTICK_PERIOD_MS * 1000;
+}
+
+bool IRAM_ATTR TWAI_CoExecutor::matches(const TWAI_Object::twai_user_filter_t& ids, const twai_message_t& msg) {
+    if (bool(msg.extd) != ids.is_extended) return false;
+    switch (ids.type) {
+        case TWAI_Object::TWAI_FILTER_TYPE_MASK:
+        case TWAI_Object::TWAI_FILTER_TYPE_CARE_MASK:
+            return ((msg.identifier ^ ids.id) & TWAI_Object::care_bits(ids)) == 0;
+        case TWAI_Object::TWAI_FILTER_TYPE_LIST:
+            return msg.identifier == ids.id;
+        case TWAI_Object::TWAI_FILTER_TYPE_RANGE:
+            return msg.identifier >= ids.id && msg.identifier <= ids.mask_or_end_id;
+    }
+    return false;
+}
+
+bool TWAI_CoExecutor::is_done(int slot) {
+    portENTER_CRITICAL_SAFE(&lock);
+    bool done = waits[slot].done;
+    portEXIT_CRITICAL_SAFE(&lock);
+    return done;
+}
+
+bool TWAI_CoExecutor::park(int slot, std::coroutine_handle<> handle) {
+    // Terminada entre await_ready() y aquí: seguir sin suspender
+    portENTER_CRITICAL_SAFE(&lock);
+    bool suspend = !waits[slot].done;
+    if (suspend) waits[slot].handle = handle;
+    portEXIT_CRITICAL_SAFE(&lock);
+    return suspend;
+}
+
+void TWAI_CoExecutor::release(int slot) {
+    portENTER_CRITICAL_SAFE(&lock);
+    wait_t& w = waits[slot];
+    if (w.kind == WAIT_RX && !w.done) unlink_rx(slot);
+    if (w.queued) {
+        // Solo al destruir un flujo ya listo: sacarlo de la lista
+        uint16_t* link = &ready_head;
+        uint16_t prev = NONE;
+        while (*link != slot) {
+            prev = *link;
+            link = &waits[*link].ready_next;
+        }
+        *link = w.ready_next;
+        if (ready_tail == slot) ready_tail = prev;
+        w.queued = false;
+    }
+    free_slot(slot);
+    portEXIT_CRITICAL_SAFE(&lock);
+}
+
+void TWAI_CoExecutor::tx_complete(const TWAI_Object::tx_completion_t& completion, void* context) {
+    TWAI_CoExecutor* self = static_cast<TWAI_CoExecutor*>(context);
+    if (!(completion.tag & CO_TAG)) {
+        if (self->user_tx_handler) self->user_tx_handler(completion, self->user_tx_context);
+        return;
+    }
+
+    // Descartar la finalización de una espera ya vencida o reutilizada
+    uint16_t slot = completion.tag & 0xFFFF;
+    uint16_t generation = (completion.tag >> 16) & 0x7FFF;
+    bool wake = false;
+    portENTER_CRITICAL_SAFE(&self->lock);
+    if (slot < MAX_CO_WAITS) {
+        wait_t& w = self->waits[slot];
+        if (w.kind == WAIT_TX && !w.done && (w.generation & 0x7FFF) == generation) {
+            w.tx = completion.result;
+            self->complete(slot);
+            wake = w.queued;
+        }
+    }
+    portEXIT_CRITICAL_SAFE(&self->lock);
+    if (wake) self->notify();
+}
+
+TWAI_CoExecutor::rx_result_t TWAI_CoReceive::await_resume() noexcept {
+    TWAI_CoExecutor::rx_result_t result = {};
+    if (slot < 0) return result;
+    portENTER_CRITICAL_SAFE(&executor->lock);
+    result = executor->waits[slot].rx;
+    portEXIT_CRITICAL_SAFE(&executor->lock);
+    return result;
+}
+
+twai_tx_result_t TWAI_CoSend::await_resume() noexcept {
+    if (slot < 0) return TWAI_TX_FAILED;
+    portENTER_CRITICAL_SAFE(&executor->lock);
+    twai_tx_result_t result = executor->waits[slot].tx;
+    portEXIT_CRITICAL_SAFE(&executor->lock);
+    return result;
+}
+
+#endif  // TWAI_COROUTINES
@@ -0,0 +1,413 @@
+#pragma once
+#include "TWAI_Object.h"
+
+#if TWAI_COROUTINES
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+
+#ifndef MAX_CO_WAITS
+/**Operations (receives, sends, sleeps, tasks about to start) pending at once in one executor*/
+#define MAX_CO_WAITS (256)
+#endif  // MAX_CO_WAITS
+
+#ifndef TWAI_CO_BUCKETS
+/**Hash buckets of the single-ID receive waits (power of two)*/
+#define TWAI_CO_BUCKETS (64)
+#endif  // TWAI_CO_BUCKETS
+
+#ifndef TWAI_CO_STACK_SIZE
+/**Stack size of the executor task (shared by every coroutine it runs)*/
+#define TWAI_CO_STACK_SIZE (4096)
+#endif  // TWAI_CO_STACK_SIZE
+
+/**
+ * @class TWAI_CoTask
+ * @brief Coroutine run by a TWAI_CoExecutor (fire and forget)
+ *
+ * @details A function returning TWAI_CoTask and using co_await becomes a
+ * protocol flow: calling it allocates its frame (the locals that live
+ * across co_await points, typically a few hundred bytes) and
+ * TWAI_CoExecutor::spawn() starts it. The frame is freed when the
+ * function returns. Allocation is nothrow: on failure the task is empty
+ * and spawn() refuses it.
+ *
+ * @note Flows are not awaitable: share code between flows with plain
+ * functions, or spawn sub-flows
+ */
+class TWAI_CoTask {
+public:
+    /**
+     * @struct promise_type
+     * @brief Coroutine promise (used by the compiler)
+     */
+    struct promise_type {
+        TWAI_CoTask get_return_object() noexcept {
+            return TWAI_CoTask(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        static TWAI_CoTask get_return_object_on_allocation_failure() noexcept { return TWAI_CoTask(); }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept;
+        static void* operator new(size_t size) noexcept;
+        static void operator delete(void* frame, size_t size) noexcept;
+    };
+
+    TWAI_CoTask() = default;
+    TWAI_CoTask(TWAI_CoTask&& other) noexcept : handle(other.handle) { other.handle = nullptr; }
+    TWAI_CoTask(const TWAI_CoTask&) = delete;
+    TWAI_CoTask& operator=(const TWAI_CoTask&) = delete;
+    ~TWAI_CoTask() { if (handle) handle.destroy(); }
+
+    /** @brief True if the frame was allocated and not yet spawned */
+    bool valid() const { return bool(handle); }
+
+    /** @brief Coroutine frames alive (all executors) */
+    static uint32_t frames() { return live_frames.load(std::memory_order_relaxed); }
+
+    /** @brief Bytes of the coroutine frames alive (all executors) */
+    static uint32_t frame_bytes() { return live_bytes.load(std::memory_order_relaxed); }
+
+private:
+    friend class TWAI_CoExecutor;
+
+    std::coroutine_handle<promise_type> handle = nullptr;  ///< Frame not yet spawned
+    static std::atomic<uint32_t> live_frames;             ///< Frames allocated
+    static std::atomic<uint32_t> live_bytes;              ///< Bytes allocated
+
+    explicit TWAI_CoTask(std::coroutine_handle<promise_type> h) : handle(h) {}
+};
+
+class TWAI_CoSleep;
+
+/**
+ * @class TWAI_CoExecutor
+ * @brief Single-task executor resuming coroutines from the RX and TX completion paths
+ *
+ * @details Every pending co_receive(), co_send() and sleep() holds one of
+ * MAX_CO_WAITS wait slots instead of a task: frames of the ID sets given
+ * to listen() are matched in the RX interrupt against the armed receive
+ * waits (single-ID waits through a hash table first, then ranges and
+ * masks by scanning; the oldest matching wait wins within each), TX
+ * completions are matched by tag, and the slot is
+ * queued as ready. One task then resumes the ready coroutines in order,
+ * all on its stack. A frame of a listened ID that no wait claims is
+ * dropped and counted as unclaimed.
+ *
+ * Timeouts are checked against the earliest deadline, so the slots are
+ * scanned only when one expires.
+ *
+ * The executor installs the TX completion handler of its controller;
+ * completions of frames not sent by co_send() are passed on to the
+ * handler given to set_tx_complete_handler().
+ *
+ * @note spawn() may be called from any task; the awaitables only from
+ * coroutines run by this executor
+ */
+class TWAI_CoExecutor {
+public:
+    /**
+     * @struct rx_result_t
+     * @brief Result of co_receive()
+     */
+    typedef struct {
+        bool received;                      ///< False on timeout (or no free wait slot)
+        TWAI_Object::can_event_t event;     ///< Frame received
+    } rx_result_t;
+
+    /**
+     * @struct stats_t
+     * @brief Executor counters
+     */
+    typedef struct {
+        uint32_t tasks;                     ///< Coroutine frames alive (all executors)
+        uint32_t frame_bytes;               ///< Bytes of those frames
+        uint32_t waits;                     ///< Wait slots in use
+        uint32_t waits_peak;                ///< Most wait slots in use at once
+        uint32_t waits_full;                ///< Operations refused for lack of a slot
+        uint32_t resumes;                   ///< Coroutines resumed
+        uint32_t timeouts;                  ///< Waits ended by their deadline
+        uint32_t unclaimed;                 ///< Listened frames with no matching wait
+        uint32_t resume_latency_avg_us;     ///< Average ready to resumed time
+        uint32_t resume_latency_max_us;     ///< Longest ready to resumed time
+    } stats_t;
+
+    /**
+     * @brief Create the executor of a controller
+     * @param controller Controller whose co_receive()/co_send() it runs
+     */
+    explicit TWAI_CoExecutor(TWAI_Object& controller);
+    ~TWAI_CoExecutor();
+
+    /**
+     * @brief Route frames to the receive waits
+     * @param ids ID set (MASK, CARE_MASK, LIST = single ID, or RANGE)
+     * @return Subscription handle, or -1 if the dispatch tables are full
+     * @note Frames of these IDs no longer reach the event queue/ring
+     */
+    int listen(const TWAI_Object::twai_user_filter_t& ids);
+
+    /**
+     * @brief Stop routing an ID set
+     * @param handle Handle returned by listen()
+     */
+    bool unlisten(int handle);
+
+    /**
+     * @brief Start a coroutine
+     * @param task Flow returned by a TWAI_CoTask function
+     * @return False if the task is empty or no wait slot is free (the flow is destroyed)
+     */
+    bool spawn(TWAI_CoTask task);
+
+    /**
+     * @brief Suspend the calling coroutine
+     * @param ticks Delay in ticks
+     * @return Awaitable
+     */
+    TWAI_CoSleep sleep(TickType_t ticks);
+
+    /**
+     * @brief Run the executor in its own task
+     * @param priority Task priority
+     * @param core Core affinity (tskNO_AFFINITY for any)
+     * @return False if the task could not be created
+     */
+    bool start(UBaseType_t priority = tskIDLE_PRIORITY + 5, BaseType_t core = tskNO_AFFINITY);
+
+    /** @brief Stop the executor task */
+    void stop();
+
+    /**
+     * @brief Resume the ready coroutines (when not using start())
+     * @param wait Maximum time to wait for one to become ready
+     * @return Coroutines resumed
+     * @note Single consumer: one task only. On a virtual bus call it with
+     * wait 0 after advancing the bus
+     */
+    size_t run(TickType_t wait = 0);
+
+    /**
+     * @brief Handler for the TX completions not started by co_send()
+     * @param handler Callback (nullptr to remove)
+     * @param context User pointer passed to @p handler
+     */
+    void set_tx_complete_handler(TWAI_Object::tx_complete_handler_t handler, void* context = nullptr);
+
+    /**
+     * @brief Get the executor counters
+     * @param reset True to clear the event counters and peaks after reading
+     */
+    stats_t get_stats(bool reset = false);
+
+    /** @brief RAM of one wait slot (each pending co_receive(), co_send() or sleep() holds one) */
+    static constexpr size_t wait_slot_bytes() { return sizeof(wait_t); }
+
+    /**
+     * @brief Match a frame against the receive waits (RX interrupt)
+     * @param event Received frame
+     * @param woken Set to pdTRUE if the executor was woken
+     * @note Internal use - called by TWAI_Object
+     */
+    void on_frame(const TWAI_Object::can_event_t& event, BaseType_t* woken);
+
+private:
+    friend class TWAI_CoWait;
+    friend class TWAI_CoReceive;
+    friend class TWAI_CoSend;
+    friend class TWAI_Object;
+
+    static constexpr uint16_t NONE = 0xFFFF;        ///< Empty link
+    static constexpr uint32_t CO_TAG = 0x80000000u; ///< TX tag bit of co_send() frames
+    static constexpr uint64_t NO_DEADLINE = UINT64_MAX;
+
+    /**
+     * @enum wait_kind_t
+     * @brief What a wait slot waits for
+     */
+    enum wait_kind_t : uint8_t {
+        WAIT_FREE,      ///< Slot unused
+        WAIT_SPAWN,     ///< Task about to start
+        WAIT_RX,        ///< co_receive()
+        WAIT_TX,        ///< co_send()
+        WAIT_SLEEP      ///< sleep()
+    };
+
+    /**
+     * @struct wait_t
+     * @brief Wait slot
+     */
+    typedef struct {
+        wait_kind_t kind;                       ///< Operation
+        bool done;                              ///< Result available
+        bool queued;                            ///< In the ready list
+        bool bucketed;                          ///< RX wait in a hash bucket (single ID)
+        uint16_t prev;                          ///< RX list links (free list: next only)
+        uint16_t next;
+        uint16_t ready_next;                    ///< Ready list link
+        uint16_t generation;                    ///< Reuse count (checked in TX tags)
+        TWAI_Object::twai_user_filter_t ids;    ///< Frames accepted by an RX wait
+        uint64_t deadline_us;                   ///< Timeout (NO_DEADLINE = none)
+        uint32_t ready_stamp;                   ///< Low 32 bits of the esp_timer time it became ready
+        std::coroutine_handle<> handle;         ///< Suspended coroutine (nullptr = not yet)
+        rx_result_t rx;                         ///< RX result
+        twai_tx_result_t tx;                    ///< TX result
+    } wait_t;
+
+    TWAI_Object& controller;                        ///< Controller of the operations
+    portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;   ///< Protects the slots and lists
+    wait_t waits[MAX_CO_WAITS];                     ///< Wait slots
+    uint16_t free_head = NONE;                      ///< Free slots
+    uint16_t buckets[TWAI_CO_BUCKETS];              ///< Single-ID RX waits by ID hash (FIFO)
+    uint16_t bucket_tails[TWAI_CO_BUCKETS];         ///< Last wait of each bucket
+    uint16_t general_head = NONE;                   ///< Range and mask RX waits (FIFO)
+    uint16_t general_tail = NONE;                   ///< Last range or mask wait
+    uint16_t ready_head = NONE;                     ///< Slots to resume (FIFO)
+    uint16_t ready_tail = NONE;                     ///< Last slot to resume
+    uint64_t next_deadline_us = NO_DEADLINE;        ///< Earliest deadline (may be early after a cancel)
+    std::atomic<TaskHandle_t> waiter{nullptr};      ///< Executor blocked in run()
+    std::atomic<bool> wake_pending{false};          ///< Executor already notified
+    TaskHandle_t task = nullptr;                    ///< Task created by start()
+    TWAI_Object::tx_complete_handler_t user_tx_handler = nullptr;  ///< Completions of other frames
+    void* user_tx_context = nullptr;                ///< Context of user_tx_handler
+    int subscriptions[MAX_SUBSCRIPTIONS];           ///< listen() handles (-1 = free)
+    uint32_t waits_used = 0;                        ///< Slots in use
+    uint32_t waits_peak = 0;                        ///< Most slots in use
+    uint32_t waits_full = 0;                        ///< Refused operations
+    uint32_t resumes = 0;                           ///< Coroutines resumed
+    uint32_t timeouts = 0;                          ///< Expired waits
+    std::atomic<uint32_t> unclaimed{0};             ///< Frames no wait claimed
+    uint64_t latency_total_us = 0;                  ///< Sum of resume latencies
+    uint32_t latency_count = 0;                     ///< Resume latencies measured
+    uint32_t latency_max_us = 0;                    ///< Longest resume latency
+
+    /** @brief Take a free slot and count it (lock held), NONE if full */
+    uint16_t alloc(wait_kind_t kind);
+
+    /** @brief Return a slot to the free list (lock held) */
+    void free_slot(uint16_t slot);
+
+    /** @brief Arm an RX wait: link it and start its timeout */
+    int arm_rx(const TWAI_Object::twai_user_filter_t& ids, TickType_t timeout);
+
+    /** @brief Arm a TX wait and queue the frame */
+    int arm_tx(const twai_message_t& msg, TickType_t timeout);
+
+    /** @brief Arm a sleep wait */
+    int arm_sleep(TickType_t ticks);
+
+    /** @brief Link an RX wait at the tail of its list (lock held) */
+    void link_rx(uint16_t slot);
+
+    /** @brief Unlink an RX wait (lock held) */
+    void unlink_rx(uint16_t slot);
+
+    /** @brief Mark a slot done and queue its coroutine if suspended (lock held) */
+    void complete(uint16_t slot);
+
+    /** @brief End the waits whose deadline passed */
+    void expire(uint64_t now_us);
+
+    /** @brief Wake the executor task (task context) */
+    void notify();
+
+    /** @brief Convert a timeout in ticks to an absolute deadline */
+    uint64_t deadline(TickType_t timeout) const;
+
+    /** @brief Bucket of a single ID */
+    static uint32_t bucket(uint32_t id, bool is_extended) {
+        return ((id ^ (is_extended ? 0x9E3779B9u : 0)) * 2654435761u >> 16) & (TWAI_CO_BUCKETS - 1);
+    }
+
+    /** @brief True if a frame belongs to an ID set */
+    static bool matches(const TWAI_Object::twai_user_filter_t& ids, const twai_message_t& msg);
+
+    /**
+     * @name Awaitable support
+     * @brief Used by TWAI_CoWait and its subclasses
+     * @{
+     */
+    bool is_done(int slot);
+    bool park(int slot, std::coroutine_handle<> handle);
+    void release(int slot);
+    /** @} */
+
+    /** @brief TX completion handler installed on the controller */
+    static void tx_complete(const TWAI_Object::tx_completion_t& completion, void* context);
+
+    /** @brief Executor task body */
+    static void executor_task(void* arg);
+
+    static_assert(MAX_CO_WAITS < NONE, "MAX_CO_WAITS must fit the 16-bit slot links");
+    static_assert((TWAI_CO_BUCKETS & (TWAI_CO_BUCKETS - 1)) == 0, "TWAI_CO_BUCKETS must be a power of two");
+};
+
+/**
+ * @class TWAI_CoWait
+ * @brief Awaitable base: one armed wait slot
+ *
+ * @details The operation starts when the awaitable is created; co_await
+ * only waits for its result. Destroying an awaitable that was never
+ * awaited cancels the wait.
+ */
+class TWAI_CoWait {
+public:
+    TWAI_CoWait(TWAI_CoWait&& other) noexcept : executor(other.executor), slot(other.slot) { other.slot = -1; }
+    TWAI_CoWait(const TWAI_CoWait&) = delete;
+    TWAI_CoWait& operator=(const TWAI_CoWait&) = delete;
+    ~TWAI_CoWait() { if (slot >= 0) executor->release(slot); }
+
+    bool await_ready() const noexcept { return slot < 0 || executor->is_done(slot); }
+    bool await_suspend(std::coroutine_handle<> handle) noexcept { return executor->park(slot, handle); }
+
+protected:
+    TWAI_CoWait(TWAI_CoExecutor* executor, int slot) : executor(executor), slot(slot) {}
+
+    TWAI_CoExecutor* executor;  ///< Owner of the slot
+    int slot;                   ///< Wait slot (-1 = none: the operation failed at once)
+};
+
+/**
+ * @class TWAI_CoReceive
+ * @brief Awaitable of TWAI_Object::co_receive()
+ */
+class TWAI_CoReceive : public TWAI_CoWait {
+public:
+    TWAI_CoExecutor::rx_result_t await_resume() noexcept;
+
+private:
+    friend class TWAI_Object;
+    TWAI_CoReceive(TWAI_CoExecutor* executor, int slot) : TWAI_CoWait(executor, slot) {}
+};
+
+/**
+ * @class TWAI_CoSend
+ * @brief Awaitable of TWAI_Object::co_send()
+ * @note TWAI_TX_EXPIRED also when no completion came by the deadline; the
+ * frame may still be sent if the controller already had it
+ */
+class TWAI_CoSend : public TWAI_CoWait {
+public:
+    twai_tx_result_t await_resume() noexcept;
+
+private:
+    friend class TWAI_Object;
+    TWAI_CoSend(TWAI_CoExecutor* executor, int slot) : TWAI_CoWait(executor, slot) {}
+};
+
+/**
+ * @class TWAI_CoSleep
+ * @brief Awaitable of TWAI_CoExecutor::sleep()
+ */
+class TWAI_CoSleep : public TWAI_CoWait {
+public:
+    void await_resume() noexcept {}
+
+private:
+    friend class TWAI_CoExecutor;
+    TWAI_CoSleep(TWAI_CoExecutor* executor, int slot) : TWAI_CoWait(executor, slot) {}
+};
+
+#endif  // TWAI_COROUTINES
@@ -0,0 +1,196 @@
+#include "TWAI_Dispatch.h"
+#include <algorithm>
+#include <cstring>
+
+// Máximo de intervalos en que se expande una suscripción por máscara extendida
+static constexpr uint32_t MAX_MASK_EXPANSION = 16;
+static constexpr uint32_t EXT_ID_MASK = 0x1FFFFFFF;
+
+namespace {
+
+inline uint32_t hash_id(uint32_t id) {
+    // Hash multiplicativo de Knuth
+    return (id * 2654435761u) >> 16;
+}
+
+inline bool is_single(const TWAI_Dispatch::entry_t& e) {
+    return !e.is_mask && e.first == e.last;
+}
+
+// Recorre los intervalos [first, last] que cubre una suscripción extendida
+template <typename F>
+bool for_each_interval(const TWAI_Dispatch::entry_t& e, F&& fn) {
+    if (!e.is_mask) {
+        fn(e.first, e.last);
+        return true;
+    }
+    uint32_t mask = e.last & EXT_ID_MASK;
+    uint32_t code = e.first & mask;
+    uint32_t low_free = mask ? (mask & (~mask + 1)) - 1 : EXT_ID_MASK;
+    uint32_t high_free = ~mask & EXT_ID_MASK & ~low_free;
+    uint32_t bits = 0;
+    for (uint32_t b = high_free; b; b &= b - 1) ++bits;
+    if (bits > 4) return false;  // 2^4 = MAX_MASK_EXPANSION
+
+    uint32_t sub = 0;
+    do {
+        fn(code | sub, code | sub | low_free);
+        sub = (sub - high_free) & high_free;
+    } while (sub != 0);
+    return true;
+}
+
+}  // namespace
+
+static_assert((DISPATCH_EXT_HASH_SIZE & (DISPATCH_EXT_HASH_SIZE - 1)) == 0,
+              "DISPATCH_EXT_HASH_SIZE must be a power of two");
+static_assert(MAX_SUBSCRIPTIONS <= 32, "Group masks are 32 bits wide");
+static_assert(MAX_DISPATCH_GROUPS <= 256 && MAX_DISPATCH_SEGMENTS <= 256, "Indexes are 8 bits wide");
+static_assert(MAX_MASK_EXPANSION == 16, "for_each_interval assumes 4 free bits");
+
+TWAI_Dispatch::TWAI_Dispatch() {
+    memset(entries, 0, sizeof(entries));
+}
+
+int TWAI_Dispatch::add(uint32_t first, uint32_t last, bool is_mask, bool is_extended,
+                       uint8_t kind, void* target, void* context) {
+    if (!is_mask && first > last) std::swap(first, last);
+
+    for (int slot = 0; slot < MAX_SUBSCRIPTIONS; ++slot) {
+        if (entries[slot].active) continue;
+
+        entries[slot] = { target, context, first, last, kind, is_mask, is_extended, true };
+        if (!rebuild()) {
+            // No cabe: deshacer y volver a publicar las tablas anteriores
+            entries[slot].active = false;
+            rebuild();
+            return -1;
+        }
+        return slot;
+    }
+    return -1;
+}
+
+bool TWAI_Dispatch::remove(int handle) {
+    if (handle < 0 || handle >= MAX_SUBSCRIPTIONS || !entries[handle].active) return false;
+    entries[handle].active = false;
+    return rebuild();
+}
+
+uint32_t TWAI_Dispatch::ext_range_mask(uint32_t id) const {
+    uint32_t mask = 0;
+    for (int slot = 0; slot < MAX_SUBSCRIPTIONS; ++slot) {
+        const entry_t& e = entries[slot];
+        if (!e.active || !e.is_extended || is_single(e)) continue;
+        bool hit = e.is_mask ? (id & e.last) == (e.first & e.last)
+                             : (id >= e.first && id <= e.last);
+        if (hit) mask |= 1u << slot;
+    }
+    return mask;
+}
+
+bool TWAI_Dispatch::rebuild() {
+    tables_t& t = tables.back();
+    memset(&t, 0, sizeof(t));
+    t.group_count = 1;  // grupo 0 = sin suscriptores
+
+    auto intern = [&t](uint32_t mask, uint8_t& group) -> bool {
+        for (uint8_t g = 0; g < t.group_count; ++g) {
+            if (t.groups[g] == mask) {
+                group = g;
+                return true;
+            }
+        }
+        if (t.group_count >= MAX_DISPATCH_GROUPS) return false;
+        t.groups[t.group_count] = mask;
+        group = t.group_count++;
+        return true;
+    };
+
+    // 1. Tabla plana de IDs estándar
+    for (uint32_t id = 0; id < 2048; ++id) {
+        uint32_t mask = 0;
+        for (int slot = 0; slot < MAX_SUBSCRIPTIONS; ++slot) {
+            const entry_t& e = entries[slot];
+            if (!e.active || e.is_extended) continue;
+            bool hit = e.is_mask ? (id & e.last) == (e.first & e.last)
+                                 : (id >= e.first && id <= e.last);
+            if (hit) mask |= 1u << slot;
+        }
+        if (mask && !intern(mask, t.std_table[id])) return false;
+    }
+
+    // 2. Hash de IDs extendidos exactos (incluye rangos que también los contienen)
+    for (int slot = 0; slot < MAX_SUBSCRIPTIONS; ++slot) {
+        const entry_t& e = entries[slot];
+        if (!e.active || !e.is_extended || !is_single(e)) continue;
+
+        uint32_t id = e.first & EXT_ID_MASK;
+        uint32_t mask = ext_range_mask(id);
+        for (int other = 0; other < MAX_SUBSCRIPTIONS; ++other) {
+            const entry_t& o = entries[other];
+            if (o.active && o.is_extended && is_single(o) && (o.first & EXT_ID_MASK) == id) {
+                mask |= 1u << other;
+            }
+        }
+
+        uint32_t h = hash_id(id) & (DISPATCH_EXT_HASH_SIZE - 1);
+        size_t probes = 0;
+        while (t.ext_hash[h].group != 0 && t.ext_hash[h].id != id) {
+            h = (h + 1) & (DISPATCH_EXT_HASH_SIZE - 1);
+            if (++probes >= DISPATCH_EXT_HASH_SIZE) return false;
+        }
+        t.ext_hash[h].id = id;
+        if (!intern(mask, t.ext_hash[h].group)) return false;
+    }
+
+    // 3. Segmentos de rangos extendidos: límites ordenados y un grupo por tramo
+    uint32_t bounds[2 * MAX_DISPATCH_SEGMENTS];
+    size_t bound_count = 0;
+    for (int slot = 0; slot < MAX_SUBSCRIPTIONS; ++slot) {
+        const entry_t& e = entries[slot];
+        if (!e.active || !e.is_extended || is_single(e)) continue;
+        bool fits = true;
+        bool expanded = for_each_interval(e, [&](uint32_t first, uint32_t last) {
+            if (bound_count + 2 > 2 * MAX_DISPATCH_SEGMENTS) {
+                fits = false;
+                return;
+            }
+            bounds[bound_count++] = first & EXT_ID_MASK;
+            if ((last & EXT_ID_MASK) < EXT_ID_MASK) bounds[bound_count++] = (last & EXT_ID_MASK) + 1;
+        });
+        if (!expanded || !fits) return false;
+    }
+    std::sort(bounds, bounds + bound_count);
+    bound_count = std::unique(bounds, bounds + bound_count) - bounds;
+
+    for (size_t i = 0; i < bound_count; ++i) {
+        uint8_t group;
+        if (!intern(ext_range_mask(bounds[i]), group)) return false;
+        // Fusionar tramos contiguos con el mismo grupo
+        if (t.segment_count > 0 && t.ext_segments[t.segment_count - 1].group == group) continue;
+        if (t.segment_count >= MAX_DISPATCH_SEGMENTS) return false;
+        t.ext_segments[t.segment_count++] = { bounds[i], group };
+    }
+
+    // Publicar y esperar a las ISR que aún recorren las tablas anteriores
+    tables.publish();
+    return true;
+}
+
+uint8_t TWAI_Dispatch::lookup_extended(const tables_t& t, uint32_t id) {
+    uint32_t h = hash_id(id) & (DISPATCH_EXT_HASH_SIZE - 1);
+    for (size_t probes = 0; probes < DISPATCH_EXT_HASH_SIZE && t.ext_hash[h].group != 0; ++probes) {
+        if (t.ext_hash[h].id == id) return t.ext_hash[h].group;
+        h = (h + 1) & (DISPATCH_EXT_HASH_SIZE - 1);
+    }
+
+    // Último segmento con first <= id
+    size_t lo = 0, hi = t.segment_count;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (t.ext_segments[mid].first <= id) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo > 0 ? t.ext_segments[lo - 1].group : 0;
+}
@@ -0,0 +1,190 @@
+#pragma once
+#include "TWAI_DoubleBuffer.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#ifndef MAX_SUBSCRIPTIONS
+/**Maximum number of simultaneous subscriptions (one bit each in a group mask)*/
+#define MAX_SUBSCRIPTIONS (32)
+#endif  // MAX_SUBSCRIPTIONS
+
+#ifndef MAX_DISPATCH_GROUPS
+/**Maximum number of distinct subscriber sets*/
+#define MAX_DISPATCH_GROUPS (64)
+#endif  // MAX_DISPATCH_GROUPS
+
+#ifndef DISPATCH_EXT_HASH_SIZE
+/**Slots of the 29-bit exact ID hash (power of two)*/
+#define DISPATCH_EXT_HASH_SIZE (64)
+#endif  // DISPATCH_EXT_HASH_SIZE
+
+#ifndef MAX_DISPATCH_SEGMENTS
+/**Maximum number of 29-bit range segments*/
+#define MAX_DISPATCH_SEGMENTS (64)
+#endif  // MAX_DISPATCH_SEGMENTS
+
+/**
+ * @class TWAI_Dispatch
+ * @brief ID to subscriber routing table
+ *
+ * @details Subscriptions cover an 11-bit or 29-bit ID set (single ID, range
+ * or mask). Every distinct set of subscribers that share an ID becomes a
+ * "group" (bitmask of subscription slots). Lookups are:
+ * - 11-bit IDs: flat 2048-entry table of group indexes
+ * - 29-bit single IDs: open addressing hash
+ * - 29-bit ranges: sorted segment table (binary search)
+ *
+ * Tables are rebuilt in task context on every subscribe/unsubscribe into
+ * a second buffer and then published, so lookups are safe from the ISR
+ * and never allocate. The ISR holds a reader_t from the lookup until its
+ * last entry() use: add() and remove() wait for such readers, so a slot is
+ * never reused while an interrupt on the other core still delivers to it.
+ */
+class TWAI_Dispatch {
+public:
+    /**
+     * @struct entry_t
+     * @brief Subscription slot
+     * @details target/context meaning is defined by the owner (kind)
+     */
+    typedef struct {
+        void* target;       ///< Callback, queue or mailbox pointer
+        void* context;      ///< User context
+        uint32_t first;     ///< First ID (or code for mask subscriptions)
+        uint32_t last;      ///< Last ID (or mask for mask subscriptions)
+        uint8_t kind;       ///< Delivery type (owner defined)
+        bool is_mask;       ///< first/last are code/mask
+        bool is_extended;   ///< 29-bit IDs
+        bool active;        ///< Slot in use
+    } entry_t;
+
+    class reader_t;
+
+    TWAI_Dispatch();
+
+    /**
+     * @brief Add a subscription and rebuild the tables
+     * @param first First ID (or acceptance code)
+     * @param last Last ID (or care mask if @p is_mask)
+     * @param is_mask Interpret first/last as code/mask
+     * @param is_extended 29-bit IDs
+     * @param kind Delivery type stored in the slot
+     * @param target Delivery target stored in the slot
+     * @param context User context stored in the slot
+     * @return Subscription handle, or -1 if tables are full
+     */
+    int add(uint32_t first, uint32_t last, bool is_mask, bool is_extended,
+            uint8_t kind, void* target, void* context);
+
+    /**
+     * @brief Remove a subscription and rebuild the tables
+     * @param handle Handle returned by add()
+     * @return True if the subscription existed
+     */
+    bool remove(int handle);
+
+    /**
+     * @brief Find subscribers of an identifier
+     * @param id Frame identifier
+     * @param extended True for 29-bit frames
+     * @return Bitmask of subscription slots (0 if none)
+     * @note To use the slots from an ISR, look up through a reader_t
+     */
+    uint32_t lookup(uint32_t id, bool extended) const;
+
+    /**
+     * @brief Access a subscription slot (task side)
+     * @param slot Slot index (bit position in the lookup() mask)
+     */
+    const entry_t& entry(uint8_t slot) const { return entries[slot]; }
+
+    /** @brief True if any subscription is active */
+    bool empty() const { return tables.front().group_count <= 1; }
+
+private:
+    /**
+     * @struct segment_t
+     * @brief 29-bit ID segment [first, next segment first) mapped to a group
+     */
+    typedef struct {
+        uint32_t first;     ///< First ID of segment
+        uint8_t group;      ///< Group index
+    } segment_t;
+
+    /**
+     * @struct hash_slot_t
+     * @brief Exact 29-bit ID to group
+     */
+    typedef struct {
+        uint32_t id;        ///< Identifier (valid if group != 0)
+        uint8_t group;      ///< Group index (0 = empty slot)
+    } hash_slot_t;
+
+    /**
+     * @struct tables_t
+     * @brief One published generation of lookup tables
+     */
+    typedef struct {
+        uint32_t groups[MAX_DISPATCH_GROUPS];           ///< Subscriber bitmask per group (group 0 = none)
+        uint8_t group_count;                            ///< Used groups
+        uint8_t std_table[2048];                        ///< Group per 11-bit ID
+        hash_slot_t ext_hash[DISPATCH_EXT_HASH_SIZE];   ///< Exact 29-bit IDs
+        segment_t ext_segments[MAX_DISPATCH_SEGMENTS];  ///< 29-bit range segments
+        uint8_t segment_count;                          ///< Used segments
+    } tables_t;
+
+    entry_t entries[MAX_SUBSCRIPTIONS];     ///< Subscription slots
+    TWAI_DoubleBuffer<tables_t> tables;     ///< Lookup tables (published and in rebuild)
+
+    /**
+     * @brief Rebuild the inactive tables from entries and publish them
+     * @return False if the groups, hash or segment tables overflow
+     */
+    bool rebuild();
+
+    /**
+     * @brief Subscribers of an identifier in one table generation
+     */
+    static uint32_t lookup(const tables_t& t, uint32_t id, bool extended) {
+        if (!extended) {
+            return t.groups[t.std_table[id & 0x7FF]];
+        }
+        return t.groups[lookup_extended(t, id & 0x1FFFFFFF)];
+    }
+
+    /**
+     * @brief Hash probe, then segment binary search
+     */
+    static uint8_t lookup_extended(const tables_t& t, uint32_t id);
+
+    /**
+     * @brief Bitmask of 29-bit range/mask entries containing @p id
+     */
+    uint32_t ext_range_mask(uint32_t id) const;
+};
+
+/**
+ * @class TWAI_Dispatch::reader_t
+ * @brief Pins the published tables and the slots they route to
+ * @details ISR safe, never blocks. Keep it alive until the last entry()
+ * returned for its lookup() has been used.
+ */
+class TWAI_Dispatch::reader_t {
+public:
+    explicit reader_t(const TWAI_Dispatch& dispatch) : owner(dispatch), tables(dispatch.tables) {}
+
+    /** @copydoc TWAI_Dispatch::lookup(uint32_t, bool) const */
+    uint32_t lookup(uint32_t id, bool extended) const { return TWAI_Dispatch::lookup(*tables, id, extended); }
+
+    /** @copydoc TWAI_Dispatch::entry */
+    const entry_t& entry(uint8_t slot) const { return owner.entries[slot]; }
+
+private:
+    const TWAI_Dispatch& owner;                         ///< Dispatcher being read
+    TWAI_DoubleBuffer<tables_t>::reader_t tables;       ///< Pinned table generation
+};
+
+inline uint32_t TWAI_Dispatch::lookup(uint32_t id, bool extended) const {
+    return reader_t(*this).lookup(id, extended);
+}
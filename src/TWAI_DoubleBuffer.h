@@ -0,0 +1,76 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+/**
+ * @class TWAI_DoubleBuffer
+ * @brief Two copies of a table: the ISR reads one while a task rebuilds the other
+ *
+ * @details Readers (ISR or task, any core) pin the published copy with a
+ * reader_t for as long as they use it, including anything they reach
+ * through it. The writer (one task at a time) fills back() and calls
+ * publish(), which swaps the copies and then waits until no reader is left
+ * on the old one. So back() is never written while a reader holds it, even
+ * after two quick publishes, and when publish() returns nothing is still
+ * using the previous contents.
+ *
+ * Each reader increments the counter of the copy it is going to read, then
+ * checks that the copy is still the published one; the writer swaps first
+ * and reads the counter afterwards (both sequentially consistent), so
+ * one of the two always sees the other.
+ *
+ * @tparam T Table type
+ */
+template <typename T>
+class TWAI_DoubleBuffer {
+public:
+    /**
+     * @class reader_t
+     * @brief Pins the published copy until destroyed (ISR safe, never blocks)
+     */
+    class reader_t {
+    public:
+        explicit reader_t(const TWAI_DoubleBuffer& buffer) : owner(buffer) {
+            do {
+                index = owner.active.load();
+                owner.readers[index].fetch_add(1);
+                if (owner.active.load() == index) break;
+                owner.readers[index].fetch_sub(1);     // Publicado otro mientras tanto
+            } while (true);
+        }
+        ~reader_t() { owner.readers[index].fetch_sub(1, std::memory_order_release); }
+        reader_t(const reader_t&) = delete;
+        reader_t& operator=(const reader_t&) = delete;
+
+        const T& operator*() const { return owner.items[index]; }
+        const T* operator->() const { return &owner.items[index]; }
+
+    private:
+        const TWAI_DoubleBuffer& owner;
+        uint8_t index;
+    };
+
+    /** @brief Copy being prepared (writer only, no reader can hold it) */
+    T& back() { return items[active.load(std::memory_order_relaxed) ^ 1]; }
+
+    /** @brief Published copy, unpinned (writer side or when no reader can run) */
+    const T& front() const { return items[active.load(std::memory_order_acquire)]; }
+
+    /**
+     * @brief Publish back() and wait for the readers of the old copy
+     * @note Task context. Readers hold the copy for microseconds; the wait
+     * only sleeps if one is still inside after the swap.
+     */
+    void publish() {
+        uint8_t old = active.load(std::memory_order_relaxed);
+        active.store(old ^ 1);
+        while (readers[old].load() != 0) vTaskDelay(1);
+    }
+
+private:
+    T items[2] = {};                            ///< Published and spare copy
+    std::atomic<uint8_t> active{0};             ///< Index of the published copy
+    mutable std::atomic<uint32_t> readers[2] = {};  ///< Readers inside each copy
+};
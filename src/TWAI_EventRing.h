@@ -0,0 +1,94 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @class TWAI_EventRing
+ * @brief Lock-free single-producer/single-consumer ring buffer
+ *
+ * @details Statically allocated storage for @p N items of type @p T.
+ * The producer (ISR) only writes @c head and the consumer (task) advances
+ * @c tail, so no critical section is needed on either side. The producer
+ * may also evict the oldest item; the consumer commits its reads with a
+ * compare-and-swap and retries if an eviction overtook it.
+ * Indices run freely and are wrapped with a mask, so @p N must be a
+ * power of two and the whole capacity is usable.
+ *
+ * @tparam T Item type (trivially copyable)
+ * @tparam N Capacity, power of two
+ */
+template <typename T, size_t N>
+class TWAI_EventRing {
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "TWAI_EventRing capacity must be a power of two");
+
+public:
+    /**
+     * @brief Append one item (producer side)
+     * @param item Item to copy into the ring
+     * @return false if the ring is full (item is not stored)
+     */
+    bool push(const T& item) {
+        const uint32_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) >= N) {
+            return false;
+        }
+        slots[h & MASK] = item;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Remove up to @p max items in one pass (consumer side)
+     * @param out Destination array
+     * @param max Capacity of @p out
+     * @return Number of items copied
+     */
+    size_t pop_batch(T* out, size_t max) {
+        uint32_t t = tail.load(std::memory_order_acquire);
+        size_t n;
+        do {
+            size_t available = head.load(std::memory_order_acquire) - t;
+            n = available < max ? available : max;
+            for (size_t i = 0; i < n; ++i) {
+                out[i] = slots[(t + i) & MASK];
+            }
+            // Si el productor descartó elementos mientras copiábamos, repetir
+        } while (n > 0 && !tail.compare_exchange_weak(t, t + n, std::memory_order_acq_rel,
+                                                       std::memory_order_acquire));
+        return n;
+    }
+
+    /**
+     * @brief Discard the oldest item (producer side)
+     * @return False if the ring is empty or the consumer just took the item
+     */
+    bool evict_oldest() {
+        uint32_t t = tail.load(std::memory_order_acquire);
+        if (head.load(std::memory_order_relaxed) == t) {
+            return false;
+        }
+        return tail.compare_exchange_strong(t, t + 1, std::memory_order_acq_rel);
+    }
+
+    /**
+     * @brief Number of items currently stored
+     * @note Exact only when called from the producer or consumer side
+     */
+    size_t size() const {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+
+    /** @brief True if no items are stored */
+    bool empty() const { return size() == 0; }
+
+    /** @brief Ring capacity in items */
+    static constexpr size_t capacity() { return N; }
+
+private:
+    static constexpr uint32_t MASK = N - 1;
+
+    T slots[N];                         ///< Item storage
+    std::atomic<uint32_t> head{0};      ///< Next write index (producer owned)
+    std::atomic<uint32_t> tail{0};      ///< Next read index (advanced by consumer or eviction)
+};
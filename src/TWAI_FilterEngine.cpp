@@ -0,0 +1,120 @@
+#include "TWAI_FilterEngine.h"
+#include <algorithm>
+#include <cstring>
+
+// Máximo de intervalos en que se expande una máscara extendida
+static constexpr uint32_t MAX_MASK_EXPANSION = 16;
+
+void TWAI_FilterEngine::reset() {
+    accept_all = true;
+    memset(std_bitmap, 0, sizeof(std_bitmap));
+    ext_interval_count = 0;
+    ext_mask_count = 0;
+}
+
+bool TWAI_FilterEngine::add_mask(uint32_t code, uint32_t mask, bool extended) {
+    accept_all = false;
+
+    if (!extended) {
+        // 2048 IDs: se evalúa la máscara sobre todo el espacio estándar
+        mask &= STD_ID_MASK;
+        code &= mask;
+        for (uint32_t id = 0; id <= STD_ID_MASK; ++id) {
+            if ((id & mask) == code) {
+                std_bitmap[id >> 5] |= 1u << (id & 31);
+            }
+        }
+        return true;
+    }
+
+    mask &= EXT_ID_MASK;
+    code &= mask;
+
+    // Bits libres por debajo del bit de cuidado más bajo forman intervalos contiguos
+    uint32_t low_free = mask ? (mask & (~mask + 1)) - 1 : EXT_ID_MASK;
+    uint32_t high_free = ~mask & EXT_ID_MASK & ~low_free;
+    uint32_t high_free_bits = 0;
+    for (uint32_t b = high_free; b; b &= b - 1) ++high_free_bits;
+
+    uint32_t expansion = high_free_bits < 31 ? (1u << high_free_bits) : UINT32_MAX;
+    if (expansion <= MAX_MASK_EXPANSION &&
+        ext_interval_count + expansion <= MAX_EXT_FILTER_INTERVALS) {
+        // Enumerar los subconjuntos de los bits libres altos
+        uint32_t sub = 0;
+        do {
+            uint32_t first = code | sub;
+            ext_table[ext_interval_count++] = { first, first | low_free };
+            sub = (sub - high_free) & high_free;
+        } while (sub != 0);
+        return true;
+    }
+
+    if (ext_mask_count >= MAX_EXT_FILTER_MASKS) return false;
+    ext_mask_rules[ext_mask_count++] = { code, mask };
+    return true;
+}
+
+bool TWAI_FilterEngine::add_range(uint32_t first, uint32_t last, bool extended) {
+    accept_all = false;
+    if (first > last) std::swap(first, last);
+
+    if (!extended) {
+        if (first > STD_ID_MASK) return true;
+        if (last > STD_ID_MASK) last = STD_ID_MASK;
+        for (uint32_t id = first; id <= last; ++id) {
+            std_bitmap[id >> 5] |= 1u << (id & 31);
+        }
+        return true;
+    }
+
+    if (first > EXT_ID_MASK) return true;
+    if (last > EXT_ID_MASK) last = EXT_ID_MASK;
+    if (ext_interval_count >= MAX_EXT_FILTER_INTERVALS) return false;
+    ext_table[ext_interval_count++] = { first, last };
+    return true;
+}
+
+void TWAI_FilterEngine::finalize() {
+    if (ext_interval_count < 2) return;
+
+    std::sort(ext_table, ext_table + ext_interval_count,
+              [](const interval_t& a, const interval_t& b) { return a.first < b.first; });
+
+    // Fusionar intervalos solapados o adyacentes
+    size_t out = 0;
+    for (size_t i = 1; i < ext_interval_count; ++i) {
+        interval_t& cur = ext_table[out];
+        const interval_t& next = ext_table[i];
+        if (next.first <= cur.last + 1) {
+            if (next.last > cur.last) cur.last = next.last;
+        } else {
+            ext_table[++out] = next;
+        }
+    }
+    ext_interval_count = out + 1;
+}
+
+uint32_t TWAI_FilterEngine::std_count() const {
+    if (accept_all) return STD_ID_MASK + 1;
+    uint32_t count = 0;
+    for (uint32_t word : std_bitmap) {
+        for (; word; word &= word - 1) ++count;
+    }
+    return count;
+}
+
+bool TWAI_FilterEngine::match_extended(uint32_t id) const {
+    // Búsqueda binaria del último intervalo con first <= id
+    size_t lo = 0, hi = ext_interval_count;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (ext_table[mid].first <= id) lo = mid + 1;
+        else hi = mid;
+    }
+    if (lo > 0 && id <= ext_table[lo - 1].last) return true;
+
+    for (size_t i = 0; i < ext_mask_count; ++i) {
+        if ((id & ext_mask_rules[i].mask) == ext_mask_rules[i].code) return true;
+    }
+    return false;
+}
@@ -0,0 +1,134 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+#ifndef MAX_EXT_FILTER_INTERVALS
+/**Maximum number of merged 29-bit ID intervals in a compiled filter set*/
+#define MAX_EXT_FILTER_INTERVALS (64)
+#endif  // MAX_EXT_FILTER_INTERVALS
+
+#ifndef MAX_EXT_FILTER_MASKS
+/**Maximum number of 29-bit mask rules that cannot be expanded into intervals*/
+#define MAX_EXT_FILTER_MASKS (32)
+#endif  // MAX_EXT_FILTER_MASKS
+
+/**
+ * @class TWAI_FilterEngine
+ * @brief Compiled software acceptance filter
+ *
+ * @details Turns a set of mask, list and range rules into structures that
+ * can be evaluated from the ISR in bounded time:
+ * - 11-bit IDs: 2048-bit bitmap, one lookup per frame
+ * - 29-bit IDs: sorted, merged interval table (binary search). Mask rules
+ *   are expanded into intervals when the expansion is small; the rest are
+ *   kept in a short list checked after the table.
+ *
+ * An engine with no rules accepts every frame. Rules are added with
+ * reset()/add_*() and become effective after finalize().
+ */
+class TWAI_FilterEngine {
+public:
+    /**
+     * @struct interval_t
+     * @brief Closed 29-bit ID interval
+     */
+    typedef struct {
+        uint32_t first;     ///< First accepted ID
+        uint32_t last;      ///< Last accepted ID
+    } interval_t;
+
+    /**
+     * @struct mask_rule_t
+     * @brief 29-bit code/mask rule: ID accepted if (ID & mask) == (code & mask)
+     */
+    typedef struct {
+        uint32_t code;      ///< Acceptance code
+        uint32_t mask;      ///< Care bits (1 = must match)
+    } mask_rule_t;
+
+    TWAI_FilterEngine() { reset(); }
+
+    /**
+     * @brief Remove all rules (engine accepts every frame)
+     */
+    void reset();
+
+    /**
+     * @brief Add a code/mask rule
+     * @param code Acceptance code
+     * @param mask Care bits (1 = bit must match @p code)
+     * @param extended True for 29-bit IDs
+     * @return False if the compiled tables are full
+     */
+    bool add_mask(uint32_t code, uint32_t mask, bool extended);
+
+    /**
+     * @brief Add an inclusive ID range rule
+     * @param first Lowest accepted ID
+     * @param last Highest accepted ID
+     * @param extended True for 29-bit IDs
+     * @return False if the compiled tables are full
+     */
+    bool add_range(uint32_t first, uint32_t last, bool extended);
+
+    /**
+     * @brief Add a single ID rule
+     * @param id Accepted ID
+     * @param extended True for 29-bit IDs
+     * @return False if the compiled tables are full
+     */
+    bool add_id(uint32_t id, bool extended) { return add_range(id, id, extended); }
+
+    /**
+     * @brief Sort and merge the 29-bit interval table
+     * @note Must be called after the last add_*() and before matches()
+     */
+    void finalize();
+
+    /**
+     * @brief Evaluate a received identifier
+     * @param id Frame identifier
+     * @param extended True for 29-bit frames
+     * @return True if the frame passes the filter set
+     */
+    bool matches(uint32_t id, bool extended) const {
+        if (accept_all) return true;
+        if (!extended) {
+            id &= STD_ID_MASK;
+            return (std_bitmap[id >> 5] >> (id & 31)) & 1u;
+        }
+        return match_extended(id & EXT_ID_MASK);
+    }
+
+    /** @brief True if no rule is installed */
+    bool accepts_all() const { return accept_all; }
+
+    /** @brief True if the 11-bit ID is accepted */
+    bool std_accepted(uint32_t id) const { return matches(id, false); }
+
+    /** @brief Number of accepted 11-bit IDs */
+    uint32_t std_count() const;
+
+    /** @brief Merged 29-bit interval table */
+    const interval_t* ext_intervals(size_t& count) const { count = ext_interval_count; return ext_table; }
+
+    /** @brief 29-bit mask rules kept outside the interval table */
+    const mask_rule_t* ext_masks(size_t& count) const { count = ext_mask_count; return ext_mask_rules; }
+
+    static constexpr uint32_t STD_ID_MASK = 0x7FF;        ///< 11-bit identifier mask
+    static constexpr uint32_t EXT_ID_MASK = 0x1FFFFFFF;   ///< 29-bit identifier mask
+
+private:
+    bool accept_all = true;                             ///< No rules installed
+    uint32_t std_bitmap[(STD_ID_MASK + 1) / 32];        ///< One bit per 11-bit ID
+    interval_t ext_table[MAX_EXT_FILTER_INTERVALS];     ///< Sorted 29-bit intervals
+    size_t ext_interval_count = 0;                      ///< Used entries in ext_table
+    mask_rule_t ext_mask_rules[MAX_EXT_FILTER_MASKS];   ///< Non-expandable 29-bit masks
+    size_t ext_mask_count = 0;                          ///< Used entries in ext_mask_rules
+
+    /**
+     * @brief Binary search of the interval table, then mask rules
+     * @param id 29-bit identifier
+     */
+    bool match_extended(uint32_t id) const;
+};
@@ -0,0 +1,74 @@
+#include "TWAI_FrameBits.h"
+
+namespace {
+
+// Secuencia de bits de SOF hasta el final del CRC (máx. 1+11+1+1+18+1+2+4+64+15)
+struct bit_stream_t {
+    uint8_t bits[128];
+    uint32_t count = 0;
+
+    void put(uint32_t value, uint32_t width) {
+        while (width--) bits[count++] = (value >> width) & 1;
+    }
+};
+
+uint16_t crc15(const bit_stream_t& s) {
+    uint16_t crc = 0;
+    for (uint32_t i = 0; i < s.count; ++i) {
+        bool feedback = s.bits[i] ^ ((crc >> 14) & 1);
+        crc = (crc << 1) & 0x7FFF;
+        if (feedback) crc ^= 0x4599;
+    }
+    return crc;
+}
+
+}  // namespace
+
+uint32_t TWAI_FrameBits::frame_bits(const twai_message_t& msg) {
+    uint8_t dlc = msg.data_length_code & 0x0F;
+    uint8_t length = msg.rtr ? 0 : (dlc > 8 ? 8 : dlc);
+
+    bit_stream_t s;
+    s.put(0, 1);                                        // SOF
+    if (msg.extd) {
+        uint32_t id = msg.identifier & 0x1FFFFFFF;
+        s.put(id >> 18, 11);                            // ID base
+        s.put(1, 1);                                    // SRR
+        s.put(1, 1);                                    // IDE
+        s.put(id & 0x3FFFF, 18);                        // ID extendido
+        s.put(msg.rtr ? 1 : 0, 1);                      // RTR
+        s.put(0, 2);                                    // r1, r0
+    } else {
+        s.put(msg.identifier & 0x7FF, 11);
+        s.put(msg.rtr ? 1 : 0, 1);                      // RTR
+        s.put(0, 2);                                    // IDE, r0
+    }
+    s.put(dlc, 4);
+    for (uint8_t i = 0; i < length; ++i) s.put(msg.data[i], 8);
+    s.put(crc15(s), 15);
+
+    // Bit de relleno tras 5 iguales; el relleno cuenta para la racha siguiente
+    uint32_t stuffed = 0;
+    uint32_t run = 1;
+    uint8_t last = s.bits[0];
+    for (uint32_t i = 1; i < s.count; ++i) {
+        if (s.bits[i] == last) {
+            ++run;
+        } else {
+            last = s.bits[i];
+            run = 1;
+        }
+        if (run == 5) {
+            ++stuffed;
+            last ^= 1;
+            run = 1;
+        }
+    }
+    return s.count + stuffed + FIXED_TAIL_BITS;
+}
+
+uint32_t TWAI_FrameBits::max_frame_bits(bool is_extended, uint8_t length) {
+    if (length > 8) length = 8;
+    uint32_t stuffed_region = (is_extended ? 54 : 34) + 8 * length;
+    return stuffed_region + (stuffed_region - 1) / 4 + FIXED_TAIL_BITS;
+}
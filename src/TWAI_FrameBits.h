@@ -0,0 +1,41 @@
+#pragma once
+#include <driver/twai.h>
+#include <cstdint>
+
+/**
+ * @class TWAI_FrameBits
+ * @brief Exact on-wire length of classic CAN frames
+ *
+ * @details Builds the frame bit stream (SOF to CRC), computes the CRC-15
+ * and counts the stuff bits the controller inserts, so the result is the
+ * real number of bit times a frame occupies for its ID and payload, not a
+ * worst-case estimate.
+ */
+class TWAI_FrameBits {
+public:
+    static constexpr uint32_t FIXED_TAIL_BITS = 10;    ///< CRC delimiter, ACK slot, ACK delimiter and EOF (never stuffed)
+    static constexpr uint32_t INTERMISSION_BITS = 3;   ///< Minimum recessive gap between frames
+
+    /**
+     * @brief Bits from SOF to the end of EOF, stuff bits included
+     * @param msg Frame (identifier, format, RTR, DLC and payload)
+     */
+    static uint32_t frame_bits(const twai_message_t& msg);
+
+    /**
+     * @brief Bits of a frame in the worst stuffing case
+     * @param is_extended True for 29-bit ID
+     * @param length Payload bytes (0 for remote frames)
+     */
+    static uint32_t max_frame_bits(bool is_extended, uint8_t length);
+
+    /**
+     * @brief Bus time of a frame including intermission
+     * @param msg Frame
+     * @param baud_rate Bus speed in bps
+     * @return Nanoseconds
+     */
+    static uint32_t frame_time_ns(const twai_message_t& msg, uint32_t baud_rate) {
+        return uint32_t((uint64_t(frame_bits(msg) + INTERMISSION_BITS) * 1000000000ULL) / baud_rate);
+    }
+};
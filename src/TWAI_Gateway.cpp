@@ -0,0 +1,163 @@
+#include "TWAI_Gateway.h"
+
+TWAI_Gateway::TWAI_Gateway(TWAI_Object& source, TWAI_Object& destination)
+    : source(source), destination(destination) {
+    for (auto& r : routes) {
+        r.used = false;
+        r.subscription = -1;
+        r.forwarded.store(0, std::memory_order_relaxed);
+        r.rate_limited.store(0, std::memory_order_relaxed);
+    }
+}
+
+TWAI_Gateway::~TWAI_Gateway() {
+    stop();
+    for (int i = 0; i < MAX_GATEWAY_ROUTES; ++i) remove_route(i);
+}
+
+int TWAI_Gateway::add_route(const route_t& route) {
+    for (int i = 0; i < MAX_GATEWAY_ROUTES; ++i) {
+        slot_t& r = routes[i];
+        if (r.used) continue;
+
+        r.config = route;
+        r.interval_us = route.rate_limit ? 1000000 / route.rate_limit : 0;
+        r.tolerance_us = route.burst > 1 ? (route.burst - 1) * r.interval_us : 0;
+        r.tat_us = 0;
+        r.forwarded.store(0, std::memory_order_relaxed);
+        r.rate_limited.store(0, std::memory_order_relaxed);
+        // Publicar la ruta antes de que el ISR pueda verla
+        r.subscription = source.subscribe_gateway(route.ids, this, &r);
+        if (r.subscription < 0) return -1;
+        r.used = true;
+        return i;
+    }
+    return -1;
+}
+
+bool TWAI_Gateway::remove_route(int route) {
+    if (route < 0 || route >= MAX_GATEWAY_ROUTES || !routes[route].used) return false;
+    source.unsubscribe(routes[route].subscription);
+    routes[route].subscription = -1;
+    routes[route].used = false;
+    return true;
+}
+
+void IRAM_ATTR TWAI_Gateway::on_frame(const TWAI_Object::can_event_t& event, uint64_t timestamp_us,
+                                      void* route, BaseType_t* woken) {
+    slot_t& r = *static_cast<slot_t*>(route);
+
+    // Límite de tasa (cubeta de fichas en forma GCRA): sin estado por ficha
+    if (r.interval_us) {
+        uint64_t earliest = r.tat_us > r.tolerance_us ? r.tat_us - r.tolerance_us : 0;
+        if (timestamp_us < earliest) {
+            r.rate_limited.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        r.tat_us = (r.tat_us > timestamp_us ? r.tat_us : timestamp_us) + r.interval_us;
+    }
+
+    pending_t item;
+    item.msg = event.message;
+    item.msg.identifier = (event.message.identifier & ~r.config.rewrite_mask)
+                        | (r.config.rewrite_id & r.config.rewrite_mask);
+    item.rx_us = timestamp_us;
+    item.route = uint8_t(&r - routes);
+    if (!ring.push(item)) {
+        ring_full.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    uint32_t level = ring.size();
+    if (level > ring_peak.load(std::memory_order_relaxed)) ring_peak.store(level, std::memory_order_relaxed);
+
+    // Una sola notificación por vaciado del anillo
+    TaskHandle_t forwarder = waiter.load(std::memory_order_acquire);
+    if (forwarder && !wake_pending.exchange(true, std::memory_order_acq_rel)) {
+        vTaskNotifyGiveFromISR(forwarder, woken);
+    }
+}
+
+size_t TWAI_Gateway::service(TickType_t wait, TickType_t tx_wait) {
+    if (ring.empty() && wait > 0) {
+        // Registrarse antes de volver a mirar, para no perder la notificación
+        waiter.store(xTaskGetCurrentTaskHandle(), std::memory_order_release);
+        if (ring.empty()) ulTaskNotifyTake(pdTRUE, wait);
+        waiter.store(nullptr, std::memory_order_release);
+    }
+    wake_pending.store(false, std::memory_order_release);
+
+    pending_t batch[16];
+    size_t total = 0;
+    size_t n;
+    while ((n = ring.pop_batch(batch, 16)) > 0) {
+        for (size_t i = 0; i < n; ++i) {
+            if (!destination.send(batch[i].msg, tx_wait)) {
+                tx_refused.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            routes[batch[i].route].forwarded.fetch_add(1, std::memory_order_relaxed);
+            uint32_t latency = uint32_t(source.now_us() - batch[i].rx_us);
+            latency_total_us.fetch_add(latency, std::memory_order_relaxed);
+            if (latency > latency_max_us.load(std::memory_order_relaxed)) {
+                latency_max_us.store(latency, std::memory_order_relaxed);
+            }
+            ++total;
+        }
+    }
+    forwarded.fetch_add(total, std::memory_order_relaxed);
+    return total;
+}
+
+bool TWAI_Gateway::start(UBaseType_t priority, BaseType_t core, TickType_t tx_wait) {
+    if (task) return true;
+    task_tx_wait = tx_wait;
+    return xTaskCreatePinnedToCore(forward_task, "TWAI_GW", TWAI_GATEWAY_STACK_SIZE, this,
+                                   priority, &task, core) == pdPASS;
+}
+
+void TWAI_Gateway::stop() {
+    if (!task) return;
+    vTaskDelete(task);
+    task = nullptr;
+    waiter.store(nullptr, std::memory_order_release);
+}
+
+void TWAI_Gateway::forward_task(void* arg) {
+    TWAI_Gateway* self = static_cast<TWAI_Gateway*>(arg);
+    while (true) {
+        self->service(portMAX_DELAY, self->task_tx_wait);
+    }
+}
+
+TWAI_Gateway::stats_t TWAI_Gateway::get_stats(bool reset) {
+    stats_t s = {};
+    for (auto& r : routes) {
+        s.rate_limited += reset ? r.rate_limited.exchange(0, std::memory_order_relaxed)
+                                : r.rate_limited.load(std::memory_order_relaxed);
+    }
+    if (reset) {
+        s.forwarded = forwarded.exchange(0, std::memory_order_relaxed);
+        s.ring_full = ring_full.exchange(0, std::memory_order_relaxed);
+        s.tx_refused = tx_refused.exchange(0, std::memory_order_relaxed);
+        s.ring_peak = ring_peak.exchange(0, std::memory_order_relaxed);
+        s.latency_max_us = latency_max_us.exchange(0, std::memory_order_relaxed);
+        uint32_t total = latency_total_us.exchange(0, std::memory_order_relaxed);
+        s.latency_avg_us = s.forwarded ? total / s.forwarded : 0;
+    } else {
+        s.forwarded = forwarded.load(std::memory_order_relaxed);
+        s.ring_full = ring_full.load(std::memory_order_relaxed);
+        s.tx_refused = tx_refused.load(std::memory_order_relaxed);
+        s.ring_peak = ring_peak.load(std::memory_order_relaxed);
+        s.latency_max_us = latency_max_us.load(std::memory_order_relaxed);
+        uint32_t total = latency_total_us.load(std::memory_order_relaxed);
+        s.latency_avg_us = s.forwarded ? total / s.forwarded : 0;
+    }
+    return s;
+}
+
+bool TWAI_Gateway::get_route_stats(int route, uint32_t& forwarded_frames, uint32_t& rate_limited) const {
+    if (route < 0 || route >= MAX_GATEWAY_ROUTES || !routes[route].used) return false;
+    forwarded_frames = routes[route].forwarded.load(std::memory_order_relaxed);
+    rate_limited = routes[route].rate_limited.load(std::memory_order_relaxed);
+    return true;
+}
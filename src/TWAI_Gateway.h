@@ -0,0 +1,178 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "TWAI_EventRing.h"
+#include "TWAI_Object.h"
+
+#ifndef MAX_GATEWAY_ROUTES
+/**Maximum number of routes per gateway*/
+#define MAX_GATEWAY_ROUTES (16)
+#endif  // MAX_GATEWAY_ROUTES
+
+#ifndef TWAI_GATEWAY_RING_SIZE
+/**Frames buffered between the source RX interrupt and the forwarder (power of two)*/
+#define TWAI_GATEWAY_RING_SIZE (128)
+#endif  // TWAI_GATEWAY_RING_SIZE
+
+#ifndef TWAI_GATEWAY_STACK_SIZE
+/**Stack size of the forwarding task*/
+#define TWAI_GATEWAY_STACK_SIZE (3072)
+#endif  // TWAI_GATEWAY_STACK_SIZE
+
+/**
+ * @class TWAI_Gateway
+ * @brief One-way frame forwarding between two controllers
+ *
+ * @details Routes are subscriptions on the source controller: the RX
+ * interrupt looks them up in the dispatch table, applies the route rate
+ * limit and ID rewrite and stores the frame in a lock-free ring, without
+ * passing through the event queue. A forwarding task (start() or a task
+ * calling service()) is woken with a direct notification, at most once
+ * per drain, and hands the frames to the destination's send() in order.
+ * Use two gateways for a bidirectional bridge.
+ *
+ * Routed IDs must pass the source acceptance filters, and frames matching
+ * a route are no longer delivered to the source event queue/ring.
+ */
+class TWAI_Gateway {
+public:
+    /**
+     * @struct route_t
+     * @brief Routing table entry
+     */
+    typedef struct {
+        TWAI_Object::twai_user_filter_t ids;    ///< Source IDs (MASK, LIST or RANGE)
+        uint32_t rewrite_mask;                  ///< ID bits replaced on the destination (0 = same ID)
+        uint32_t rewrite_id;                    ///< New value of the bits in rewrite_mask
+        uint32_t rate_limit;                    ///< Maximum frames per second (0 = unlimited)
+        uint16_t burst;                         ///< Frames allowed back to back under the limit (0 = 1)
+    } route_t;
+
+    /**
+     * @struct stats_t
+     * @brief Forwarding counters
+     */
+    typedef struct {
+        uint32_t forwarded;         ///< Frames accepted by the destination
+        uint32_t rate_limited;      ///< Frames dropped by route rate limits
+        uint32_t ring_full;         ///< Frames dropped because the forwarder fell behind
+        uint32_t tx_refused;        ///< Frames the destination did not accept in time
+        uint32_t ring_peak;         ///< Highest ring occupancy seen
+        uint32_t latency_avg_us;    ///< Average source RX to destination send() time (us)
+        uint32_t latency_max_us;    ///< Longest source RX to destination send() time (us)
+    } stats_t;
+
+    /**
+     * @brief Create a gateway
+     * @param source Controller whose frames are routed
+     * @param destination Controller that transmits them
+     */
+    TWAI_Gateway(TWAI_Object& source, TWAI_Object& destination);
+    ~TWAI_Gateway();
+
+    /**
+     * @brief Add a route
+     * @param route Routing entry
+     * @return Route handle, or -1 if the gateway or dispatch tables are full
+     */
+    int add_route(const route_t& route);
+
+    /**
+     * @brief Remove a route
+     * @param route Handle returned by add_route()
+     * @return True if the route existed
+     */
+    bool remove_route(int route);
+
+    /**
+     * @brief Run the forwarder in its own task
+     * @param priority Task priority
+     * @param core Core affinity (tskNO_AFFINITY for any)
+     * @param tx_wait Longest wait for room in the destination TX queue
+     * @return False if the task could not be created
+     */
+    bool start(UBaseType_t priority = tskIDLE_PRIORITY + 6, BaseType_t core = tskNO_AFFINITY,
+               TickType_t tx_wait = pdMS_TO_TICKS(10));
+
+    /** @brief Stop the forwarding task */
+    void stop();
+
+    /**
+     * @brief Forward pending frames (when not using start())
+     * @param wait Maximum time to wait for a frame
+     * @param tx_wait Longest wait for room in the destination TX queue
+     * @return Frames forwarded
+     * @note Single consumer: one task only
+     */
+    size_t service(TickType_t wait = 0, TickType_t tx_wait = 0);
+
+    /**
+     * @brief Get forwarding counters
+     * @param reset True to clear the counters after reading
+     */
+    stats_t get_stats(bool reset = false);
+
+    /**
+     * @brief Get the counters of one route
+     * @param route Route handle
+     * @param forwarded_frames Frames forwarded by the route
+     * @param rate_limited Frames dropped by its rate limit
+     * @return False if the route does not exist
+     */
+    bool get_route_stats(int route, uint32_t& forwarded_frames, uint32_t& rate_limited) const;
+
+    /**
+     * @brief Route one frame (source RX interrupt)
+     * @param event Received frame
+     * @param timestamp_us Reception time
+     * @param route Route slot stored in the subscription
+     * @param woken Set to pdTRUE if the forwarder was woken
+     * @note Internal use - called by TWAI_Object
+     */
+    void on_frame(const TWAI_Object::can_event_t& event, uint64_t timestamp_us, void* route, BaseType_t* woken);
+
+private:
+    /**
+     * @struct slot_t
+     * @brief Route slot
+     */
+    typedef struct {
+        route_t config;                         ///< Routing entry
+        bool used;                              ///< Slot in use
+        int subscription;                       ///< Dispatch handle on the source
+        uint32_t interval_us;                   ///< 1 / rate_limit (0 = unlimited)
+        uint32_t tolerance_us;                  ///< (burst - 1) * interval_us
+        uint64_t tat_us;                        ///< Theoretical arrival time of the next frame
+        std::atomic<uint32_t> forwarded;        ///< Frames forwarded
+        std::atomic<uint32_t> rate_limited;     ///< Frames over the rate limit
+    } slot_t;
+
+    /**
+     * @struct pending_t
+     * @brief Frame waiting in the ring
+     */
+    typedef struct {
+        twai_message_t msg;     ///< Frame with rewritten ID
+        uint64_t rx_us;         ///< Source reception time
+        uint8_t route;          ///< Route slot index
+    } pending_t;
+
+    TWAI_Object& source;                                        ///< Routed controller
+    TWAI_Object& destination;                                   ///< Transmitting controller
+    slot_t routes[MAX_GATEWAY_ROUTES];                          ///< Routing table
+    TWAI_EventRing<pending_t, TWAI_GATEWAY_RING_SIZE> ring;     ///< Frames to forward
+    std::atomic<TaskHandle_t> waiter{nullptr};                  ///< Forwarder blocked in service()
+    std::atomic<bool> wake_pending{false};                      ///< Forwarder already notified
+    TaskHandle_t task = nullptr;                                ///< Task created by start()
+    TickType_t task_tx_wait = 0;                                ///< tx_wait of the task
+    std::atomic<uint32_t> ring_full{0};                         ///< Ring overflows
+    std::atomic<uint32_t> ring_peak{0};                         ///< Highest ring occupancy
+    std::atomic<uint32_t> forwarded{0};                         ///< Frames accepted by the destination
+    std::atomic<uint32_t> tx_refused{0};                        ///< Frames not accepted by the destination
+    std::atomic<uint32_t> latency_total_us{0};                  ///< Sum of forwarding latencies (us)
+    std::atomic<uint32_t> latency_max_us{0};                    ///< Longest forwarding latency (us)
+
+    /** @brief Forwarding task body */
+    static void forward_task(void* arg);
+};
@@ -0,0 +1,236 @@
+#include "TWAI_HwFilter.h"
+
+namespace {
+
+// Cubo ternario: bits con care=1 deben valer value, el resto es libre
+struct cube_t {
+    uint32_t value;
+    uint32_t care;
+    bool empty;
+};
+
+// Bits de ID dentro de cada espacio de registro
+constexpr uint32_t SINGLE_STD_BITS = 0xFFE00000;   // ID[10:0] en [31:21]
+constexpr uint32_t SINGLE_EXT_BITS = 0xFFFFFFF8;   // ID[28:0] en [31:3]
+constexpr uint32_t DUAL_STD_BITS   = 0xFFE0;       // ID[10:0] en [15:5]
+constexpr uint32_t DUAL_EXT_BITS   = 0xFFF0;       // ID[28:17] en [15:4]
+
+constexpr uint32_t STD_ID_BITS = 11;
+constexpr uint32_t EXT_ID_BITS = 29;
+
+inline uint32_t popcount(uint32_t v) {
+    uint32_t n = 0;
+    for (; v; v &= v - 1) ++n;
+    return n;
+}
+
+inline void merge(cube_t& c, uint32_t value, uint32_t care) {
+    if (c.empty) {
+        c = { value & care, care, false };
+        return;
+    }
+    c.care &= care & ~(c.value ^ value);
+    c.value &= c.care;
+}
+
+inline void map_single(uint32_t& value, uint32_t& care, bool extended) {
+    uint8_t shift = extended ? 3 : 21;
+    value <<= shift;
+    care <<= shift;
+}
+
+inline void map_dual(uint32_t& value, uint32_t& care, bool extended) {
+    // Los 4 bits bajos se dejan libres: en tramas estándar corresponden a datos
+    if (extended) {
+        value = (value >> 13) & DUAL_EXT_BITS;
+        care = (care >> 13) & DUAL_EXT_BITS;
+    } else {
+        value = (value << 5) & DUAL_STD_BITS;
+        care = (care << 5) & DUAL_STD_BITS;
+    }
+}
+
+inline uint64_t pow2(uint32_t bits) {
+    return uint64_t(1) << bits;
+}
+
+uint64_t single_passes(const cube_t& c) {
+    return pow2(STD_ID_BITS - popcount(c.care & SINGLE_STD_BITS)) +
+           pow2(EXT_ID_BITS - popcount(c.care & SINGLE_EXT_BITS));
+}
+
+uint64_t dual_passes(uint32_t care) {
+    return pow2(STD_ID_BITS - popcount(care & DUAL_STD_BITS)) +
+           pow2(EXT_ID_BITS - popcount(care & DUAL_EXT_BITS));
+}
+
+uint64_t dual_passes(const cube_t& a, const cube_t& b) {
+    uint64_t total = dual_passes(a.care) + dual_passes(b.care);
+    // Restar la intersección si ambos filtros son compatibles
+    if (((a.value ^ b.value) & a.care & b.care) == 0) {
+        total -= dual_passes(a.care | b.care);
+    }
+    return total;
+}
+
+// Descompone [first, last] en bloques alineados de potencia de dos
+template <typename F>
+void emit_blocks(uint32_t first, uint32_t last, uint32_t id_mask, bool extended, F& fn) {
+    uint64_t a = first;
+    const uint64_t b = last;
+    while (a <= b) {
+        uint64_t size = a ? (a & (~a + 1)) : (uint64_t(id_mask) + 1);
+        while (a + size - 1 > b) size >>= 1;
+        fn(uint32_t(a), id_mask & ~uint32_t(size - 1), extended);
+        a += size;
+    }
+}
+
+// Recorre el conjunto aceptado como bloques (value, care) en espacio de ID
+template <typename F>
+void for_each_block(const TWAI_FilterEngine& engine, F&& fn) {
+    const uint32_t std_max = TWAI_FilterEngine::STD_ID_MASK;
+    uint32_t id = 0;
+    while (id <= std_max) {
+        if (!engine.std_accepted(id)) {
+            ++id;
+            continue;
+        }
+        uint32_t end = id;
+        while (end < std_max && engine.std_accepted(end + 1)) ++end;
+        emit_blocks(id, end, std_max, false, fn);
+        id = end + 1;
+    }
+
+    size_t count;
+    const TWAI_FilterEngine::interval_t* intervals = engine.ext_intervals(count);
+    for (size_t i = 0; i < count; ++i) {
+        emit_blocks(intervals[i].first, intervals[i].last, TWAI_FilterEngine::EXT_ID_MASK, true, fn);
+    }
+
+    const TWAI_FilterEngine::mask_rule_t* masks = engine.ext_masks(count);
+    for (size_t i = 0; i < count; ++i) {
+        fn(masks[i].code, masks[i].mask, true);
+    }
+}
+
+// Evalúa una partición dual; pick() devuelve true para el filtro B
+template <typename P>
+uint64_t eval_dual(const TWAI_FilterEngine& engine, P pick, cube_t& a, cube_t& b) {
+    a = { 0, 0, true };
+    b = { 0, 0, true };
+    for_each_block(engine, [&](uint32_t value, uint32_t care, bool extended) {
+        map_dual(value, care, extended);
+        merge(pick(value, care, extended) ? b : a, value, care);
+    });
+    if (a.empty || b.empty) return UINT64_MAX;
+    return dual_passes(a, b);
+}
+
+// Registro de filtro dual a partir de los dos cubos
+TWAI_HwFilter::plan_t dual_plan(const cube_t& a, const cube_t& b) {
+    TWAI_HwFilter::plan_t plan = {};
+    plan.acceptance_code = (a.value << 16) | b.value;
+    plan.acceptance_mask = ~((a.care << 16) | b.care);
+    plan.single_filter = false;
+    return plan;
+}
+
+}  // namespace
+
+bool TWAI_HwFilter::passes(const plan_t& plan, uint32_t id, bool extended) {
+    const uint32_t care = ~plan.acceptance_mask;
+    if (plan.single_filter) {
+        uint32_t value = extended ? (id & TWAI_FilterEngine::EXT_ID_MASK) << 3 : (id & TWAI_FilterEngine::STD_ID_MASK) << 21;
+        uint32_t bits = extended ? SINGLE_EXT_BITS : SINGLE_STD_BITS;
+        return ((value ^ plan.acceptance_code) & care & bits) == 0;
+    }
+    uint32_t value = extended ? (id >> 13) & DUAL_EXT_BITS : (id << 5) & DUAL_STD_BITS;
+    uint32_t bits = extended ? DUAL_EXT_BITS : DUAL_STD_BITS;
+    return ((value ^ (plan.acceptance_code >> 16)) & (care >> 16) & bits) == 0 ||
+           ((value ^ plan.acceptance_code) & care & bits) == 0;
+}
+
+uint64_t TWAI_HwFilter::traffic_passed(const plan_t& plan, const TWAI_IdHistogram::entry_t* traffic, size_t count) {
+    uint64_t total = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (passes(plan, traffic[i].id, traffic[i].is_extended)) total += traffic[i].count;
+    }
+    return total;
+}
+
+TWAI_HwFilter::plan_t TWAI_HwFilter::synthesize(const TWAI_FilterEngine& engine) {
+    return synthesize(engine, nullptr, 0);
+}
+
+TWAI_HwFilter::plan_t TWAI_HwFilter::synthesize(const TWAI_FilterEngine& engine,
+                                                const TWAI_IdHistogram::entry_t* traffic, size_t count) {
+    plan_t plan;
+    plan.acceptance_code = 0;
+    plan.acceptance_mask = 0xFFFFFFFF;
+    plan.single_filter = true;
+    plan.passed_ids = pow2(STD_ID_BITS) + pow2(EXT_ID_BITS);
+    plan.accepted_ids = plan.passed_ids;
+
+    if (engine.accepts_all()) return plan;
+
+    // IDs aceptados por software
+    plan.accepted_ids = engine.std_count();
+    size_t rules;
+    const TWAI_FilterEngine::interval_t* intervals = engine.ext_intervals(rules);
+    for (size_t i = 0; i < rules; ++i) {
+        plan.accepted_ids += uint64_t(intervals[i].last - intervals[i].first) + 1;
+    }
+    const TWAI_FilterEngine::mask_rule_t* masks = engine.ext_masks(rules);
+    for (size_t i = 0; i < rules; ++i) {
+        plan.accepted_ids += pow2(EXT_ID_BITS - popcount(masks[i].mask));
+    }
+
+    // 1. Filtro único: el cubo mínimo que contiene todos los bloques
+    cube_t single = { 0, 0, true };
+    for_each_block(engine, [&](uint32_t value, uint32_t care, bool extended) {
+        map_single(value, care, extended);
+        merge(single, value, care);
+    });
+    if (single.empty) {
+        // Ningún ID aceptado: comparar todo el registro con un ID imposible de cubrir
+        single = { 0, 0xFFFFFFFF, false };
+    }
+    uint64_t best = single_passes(single);
+    plan.acceptance_code = single.value;
+    plan.acceptance_mask = ~single.care;
+    // Con tráfico observado manda lo que realmente pasaría; los IDs teóricos desempatan
+    uint64_t best_hits = traffic_passed(plan, traffic, count);
+
+    // 2. Filtro dual: probar divisiones por formato y por cada bit del ID
+    cube_t a, b, best_a = {0, 0, true}, best_b = {0, 0, true};
+    auto consider = [&](uint64_t passes) {
+        if (passes == UINT64_MAX) return;
+        uint64_t hits = count ? traffic_passed(dual_plan(a, b), traffic, count) : 0;
+        if (hits < best_hits || (hits == best_hits && passes < best)) {
+            best = passes;
+            best_hits = hits;
+            best_a = a;
+            best_b = b;
+        }
+    };
+
+    consider(eval_dual(engine, [](uint32_t, uint32_t, bool extended) { return extended; }, a, b));
+    for (uint32_t bit = 4; bit < 16; ++bit) {
+        const uint32_t m = 1u << bit;
+        for (int free_to_b = 0; free_to_b < 2; ++free_to_b) {
+            consider(eval_dual(engine, [m, free_to_b](uint32_t value, uint32_t care, bool) {
+                return (care & m) ? (value & m) != 0 : free_to_b != 0;
+            }, a, b));
+        }
+    }
+
+    if (!best_a.empty) {
+        TWAI_HwFilter::plan_t dual = dual_plan(best_a, best_b);
+        plan.acceptance_code = dual.acceptance_code;
+        plan.acceptance_mask = dual.acceptance_mask;
+        plan.single_filter = false;
+    }
+    plan.passed_ids = best;
+    return plan;
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "TWAI_FilterEngine.h"
+#include "TWAI_IdHistogram.h"
+
+/**
+ * @class TWAI_HwFilter
+ * @brief Acceptance code/mask synthesizer for the TWAI hardware filter
+ *
+ * @details Computes the hardware filter that passes every ID accepted by a
+ * compiled TWAI_FilterEngine while passing as few other IDs as possible.
+ * The accepted set is decomposed into aligned ID blocks; the tightest
+ * single filter covering all blocks is compared with dual filter splits
+ * (by frame format and by every ID bit) and the candidate that lets the
+ * fewest IDs through is chosen.
+ *
+ * Dual filter mode only compares the upper bits of 29-bit IDs, so it wins
+ * mostly on standard-ID filter sets.
+ *
+ * Given observed traffic (IDs rejected in software), the same candidates
+ * are ranked by how many of those frames they would still pass, so the
+ * split that blocks the busiest unwanted IDs is chosen even if it lets
+ * more IDs through in theory.
+ */
+class TWAI_HwFilter {
+public:
+    /**
+     * @struct plan_t
+     * @brief Synthesized hardware filter and its estimated selectivity
+     */
+    typedef struct {
+        uint32_t acceptance_code;   ///< TWAI acceptance code register value
+        uint32_t acceptance_mask;   ///< TWAI acceptance mask register value (1 = don't care)
+        bool single_filter;         ///< True for single filter mode, false for dual
+        uint64_t accepted_ids;      ///< IDs accepted by the software filters (estimate for overlapping 29-bit masks)
+        uint64_t passed_ids;        ///< IDs the hardware filter lets through
+    } plan_t;
+
+    /**
+     * @brief Compute the best hardware filter for a compiled filter set
+     * @param engine Finalized software filter engine
+     * @return Synthesized plan (accept-all if the engine has no rules)
+     */
+    static plan_t synthesize(const TWAI_FilterEngine& engine);
+
+    /**
+     * @brief Compute the hardware filter that passes the least observed unwanted traffic
+     * @param engine Finalized software filter engine
+     * @param traffic Frame counts of IDs rejected in software
+     * @param count Entries in @p traffic
+     * @return Synthesized plan (ties broken by the number of IDs passed)
+     */
+    static plan_t synthesize(const TWAI_FilterEngine& engine, const TWAI_IdHistogram::entry_t* traffic, size_t count);
+
+    /**
+     * @brief True if a plan lets an ID through (identifier bits only)
+     * @param plan Synthesized plan
+     * @param id Frame identifier
+     * @param extended True for 29-bit ID
+     */
+    static bool passes(const plan_t& plan, uint32_t id, bool extended);
+
+    /**
+     * @brief Frames of @p traffic a plan lets through
+     * @param plan Synthesized plan
+     * @param traffic Frame counts per ID
+     * @param count Entries in @p traffic
+     */
+    static uint64_t traffic_passed(const plan_t& plan, const TWAI_IdHistogram::entry_t* traffic, size_t count);
+
+    /**
+     * @brief IDs passed by the hardware filter but rejected in software
+     * @param plan Synthesized plan
+     */
+    static uint64_t false_positive_ids(const plan_t& plan) {
+        return plan.passed_ids > plan.accepted_ids ? plan.passed_ids - plan.accepted_ids : 0;
+    }
+};
@@ -0,0 +1,120 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#ifndef TWAI_ID_HISTOGRAM_SIZE
+/**Slots of the observed-ID histogram (power of two)*/
+#define TWAI_ID_HISTOGRAM_SIZE (64)
+#endif  // TWAI_ID_HISTOGRAM_SIZE
+
+/**
+ * @class TWAI_IdHistogram
+ * @brief Approximate frame (or bit) count of the most frequent IDs
+ *
+ * @details Hash table with short linear probing. An ID that finds no slot
+ * replaces the weakest probed entry if its count is not above the new
+ * weight, and otherwise wears it down by that weight (lossy counting), so
+ * frequent IDs keep their slots and rare ones come and go. record() is a few relaxed atomic operations and
+ * can run in the ISR; decay() and snapshot() run in a task.
+ *
+ * @note Single writer: one ISR (or one task) calls record()
+ */
+class TWAI_IdHistogram {
+    static_assert((TWAI_ID_HISTOGRAM_SIZE & (TWAI_ID_HISTOGRAM_SIZE - 1)) == 0,
+                  "TWAI_ID_HISTOGRAM_SIZE must be a power of two");
+
+public:
+    /**
+     * @struct entry_t
+     * @brief One counted ID
+     */
+    typedef struct {
+        uint32_t id;        ///< Frame identifier
+        bool is_extended;   ///< 29-bit identifier
+        uint32_t count;     ///< Frames (or weight) seen, decayed
+    } entry_t;
+
+    /**
+     * @brief Count one frame
+     * @param id Frame identifier
+     * @param is_extended True for 29-bit ID
+     * @param weight Amount added (1 per frame, or e.g. its bit length)
+     */
+    void record(uint32_t id, bool is_extended, uint32_t weight = 1) {
+        const uint32_t key = make_key(id, is_extended);
+        uint32_t slot = hash(key);
+        uint32_t weakest = slot;
+        uint32_t weakest_count = UINT32_MAX;
+        for (uint32_t i = 0; i < PROBES; ++i, slot = (slot + 1) & (TWAI_ID_HISTOGRAM_SIZE - 1)) {
+            uint32_t k = keys[slot].load(std::memory_order_relaxed);
+            uint32_t c = counts[slot].load(std::memory_order_relaxed);
+            if (k == key) {
+                counts[slot].fetch_add(weight, std::memory_order_relaxed);
+                return;
+            }
+            if (c < weakest_count) {
+                weakest = slot;
+                weakest_count = c;
+            }
+        }
+        // Sin hueco: reemplazar el más débil o desgastarlo
+        if (weakest_count <= weight) {
+            counts[weakest].store(0, std::memory_order_relaxed);
+            keys[weakest].store(key, std::memory_order_relaxed);
+            counts[weakest].store(weight, std::memory_order_relaxed);
+        } else {
+            counts[weakest].fetch_sub(weight, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * @brief Copy the counted IDs
+     * @param out Destination
+     * @param max Capacity of @p out
+     * @return Entries copied (count above zero)
+     */
+    size_t snapshot(entry_t* out, size_t max) const {
+        size_t n = 0;
+        for (uint32_t i = 0; i < TWAI_ID_HISTOGRAM_SIZE && n < max; ++i) {
+            uint32_t c = counts[i].load(std::memory_order_relaxed);
+            uint32_t k = keys[i].load(std::memory_order_relaxed);
+            if (c == 0 || k == 0) continue;
+            out[n].id = k & ID_MASK;
+            out[n].is_extended = (k & EXTENDED) != 0;
+            out[n].count = c;
+            ++n;
+        }
+        return n;
+    }
+
+    /** @brief Halve every count, so old traffic fades out */
+    void decay() {
+        for (auto& count : counts) {
+            uint32_t c = count.load(std::memory_order_relaxed);
+            while (c && !count.compare_exchange_weak(c, c / 2, std::memory_order_relaxed)) {}
+        }
+    }
+
+    /** @brief Forget every ID */
+    void clear() {
+        for (auto& count : counts) count.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    static constexpr uint32_t PROBES = 4;               ///< Slots tried per ID
+    static constexpr uint32_t USED = 1u << 30;          ///< Key bit: slot holds an ID
+    static constexpr uint32_t EXTENDED = 1u << 31;      ///< Key bit: 29-bit ID
+    static constexpr uint32_t ID_MASK = 0x1FFFFFFF;     ///< Key bits of the ID
+
+    std::atomic<uint32_t> keys[TWAI_ID_HISTOGRAM_SIZE] = {};     ///< Encoded IDs (0 = never used)
+    std::atomic<uint32_t> counts[TWAI_ID_HISTOGRAM_SIZE] = {};   ///< Frames per slot
+
+    static uint32_t make_key(uint32_t id, bool is_extended) {
+        return (id & ID_MASK) | USED | (is_extended ? EXTENDED : 0);
+    }
+
+    static uint32_t hash(uint32_t key) {
+        return ((key * 2654435761u) >> 16) & (TWAI_ID_HISTOGRAM_SIZE - 1);
+    }
+};
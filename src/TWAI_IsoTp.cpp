@@ -0,0 +1,358 @@
+#include "TWAI_IsoTp.h"
+#include <cstring>
+#include <esp_timer.h>
+
+namespace {
+
+// Tipos de PCI (nibble alto del primer byte)
+constexpr uint8_t PCI_SINGLE = 0x00;
+constexpr uint8_t PCI_FIRST = 0x10;
+constexpr uint8_t PCI_CONSECUTIVE = 0x20;
+constexpr uint8_t PCI_FLOW_CONTROL = 0x30;
+
+// Estados del control de flujo
+constexpr uint8_t FC_CONTINUE = 0;
+constexpr uint8_t FC_WAIT = 1;
+constexpr uint8_t FC_OVERFLOW = 2;
+
+constexpr uint32_t DEFAULT_TIMEOUT_MS = 1000;
+
+}  // namespace
+
+TWAI_IsoTp::TWAI_IsoTp() {
+    for (auto& s : sessions) s.subscription = -1;
+}
+
+int TWAI_IsoTp::open(const session_config_t& config) {
+    for (int i = 0; i < MAX_ISOTP_SESSIONS; ++i) {
+        session_t& s = sessions[i];
+        if (s.used) continue;
+
+        s = {};
+        s.config = config;
+        if (s.config.timeout_ms == 0) s.config.timeout_ms = DEFAULT_TIMEOUT_MS;
+        s.subscription = -1;
+        s.used = true;
+        if (twai && !route(i)) {
+            s.used = false;
+            return -1;
+        }
+        return i;
+    }
+    return -1;
+}
+
+void TWAI_IsoTp::close(int session) {
+    if (!valid(session)) return;
+    session_t& s = sessions[session];
+    if (s.rx_buffer) abort_rx(s);
+    if (s.tx_state != TX_IDLE) finish_tx(session, false, esp_timer_get_time());
+    if (twai && s.subscription >= 0) twai->unsubscribe(s.subscription);
+    s = {};
+    s.subscription = -1;
+}
+
+bool TWAI_IsoTp::tx_busy(int session) const {
+    return valid(session) && sessions[session].tx_state != TX_IDLE;
+}
+
+void TWAI_IsoTp::set_output(output_t out, void* context) {
+    output = out;
+    output_context = context;
+}
+
+uint32_t TWAI_IsoTp::st_min_us(uint8_t st_min) {
+    if (st_min <= 0x7F) return uint32_t(st_min) * 1000;
+    if (st_min >= 0xF1 && st_min <= 0xF9) return uint32_t(st_min - 0xF0) * 100;
+    // Valores reservados: usar el máximo
+    return 127000;
+}
+
+uint8_t* TWAI_IsoTp::arena_alloc(size_t length) {
+    size_t needed = (length + ISOTP_ARENA_BLOCK_SIZE - 1) / ISOTP_ARENA_BLOCK_SIZE;
+    size_t run = 0;
+    // Primer hueco contiguo suficiente
+    for (size_t b = 0; b < ARENA_BLOCKS; ++b) {
+        if (arena_used[b / 32] & (1u << (b % 32))) {
+            run = 0;
+            continue;
+        }
+        if (++run < needed) continue;
+
+        size_t first = b + 1 - needed;
+        for (size_t i = first; i <= b; ++i) arena_used[i / 32] |= 1u << (i % 32);
+        return &arena[first * ISOTP_ARENA_BLOCK_SIZE];
+    }
+    return nullptr;
+}
+
+void TWAI_IsoTp::arena_free(uint8_t* buffer, size_t length) {
+    size_t first = (buffer - arena) / ISOTP_ARENA_BLOCK_SIZE;
+    size_t count = (length + ISOTP_ARENA_BLOCK_SIZE - 1) / ISOTP_ARENA_BLOCK_SIZE;
+    for (size_t i = first; i < first + count; ++i) arena_used[i / 32] &= ~(1u << (i % 32));
+}
+
+bool TWAI_IsoTp::emit(const session_t& s, const uint8_t* payload, uint8_t length) {
+    if (!output) return false;
+    twai_message_t msg = {};
+    msg.identifier = s.config.tx_id;
+    msg.extd = s.config.is_extended;
+    msg.data_length_code = 8;
+    memcpy(msg.data, payload, length);
+    memset(msg.data + length, s.config.padding, 8 - length);
+    return output(msg, output_context);
+}
+
+bool TWAI_IsoTp::send_flow_control(const session_t& s, uint8_t status) {
+    uint8_t fc[3] = { uint8_t(PCI_FLOW_CONTROL | status), s.config.block_size, s.config.st_min };
+    return emit(s, fc, sizeof(fc));
+}
+
+void TWAI_IsoTp::abort_rx(session_t& s) {
+    arena_free(s.rx_buffer, s.rx_length);
+    s.rx_buffer = nullptr;
+    ++stats.rx_aborted;
+}
+
+void TWAI_IsoTp::finish_tx(int session, bool success, uint64_t now_us) {
+    session_t& s = sessions[session];
+    s.tx_state = TX_IDLE;
+    if (success) {
+        ++stats.tx_messages;
+        stats.tx_bytes += s.tx_length;
+        uint32_t latency = uint32_t(now_us - s.tx_start_us);
+        if (latency > stats.tx_latency_max_us) stats.tx_latency_max_us = latency;
+    } else {
+        ++stats.tx_aborted;
+    }
+    if (s.config.on_sent) s.config.on_sent(session, success, s.config.context);
+}
+
+bool TWAI_IsoTp::send(int session, const uint8_t* data, size_t length) {
+    return send(session, data, length, esp_timer_get_time());
+}
+
+bool TWAI_IsoTp::send(int session, const uint8_t* data, size_t length, uint64_t now) {
+    if (!valid(session) || !data || length == 0 || length > MAX_PAYLOAD) return false;
+    session_t& s = sessions[session];
+    if (s.tx_state != TX_IDLE) return false;
+
+    s.tx_start_us = now;
+    s.tx_data = data;
+    s.tx_length = length;
+
+    // Trama única
+    if (length <= 7) {
+        uint8_t sf[8] = { uint8_t(PCI_SINGLE | length) };
+        memcpy(sf + 1, data, length);
+        if (!emit(s, sf, length + 1)) return false;
+        finish_tx(session, true, now);
+        return true;
+    }
+
+    // Primera trama y esperar el control de flujo
+    uint8_t ff[8] = { uint8_t(PCI_FIRST | (length >> 8)), uint8_t(length) };
+    memcpy(ff + 2, data, 6);
+    if (!emit(s, ff, 8)) return false;
+    s.tx_sent = 6;
+    s.tx_sn = 1;
+    s.tx_state = TX_WAIT_FC;
+    s.tx_deadline_us = now + uint64_t(s.config.timeout_ms) * 1000;
+    return true;
+}
+
+void TWAI_IsoTp::on_frame(const twai_message_t& msg, uint64_t now_us) {
+    if (msg.rtr || msg.data_length_code < 1) return;
+
+    int index = -1;
+    for (int i = 0; i < MAX_ISOTP_SESSIONS; ++i) {
+        const session_t& s = sessions[i];
+        if (s.used && s.config.rx_id == msg.identifier && s.config.is_extended == bool(msg.extd)) {
+            index = i;
+            break;
+        }
+    }
+    if (index < 0) return;
+
+    session_t& s = sessions[index];
+    const uint8_t* d = msg.data;
+    uint8_t dlc = msg.data_length_code > 8 ? 8 : msg.data_length_code;
+
+    switch (d[0] & 0xF0) {
+        case PCI_SINGLE: {
+            uint8_t length = d[0] & 0x0F;
+            if (length == 0 || length > dlc - 1) return;
+            // Una trama nueva termina la recepción en curso
+            if (s.rx_buffer) abort_rx(s);
+            ++stats.rx_messages;
+            stats.rx_bytes += length;
+            if (s.config.on_receive) s.config.on_receive(index, d + 1, length, s.config.context);
+            break;
+        }
+        case PCI_FIRST: {
+            if (dlc < 8) return;
+            uint16_t length = uint16_t((d[0] & 0x0F) << 8) | d[1];
+            if (length < 8) return;
+            if (s.rx_buffer) abort_rx(s);
+
+            s.rx_buffer = arena_alloc(length);
+            if (!s.rx_buffer) {
+                ++stats.arena_full;
+                send_flow_control(s, FC_OVERFLOW);
+                return;
+            }
+            memcpy(s.rx_buffer, d + 2, 6);
+            s.rx_length = length;
+            s.rx_received = 6;
+            s.rx_sn = 1;
+            s.rx_block = 0;
+            s.rx_start_us = now_us;
+            s.rx_deadline_us = now_us + uint64_t(s.config.timeout_ms) * 1000;
+            send_flow_control(s, FC_CONTINUE);
+            break;
+        }
+        case PCI_CONSECUTIVE: {
+            if (!s.rx_buffer) return;
+            if ((d[0] & 0x0F) != s.rx_sn) {
+                abort_rx(s);
+                return;
+            }
+            // Copiar directamente al búfer del arena
+            uint16_t chunk = s.rx_length - s.rx_received;
+            if (chunk > 7) chunk = 7;
+            if (chunk > dlc - 1) chunk = dlc - 1;
+            memcpy(s.rx_buffer + s.rx_received, d + 1, chunk);
+            s.rx_received += chunk;
+            s.rx_sn = (s.rx_sn + 1) & 0x0F;
+            s.rx_deadline_us = now_us + uint64_t(s.config.timeout_ms) * 1000;
+
+            if (s.rx_received >= s.rx_length) {
+                uint8_t* buffer = s.rx_buffer;
+                s.rx_buffer = nullptr;
+                ++stats.rx_messages;
+                stats.rx_bytes += s.rx_length;
+                uint32_t latency = uint32_t(now_us - s.rx_start_us);
+                if (latency > stats.rx_latency_max_us) stats.rx_latency_max_us = latency;
+                if (s.config.on_receive) s.config.on_receive(index, buffer, s.rx_length, s.config.context);
+                arena_free(buffer, s.rx_length);
+            } else if (s.config.block_size && ++s.rx_block >= s.config.block_size) {
+                s.rx_block = 0;
+                send_flow_control(s, FC_CONTINUE);
+            }
+            break;
+        }
+        case PCI_FLOW_CONTROL: {
+            if (s.tx_state != TX_WAIT_FC || dlc < 3) return;
+            switch (d[0] & 0x0F) {
+                case FC_CONTINUE:
+                    s.tx_block_left = d[1];
+                    s.tx_st_min_us = st_min_us(d[2]);
+                    s.tx_next_us = now_us;
+                    s.tx_state = TX_SENDING;
+                    break;
+                case FC_WAIT:
+                    s.tx_deadline_us = now_us + uint64_t(s.config.timeout_ms) * 1000;
+                    break;
+                default:
+                    finish_tx(index, false, now_us);
+                    break;
+            }
+            break;
+        }
+    }
+}
+
+uint32_t TWAI_IsoTp::poll(uint64_t now_us) {
+    uint64_t next = UINT64_MAX;
+
+    for (int i = 0; i < MAX_ISOTP_SESSIONS; ++i) {
+        session_t& s = sessions[i];
+        if (!s.used) continue;
+
+        if (s.rx_buffer) {
+            if (now_us >= s.rx_deadline_us) abort_rx(s);
+            else if (s.rx_deadline_us < next) next = s.rx_deadline_us;
+        }
+
+        if (s.tx_state == TX_WAIT_FC) {
+            if (now_us >= s.tx_deadline_us) finish_tx(i, false, now_us);
+            else if (s.tx_deadline_us < next) next = s.tx_deadline_us;
+            continue;
+        }
+
+        // Tramas consecutivas respetando STmin y el tamaño de bloque
+        while (s.tx_state == TX_SENDING && now_us >= s.tx_next_us) {
+            uint16_t chunk = s.tx_length - s.tx_sent;
+            if (chunk > 7) chunk = 7;
+            uint8_t cf[8] = { uint8_t(PCI_CONSECUTIVE | s.tx_sn) };
+            memcpy(cf + 1, s.tx_data + s.tx_sent, chunk);
+            if (!emit(s, cf, chunk + 1)) break;     // salida llena: reintentar luego
+
+            s.tx_sent += chunk;
+            s.tx_sn = (s.tx_sn + 1) & 0x0F;
+            s.tx_next_us = now_us + s.tx_st_min_us;
+            if (s.tx_sent >= s.tx_length) {
+                finish_tx(i, true, now_us);
+            } else if (s.tx_block_left && --s.tx_block_left == 0) {
+                s.tx_state = TX_WAIT_FC;
+                s.tx_deadline_us = now_us + uint64_t(s.config.timeout_ms) * 1000;
+                if (s.tx_deadline_us < next) next = s.tx_deadline_us;
+            }
+            if (s.tx_st_min_us) break;
+        }
+        if (s.tx_state == TX_SENDING && s.tx_next_us < next) next = s.tx_next_us;
+    }
+
+    if (next == UINT64_MAX) return UINT32_MAX;
+    return next > now_us ? uint32_t(next - now_us) : 0;
+}
+
+bool TWAI_IsoTp::twai_output(const twai_message_t& msg, void* context) {
+    return static_cast<TWAI_Object*>(context)->send(msg, 0);
+}
+
+bool TWAI_IsoTp::route(int session) {
+    session_t& s = sessions[session];
+    TWAI_Object::twai_user_filter_t ids = { s.config.rx_id, s.config.rx_id,
+                                            TWAI_Object::TWAI_FILTER_TYPE_LIST, s.config.is_extended };
+    s.subscription = twai->subscribe(ids, rx_queue);
+    return s.subscription >= 0;
+}
+
+bool TWAI_IsoTp::attach(TWAI_Object& controller) {
+    if (!rx_queue) {
+        rx_queue = xQueueCreate(ISOTP_RX_QUEUE_LEN, sizeof(TWAI_Object::can_event_t));
+        if (!rx_queue) return false;
+    }
+    twai = &controller;
+    set_output(twai_output, twai);
+
+    bool ok = true;
+    for (int i = 0; i < MAX_ISOTP_SESSIONS; ++i) {
+        if (sessions[i].used && sessions[i].subscription < 0) ok &= route(i);
+    }
+    return ok;
+}
+
+void TWAI_IsoTp::service(TickType_t wait) {
+    if (!rx_queue) return;
+
+    // No dormir más allá de la próxima trama consecutiva
+    uint32_t due_us = poll(esp_timer_get_time());
+    TickType_t due = due_us == UINT32_MAX ? wait : pdMS_TO_TICKS(due_us / 1000);
+    if (due < wait) wait = due;
+
+    TWAI_Object::can_event_t event;
+    if (xQueueReceive(rx_queue, &event, wait) == pdTRUE) {
+        do {
+            on_frame(event.message, esp_timer_get_time());
+        } while (xQueueReceive(rx_queue, &event, 0) == pdTRUE);
+    }
+    poll(esp_timer_get_time());
+}
+
+TWAI_IsoTp::stats_t TWAI_IsoTp::get_stats(bool reset) {
+    stats_t result = stats;
+    if (reset) stats = {};
+    return result;
+}
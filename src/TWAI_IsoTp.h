@@ -0,0 +1,266 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "TWAI_Object.h"
+
+#ifndef MAX_ISOTP_SESSIONS
+/**Maximum number of concurrent ISO-TP sessions*/
+#define MAX_ISOTP_SESSIONS (8)
+#endif  // MAX_ISOTP_SESSIONS
+
+#ifndef ISOTP_ARENA_SIZE
+/**Bytes of the reassembly arena shared by all sessions*/
+#define ISOTP_ARENA_SIZE (8192)
+#endif  // ISOTP_ARENA_SIZE
+
+#ifndef ISOTP_ARENA_BLOCK_SIZE
+/**Allocation granularity of the reassembly arena*/
+#define ISOTP_ARENA_BLOCK_SIZE (64)
+#endif  // ISOTP_ARENA_BLOCK_SIZE
+
+#ifndef ISOTP_RX_QUEUE_LEN
+/**Frames buffered between the RX interrupt and service()*/
+#define ISOTP_RX_QUEUE_LEN (32)
+#endif  // ISOTP_RX_QUEUE_LEN
+
+/**
+ * @class TWAI_IsoTp
+ * @brief ISO 15765-2 (ISO-TP) transport layer, normal addressing, classic CAN
+ *
+ * @details Segments outgoing payloads of up to 4095 bytes into single,
+ * first and consecutive frames, honouring the block size and STmin of
+ * the receiver's flow control frames, and reassembles incoming messages
+ * sending its own flow control. Incoming multi-frame messages are written
+ * directly into buffers taken from a fixed arena (first-fit over
+ * ISOTP_ARENA_BLOCK_SIZE blocks), so nothing is allocated per message;
+ * outgoing payloads are read in place from the caller's buffer.
+ *
+ * The protocol core only needs on_frame(), poll() and an output callback,
+ * so it can run over any transport (loopback, TWAI_VirtualBus). attach()
+ * wires it to a TWAI_Object: session IDs are subscribed to an internal
+ * queue and service() processes them from a task.
+ *
+ * @note Not synchronized: call on_frame(), poll(), service(), send() and
+ * open()/close() from one task
+ */
+class TWAI_IsoTp {
+public:
+    static constexpr size_t MAX_PAYLOAD = 4095;    ///< Largest classic ISO-TP message
+
+    /**
+     * @brief Complete message received
+     * @param session Session handle
+     * @param data Reassembled payload (valid only during the call)
+     * @param length Payload length
+     * @param context User context of the session
+     */
+    typedef void (*rx_handler_t)(int session, const uint8_t* data, size_t length, void* context);
+
+    /**
+     * @brief Transmission finished
+     * @param session Session handle
+     * @param success False on timeout, overflow or abort by the receiver
+     * @param context User context of the session
+     */
+    typedef void (*tx_handler_t)(int session, bool success, void* context);
+
+    /**
+     * @brief Frame output
+     * @param msg Frame to send
+     * @param context Output context
+     * @return False if the frame could not be queued (retried by poll())
+     */
+    typedef bool (*output_t)(const twai_message_t& msg, void* context);
+
+    /**
+     * @struct session_config_t
+     * @brief Addressing and flow control parameters of a session
+     */
+    typedef struct {
+        uint32_t tx_id;             ///< Identifier of the frames we send
+        uint32_t rx_id;             ///< Identifier of the frames we receive
+        bool is_extended;           ///< 29-bit identifiers
+        uint8_t block_size;         ///< BS announced to the sender (0 = no flow control pauses)
+        uint8_t st_min;             ///< STmin announced (0x00-0x7F ms, 0xF1-0xF9 = 100-900 us)
+        uint8_t padding;            ///< Byte used to pad every frame to 8 bytes
+        uint32_t timeout_ms;        ///< N_Bs/N_Cr timeout (0 = 1000 ms)
+        rx_handler_t on_receive;    ///< Message callback (may be nullptr)
+        tx_handler_t on_sent;       ///< Completion callback (may be nullptr)
+        void* context;              ///< User pointer passed to the callbacks
+    } session_config_t;
+
+    /**
+     * @struct stats_t
+     * @brief Transfer counters
+     */
+    typedef struct {
+        uint32_t rx_messages;       ///< Messages delivered
+        uint32_t rx_bytes;          ///< Payload bytes delivered
+        uint32_t tx_messages;       ///< Messages sent completely
+        uint32_t tx_bytes;          ///< Payload bytes sent completely
+        uint32_t rx_aborted;        ///< Receptions lost (timeout, sequence error, new first frame)
+        uint32_t tx_aborted;        ///< Transmissions failed
+        uint32_t arena_full;        ///< First frames refused for lack of buffer space
+        uint32_t tx_latency_max_us; ///< Longest send()-to-completion time (us)
+        uint32_t rx_latency_max_us; ///< Longest first-frame-to-delivery time (us)
+    } stats_t;
+
+    TWAI_IsoTp();
+
+    /**
+     * @brief Open a session
+     * @param config Session parameters
+     * @return Session handle, or -1 if no slot is available
+     */
+    int open(const session_config_t& config);
+
+    /**
+     * @brief Close a session, aborting any transfer in progress
+     * @param session Session handle
+     */
+    void close(int session);
+
+    /**
+     * @brief Start sending a message
+     * @param session Session handle
+     * @param data Payload (must stay valid until on_sent)
+     * @param length Payload length (1..MAX_PAYLOAD)
+     * @return False if the session is busy or the first frame was not accepted
+     */
+    bool send(int session, const uint8_t* data, size_t length);
+
+    /**
+     * @brief Start sending a message at a given time (protocol core use)
+     * @param now_us Current time on the clock given to on_frame()/poll()
+     */
+    bool send(int session, const uint8_t* data, size_t length, uint64_t now_us);
+
+    /** @brief True while a transmission is in progress */
+    bool tx_busy(int session) const;
+
+    /**
+     * @brief Select the frame output (protocol core use)
+     * @param output Output callback
+     * @param context User pointer passed to @p output
+     */
+    void set_output(output_t output, void* context = nullptr);
+
+    /**
+     * @brief Process one received frame (protocol core use)
+     * @param msg Frame
+     * @param now_us Current time
+     */
+    void on_frame(const twai_message_t& msg, uint64_t now_us);
+
+    /**
+     * @brief Send due consecutive frames and check timeouts (protocol core use)
+     * @param now_us Current time
+     * @return Microseconds until poll() has work again (UINT32_MAX if idle)
+     */
+    uint32_t poll(uint64_t now_us);
+
+    /**
+     * @brief Run over a TWAI_Object
+     * @param twai Controller (frames are sent with send() without waiting)
+     * @return False if the RX queue could not be created or a subscription failed
+     */
+    bool attach(TWAI_Object& twai);
+
+    /**
+     * @brief Process received frames and pending transmissions
+     * @param wait Maximum time to wait for a frame
+     * @pre attach()
+     * @details Waits at most until the next consecutive frame is due
+     */
+    void service(TickType_t wait = pdMS_TO_TICKS(10));
+
+    /**
+     * @brief Get transfer counters
+     * @param reset True to clear the counters after reading
+     */
+    stats_t get_stats(bool reset = false);
+
+private:
+    static constexpr size_t ARENA_BLOCKS = ISOTP_ARENA_SIZE / ISOTP_ARENA_BLOCK_SIZE;
+    static constexpr size_t ARENA_WORDS = (ARENA_BLOCKS + 31) / 32;
+
+    /**
+     * @enum tx_state_t
+     * @brief Transmit side of a session
+     */
+    enum tx_state_t : uint8_t {
+        TX_IDLE,        ///< Nothing to send
+        TX_WAIT_FC,     ///< First frame or block sent, waiting for flow control
+        TX_SENDING      ///< Sending consecutive frames
+    };
+
+    /**
+     * @struct session_t
+     * @brief Session slot
+     */
+    typedef struct {
+        session_config_t config;    ///< Parameters
+        bool used;                  ///< Slot in use
+        int subscription;           ///< Subscription on the attached TWAI_Object (-1 = none)
+        // Reception
+        uint8_t* rx_buffer;         ///< Arena buffer being filled (nullptr = idle)
+        uint16_t rx_length;         ///< Announced length
+        uint16_t rx_received;       ///< Bytes stored
+        uint8_t rx_sn;              ///< Expected sequence number
+        uint8_t rx_block;           ///< Consecutive frames since the last flow control
+        uint64_t rx_deadline_us;    ///< N_Cr deadline
+        uint64_t rx_start_us;       ///< First frame time
+        // Transmission
+        tx_state_t tx_state;        ///< Transmit state
+        const uint8_t* tx_data;     ///< Caller payload
+        uint16_t tx_length;         ///< Payload length
+        uint16_t tx_sent;           ///< Bytes already framed
+        uint8_t tx_sn;              ///< Next sequence number
+        uint8_t tx_block_left;      ///< Frames left in the block (0 = unlimited)
+        uint32_t tx_st_min_us;      ///< Receiver STmin
+        uint64_t tx_next_us;        ///< Earliest time of the next consecutive frame
+        uint64_t tx_deadline_us;    ///< N_Bs deadline
+        uint64_t tx_start_us;       ///< send() time
+    } session_t;
+
+    session_t sessions[MAX_ISOTP_SESSIONS] = {};    ///< Session slots
+    uint8_t arena[ISOTP_ARENA_SIZE];                ///< Reassembly storage
+    uint32_t arena_used[ARENA_WORDS] = {};          ///< Allocated blocks bitmap
+    output_t output = nullptr;                      ///< Frame output
+    void* output_context = nullptr;                 ///< Frame output context
+    TWAI_Object* twai = nullptr;                    ///< Attached controller
+    QueueHandle_t rx_queue = nullptr;               ///< Frames routed from the attached controller
+    stats_t stats = {};                             ///< Transfer counters
+
+    /** @brief True if @p session is an open slot */
+    bool valid(int session) const {
+        return session >= 0 && session < MAX_ISOTP_SESSIONS && sessions[session].used;
+    }
+
+    /** @brief Take contiguous arena blocks for @p length bytes (nullptr if full) */
+    uint8_t* arena_alloc(size_t length);
+
+    /** @brief Return a buffer obtained from arena_alloc() */
+    void arena_free(uint8_t* buffer, size_t length);
+
+    /** @brief Build and output one frame of a session (padded to 8 bytes) */
+    bool emit(const session_t& s, const uint8_t* payload, uint8_t length);
+
+    /** @brief Send our flow control frame */
+    bool send_flow_control(const session_t& s, uint8_t status);
+
+    /** @brief Drop the reception in progress */
+    void abort_rx(session_t& s);
+
+    /** @brief End the transmission in progress and report it */
+    void finish_tx(int session, bool success, uint64_t now_us);
+
+    /** @brief Subscribe a session to the attached controller */
+    bool route(int session);
+
+    /** @brief Output callback for attach() */
+    static bool twai_output(const twai_message_t& msg, void* context);
+
+    /** @brief STmin byte to microseconds */
+    static uint32_t st_min_us(uint8_t st_min);
+};
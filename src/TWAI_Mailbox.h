@@ -0,0 +1,61 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+/**
+ * @class TWAI_Mailbox
+ * @brief Latest-value slot protected by a sequence lock
+ *
+ * @details A single writer (the RX interrupt) overwrites the slot in place;
+ * any number of readers take consistent snapshots without ever blocking
+ * the writer. The sequence counter is odd while a write is in progress
+ * and its half is the number of completed updates.
+ *
+ * @tparam T Stored item (trivially copyable)
+ */
+template <typename T>
+class TWAI_Mailbox {
+public:
+    /**
+     * @brief Overwrite the stored value (single writer)
+     * @param item New value
+     */
+    void write(const T& item) {
+        uint32_t s = seq.load(std::memory_order_relaxed);
+        seq.store(s + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        value = item;
+        seq.store(s + 2, std::memory_order_release);
+    }
+
+    /**
+     * @brief Take a consistent snapshot
+     * @param out Destination for the value
+     * @param updates Optional number of writes since reset()
+     * @return False if the slot was never written
+     */
+    bool read(T& out, uint32_t* updates = nullptr) const {
+        uint32_t s1, s2;
+        do {
+            s1 = seq.load(std::memory_order_acquire);
+            if (s1 & 1) continue;   // escritura en curso
+            out = value;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            s2 = seq.load(std::memory_order_relaxed);
+            if (s1 == s2) break;
+        } while (true);
+
+        if (updates) *updates = s1 / 2;
+        return s1 != 0;
+    }
+
+    /**
+     * @brief Forget the stored value and update count
+     * @note Must not race with write()
+     */
+    void reset() { seq.store(0, std::memory_order_release); }
+
+private:
+    T value{};                      ///< Latest value
+    std::atomic<uint32_t> seq{0};   ///< Sequence counter (odd = write in progress)
+};
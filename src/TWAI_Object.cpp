@@ -1,21 +1,77 @@
 #include "TWAI_Object.h"
+#include "TWAI_Coro.h"
+#include "TWAI_Gateway.h"
+#include "TWAI_Trace.h"
 #include <cstring>
+#include <esp_timer.h>
+
+static_assert(sizeof(TWAI_Object::can_event_packed_t) == 24, "Packed event must stay 24 bytes");
 
 // Instancia global
 TWAI_Object TWAI_Object::twai;
 
-TWAI_Object::TWAI_Object() {}
+namespace {
+
+#if TWAI_MULTI_CONTROLLER
+constexpr int CONTROLLER_COUNT = SOC_TWAI_CONTROLLER_NUM;
+#else
+constexpr int CONTROLLER_COUNT = 1;   // El driver clásico solo maneja el controlador 0
+#endif
+
+// Fuente de interrupción de cada controlador
+int intr_source(int controller) {
+#if SOC_TWAI_CONTROLLER_NUM > 2
+    if (controller == 2) return ETS_TWAI2_INTR_SOURCE;
+#endif
+#if SOC_TWAI_CONTROLLER_NUM > 1
+    return controller == 0 ? ETS_TWAI0_INTR_SOURCE : ETS_TWAI1_INTR_SOURCE;
+#else
+    (void) controller;
+    return ETS_TWAI_INTR_SOURCE;
+#endif
+}
+
+}  // namespace
+
+TWAI_Object::TWAI_Object()
+    : active_filters(new twai_user_filter_t[MAX_USER_FILTERS]),
+      filter_capacity(MAX_USER_FILTERS),
+      owns_filters(true) {
+    for (auto& sub : mailbox_subscription) sub = -1;
+    hw_filter_plan = TWAI_HwFilter::synthesize(filter_engines.front());
+}
+
+TWAI_Object::TWAI_Object(const storage_t& storage)
+    : queue_items(storage.queue_items),
+      queue_control(storage.queue),
+      event_queue_length(storage.queue_length),
+      packed_events(storage.packed_events),
+      active_filters(storage.filters),
+      filter_capacity(storage.filter_capacity),
+      owns_filters(false),
+      service_stack(storage.service_stack),
+      service_stack_size(storage.service_stack_size),
+      service_tcb(storage.service_tcb) {
+    for (auto& sub : mailbox_subscription) sub = -1;
+    hw_filter_plan = TWAI_HwFilter::synthesize(filter_engines.front());
+}
 
 TWAI_Object::~TWAI_Object() {
     end();
+    if (owns_filters) delete[] active_filters;
 }
 
 bool TWAI_Object::begin(gpio_num_t tx_pin, gpio_num_t rx_pin, 
                        uint32_t baud_rate, twai_mode_t mode, int controller_num) {
+    if (controller_num < 0 || controller_num >= CONTROLLER_COUNT) return false;
     controller_id = controller_num;
+    bus_baud = baud_rate;
 
     // Guardar configuraciones
     g_config = TWAI_GENERAL_CONFIG_DEFAULT(tx_pin, rx_pin, mode);
+#if TWAI_MULTI_CONTROLLER
+    g_config.controller_id = controller_num;
+#endif
     
     switch (baud_rate) {
         case 1000000: t_config = TWAI_TIMING_CONFIG_1MBITS(); break;
@@ -27,25 +83,311 @@ bool TWAI_Object::begin(gpio_num_t tx_pin, gpio_num_t rx_pin,
         default: return false;
     }
 
-    // Inicializar event_queue
-    event_queue = xQueueCreate(MAX_EVENT_QUEUE_ITEMS, sizeof(can_event_t));
+    // El planificador entrega las tramas una a una: sin cola en el driver
+    if (tx_scheduler_enabled) {
+        g_config.tx_queue_len = 0;
+        g_config.alerts_enabled |= TWAI_ALERT_TX_IDLE | TWAI_ALERT_TX_SUCCESS | TWAI_ALERT_TX_FAILED;
+    }
+    // Latencia de despertar también sin planificador
+    if (txcvr_idle_ms) g_config.alerts_enabled |= TWAI_ALERT_TX_SUCCESS;
+    // Despertar al servicio en cada cambio de estado de error
+    if (recovery_enabled) {
+        g_config.alerts_enabled |= TWAI_ALERT_ABOVE_ERR_WARN | TWAI_ALERT_ERR_PASS | TWAI_ALERT_BUS_OFF
+                                 | TWAI_ALERT_BUS_RECOVERED | TWAI_ALERT_ERR_ACTIVE;
+    }
+
+    // Inicializar event_queue (en memoria propia si la hay)
+    UBaseType_t item_size = packed_events ? sizeof(can_event_packed_t) : sizeof(can_event_t);
+    event_queue = queue_items
+        ? xQueueCreateStatic(event_queue_length, item_size, queue_items, queue_control)
+        : xQueueCreate(event_queue_length, item_size);
     if (event_queue == 0) {
         return false;
     }
 
-    f_config = TWAI_FILTER_CONFIG_ACCEPT_ALL();
+    // Filtros definidos antes de begin()
+    compile_software_filters();
+    f_config.acceptance_code = hw_filter_plan.acceptance_code;
+    f_config.acceptance_mask = hw_filter_plan.acceptance_mask;
+    f_config.single_filter = hw_filter_plan.single_filter;
+
+    if (bus_load_requested) bus_load.configure(bus_baud, bus_load_stuffing, now_us());
+
+    // Bus simulado: unirse como nodo en lugar de instalar el driver
+    if (virtual_bus) {
+        if (virtual_bus->baud_rate() != baud_rate) return false;
+        virtual_node = virtual_bus->add_node(virtual_rx, virtual_tx, this, mode == TWAI_MODE_LISTEN_ONLY);
+        return virtual_node >= 0 && virtual_bus->start(virtual_node);
+    }
     
-    if (twai_driver_install(&g_config, &t_config, &f_config) != ESP_OK) {
+    if (driver_install(f_config) != ESP_OK) {
         return false;
     }
-    if (esp_intr_alloc(ETS_TWAI_INTR_SOURCE, 0, twai_isr_handler, (void*) this, &ret_handle) != ESP_OK) {
+    driver_installed = true;
+    if (esp_intr_alloc(intr_source(controller_id), 0, twai_isr_handler, (void*) this, &ret_handle) != ESP_OK) {
         // Wont work because "twai_driver_install" allocates TWAI interrupt:
         // esp_intr_alloc(ETS_TWAI_INTR_SOURCE, g_config->intr_flags, twai_intr_handler_main, NULL, &p_twai_obj->isr_handle)
         // If you want to use interrupt, dont use ESP TWAI C library
         // TODO: drop ESP TWAI C library
         return false;
     }
-    return twai_start() == ESP_OK;
+    if (driver_start() != ESP_OK) return false;
+    return start_service();
+}
+
+// Llamadas al driver: con TWAI_MULTI_CONTROLLER cada objeto usa su propio handle
+#if TWAI_MULTI_CONTROLLER
+esp_err_t TWAI_Object::driver_install(const twai_filter_config_t& filter) {
+    return twai_driver_install_v2(&g_config, &t_config, &filter, &driver_handle);
+}
+
+esp_err_t TWAI_Object::driver_uninstall() {
+    esp_err_t err = twai_driver_uninstall_v2(driver_handle);
+    if (err == ESP_OK) driver_handle = nullptr;
+    return err;
+}
+
+esp_err_t TWAI_Object::driver_start() { return twai_start_v2(driver_handle); }
+esp_err_t TWAI_Object::driver_stop() { return twai_stop_v2(driver_handle); }
+esp_err_t TWAI_Object::driver_transmit(const twai_message_t& msg, TickType_t timeout) {
+    return twai_transmit_v2(driver_handle, &msg, timeout);
+}
+esp_err_t IRAM_ATTR TWAI_Object::driver_receive(twai_message_t* msg, TickType_t timeout) {
+    return twai_receive_v2(driver_handle, msg, timeout);
+}
+esp_err_t TWAI_Object::driver_read_alerts(uint32_t* alerts, TickType_t timeout) {
+    return twai_read_alerts_v2(driver_handle, alerts, timeout);
+}
+esp_err_t IRAM_ATTR TWAI_Object::driver_status(twai_status_info_t* status) {
+    return twai_get_status_info_v2(driver_handle, status);
+}
+esp_err_t TWAI_Object::driver_recover() { return twai_initiate_recovery_v2(driver_handle); }
+#else
+esp_err_t TWAI_Object::driver_install(const twai_filter_config_t& filter) {
+    return twai_driver_install(&g_config, &t_config, &filter);
+}
+
+esp_err_t TWAI_Object::driver_uninstall() { return twai_driver_uninstall(); }
+esp_err_t TWAI_Object::driver_start() { return twai_start(); }
+esp_err_t TWAI_Object::driver_stop() { return twai_stop(); }
+esp_err_t TWAI_Object::driver_transmit(const twai_message_t& msg, TickType_t timeout) {
+    return twai_transmit(&msg, timeout);
+}
+esp_err_t IRAM_ATTR TWAI_Object::driver_receive(twai_message_t* msg, TickType_t timeout) {
+    return twai_receive(msg, timeout);
+}
+esp_err_t TWAI_Object::driver_read_alerts(uint32_t* alerts, TickType_t timeout) {
+    return twai_read_alerts(alerts, timeout);
+}
+esp_err_t IRAM_ATTR TWAI_Object::driver_status(twai_status_info_t* status) {
+    return twai_get_status_info(status);
+}
+esp_err_t TWAI_Object::driver_recover() { return twai_initiate_recovery(); }
+#endif
+
+bool TWAI_Object::start_service() {
+    if (service_handle || !(tx_scheduler_enabled || service_required)) return true;
+    if (service_stack) {
+        service_handle = xTaskCreateStaticPinnedToCore(service_task, "TWAI_SVC", service_stack_size, this,
+                                                       service_priority, service_stack, service_tcb, service_core);
+        return service_handle != nullptr;
+    }
+    return xTaskCreatePinnedToCore(service_task, "TWAI_SVC", service_stack_size, this,
+                                   service_priority, &service_handle, service_core) == pdPASS;
+}
+
+void TWAI_Object::service_task(void* arg) {
+    static_cast<TWAI_Object*>(arg)->service_loop();
+}
+
+void TWAI_Object::service_loop() {
+    while (true) {
+        // Esperar alertas como mucho hasta el próximo mensaje periódico
+        TickType_t wait = pdMS_TO_TICKS(periodic_wait_ms(TWAI_SERVICE_PERIOD_MS));
+        if (recovery_state != TWAI_RECOVERY_IDLE) wait = 1;   // Plazos de recuperación al tick
+        // En standby la interrupción solo anota el despertar: aplicarlo al tick
+        if (txcvr_asleep.load(std::memory_order_relaxed) || txcvr_wake_pending.load(std::memory_order_relaxed)) wait = 1;
+        uint32_t alerts = 0;
+        driver_read_alerts(&alerts, wait > 0 ? wait : 1);
+
+        if (alerts & (TWAI_ALERT_TX_SUCCESS | TWAI_ALERT_TX_FAILED | TWAI_ALERT_TX_IDLE)) {
+            on_tx_done(esp_timer_get_time(), alerts & TWAI_ALERT_TX_FAILED);
+        }
+        if (recovery_enabled) poll_recovery();
+        run_periodic();
+        pump_tx();
+
+        // Reajustar el filtro hardware solo en un hueco sin tráfico
+        if (tune_period_ms) {
+            uint64_t now = esp_timer_get_time();
+            if (now - tune_last_us >= uint64_t(tune_period_ms) * 1000 && bus_quiet(tune_quiet_us)) tune_filters();
+        }
+        if (txcvr_idle_ms) poll_txcvr_idle();
+    }
+}
+
+int TWAI_Object::schedule_periodic(const twai_message_t& msg, uint32_t period_ms, int32_t phase_ms) {
+    if (period_ms == 0) return -1;
+
+    // Elegir la fase fuera de la sección crítica: recorre todos los periódicos
+    uint32_t phase = phase_ms >= 0 ? uint32_t(phase_ms) % period_ms : pick_phase(period_ms);
+    uint32_t now = uint32_t(esp_timer_get_time() / 1000);
+
+    int handle = -1;
+    portENTER_CRITICAL(&periodic_lock);
+    if (!timer_wheel_started) {
+        timer_wheel.reset(now);
+        timer_wheel_started = true;
+    }
+    for (int i = 0; i < MAX_PERIODIC_MSGS; ++i) {
+        periodic_t& p = periodic[i];
+        if (p.active || p.in_wheel) continue;
+
+        p = {};
+        p.msg = msg;
+        p.period_ms = period_ms;
+        p.phase_ms = phase;
+        p.active = true;
+        p.in_wheel = true;
+        // Primer instante > now con due % period == phase
+        uint32_t first = now + 1;
+        timer_wheel.insert(i, first + (phase + period_ms - first % period_ms) % period_ms);
+        handle = i;
+        break;
+    }
+    portEXIT_CRITICAL(&periodic_lock);
+
+    if (handle >= 0) {
+        service_required = true;
+        if (driver_installed) start_service();
+    }
+    return handle;
+}
+
+bool TWAI_Object::update_periodic(int handle, const uint8_t* data, uint8_t length) {
+    if (handle < 0 || handle >= MAX_PERIODIC_MSGS || !data || length > TWAI_FRAME_MAX_DLC) return false;
+
+    portENTER_CRITICAL(&periodic_lock);
+    bool ok = periodic[handle].active;
+    if (ok) {
+        memcpy(periodic[handle].msg.data, data, length);
+        periodic[handle].msg.data_length_code = length;
+    }
+    portEXIT_CRITICAL(&periodic_lock);
+    return ok;
+}
+
+bool TWAI_Object::cancel_periodic(int handle) {
+    if (handle < 0 || handle >= MAX_PERIODIC_MSGS) return false;
+
+    // La entrada sale de la rueda la próxima vez que venza
+    portENTER_CRITICAL(&periodic_lock);
+    bool ok = periodic[handle].active;
+    periodic[handle].active = false;
+    portEXIT_CRITICAL(&periodic_lock);
+    return ok;
+}
+
+bool TWAI_Object::get_periodic_stats(int handle, periodic_stats_t& stats) {
+    if (handle < 0 || handle >= MAX_PERIODIC_MSGS) return false;
+
+    portENTER_CRITICAL(&periodic_lock);
+    bool ok = periodic[handle].active;
+    stats = periodic[handle].stats;
+    portEXIT_CRITICAL(&periodic_lock);
+    return ok;
+}
+
+uint32_t TWAI_Object::pick_phase(uint32_t period_ms) {
+    // Dos series periódicas coinciden si sus fases son congruentes módulo mcd(periodos)
+    auto gcd = [](uint32_t a, uint32_t b) {
+        while (b) {
+            uint32_t t = a % b;
+            a = b;
+            b = t;
+        }
+        return a;
+    };
+
+    uint32_t best_phase = 0;
+    uint32_t best_cost = UINT32_MAX;
+    for (uint32_t phase = 0; phase < period_ms && best_cost > 0; ++phase) {
+        uint32_t cost = 0;
+        for (const periodic_t& p : periodic) {
+            if (!p.active) continue;
+            uint32_t g = gcd(period_ms, p.period_ms);
+            if ((phase + g - p.phase_ms % g) % g == 0) ++cost;
+        }
+        if (cost < best_cost) {
+            best_cost = cost;
+            best_phase = phase;
+        }
+    }
+    return best_phase;
+}
+
+uint32_t TWAI_Object::periodic_wait_ms(uint32_t limit) {
+    if (!timer_wheel_started) return limit;
+
+    uint32_t now = uint32_t(esp_timer_get_time() / 1000);
+    portENTER_CRITICAL(&periodic_lock);
+    uint32_t behind = now - timer_wheel.now();
+    uint32_t ahead = timer_wheel.ticks_to_next(limit);
+    portEXIT_CRITICAL(&periodic_lock);
+
+    // La rueda va por detrás del reloj: hay trabajo pendiente
+    return ahead > behind ? ahead - behind : 0;
+}
+
+void TWAI_Object::run_periodic() {
+    if (!timer_wheel_started) return;
+
+    uint16_t expired[8];
+    twai_message_t msgs[8];
+    bool send_it[8];
+    size_t n;
+    do {
+        uint64_t now_us = esp_timer_get_time();
+        uint32_t now = uint32_t(now_us / 1000);
+
+        portENTER_CRITICAL(&periodic_lock);
+        n = timer_wheel.advance(now, expired, 8);
+        for (size_t i = 0; i < n; ++i) {
+            periodic_t& p = periodic[expired[i]];
+            send_it[i] = p.active;
+            if (p.active) msgs[i] = p.msg;
+            else p.in_wheel = false;    // cancelado: liberar el hueco
+        }
+        portEXIT_CRITICAL(&periodic_lock);
+
+        for (size_t i = 0; i < n; ++i) {
+            if (!send_it[i]) continue;
+            bool sent = send(msgs[i], 0);
+
+            portENTER_CRITICAL(&periodic_lock);
+            periodic_t& p = periodic[expired[i]];
+            uint32_t due = timer_wheel.due(expired[i]);
+            uint32_t late_us = uint32_t(now_us - uint64_t(due) * 1000);
+            if (int32_t(late_us) < 0) late_us = 0;
+
+            if (sent) ++p.stats.sent;
+            else ++p.stats.send_failures;
+            p.jitter_total_us += late_us;
+            if (late_us > p.stats.jitter_max_us) p.stats.jitter_max_us = late_us;
+            uint32_t releases = p.stats.sent + p.stats.send_failures;
+            p.stats.jitter_avg_us = uint32_t(p.jitter_total_us / releases);
+
+            // Periodos completos perdidos: saltarlos sin perder la fase
+            uint32_t missed = (now - due) / p.period_ms;
+            p.stats.overruns += missed;
+            if (p.active) {
+                timer_wheel.insert(expired[i], due + (missed + 1) * p.period_ms);
+            } else {
+                p.in_wheel = false;
+            }
+            portEXIT_CRITICAL(&periodic_lock);
+        }
+    } while (n == 8);
 }
 
 bool TWAI_Object::link_transceiver(TWAI_Txcvr& txcvr) {
@@ -53,81 +395,290 @@ bool TWAI_Object::link_transceiver(TWAI_Txcvr& txcvr) {
     return true;
 }
 
+bool TWAI_Object::attach_virtual_bus(TWAI_VirtualBus& bus) {
+    if (driver_installed || virtual_node >= 0) return false;
+    virtual_bus = &bus;
+    return true;
+}
+
+void TWAI_Object::virtual_rx(const twai_message_t& msg, uint64_t timestamp_us, void* context) {
+    TWAI_Object* self = static_cast<TWAI_Object*>(context);
+
+    // Filtro de aceptación tal como está programado
+    TWAI_HwFilter::plan_t installed = {};
+    installed.acceptance_code = self->f_config.acceptance_code;
+    installed.acceptance_mask = self->f_config.acceptance_mask;
+    installed.single_filter = self->f_config.single_filter;
+    if (!TWAI_HwFilter::passes(installed, msg.identifier, msg.extd)) return;
+
+    // Una interrupción por trama; el reloj virtual ya marca el final de la trama
+    self->irq_count.fetch_add(1, std::memory_order_relaxed);
+    self->last_rx_stamp.store(uint32_t(timestamp_us), std::memory_order_relaxed);
+    if (self->txcvr_asleep.load(std::memory_order_relaxed)) self->request_txcvr_wake(timestamp_us);
+    self->inject_frame(msg);
+}
+
+void TWAI_Object::inject_frame(const twai_message_t& msg) {
+    BaseType_t woken = pdFALSE;
+    uint64_t timestamp_us = now_us();
+    can_event_t event = {};
+    event.message = msg;
+    event.timestamp = virtual_bus ? TickType_t(timestamp_us / (1000ULL * portTICK_PERIOD_MS))
+                                  : xTaskGetTickCount();
+    // Un solo productor a la vez en receive_frame(): excluye a la interrupción en ambos núcleos
+    portENTER_CRITICAL(&rx_lock);
+    receive_frame(event, timestamp_us, &woken);
+    portEXIT_CRITICAL(&rx_lock);
+    wake_rx_waiter(&woken);
+    if (woken == pdTRUE) taskYIELD();
+}
+
+void TWAI_Object::attach_trace(TWAI_Trace* recorder) {
+    trace.store(recorder, std::memory_order_release);
+}
+
+uint64_t TWAI_Object::now_us() const {
+    return virtual_bus ? virtual_bus->now_us() : esp_timer_get_time();
+}
+
+void TWAI_Object::trace_tx(const twai_message_t& msg) {
+    TWAI_Trace* recorder = trace.load(std::memory_order_acquire);
+    if (!recorder) return;
+    can_event_t event = {};
+    event.message = msg;
+    can_event_packed_t record = pack_event(event, now_us(), controller_id);
+    record.flags_dlc |= PACKED_TX;
+    recorder->record(record);
+}
+
+void TWAI_Object::virtual_tx(const TWAI_TxQueue::entry_t& entry, twai_tx_result_t result, uint64_t done_us, void* context) {
+    static_cast<TWAI_Object*>(context)->complete_tx(entry, result, done_us);
+}
+
 bool TWAI_Object::set_filter_mode(uint32_t acceptance_code, uint32_t acceptance_mask, bool is_extended) {
-    active_filters.clear();
-    active_filters.push_back({
+    active_filters[0] = {
         .id = acceptance_code,
         .mask_or_end_id = acceptance_mask,
         .type = TWAI_FILTER_TYPE_MASK,
         .is_extended = is_extended
-    });
+    };
+    filter_count = 1;
     return apply_hardware_filters();
 }
 
 bool TWAI_Object::add_filter(const twai_user_filter_t& filter) {
-    if (active_filters.size() >= 32) return false;
+    if (filter_count >= filter_capacity) return false;
     
-    active_filters.push_back(filter);
+    active_filters[filter_count++] = filter;
     return apply_hardware_filters();
 }
 
 bool TWAI_Object::set_filters(const twai_user_filter_t* filters, uint8_t count) {
-    if (!filters || count > 32) return false;
+    if (!filters || count > filter_capacity) return false;
     
-    // Copia segura a buffer interno
-    twai_user_filter_t temp_filters[32];
-    memcpy(temp_filters, filters, sizeof(twai_user_filter_t) * count);
-    
-    // Limpiar y agregar nuevos filtros
-    active_filters.clear();
-    for (uint8_t i = 0; i < count; ++i) {
-        active_filters.push_back(temp_filters[i]);
-    }
+    // Copia directa a la tabla fija (memmove: filters puede ser la propia tabla)
+    memmove(active_filters, filters, sizeof(twai_user_filter_t) * count);
+    filter_count = count;
     
     return apply_hardware_filters();
 }
 
 bool TWAI_Object::clear_filters() {    
     // Limpiar filtros
-    active_filters.clear();
+    filter_count = 0;
     
     return apply_hardware_filters();
 }
 
+void TWAI_Object::begin_filter_update() {
+    ++filter_update_depth;
+}
+
+bool TWAI_Object::commit_filters() {
+    if (filter_update_depth == 0) return false;
+    if (--filter_update_depth > 0 || !filters_dirty) return true;
+    return apply_hardware_filters();
+}
+
+TWAI_Object::filter_stats_t TWAI_Object::get_filter_stats() {
+    filter_stats_t stats;
+    stats.acceptance_code = hw_filter_plan.acceptance_code;
+    stats.acceptance_mask = hw_filter_plan.acceptance_mask;
+    stats.single_filter = hw_filter_plan.single_filter;
+    stats.accepted_ids = hw_filter_plan.accepted_ids;
+    stats.passed_ids = hw_filter_plan.passed_ids;
+    stats.false_positive_ids = TWAI_HwFilter::false_positive_ids(hw_filter_plan);
+    stats.false_positive_rate = stats.passed_ids
+        ? float(stats.false_positive_ids) / float(stats.passed_ids) : 0.0f;
+    stats.reprogram_count = filter_reprograms;
+    stats.reprogram_skipped = filter_reprograms_skipped;
+    return stats;
+}
+
+bool TWAI_Object::compile_software_filters() {
+    TWAI_FilterEngine& engine = filter_engines.back();
+    bool ok = true;
+
+    engine.reset();
+    for (uint8_t i = 0; i < filter_count; ++i) {
+        const twai_user_filter_t& filter = active_filters[i];
+        switch (filter.type) {
+            case TWAI_FILTER_TYPE_MASK:
+            case TWAI_FILTER_TYPE_CARE_MASK:
+                ok &= engine.add_mask(filter.id, care_bits(filter), filter.is_extended);
+                break;
+            case TWAI_FILTER_TYPE_LIST:
+                ok &= engine.add_id(filter.id, filter.is_extended);
+                break;
+            case TWAI_FILTER_TYPE_RANGE:
+                ok &= engine.add_range(filter.id, filter.mask_or_end_id, filter.is_extended);
+                break;
+        }
+    }
+    engine.finalize();
+    hw_filter_plan = TWAI_HwFilter::synthesize(engine);
+    rejected_ids.clear();   // El tráfico rechazado era relativo a los filtros anteriores
+
+    // Publicar el motor nuevo y esperar a las ISR que aún usan el anterior
+    filter_engines.publish();
+    return ok;
+}
+
 bool TWAI_Object::apply_hardware_filters() {
-    // 1. Detener el controlador temporalmente
-    twai_stop();
-    twai_driver_uninstall();
-
-    // 2. Configurar filtros según active_filters
-    twai_filter_config_t final_filter = TWAI_FILTER_CONFIG_ACCEPT_ALL();
-
-    if (!active_filters.empty()) {
-        // Configuración para primer filtro
-        const auto& primary_filter = active_filters[0];
-        
-        final_filter.acceptance_code = primary_filter.id << (primary_filter.is_extended ? 0 : 21);
-        final_filter.acceptance_mask = 
-            (primary_filter.type == TWAI_FILTER_TYPE_MASK) 
-            ? (primary_filter.mask_or_end_id << (primary_filter.is_extended ? 0 : 21))
-            : 0x7FFFFFFF; // Máscara completa para filtro de rango
-    }
-
-    // 3. Reinstalar driver con nuevos filtros
-    esp_err_t err = twai_driver_install(&g_config, &t_config, &final_filter);
+    // Dentro de una transacción solo se marca el cambio
+    if (filter_update_depth > 0) {
+        filters_dirty = true;
+        return true;
+    }
+    filters_dirty = false;
+
+    // Excluir al ajuste automático mientras se recompila
+    while (filter_busy.exchange(true, std::memory_order_acquire)) vTaskDelay(1);
+    bool ok = compile_software_filters() && program_hw_filter(hw_filter_plan);
+    filter_busy.store(false, std::memory_order_release);
+    return ok;
+}
+
+bool TWAI_Object::program_hw_filter(const TWAI_HwFilter::plan_t& plan) {
+    twai_filter_config_t final_filter = f_config;
+    final_filter.acceptance_code = plan.acceptance_code;
+    final_filter.acceptance_mask = plan.acceptance_mask;
+    final_filter.single_filter = plan.single_filter;
+
+    // Si el hardware no cambia, el motor software ya está activo: sin reinstalar
+    if (!driver_installed ||
+        (final_filter.acceptance_code == f_config.acceptance_code &&
+         final_filter.acceptance_mask == f_config.acceptance_mask &&
+         final_filter.single_filter == f_config.single_filter)) {
+        f_config = final_filter;
+        ++filter_reprograms_skipped;
+        return true;
+    }
+
+    // 1. Entregar lo que ya está en el driver y detener el controlador
+    if (ret_handle) esp_intr_disable(ret_handle);
+    drain_driver_rx();
+    driver_stop();
+    driver_uninstall();
+    driver_installed = false;
+    ++filter_reprograms;
+
+    // 2. Reinstalar driver con el filtro sintetizado. ESP32-C3/C6 tienen el mismo
+    //    filtro de aceptación único (sin segundo banco ni filter_reg_conf): el
+    //    segundo filtro es el modo doble del plan y el resto, el motor software
+    esp_err_t err = driver_install(final_filter);
+    if (ret_handle) esp_intr_enable(ret_handle);
     if (err != ESP_OK) return false;
+    driver_installed = true;
+    f_config = final_filter;
+
+    return driver_start() == ESP_OK;
+}
+
+void TWAI_Object::drain_driver_rx() {
+    BaseType_t woken = pdFALSE;
+    can_event_t event = {0};
+    // La cola del driver se lee fuera de la sección crítica; solo la entrega excluye a la interrupción
+    while (driver_receive(&event.message, 0) == ESP_OK) {
+        event.timestamp = xTaskGetTickCount();
+        uint64_t timestamp_us = esp_timer_get_time();
+        portENTER_CRITICAL(&rx_lock);
+        receive_frame(event, timestamp_us, &woken);
+        portEXIT_CRITICAL(&rx_lock);
+    }
+    wake_rx_waiter(&woken);
+}
+
+void TWAI_Object::enable_filter_tuning(uint32_t period_ms, uint8_t min_gain_percent, uint32_t quiet_us) {
+    tune_period_ms = period_ms;
+    tune_min_gain = min_gain_percent;
+    tune_quiet_us = quiet_us;
+    tune_last_us = 0;
+    rejected_ids.clear();
+    if (period_ms) service_required = true;
+}
+
+bool TWAI_Object::bus_quiet(uint32_t quiet_us) {
+    // Sellos antes que la hora: ninguno puede quedar en el futuro
+    uint32_t rx = last_rx_stamp.load(std::memory_order_relaxed);
+    uint32_t tx = last_tx_stamp.load(std::memory_order_relaxed);
+    uint32_t now = uint32_t(now_us());
+    if (now - rx < quiet_us || now - tx < quiet_us) return false;
+
+    portENTER_CRITICAL(&tx_lock);
+    bool idle = !tx_inflight && tx_pending.empty();
+    portEXIT_CRITICAL(&tx_lock);
+    if (!idle) return false;
+
+    twai_status_info_t status = get_status();
+    return status.msgs_to_tx == 0 && status.msgs_to_rx == 0;
+}
+
+bool TWAI_Object::tune_filters() {
+    if (filter_busy.exchange(true, std::memory_order_acquire)) return false;
+
+    // Tasa de interrupciones desde el paso anterior
+    uint64_t now = now_us();
+    uint32_t irqs = irq_count.load(std::memory_order_relaxed);
+    bool first = tune_last_us == 0;
+    uint32_t rate = first || now == tune_last_us ? 0
+                  : uint32_t(uint64_t(irqs - tune_last_irqs) * 1000000 / (now - tune_last_us));
+    tune_last_us = now;
+    tune_last_irqs = irqs;
+    if (tune_measuring && !first) {
+        tune_report.irq_rate_after = rate;
+        tune_measuring = false;
+    }
+
+    TWAI_IdHistogram::entry_t traffic[TWAI_ID_HISTOGRAM_SIZE];
+    size_t count = rejected_ids.snapshot(traffic, TWAI_ID_HISTOGRAM_SIZE);
+    rejected_ids.decay();
+
+    bool retuned = false;
+    if (!first && count > 0 && filter_update_depth == 0) {
+        const TWAI_FilterEngine& engine = filter_engines.front();
+        TWAI_HwFilter::plan_t plan = TWAI_HwFilter::synthesize(engine, traffic, count);
+        uint64_t before = TWAI_HwFilter::traffic_passed(hw_filter_plan, traffic, count);
+        uint64_t after = TWAI_HwFilter::traffic_passed(plan, traffic, count);
+        uint8_t gain = before ? uint8_t((before - after) * 100 / before) : 0;
 
-    // 4. Para ESP32-C3/C6 con doble banco de filtros:
-    // TODO: Probar con estos controladores cuando los tenga disponibles.
-    #if defined(CONFIG_IDF_TARGET_ESP32C3) || defined(CONFIG_IDF_TARGET_ESP32C6)
-    if (active_filters.size() > 1) {
-        const auto& secondary_filter = active_filters[1];
-        TWAI.filter_reg_conf.acceptance_code = secondary_filter.id;
-        TWAI.filter_reg_conf.acceptance_mask = secondary_filter.mask_or_end_id;
+        if (after < before && gain >= tune_min_gain && program_hw_filter(plan)) {
+            hw_filter_plan = plan;
+            ++tune_report.retunes;
+            tune_report.irq_rate_before = rate;
+            tune_report.irq_rate_after = 0;
+            tune_report.expected_gain = gain;
+            tune_measuring = true;
+            retuned = true;
+        }
     }
-    #endif
 
-    return twai_start() == ESP_OK;
+    filter_busy.store(false, std::memory_order_release);
+    return retuned;
+}
+
+TWAI_Object::filter_tune_report_t TWAI_Object::get_filter_tune_report() const {
+    return tune_report;
 }
 
 void IRAM_ATTR TWAI_Object::twai_isr_handler(void* arg) {
@@ -138,32 +689,451 @@ void IRAM_ATTR TWAI_Object::twai_isr_handler(void* arg) {
 }
 
 void IRAM_ATTR TWAI_Object::handle_interrupt() {
+    int64_t isr_start = esp_timer_get_time();
     BaseType_t xHigherPriorityTaskWoken = pdFALSE;
     twai_status_info_t status;
-    twai_get_status_info(&status);
+    driver_status(&status);
+    stats.on_error_counters(status.tx_error_counter, status.rx_error_counter);
+    track_error_level(status, isr_start);
 
+    // Fin de la trama en curso: sellar con la hora de esta interrupción
+    if (tx_inflight && status.msgs_to_tx == 0 && tx_done_stamp.load(std::memory_order_relaxed) == 0) {
+        tx_done_stamp.store(uint32_t(isr_start) | 1, std::memory_order_relaxed);
+    }
+
+    irq_count.fetch_add(1, std::memory_order_relaxed);
+    portENTER_CRITICAL_ISR(&rx_lock);
     if (status.msgs_to_rx > 0) {
+        last_rx_stamp.store(uint32_t(isr_start), std::memory_order_relaxed);
+        if (txcvr_asleep.load(std::memory_order_relaxed)) request_txcvr_wake(isr_start);
         can_event_t event = {0};
-        while (twai_receive(&event.message, 0) == ESP_OK) {
+        while (driver_receive(&event.message, 0) == ESP_OK) {
             event.timestamp = xTaskGetTickCountFromISR();
-            xQueueSendFromISR(event_queue, &event, &xHigherPriorityTaskWoken);
+            receive_frame(event, esp_timer_get_time(), &xHigherPriorityTaskWoken);
         }
     }
 
     if (error_events_enabled && status.state == TWAI_STATE_BUS_OFF) {
         can_event_t event = {0};
         event.is_error = true;
-        xQueueSendFromISR(event_queue, &event, &xHigherPriorityTaskWoken);
+        event.timestamp = xTaskGetTickCountFromISR();
+        post_event(event, esp_timer_get_time(), &xHigherPriorityTaskWoken);
     }
 
+    portEXIT_CRITICAL_ISR(&rx_lock);
+
+    // Despertar al consumidor del anillo una sola vez por interrupción
+    wake_rx_waiter(&xHigherPriorityTaskWoken);
+
+    stats.on_isr(uint32_t(esp_timer_get_time() - isr_start));
+
     if (xHigherPriorityTaskWoken == pdTRUE) {
         portYIELD_FROM_ISR();
     }
 }
 
+void IRAM_ATTR TWAI_Object::receive_frame(const can_event_t& event, uint64_t timestamp_us, BaseType_t* woken) {
+    // La traza y la carga de bus ven todo lo que entrega el controlador, antes del filtro
+    TWAI_Trace* recorder = trace.load(std::memory_order_acquire);
+    if (recorder) {
+        recorder->record(pack_event(event, timestamp_us, controller_id));
+    }
+    bus_load.on_frame(event.message, timestamp_us);
+
+    // Filtro software antes de encolar
+    bool accepted = TWAI_DoubleBuffer<TWAI_FilterEngine>::reader_t(filter_engines)->matches(
+        event.message.identifier, event.message.extd);
+    if (!accepted) {
+        drops_filtered.fetch_add(1, std::memory_order_relaxed);
+        if (tune_period_ms) rejected_ids.record(event.message.identifier, event.message.extd);
+        return;
+    }
+    stats.on_rx(event.message.data_length_code);
+
+    // Suscriptores directos; el resto va a la cola general. Las tablas quedan
+    // fijadas hasta terminar la entrega
+    TWAI_Dispatch::reader_t subscribers(dispatch);
+    uint32_t slots = subscribers.lookup(event.message.identifier, event.message.extd);
+    if (slots) {
+        deliver(subscribers, slots, event, timestamp_us, woken);
+        return;
+    }
+    if (post_event(event, timestamp_us, woken) && rx_moderation_frames > 1
+        && is_rx_priority(event.message.identifier, event.message.extd)) {
+        rx_urgent.store(true, std::memory_order_relaxed);
+    }
+}
+
+void IRAM_ATTR TWAI_Object::wake_rx_waiter(BaseType_t* woken) {
+    bool urgent = rx_urgent.exchange(false, std::memory_order_relaxed);
+    if (!event_ring_enabled || event_ring.empty()) return;
+    TaskHandle_t waiter = rx_waiter.load(std::memory_order_acquire);
+    if (!waiter) return;   // El consumidor vaciará el anillo en su próxima llamada
+
+    if (rx_moderation_frames > 1 && !urgent && event_ring.size() < rx_moderation_frames) {
+        // Acotar la espera desde el primer evento pendiente
+        if (!rx_timer_armed.exchange(true, std::memory_order_relaxed)) {
+            esp_timer_start_once(rx_timer, rx_moderation_us);
+        }
+        return;
+    }
+    if (rx_timer_armed.exchange(false, std::memory_order_relaxed)) {
+        esp_timer_stop(rx_timer);
+    }
+    stats.on_rx_wake();
+    vTaskNotifyGiveFromISR(waiter, woken);
+}
+
+bool IRAM_ATTR TWAI_Object::is_rx_priority(uint32_t id, bool is_extended) const {
+    uint32_t key = id | (is_extended ? 0x80000000 : 0);
+    uint8_t count = rx_priority_count.load(std::memory_order_acquire);
+    for (uint8_t i = 0; i < count; ++i) {
+        if (rx_priority_ids[i] == key) return true;
+    }
+    return false;
+}
+
+void TWAI_Object::rx_timer_callback(void* arg) {
+    TWAI_Object* self = static_cast<TWAI_Object*>(arg);
+    self->rx_timer_armed.store(false, std::memory_order_relaxed);
+    TaskHandle_t waiter = self->rx_waiter.load(std::memory_order_acquire);
+    if (waiter && !self->event_ring.empty()) {
+        self->stats.on_rx_wake();
+        xTaskNotifyGive(waiter);
+    }
+}
+
+bool IRAM_ATTR TWAI_Object::post_event(const can_event_t& event, uint64_t timestamp_us, BaseType_t* woken) {
+    can_event_packed_t packed = pack_event(event, timestamp_us, controller_id);
+    const void* queued = packed_events ? static_cast<const void*>(&packed) : static_cast<const void*>(&event);
+
+    // Con RESERVE_ERRORS los datos no pueden ocupar el último hueco
+    if (overflow_policy == TWAI_OVERFLOW_RESERVE_ERRORS && !event.is_error) {
+        size_t used = event_ring_enabled ? event_ring.size() : uxQueueMessagesWaitingFromISR(event_queue);
+        size_t capacity = event_ring_enabled ? event_ring.capacity() : event_queue_length;
+        if (used + 1 >= capacity) {
+            drops_queue_full.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+    }
+
+    bool stored = event_ring_enabled ? event_ring.push(packed)
+                                     : xQueueSendFromISR(event_queue, queued, woken) == pdTRUE;
+    if (stored) {
+        stats.on_queue_level(event_ring_enabled ? event_ring.size() : uxQueueMessagesWaitingFromISR(event_queue));
+        return true;
+    }
+
+    // Lleno: descartar el más antiguo si la política lo permite (los errores siempre)
+    if (overflow_policy != TWAI_OVERFLOW_DROP_NEWEST || event.is_error) {
+        bool evicted;
+        if (event_ring_enabled) {
+            evicted = event_ring.evict_oldest();
+        } else {
+            union { can_event_t event; can_event_packed_t packed; } oldest;
+            evicted = xQueueReceiveFromISR(event_queue, &oldest, woken) == pdTRUE;
+        }
+        if (evicted) {
+            drops_queue_full.fetch_add(1, std::memory_order_relaxed);
+            stored = event_ring_enabled ? event_ring.push(packed)
+                                        : xQueueSendFromISR(event_queue, queued, woken) == pdTRUE;
+            if (stored) return true;
+        }
+    }
+
+    (event.is_error ? drops_errors : drops_queue_full).fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+TWAI_Object::can_event_packed_t IRAM_ATTR TWAI_Object::pack_event(const can_event_t& event, uint64_t timestamp_us, uint8_t controller) {
+    can_event_packed_t packed;
+    packed.timestamp_us = timestamp_us;
+    packed.identifier = event.message.identifier;
+    packed.flags_dlc = (event.message.data_length_code & PACKED_DLC_MASK)
+                     | (event.message.extd ? PACKED_EXTD : 0)
+                     | (event.message.rtr ? PACKED_RTR : 0)
+                     | (event.is_error ? PACKED_ERROR : 0)
+                     | (event.message.dlc_non_comp ? PACKED_DLC_NON_COMP : 0)
+                     | (uint32_t(controller & 0x0F) << PACKED_CTRL_SHIFT);
+    memcpy(packed.data, event.message.data, sizeof(packed.data));
+    return packed;
+}
+
+twai_message_t TWAI_Object::to_message(const can_event_packed_t& packed) {
+    twai_message_t msg = {};
+    msg.identifier = packed.identifier;
+    msg.data_length_code = packed.flags_dlc & PACKED_DLC_MASK;
+    msg.extd = (packed.flags_dlc & PACKED_EXTD) != 0;
+    msg.rtr = (packed.flags_dlc & PACKED_RTR) != 0;
+    msg.dlc_non_comp = (packed.flags_dlc & PACKED_DLC_NON_COMP) != 0;
+    memcpy(msg.data, packed.data, sizeof(msg.data));
+    return msg;
+}
+
+TWAI_Object::can_event_t TWAI_Object::unpack_event(const can_event_packed_t& packed) {
+    can_event_t event;
+    event.message = to_message(packed);
+    event.timestamp = TickType_t(packed.timestamp_us / (1000ULL * portTICK_PERIOD_MS));
+    event.is_error = (packed.flags_dlc & PACKED_ERROR) != 0;
+    return event;
+}
+
+void IRAM_ATTR TWAI_Object::deliver(const TWAI_Dispatch::reader_t& subscribers, uint32_t slots,
+                                     const can_event_t& event, uint64_t timestamp_us, BaseType_t* woken) {
+    while (slots) {
+        uint8_t slot = __builtin_ctz(slots);
+        slots &= slots - 1;
+
+        const TWAI_Dispatch::entry_t& sub = subscribers.entry(slot);
+        switch (sub.kind) {
+            case SUBSCRIBER_CALLBACK:
+                reinterpret_cast<event_handler_t>(sub.target)(event, sub.context);
+                break;
+            case SUBSCRIBER_QUEUE:
+                if (xQueueSendFromISR(static_cast<QueueHandle_t>(sub.target), &event, woken) != pdTRUE) {
+                    drops_subscriber.fetch_add(1, std::memory_order_relaxed);
+                }
+                break;
+            case SUBSCRIBER_MAILBOX:
+                static_cast<TWAI_Mailbox<can_event_t>*>(sub.target)->write(event);
+                break;
+            case SUBSCRIBER_GATEWAY:
+                static_cast<TWAI_Gateway*>(sub.target)->on_frame(event, timestamp_us, sub.context, woken);
+                break;
+            case SUBSCRIBER_EXECUTOR:
+#if TWAI_COROUTINES
+                static_cast<TWAI_CoExecutor*>(sub.target)->on_frame(event, woken);
+#endif
+                break;
+        }
+    }
+}
+
+int TWAI_Object::add_subscription(const twai_user_filter_t& ids, subscriber_kind_t kind, void* target, void* context) {
+    if (!target) return -1;
+    switch (ids.type) {
+        case TWAI_FILTER_TYPE_MASK:
+        case TWAI_FILTER_TYPE_CARE_MASK:
+            return dispatch.add(ids.id, care_bits(ids), true, ids.is_extended, kind, target, context);
+        case TWAI_FILTER_TYPE_LIST:
+            return dispatch.add(ids.id, ids.id, false, ids.is_extended, kind, target, context);
+        case TWAI_FILTER_TYPE_RANGE:
+            return dispatch.add(ids.id, ids.mask_or_end_id, false, ids.is_extended, kind, target, context);
+    }
+    return -1;
+}
+
+int TWAI_Object::subscribe(const twai_user_filter_t& ids, event_handler_t handler, void* context) {
+    return add_subscription(ids, SUBSCRIBER_CALLBACK, reinterpret_cast<void*>(handler), context);
+}
+
+int TWAI_Object::subscribe(const twai_user_filter_t& ids, QueueHandle_t queue) {
+    return add_subscription(ids, SUBSCRIBER_QUEUE, queue, nullptr);
+}
+
+int TWAI_Object::subscribe_gateway(const twai_user_filter_t& ids, TWAI_Gateway* gateway, void* route) {
+    return add_subscription(ids, SUBSCRIBER_GATEWAY, gateway, route);
+}
+
+#if TWAI_COROUTINES
+int TWAI_Object::subscribe_executor(const twai_user_filter_t& ids, TWAI_CoExecutor* executor) {
+    return add_subscription(ids, SUBSCRIBER_EXECUTOR, executor, nullptr);
+}
+
+void TWAI_Object::attach_executor(TWAI_CoExecutor* executor) {
+    co_executor = executor;
+}
+#endif
+
+bool TWAI_Object::unsubscribe(int handle) {
+    return dispatch.remove(handle);
+}
+
+int TWAI_Object::add_mailbox(uint32_t id, bool is_extended) {
+    for (int i = 0; i < MAX_MAILBOXES; ++i) {
+        if (mailbox_subscription[i] >= 0) continue;
+
+        mailboxes[i].reset();
+        twai_user_filter_t ids = { id, id, TWAI_FILTER_TYPE_LIST, is_extended };
+        int handle = add_subscription(ids, SUBSCRIBER_MAILBOX, &mailboxes[i], nullptr);
+        if (handle < 0) return -1;
+        mailbox_subscription[i] = handle;
+        return i;
+    }
+    return -1;
+}
+
+bool TWAI_Object::read_mailbox(int handle, can_event_t& event, uint32_t* updates) {
+    if (handle < 0 || handle >= MAX_MAILBOXES || mailbox_subscription[handle] < 0) return false;
+    return mailboxes[handle].read(event, updates);
+}
+
+bool TWAI_Object::remove_mailbox(int handle) {
+    if (handle < 0 || handle >= MAX_MAILBOXES || mailbox_subscription[handle] < 0) return false;
+    bool ok = unsubscribe(mailbox_subscription[handle]);
+    mailbox_subscription[handle] = -1;
+    return ok;
+}
+
 // Implementación del resto de métodos...
 bool TWAI_Object::send(const twai_message_t& msg, TickType_t timeout) {
-    return twai_transmit(&msg, timeout) == ESP_OK;
+    return submit(msg, 0, 0, timeout);
+}
+
+bool TWAI_Object::send(const twai_message_t& msg, const tx_options_t& options, TickType_t timeout) {
+    twai_message_t frame = msg;
+    if (options.single_shot) frame.ss = 1;
+    uint64_t deadline = options.deadline_us ? now_us() + options.deadline_us : 0;
+    return submit(frame, deadline, options.tag, timeout);
+}
+
+bool TWAI_Object::submit(const twai_message_t& msg, uint64_t deadline_us, uint32_t tag, TickType_t timeout) {
+    // Transceiver en standby: volver a modo normal antes de entregar la trama
+    uint64_t submit_us = now_us();
+    last_tx_stamp.store(uint32_t(submit_us), std::memory_order_relaxed);
+    if (txcvr_idle_ms) wake_txcvr(submit_us, true);
+
+    // El nodo simulado ya ordena por prioridad y no puede bloquear
+    if (virtual_bus) {
+        if (virtual_node < 0 || !virtual_bus->transmit(virtual_node, msg, deadline_us, tag)) return false;
+        stats.on_tx(msg.data_length_code);
+        trace_tx(msg);
+        return true;
+    }
+    if (!tx_scheduler_enabled) {
+        if (driver_transmit(msg, timeout) != ESP_OK) return false;
+        bus_load.on_frame(msg, esp_timer_get_time());
+        stats.on_tx(msg.data_length_code);
+        trace_tx(msg);
+        return true;
+    }
+
+    TickType_t start = xTaskGetTickCount();
+    while (true) {
+        uint64_t now = esp_timer_get_time();
+        portENTER_CRITICAL(&tx_lock);
+        bool queued = tx_pending.push(msg, now, deadline_us, tag);
+        portEXIT_CRITICAL(&tx_lock);
+
+        if (queued) {
+            stats.on_tx(msg.data_length_code);
+            trace_tx(msg);
+            pump_tx();
+            return true;
+        }
+        // Cola llena: esperar a que se libere dentro del timeout
+        if (xTaskGetTickCount() - start >= timeout) return false;
+        vTaskDelay(1);
+    }
+}
+
+size_t TWAI_Object::send_batch(const twai_message_t* msgs, size_t count) {
+    if (!msgs) return 0;
+
+    size_t queued = 0;
+    if (!tx_scheduler_enabled || virtual_bus) {
+        while (queued < count && send(msgs[queued], 0)) ++queued;
+        return queued;
+    }
+
+    uint64_t now = esp_timer_get_time();
+    last_tx_stamp.store(uint32_t(now), std::memory_order_relaxed);
+    if (txcvr_idle_ms) wake_txcvr(now, true);
+    portENTER_CRITICAL(&tx_lock);
+    while (queued < count && tx_pending.push(msgs[queued], now)) ++queued;
+    portEXIT_CRITICAL(&tx_lock);
+
+    for (size_t i = 0; i < queued; ++i) {
+        stats.on_tx(msgs[i].data_length_code);
+        trace_tx(msgs[i]);
+    }
+    pump_tx();
+    return queued;
+}
+
+void TWAI_Object::enable_tx_scheduler(bool enable) {
+    tx_scheduler_enabled = enable;
+}
+
+void TWAI_Object::set_tx_complete_handler(tx_complete_handler_t handler, void* context) {
+    tx_complete_handler = handler;
+    tx_complete_context = context;
+}
+
+void TWAI_Object::set_service_task(UBaseType_t priority, BaseType_t core) {
+    service_priority = priority;
+    service_core = core;
+}
+
+void TWAI_Object::pump_tx() {
+    expire_tx(esp_timer_get_time());
+
+    TWAI_TxQueue::entry_t next;
+    portENTER_CRITICAL(&tx_lock);
+    bool have = !tx_inflight && tx_pending.pop(next);
+    if (have) {
+        tx_inflight = true;
+        tx_current = next;
+    }
+    portEXIT_CRITICAL(&tx_lock);
+    if (!have) return;
+
+    // Controlador ocupado o detenido: devolver la trama a su sitio
+    if (driver_transmit(next.msg, 0) != ESP_OK) {
+        portENTER_CRITICAL(&tx_lock);
+        tx_inflight = false;
+        tx_pending.requeue(next);
+        portEXIT_CRITICAL(&tx_lock);
+        return;
+    }
+    // Descartar un sello tomado antes de que el driver contara la trama
+    tx_done_stamp.store(0, std::memory_order_relaxed);
+}
+
+void TWAI_Object::expire_tx(uint64_t now_us) {
+    TWAI_TxQueue::entry_t expired[8];
+    size_t count;
+    do {
+        portENTER_CRITICAL(&tx_lock);
+        count = tx_pending.remove_expired(now_us, expired, 8);
+        portEXIT_CRITICAL(&tx_lock);
+        for (size_t i = 0; i < count; ++i) complete_tx(expired[i], TWAI_TX_EXPIRED, now_us);
+    } while (count == 8);
+}
+
+void TWAI_Object::on_tx_done(uint64_t now_us, bool failed) {
+    portENTER_CRITICAL(&tx_lock);
+    bool was_inflight = tx_inflight;
+    tx_inflight = false;
+    TWAI_TxQueue::entry_t done = tx_current;
+    portEXIT_CRITICAL(&tx_lock);
+    uint32_t stamp = tx_done_stamp.exchange(0, std::memory_order_relaxed);
+    if (!was_inflight) {
+        // Sin planificador solo la alerta marca el fin del envío tras despertar
+        if (!failed) record_wake_latency(now_us);
+        return;
+    }
+
+    // Reconstruir los 64 bits del sello de la interrupción (anterior a la alerta)
+    uint64_t done_us = stamp ? now_us - uint32_t(uint32_t(now_us) - stamp) : now_us;
+    complete_tx(done, failed ? TWAI_TX_FAILED : TWAI_TX_SUCCESS, done_us);
+}
+
+void TWAI_Object::complete_tx(const TWAI_TxQueue::entry_t& entry, twai_tx_result_t result, uint64_t done_us) {
+    if (result == TWAI_TX_SUCCESS) {
+        stats.on_tx_latency(uint32_t(done_us - entry.enqueue_us));
+        bus_load.on_frame(entry.msg, done_us);
+        record_wake_latency(done_us);
+    } else if (result == TWAI_TX_EXPIRED) stats.on_tx_expired();
+
+    if (!tx_complete_handler) return;
+    tx_completion_t completion;
+    completion.message = entry.msg;
+    completion.result = result;
+    completion.tag = entry.tag;
+    completion.enqueue_us = entry.enqueue_us;
+    completion.done_us = done_us;
+    tx_complete_handler(completion, tx_complete_context);
 }
 
 QueueHandle_t TWAI_Object::get_event_queue() {
@@ -174,21 +1144,500 @@ void TWAI_Object::enable_error_events(bool enable) {
     error_events_enabled = enable;
 }
 
+void TWAI_Object::set_overflow_policy(twai_overflow_policy_t policy) {
+    overflow_policy = policy;
+}
+
+TWAI_Object::drop_stats_t TWAI_Object::get_drop_stats(bool reset) {
+    drop_stats_t stats = {};
+    if (driver_installed || virtual_node >= 0) {
+        twai_status_info_t status = get_status();
+        stats.hw_overrun = status.rx_overrun_count;
+        stats.hw_missed = status.rx_missed_count;
+    }
+    if (reset) {
+        stats.filtered = drops_filtered.exchange(0, std::memory_order_relaxed);
+        stats.queue_full = drops_queue_full.exchange(0, std::memory_order_relaxed);
+        stats.errors_dropped = drops_errors.exchange(0, std::memory_order_relaxed);
+        stats.subscriber_full = drops_subscriber.exchange(0, std::memory_order_relaxed);
+    } else {
+        stats.filtered = drops_filtered.load(std::memory_order_relaxed);
+        stats.queue_full = drops_queue_full.load(std::memory_order_relaxed);
+        stats.errors_dropped = drops_errors.load(std::memory_order_relaxed);
+        stats.subscriber_full = drops_subscriber.load(std::memory_order_relaxed);
+    }
+    return stats;
+}
+
+void TWAI_Object::enable_event_ring(bool enable) {
+    event_ring_enabled = enable;
+}
+
+bool TWAI_Object::set_rx_moderation(uint16_t frames, uint32_t timeout_us) {
+    if (frames > TWAI_EVENT_RING_SIZE) return false;
+    if (frames > 1 && !rx_timer) {
+        esp_timer_create_args_t args = {};
+        args.callback = rx_timer_callback;
+        args.arg = this;
+        args.dispatch_method = ESP_TIMER_TASK;
+        args.name = "TWAI_RX";
+        if (esp_timer_create(&args, &rx_timer) != ESP_OK) return false;
+    }
+    // El tiempo primero: el ISR lee frames antes de usarlo
+    rx_moderation_us = timeout_us ? timeout_us : 1;
+    rx_moderation_frames = frames;
+    return true;
+}
+
+bool TWAI_Object::add_rx_priority_id(uint32_t id, bool is_extended) {
+    uint8_t count = rx_priority_count.load(std::memory_order_relaxed);
+    if (count >= MAX_RX_PRIORITY_IDS) return false;
+    rx_priority_ids[count] = id | (is_extended ? 0x80000000 : 0);
+    rx_priority_count.store(count + 1, std::memory_order_release);
+    return true;
+}
+
+void TWAI_Object::clear_rx_priority_ids() {
+    rx_priority_count.store(0, std::memory_order_release);
+}
+
+size_t TWAI_Object::receive_batch(can_event_packed_t* out, size_t max, TickType_t timeout) {
+    if (!out || max == 0) return 0;
+
+    size_t n = event_ring.pop_batch(out, max);
+    if (n > 0 || timeout == 0) {
+        record_latency(out, n);
+        return n;
+    }
+
+    // Registrar la tarea antes de volver a mirar, para no perder la notificación
+    rx_waiter.store(xTaskGetCurrentTaskHandle(), std::memory_order_release);
+    TickType_t start = xTaskGetTickCount();
+    while ((n = event_ring.pop_batch(out, max)) == 0) {
+        TickType_t elapsed = xTaskGetTickCount() - start;
+        if (timeout != portMAX_DELAY && elapsed >= timeout) break;
+        ulTaskNotifyTake(pdTRUE, timeout == portMAX_DELAY ? portMAX_DELAY : timeout - elapsed);
+    }
+    rx_waiter.store(nullptr, std::memory_order_release);
+    record_latency(out, n);
+    return n;
+}
+
+size_t TWAI_Object::receive_batch(can_event_t* out, size_t max, TickType_t timeout) {
+    if (!out || max == 0) return 0;
+
+    // Convertir por bloques; solo el primero espera
+    can_event_packed_t chunk[8];
+    size_t total = 0;
+    while (total < max) {
+        size_t want = max - total < 8 ? max - total : 8;
+        size_t n = receive_batch(chunk, want, total == 0 ? timeout : 0);
+        for (size_t i = 0; i < n; ++i) {
+            out[total + i] = unpack_event(chunk[i]);
+        }
+        total += n;
+        if (n < want) break;
+    }
+    return total;
+}
+
 twai_status_info_t TWAI_Object::get_status() {
-    twai_status_info_t status;
-    twai_get_status_info(&status);
+    twai_status_info_t status = {};
+    if (virtual_node < 0) {
+        driver_status(&status);
+        return status;
+    }
+
+    TWAI_VirtualBus::node_stats_t node;
+    virtual_bus->get_node_stats(virtual_node, node);
+    status.state = node.state;
+    status.msgs_to_tx = node.tx_pending;
+    status.tx_error_counter = node.tec;
+    status.rx_error_counter = node.rec;
+    status.tx_failed_count = node.tx_failed;
+    status.arb_lost_count = node.arb_lost;
+    status.bus_error_count = node.bus_errors;
     return status;
 }
 
+void TWAI_Object::record_latency(const can_event_packed_t* events, size_t count) {
+    uint64_t now = now_us();
+    for (size_t i = 0; i < count; ++i) {
+        stats.on_latency(uint32_t(now - events[i].timestamp_us));
+    }
+}
+
+TWAI_Object::stats_t TWAI_Object::get_stats(bool reset) {
+    stats_t result;
+    result.counters = stats.read(reset);
+
+    twai_status_info_t status = {};
+    if (driver_installed || virtual_node >= 0) status = get_status();
+    result.tx_error_counter = status.tx_error_counter;
+    result.rx_error_counter = status.rx_error_counter;
+    result.bus_errors = status.bus_error_count - stats_baseline.bus_error_count;
+    result.arb_lost = status.arb_lost_count - stats_baseline.arb_lost_count;
+    result.tx_failed = status.tx_failed_count - stats_baseline.tx_failed_count;
+    if (reset) stats_baseline = status;
+    return result;
+}
+
+void TWAI_Object::enable_bus_load(twai_stuffing_t stuffing) {
+    bus_load_requested = true;
+    bus_load_stuffing = stuffing;
+    if (bus_baud) bus_load.configure(bus_baud, stuffing, now_us());
+}
+
+TWAI_BusLoad::load_t TWAI_Object::get_bus_load(bool reset) {
+    return bus_load.read(now_us(), reset);
+}
+
+size_t TWAI_Object::get_bus_load_ids(TWAI_BusLoad::id_share_t* out, size_t max) {
+    return bus_load.top_ids(out, max);
+}
+
 bool TWAI_Object::is_bus_off() {
     return get_status().state == TWAI_STATE_BUS_OFF;
 }
 
 bool TWAI_Object::initiate_recovery() {
-    return twai_initiate_recovery() == ESP_OK;
+    if (virtual_node >= 0) return virtual_bus->initiate_recovery(virtual_node);
+    return driver_recover() == ESP_OK;
+}
+
+void TWAI_Object::enable_auto_recovery(bool enable, uint32_t backoff_ms, uint32_t backoff_max_ms,
+                                       uint32_t txcvr_cycle_ms) {
+    recovery_backoff_ms = backoff_ms;
+    recovery_backoff_max_ms = backoff_max_ms;
+    recovery_txcvr_cycle_ms = txcvr_cycle_ms;
+    recovery_enabled = enable;
+    if (!enable) return;
+    service_required = true;
+    if (driver_installed) start_service();
+}
+
+void IRAM_ATTR TWAI_Object::track_error_level(const twai_status_info_t& status, uint64_t now_us) {
+    uint8_t level = TWAI_ERROR_ACTIVE;
+    if (status.state == TWAI_STATE_BUS_OFF || status.state == TWAI_STATE_RECOVERING) {
+        level = TWAI_ERROR_BUS_OFF;
+    } else if (status.tx_error_counter >= 128 || status.rx_error_counter >= 128) {
+        level = TWAI_ERROR_PASSIVE;
+    } else if (status.tx_error_counter >= 96 || status.rx_error_counter >= 96) {
+        level = TWAI_ERROR_WARNING;
+    }
+
+    // exchange: cada transición se cuenta una sola vez aunque ISR y tarea la vean
+    uint8_t old = error_level.exchange(level, std::memory_order_relaxed);
+    if (level <= old) return;
+    if (old < TWAI_ERROR_WARNING) error_warnings.fetch_add(1, std::memory_order_relaxed);
+    if (level >= TWAI_ERROR_PASSIVE && old < TWAI_ERROR_PASSIVE) error_passives.fetch_add(1, std::memory_order_relaxed);
+    if (level == TWAI_ERROR_BUS_OFF) {
+        bus_offs.fetch_add(1, std::memory_order_relaxed);
+        bus_off_stamp.store(uint32_t(now_us) | 1, std::memory_order_relaxed);
+    }
+}
+
+TWAI_Object::twai_recovery_state_t TWAI_Object::poll_recovery() {
+    if (!recovery_enabled || !(driver_installed || virtual_node >= 0)) return recovery_state;
+
+    uint64_t now = now_us();
+    twai_status_info_t status = get_status();
+    track_error_level(status, now);
+
+    // Encadenar los pasos que no tienen que esperar
+    twai_recovery_state_t previous;
+    do {
+        previous = recovery_state;
+        switch (recovery_state) {
+            case TWAI_RECOVERY_IDLE: {
+                if (status.state != TWAI_STATE_BUS_OFF) break;
+                // Hora del bus-off según el ISR, si la vio (el bit 0 del sello puede ir 1 us adelantado)
+                uint32_t stamp = bus_off_stamp.load(std::memory_order_relaxed);
+                uint32_t age = uint32_t(now) - stamp;
+                incident_start_us = stamp && age < 0x80000000u ? now - age : now;
+                // Un bus-off poco después del anterior alarga la espera
+                bool series = last_recovered_us &&
+                    incident_start_us - last_recovered_us < uint64_t(recovery_backoff_max_ms) * 1000;
+                bus_off_series = series ? bus_off_series + 1 : 0;
+                uint32_t shift = bus_off_series > 16 ? 16 : bus_off_series;
+                uint64_t backoff = bus_off_series ? uint64_t(recovery_backoff_ms) << (shift - 1) : 0;
+                incident_backoff_ms = uint32_t(backoff < recovery_backoff_max_ms ? backoff : recovery_backoff_max_ms);
+                incident_cycles = 0;
+                recovery_deadline_us = incident_start_us + uint64_t(incident_backoff_ms) * 1000;
+                recovery_state = TWAI_RECOVERY_BACKOFF;
+                break;
+            }
+            case TWAI_RECOVERY_BACKOFF:
+                if (now < recovery_deadline_us) break;
+                if (status.state == TWAI_STATE_BUS_OFF && !initiate_recovery()) break;
+                recovering_since_us = now;
+                recovery_state = TWAI_RECOVERY_RECOVERING;
+                break;
+            case TWAI_RECOVERY_RECOVERING:
+                if (status.state == TWAI_STATE_STOPPED) {
+                    recovery_state = TWAI_RECOVERY_RESTARTING;
+                } else if (status.state == TWAI_STATE_RUNNING) {
+                    finish_incident(now);   // Reiniciado desde fuera
+                } else if (connected_txcvr && recovery_txcvr_cycle_ms &&
+                           now - recovering_since_us >= uint64_t(recovery_txcvr_cycle_ms) * 1000) {
+                    // Sin secuencias recesivas: el transceptor puede estar bloqueado
+                    connected_txcvr->set_standby_mode();
+                    ++incident_cycles;
+                    portENTER_CRITICAL(&recovery_lock);
+                    ++txcvr_cycles;
+                    portEXIT_CRITICAL(&recovery_lock);
+                    recovery_deadline_us = now + TWAI_RECOVERY_STANDBY_MS * 1000;
+                    recovery_state = TWAI_RECOVERY_STANDBY;
+                }
+                break;
+            case TWAI_RECOVERY_STANDBY:
+                if (now < recovery_deadline_us) break;
+                connected_txcvr->set_normal_mode();
+                recovering_since_us = now;
+                recovery_state = TWAI_RECOVERY_RECOVERING;
+                break;
+            case TWAI_RECOVERY_RESTARTING:
+                if (restart_controller()) finish_incident(now);
+                break;
+        }
+    } while (recovery_state != previous && recovery_state != TWAI_RECOVERY_IDLE);
+    return recovery_state;
+}
+
+bool TWAI_Object::restart_controller() {
+    if (virtual_node >= 0) return virtual_bus->start(virtual_node);
+    return driver_start() == ESP_OK;
+}
+
+void TWAI_Object::finish_incident(uint64_t now_us) {
+    recovery_incident_t incident;
+    incident.bus_off_us = incident_start_us;
+    incident.downtime_us = uint32_t(now_us - incident_start_us);
+    incident.backoff_ms = incident_backoff_ms;
+    incident.txcvr_cycles = incident_cycles;
+
+    portENTER_CRITICAL(&recovery_lock);
+    incidents[incident_next] = incident;
+    incident_next = (incident_next + 1) % MAX_RECOVERY_INCIDENTS;
+    if (incident_count < MAX_RECOVERY_INCIDENTS) ++incident_count;
+    ++recoveries;
+    last_downtime_us = incident.downtime_us;
+    if (incident.downtime_us > max_downtime_us) max_downtime_us = incident.downtime_us;
+    total_downtime_us += incident.downtime_us;
+    portEXIT_CRITICAL(&recovery_lock);
+
+    last_recovered_us = now_us;
+    bus_off_stamp.store(0, std::memory_order_relaxed);
+    recovery_state = TWAI_RECOVERY_IDLE;
+
+    // La trama que tenía el controlador se perdió con el bus-off
+    if (tx_scheduler_enabled && !virtual_bus) {
+        on_tx_done(now_us, true);
+        pump_tx();
+    }
+}
+
+TWAI_Object::recovery_stats_t TWAI_Object::get_recovery_stats(bool reset) {
+    recovery_stats_t result;
+    result.error_level = twai_error_level_t(error_level.load(std::memory_order_relaxed));
+    result.state = recovery_state;
+    if (reset) {
+        result.warnings = error_warnings.exchange(0, std::memory_order_relaxed);
+        result.passives = error_passives.exchange(0, std::memory_order_relaxed);
+        result.bus_offs = bus_offs.exchange(0, std::memory_order_relaxed);
+    } else {
+        result.warnings = error_warnings.load(std::memory_order_relaxed);
+        result.passives = error_passives.load(std::memory_order_relaxed);
+        result.bus_offs = bus_offs.load(std::memory_order_relaxed);
+    }
+
+    portENTER_CRITICAL(&recovery_lock);
+    result.recoveries = recoveries;
+    result.txcvr_cycles = txcvr_cycles;
+    result.last_downtime_us = last_downtime_us;
+    result.max_downtime_us = max_downtime_us;
+    result.total_downtime_us = total_downtime_us;
+    if (reset) {
+        recoveries = txcvr_cycles = last_downtime_us = max_downtime_us = 0;
+        total_downtime_us = 0;
+    }
+    portEXIT_CRITICAL(&recovery_lock);
+    return result;
+}
+
+size_t TWAI_Object::get_recovery_incidents(recovery_incident_t* out, size_t max) {
+    if (!out) return 0;
+    portENTER_CRITICAL(&recovery_lock);
+    size_t n = incident_count < max ? incident_count : max;
+    // Las más antiguas primero: empezar n posiciones antes de la siguiente
+    size_t first = (incident_next + MAX_RECOVERY_INCIDENTS - n) % MAX_RECOVERY_INCIDENTS;
+    for (size_t i = 0; i < n; ++i) out[i] = incidents[(first + i) % MAX_RECOVERY_INCIDENTS];
+    portEXIT_CRITICAL(&recovery_lock);
+    return n;
+}
+
+void TWAI_Object::set_txcvr_idle_policy(uint32_t idle_ms, uint32_t diagnostic_ms) {
+    // Al desactivar, no dejar el transceiver dormido
+    if (!idle_ms) wake_txcvr(now_us(), false);
+    txcvr_idle_ms = idle_ms;
+    txcvr_diag_ms = diagnostic_ms;
+    txcvr_last_diag_us = now_us();
+    if (!idle_ms) return;
+    service_required = true;
+    if (driver_installed) start_service();
+}
+
+void TWAI_Object::wake_txcvr(uint64_t now_us, bool for_tx) {
+    // Incluye un despertar anotado por la interrupción y aún sin aplicar
+    bool pending = txcvr_wake_pending.exchange(false, std::memory_order_acq_rel);
+    if (mark_txcvr_awake(now_us, for_tx) || pending) connected_txcvr->set_normal_mode();
+}
+
+void IRAM_ATTR TWAI_Object::request_txcvr_wake(uint64_t now_us) {
+    if (mark_txcvr_awake(now_us, false)) txcvr_wake_pending.store(true, std::memory_order_release);
+}
+
+bool IRAM_ATTR TWAI_Object::mark_txcvr_awake(uint64_t now_us, bool for_tx) {
+    if (!txcvr_asleep.exchange(false, std::memory_order_acq_rel)) return false;
+
+    // El sello lleva |1: descartar una edad "negativa"
+    uint32_t stamp = txcvr_sleep_stamp.exchange(0, std::memory_order_relaxed);
+    uint32_t age = uint32_t(now_us) - stamp;
+    if (stamp && age < 0x80000000u) standby_us_acc.fetch_add(age, std::memory_order_relaxed);
+    if (for_tx) {
+        txcvr_wakes_tx.fetch_add(1, std::memory_order_relaxed);
+        tx_wake_stamp.store(uint32_t(now_us) | 1, std::memory_order_relaxed);
+    } else {
+        txcvr_wakes_rx.fetch_add(1, std::memory_order_relaxed);
+    }
+    return true;
+}
+
+void TWAI_Object::record_wake_latency(uint64_t done_us) {
+    uint32_t stamp = tx_wake_stamp.exchange(0, std::memory_order_relaxed);
+    if (!stamp) return;
+    uint32_t latency = uint32_t(done_us) - stamp;
+    if (latency >= 0x80000000u) latency = 0;
+
+    portENTER_CRITICAL_SAFE(&txcvr_lock);
+    wake_latency_total_us += latency;
+    ++wake_latency_count;
+    if (latency > wake_latency_max_us) wake_latency_max_us = latency;
+    portEXIT_CRITICAL_SAFE(&txcvr_lock);
+}
+
+void TWAI_Object::txcvr_diagnostic_done(bool connected, void* context) {
+    if (!connected) static_cast<TWAI_Object*>(context)->txcvr_diag_failed.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool TWAI_Object::poll_txcvr_idle() {
+    if (!connected_txcvr || !txcvr_idle_ms) return false;
+    uint64_t now = now_us();
+
+    // Despertar anotado por la interrupción: los pines se cambian aquí
+    if (txcvr_wake_pending.exchange(false, std::memory_order_acq_rel)) connected_txcvr->set_normal_mode();
+
+    // Pasar el standby de los despertares al total; en un standby largo
+    // avanzar el sello antes de que sus 32 bits den la vuelta
+    uint64_t standby = standby_us_acc.exchange(0, std::memory_order_relaxed);
+    uint32_t stamp = txcvr_sleep_stamp.load(std::memory_order_relaxed);
+    uint32_t age = uint32_t(now) - stamp;
+    if (stamp && age >= (1u << 30) && age < 0x80000000u &&
+        txcvr_sleep_stamp.compare_exchange_strong(stamp, uint32_t(now) | 1, std::memory_order_relaxed)) {
+        standby += age;
+    }
+    if (standby) {
+        portENTER_CRITICAL_SAFE(&txcvr_lock);
+        standby_total_us += standby;
+        portEXIT_CRITICAL_SAFE(&txcvr_lock);
+    }
+
+    // La recuperación de bus-off gestiona el transceiver por su cuenta
+    if (recovery_state != TWAI_RECOVERY_IDLE) {
+        wake_txcvr(now, false);
+        return false;
+    }
+
+    if (txcvr_asleep.load(std::memory_order_relaxed)) {
+        // En standby el cambio de pines del diagnóstico no molesta al tráfico
+        if (txcvr_diag_ms && now - txcvr_last_diag_us >= uint64_t(txcvr_diag_ms) * 1000 &&
+            connected_txcvr->start_diagnostic(txcvr_diagnostic_done, this)) {
+            txcvr_last_diag_us = now;
+        }
+        return true;
+    }
+
+    uint32_t rx = last_rx_stamp.load(std::memory_order_relaxed);
+    uint32_t tx = last_tx_stamp.load(std::memory_order_relaxed);
+    if (!bus_quiet(txcvr_idle_ms * 1000)) return false;
+
+    // Marcar antes de entrar en standby: una trama posterior ya despierta
+    txcvr_sleep_stamp.store(uint32_t(now) | 1, std::memory_order_relaxed);
+    txcvr_asleep.store(true, std::memory_order_release);
+    connected_txcvr->set_standby_mode();
+    txcvr_sleeps.fetch_add(1, std::memory_order_relaxed);
+
+    // Despertado mientras tanto, o tráfico entre la comprobación y la marca
+    if (!txcvr_asleep.load(std::memory_order_acquire)) {
+        txcvr_wake_pending.store(false, std::memory_order_relaxed);
+        connected_txcvr->set_normal_mode();
+        return false;
+    }
+    if (last_rx_stamp.load(std::memory_order_relaxed) != rx ||
+        last_tx_stamp.load(std::memory_order_relaxed) != tx) {
+        wake_txcvr(now_us(), false);
+        return false;
+    }
+    return true;
+}
+
+TWAI_Object::txcvr_power_stats_t TWAI_Object::get_txcvr_power_stats(bool reset) {
+    txcvr_power_stats_t result = {};
+    uint64_t now = now_us();
+    result.asleep = txcvr_asleep.load(std::memory_order_relaxed);
+    if (reset) {
+        result.sleeps = txcvr_sleeps.exchange(0, std::memory_order_relaxed);
+        result.wakes_rx = txcvr_wakes_rx.exchange(0, std::memory_order_relaxed);
+        result.wakes_tx = txcvr_wakes_tx.exchange(0, std::memory_order_relaxed);
+        result.diagnostics_failed = txcvr_diag_failed.exchange(0, std::memory_order_relaxed);
+    } else {
+        result.sleeps = txcvr_sleeps.load(std::memory_order_relaxed);
+        result.wakes_rx = txcvr_wakes_rx.load(std::memory_order_relaxed);
+        result.wakes_tx = txcvr_wakes_tx.load(std::memory_order_relaxed);
+        result.diagnostics_failed = txcvr_diag_failed.load(std::memory_order_relaxed);
+    }
+
+    // Standby en curso incluido hasta ahora
+    uint32_t stamp = txcvr_sleep_stamp.load(std::memory_order_relaxed);
+    uint32_t age = uint32_t(now) - stamp;
+    uint64_t pending = standby_us_acc.exchange(0, std::memory_order_relaxed);
+
+    portENTER_CRITICAL_SAFE(&txcvr_lock);
+    standby_total_us += pending;
+    result.standby_us = standby_total_us + (stamp && age < 0x80000000u ? age : 0);
+    result.wake_latency_avg_us = wake_latency_count ? uint32_t(wake_latency_total_us / wake_latency_count) : 0;
+    result.wake_latency_max_us = wake_latency_max_us;
+    if (reset) {
+        standby_total_us = 0;
+        wake_latency_total_us = 0;
+        wake_latency_count = wake_latency_max_us = 0;
+    }
+    portEXIT_CRITICAL_SAFE(&txcvr_lock);
+    // El standby en curso cuenta desde ahora
+    if (reset && stamp) txcvr_sleep_stamp.compare_exchange_strong(stamp, uint32_t(now) | 1, std::memory_order_relaxed);
+    return result;
 }
 
 void TWAI_Object::end() {
+    if (service_handle) {
+        vTaskDelete(service_handle);
+        service_handle = nullptr;
+    }
+    // No dejar el transceiver en standby sin la política que lo despierta
+    wake_txcvr(now_us(), false);
+    if (rx_timer_armed.exchange(false)) {
+        esp_timer_stop(rx_timer);
+    }
     if (event_queue) {
         vQueueDelete(event_queue);
         event_queue = nullptr;
@@ -197,6 +1646,13 @@ void TWAI_Object::end() {
         esp_intr_free(ret_handle);
         ret_handle = nullptr;
     }
-    twai_stop();
-    twai_driver_uninstall();
+    if (driver_installed) {
+        driver_stop();
+        driver_uninstall();
+        driver_installed = false;
+    }
+    if (virtual_node >= 0) {
+        virtual_bus->remove_node(virtual_node);
+        virtual_node = -1;
+    }
 }
@@ -2,14 +2,97 @@
 #include <driver/twai.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/queue.h>
-#include <vector>
+#include <freertos/task.h>
+#include <esp_idf_version.h>
+#include <esp_timer.h>
+#include <soc/soc_caps.h>
+#include <atomic>
+#include "TWAI_BusLoad.h"
+#include "TWAI_Dispatch.h"
+#include "TWAI_DoubleBuffer.h"
+#include "TWAI_EventRing.h"
+#include "TWAI_FilterEngine.h"
+#include "TWAI_HwFilter.h"
+#include "TWAI_IdHistogram.h"
+#include "TWAI_Mailbox.h"
+#include "TWAI_Stats.h"
+#include "TWAI_TimerWheel.h"
+#include "TWAI_TxQueue.h"
 #include "TWAI_Txcvr.h"
+#include "TWAI_VirtualBus.h"
 
 #ifndef MAX_EVENT_QUEUE_ITEMS
 /**Maximun number of items in event queue*/
 #define MAX_EVENT_QUEUE_ITEMS (8)
 #endif  // MAX_EVENT_QUEUE_ITEMS
 
+#ifndef MAX_USER_FILTERS
+/**Maximum number of logical filters of a TWAI_Object*/
+#define MAX_USER_FILTERS (32)
+#endif  // MAX_USER_FILTERS
+
+#ifndef MAX_MAILBOXES
+/**Maximum number of latest-value mailboxes*/
+#define MAX_MAILBOXES (16)
+#endif  // MAX_MAILBOXES
+
+#ifndef TWAI_SERVICE_PERIOD_MS
+/**Maximum time the service task waits for driver alerts*/
+#define TWAI_SERVICE_PERIOD_MS (10)
+#endif  // TWAI_SERVICE_PERIOD_MS
+
+#ifndef TWAI_SERVICE_STACK_SIZE
+/**Stack size of the service task*/
+#define TWAI_SERVICE_STACK_SIZE (3072)
+#endif  // TWAI_SERVICE_STACK_SIZE
+
+#ifndef TWAI_EVENT_RING_SIZE
+/**Capacity of the lock-free event ring (must be a power of two)*/
+#define TWAI_EVENT_RING_SIZE (64)
+#endif  // TWAI_EVENT_RING_SIZE
+
+#ifndef TWAI_MULTI_CONTROLLER
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 2, 0)
+/**Use the handle based driver API (one driver instance per controller)*/
+#define TWAI_MULTI_CONTROLLER (1)
+#else
+#define TWAI_MULTI_CONTROLLER (0)
+#endif
+#endif  // TWAI_MULTI_CONTROLLER
+
+#ifndef MAX_RX_PRIORITY_IDS
+/**Maximum number of IDs that bypass RX wake moderation*/
+#define MAX_RX_PRIORITY_IDS (8)
+#endif  // MAX_RX_PRIORITY_IDS
+
+#ifndef MAX_RECOVERY_INCIDENTS
+/**Bus-off incidents kept by the recovery manager*/
+#define MAX_RECOVERY_INCIDENTS (8)
+#endif  // MAX_RECOVERY_INCIDENTS
+
+#ifndef TWAI_RECOVERY_STANDBY_MS
+/**Time the linked transceiver stays in standby when recovery cycles it*/
+#define TWAI_RECOVERY_STANDBY_MS (5)
+#endif  // TWAI_RECOVERY_STANDBY_MS
+
+#ifndef TWAI_COROUTINES
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+/**Build the C++20 coroutine API (TWAI_Coro.h)*/
+#define TWAI_COROUTINES (1)
+#endif
+#endif
+#ifndef TWAI_COROUTINES
+#define TWAI_COROUTINES (0)
+#endif
+#endif  // TWAI_COROUTINES
+
+class TWAI_CoExecutor;
+class TWAI_CoReceive;
+class TWAI_CoSend;
+class TWAI_Gateway;
+class TWAI_Trace;
+
 /**
  * @class TWAI_Object
  * @brief Main CAN controller interface for ESP32 TWAI peripheral
@@ -18,10 +101,15 @@
  * - Hardware filter management
  * - Interrupt-driven operation
  * - Transceiver integration
+ *
+ * Each instance owns its controller: driver handle, interrupt, filters,
+ * queues, locks and statistics, so chips with several TWAI controllers
+ * run one independent instance per controller (begin() with
+ * controller_num). With ESP-IDF older than 5.2 only controller 0 exists.
  */
 class TWAI_Object {
 public:
-    // Default global instance (for compatibility)
+    // Default global instance (for compatibility); other controllers need their own instance
     static TWAI_Object twai;
 
     // Types
@@ -36,14 +124,45 @@ public:
         bool is_error;           ///< Flag indicating error event (true) or data message (false)
     } can_event_t;
 
+    /**
+     * @struct can_event_packed_t
+     * @brief Compact event record with microsecond timestamp (24 bytes)
+     *
+     * @details Used by the event ring and, with TWAI_PACKED_EVENT_QUEUE, by
+     * the event queue. The timestamp comes from esp_timer, so events of
+     * different controllers can be ordered exactly. Convert with
+     * pack_event()/unpack_event()/to_message().
+     */
+    typedef struct {
+        uint64_t timestamp_us;   ///< esp_timer time when the frame was read (us)
+        uint32_t identifier;     ///< 11 or 29 bit identifier
+        uint32_t flags_dlc;      ///< DLC [3:0], PACKED_* flags, controller [11:8]
+        uint8_t data[8];         ///< Frame payload
+    } can_event_packed_t;
+
+    static constexpr uint32_t PACKED_DLC_MASK     = 0x0F;   ///< flags_dlc: data length code
+    static constexpr uint32_t PACKED_EXTD         = 1 << 4; ///< flags_dlc: 29-bit identifier
+    static constexpr uint32_t PACKED_RTR          = 1 << 5; ///< flags_dlc: remote frame
+    static constexpr uint32_t PACKED_ERROR        = 1 << 6; ///< flags_dlc: error event
+    static constexpr uint32_t PACKED_DLC_NON_COMP = 1 << 7; ///< flags_dlc: DLC above 8
+    static constexpr uint32_t PACKED_CTRL_SHIFT   = 8;      ///< flags_dlc: controller index position
+    static constexpr uint32_t PACKED_TX           = 1 << 12;///< flags_dlc: frame sent by this controller (traces)
+
+#ifdef TWAI_PACKED_EVENT_QUEUE
+    typedef can_event_packed_t queue_event_t;   ///< Item type of get_event_queue()
+#else
+    typedef can_event_t queue_event_t;          ///< Item type of get_event_queue()
+#endif
+
     /**
      * @enum twai_filter_type_t
      * @brief Filter operation modes
      */
     typedef enum {
-        TWAI_FILTER_TYPE_MASK,    ///< Bitmask filter (acceptance_code & acceptance_mask)
-        TWAI_FILTER_TYPE_LIST,    ///< Per list filter
-        TWAI_FILTER_TYPE_RANGE    ///< ID range filter (min <= ID <= max)
+        TWAI_FILTER_TYPE_MASK,      ///< Bitmask filter, acceptance mask semantics (mask bit 1 = don't care)
+        TWAI_FILTER_TYPE_LIST,      ///< Per list filter (exact match on id)
+        TWAI_FILTER_TYPE_RANGE,     ///< ID range filter (min <= ID <= max)
+        TWAI_FILTER_TYPE_CARE_MASK  ///< Bitmask filter, inverted mask (mask bit 1 = must match id)
     } twai_filter_type_t;
     
     /**
@@ -52,11 +171,204 @@ public:
      */
     typedef struct {
         uint32_t id;            ///< Filter base ID or minimum range value
-        uint32_t mask_or_end_id;///< Mask bits or maximum range value
+        uint32_t mask_or_end_id;///< Mask bits (see twai_filter_type_t) or maximum range value
         twai_filter_type_t type;///< Filter operation mode
         bool is_extended;       ///< True for extended (29-bit) IDs
     } twai_user_filter_t;
 
+    /**
+     * @brief Bits of the ID a MASK or CARE_MASK filter compares
+     * @details MASK filters use the hardware acceptance mask convention
+     * (1 = don't care) and are inverted here; CARE_MASK filters are
+     * returned as is. Limited to 11 or 29 bits.
+     */
+    static uint32_t care_bits(const twai_user_filter_t& filter) {
+        uint32_t width = filter.is_extended ? 0x1FFFFFFF : 0x7FF;
+        return (filter.type == TWAI_FILTER_TYPE_CARE_MASK ? filter.mask_or_end_id : ~filter.mask_or_end_id) & width;
+    }
+
+    /**
+     * @enum twai_overflow_policy_t
+     * @brief Behaviour of the RX path when the event queue/ring is full
+     */
+    typedef enum {
+        TWAI_OVERFLOW_DROP_NEWEST,      ///< Discard the incoming event
+        TWAI_OVERFLOW_DROP_OLDEST,      ///< Discard the oldest queued event
+        TWAI_OVERFLOW_RESERVE_ERRORS    ///< Keep the last slot for error events
+    } twai_overflow_policy_t;
+
+    /**
+     * @struct drop_stats_t
+     * @brief Frames lost at each stage of the RX path
+     */
+    typedef struct {
+        uint32_t hw_overrun;        ///< Hardware RX FIFO overruns (driver count)
+        uint32_t hw_missed;         ///< Frames lost by the driver RX queue (driver count)
+        uint32_t filtered;          ///< Frames rejected by the software filters
+        uint32_t queue_full;        ///< Data frames dropped or evicted at the event queue/ring
+        uint32_t errors_dropped;    ///< Error events that could not be queued
+        uint32_t subscriber_full;   ///< Frames dropped at full subscriber queues
+    } drop_stats_t;
+
+    /**
+     * @struct stats_t
+     * @brief Runtime statistics snapshot
+     */
+    typedef struct {
+        TWAI_Stats::snapshot_t counters;    ///< Traffic, queue, ISR time and latency counters
+        uint32_t tx_error_counter;          ///< Current transmit error counter
+        uint32_t rx_error_counter;          ///< Current receive error counter
+        uint32_t bus_errors;                ///< Bus errors since last reset
+        uint32_t arb_lost;                  ///< Arbitration losses since last reset
+        uint32_t tx_failed;                 ///< Failed transmissions since last reset
+    } stats_t;
+
+    /**
+     * @struct periodic_stats_t
+     * @brief Timing report of one periodic message
+     */
+    typedef struct {
+        uint32_t sent;              ///< Transmissions handed to send()
+        uint32_t send_failures;     ///< send() rejections (queue full, bus stopped)
+        uint32_t overruns;          ///< Whole periods skipped because the service ran late
+        uint32_t jitter_avg_us;     ///< Average release delay after the due time (us)
+        uint32_t jitter_max_us;     ///< Largest release delay after the due time (us)
+    } periodic_stats_t;
+
+    /** Let schedule_periodic() choose the phase */
+    static constexpr int32_t AUTO_PHASE = -1;
+
+    /**
+     * @brief Subscription callback
+     * @param event Received event
+     * @param context User context given to subscribe()
+     * @warning Runs in ISR context: keep it short and ISR-safe
+     */
+    typedef void (*event_handler_t)(const can_event_t& event, void* context);
+
+    /**
+     * @struct tx_options_t
+     * @brief Per-frame transmit options
+     */
+    typedef struct {
+        uint32_t deadline_us;   ///< Drop the frame if it has not reached the controller within this time (0 = none)
+        uint32_t tag;           ///< User value reported with the completion
+        bool single_shot;       ///< One attempt: no retransmission after an error or lost arbitration
+    } tx_options_t;
+
+    /**
+     * @struct tx_completion_t
+     * @brief End of one scheduled transmission
+     */
+    typedef struct {
+        twai_message_t message;     ///< Frame
+        twai_tx_result_t result;    ///< Outcome
+        uint32_t tag;               ///< tx_options_t::tag (0 for send() without options)
+        uint64_t enqueue_us;        ///< send() time (us)
+        uint64_t done_us;           ///< Completion time (us), taken in the TX interrupt when possible
+    } tx_completion_t;
+
+    /**
+     * @brief Transmit completion callback
+     * @param completion Frame and outcome
+     * @param context User context given to set_tx_complete_handler()
+     * @note Runs in the service task (virtual bus: in run_until())
+     */
+    typedef void (*tx_complete_handler_t)(const tx_completion_t& completion, void* context);
+
+    /**
+     * @struct filter_stats_t
+     * @brief Hardware filter selectivity report
+     */
+    typedef struct {
+        uint32_t acceptance_code;   ///< Programmed acceptance code
+        uint32_t acceptance_mask;   ///< Programmed acceptance mask (1 = don't care)
+        bool single_filter;         ///< Single (true) or dual (false) filter mode
+        uint64_t accepted_ids;      ///< IDs accepted by the software filters
+        uint64_t passed_ids;        ///< IDs passed by the hardware filter
+        uint64_t false_positive_ids;///< IDs passed by hardware but rejected in software
+        float false_positive_rate;  ///< false_positive_ids / passed_ids
+        uint32_t reprogram_count;   ///< Driver reinstalls caused by filter changes
+        uint32_t reprogram_skipped; ///< Filter changes applied without reinstalling the driver
+    } filter_stats_t;
+
+    /**
+     * @struct filter_tune_report_t
+     * @brief Adaptive hardware filter results
+     */
+    typedef struct {
+        uint32_t retunes;           ///< Hardware filter changes made by the tuner
+        uint32_t irq_rate_before;   ///< Interrupts per second in the period before the last retune
+        uint32_t irq_rate_after;    ///< Interrupts per second in the period after it (0 until measured)
+        uint8_t expected_gain;      ///< Share of observed unwanted frames the last retune blocks (%)
+    } filter_tune_report_t;
+
+    /**
+     * @enum twai_error_level_t
+     * @brief Fault confinement level of the controller
+     */
+    typedef enum {
+        TWAI_ERROR_ACTIVE,      ///< TEC and REC below the warning limit
+        TWAI_ERROR_WARNING,     ///< TEC or REC at 96 or above
+        TWAI_ERROR_PASSIVE,     ///< TEC or REC at 128 or above
+        TWAI_ERROR_BUS_OFF      ///< Bus-off (or recovering from it)
+    } twai_error_level_t;
+
+    /**
+     * @enum twai_recovery_state_t
+     * @brief State of the automatic bus-off recovery
+     */
+    typedef enum {
+        TWAI_RECOVERY_IDLE,         ///< Bus on, nothing to do
+        TWAI_RECOVERY_BACKOFF,      ///< Bus-off, waiting before starting recovery
+        TWAI_RECOVERY_RECOVERING,   ///< Waiting for 128 recessive sequences
+        TWAI_RECOVERY_STANDBY,      ///< Transceiver cycled through standby
+        TWAI_RECOVERY_RESTARTING    ///< Recovered, controller being restarted
+    } twai_recovery_state_t;
+
+    /**
+     * @struct recovery_incident_t
+     * @brief One bus-off and its recovery
+     */
+    typedef struct {
+        uint64_t bus_off_us;    ///< Time the controller went bus-off
+        uint32_t downtime_us;   ///< Bus-off to restart
+        uint32_t backoff_ms;    ///< Delay applied before recovery
+        uint8_t txcvr_cycles;   ///< Transceiver standby cycles needed
+    } recovery_incident_t;
+
+    /**
+     * @struct recovery_stats_t
+     * @brief Error state transitions and recovery counters
+     */
+    typedef struct {
+        twai_error_level_t error_level;     ///< Current level
+        twai_recovery_state_t state;        ///< Current recovery state
+        uint32_t warnings;                  ///< Entries into error warning
+        uint32_t passives;                  ///< Entries into error passive
+        uint32_t bus_offs;                  ///< Entries into bus-off
+        uint32_t recoveries;                ///< Completed automatic recoveries
+        uint32_t txcvr_cycles;              ///< Transceiver standby cycles
+        uint32_t last_downtime_us;          ///< Downtime of the last incident
+        uint32_t max_downtime_us;           ///< Longest downtime
+        uint64_t total_downtime_us;         ///< Sum of all downtimes
+    } recovery_stats_t;
+
+    /**
+     * @struct txcvr_power_stats_t
+     * @brief Transceiver idle policy counters
+     */
+    typedef struct {
+        uint32_t sleeps;                    ///< Entries into standby
+        uint32_t wakes_rx;                  ///< Wakes caused by a received frame
+        uint32_t wakes_tx;                  ///< Wakes caused by a frame to send
+        uint32_t wake_latency_avg_us;       ///< Average wake to end of the first frame sent
+        uint32_t wake_latency_max_us;       ///< Longest wake to end of the first frame sent
+        uint64_t standby_us;                ///< Time spent in standby
+        uint32_t diagnostics_failed;        ///< Periodic diagnostics that found no transceiver
+        bool asleep;                        ///< Transceiver in standby now
+    } txcvr_power_stats_t;
+
     // Constructor/destructor
     TWAI_Object();
     ~TWAI_Object();
@@ -67,11 +379,13 @@ public:
      * @param rx_pin GPIO number for RX 
      * @param baud_rate CAN bus speed in bps
      * @param mode Operation mode (Normal/ListenOnly/NoAck)
-     * @param controller_num ID of controller (for future ESP32 CAN implementations)
+     * @param controller_num Controller index (0..SOC_TWAI_CONTROLLER_NUM - 1)
      * @return true if initialization succeeded
      * 
      * @throws std::runtime_error if pin configuration is invalid
      * @note Automatically enters reset then operation mode
+     * @note The RX interrupt is allocated on the calling core: call begin()
+     * of each controller from a task pinned to the core that should serve it
      */
     bool begin(
         gpio_num_t tx_pin = GPIO_NUM_21,
@@ -93,13 +407,111 @@ public:
      * @note Actual transmission is handled asynchronously
      */
     bool send(const twai_message_t& msg, TickType_t timeout = pdMS_TO_TICKS(100));
+
+    /**
+     * @brief Send CAN message with a deadline, tag or single-shot attempt
+     * @param msg Message to transmit
+     * @param options Per-frame options
+     * @param timeout Maximum wait time in ticks
+     * @return true if message was queued for transmission
+     *
+     * @details Single-shot works on every path. Deadlines and completions
+     * need the transmit scheduler (or a virtual bus): a frame still pending
+     * when its deadline passes is dropped and reported as TWAI_TX_EXPIRED.
+     * A frame already handed to the controller is not aborted; make it
+     * single-shot if a late retransmission is useless.
+     */
+    bool send(const twai_message_t& msg, const tx_options_t& options, TickType_t timeout = pdMS_TO_TICKS(100));
+
+    /**
+     * @brief Queue several CAN messages at once
+     * @param msgs Messages to transmit
+     * @param count Number of messages
+     * @return Number of messages queued (stops at the first that does not fit)
+     *
+     * @details With the transmit scheduler the whole batch is inserted with a
+     * single lock acquisition; otherwise each message is queued without waiting.
+     */
+    size_t send_batch(const twai_message_t* msgs, size_t count);
+
+    /**
+     * @brief Enable the priority-ordered transmit scheduler
+     * @param enable True to order pending frames by arbitration priority
+     *
+     * @details Pending frames are kept in a heap (MAX_TX_PENDING) and handed
+     * to the controller one at a time as transmissions complete, so a high
+     * priority frame never waits behind queued low priority ones.
+     * @pre Must be called before begin()
+     */
+    void enable_tx_scheduler(bool enable);
+
+    /**
+     * @brief Report the end of every scheduled transmission
+     * @param handler Completion callback (nullptr to disable)
+     * @param context User pointer passed to @p handler
+     *
+     * @details Each frame sent through the transmit scheduler is reported
+     * once: sent, failed (single-shot, bus-off) or expired. The completion
+     * time is the TX interrupt that found the frame retired by the driver,
+     * or the driver alert if the interrupt ran first.
+     * @pre Must be called before begin()
+     */
+    void set_tx_complete_handler(tx_complete_handler_t handler, void* context = nullptr);
+
+    /**
+     * @brief Transmit a message periodically from the service task
+     * @param msg Message to send
+     * @param period_ms Period in milliseconds
+     * @param phase_ms Offset within the period, or AUTO_PHASE to pick the
+     * offset that collides with the fewest already scheduled messages
+     * @return Periodic message handle, or -1 if no slot is available
+     *
+     * @details All periodic messages share one hierarchical timer wheel
+     * served by the library service task, so no task or timer is needed
+     * per message.
+     */
+    int schedule_periodic(const twai_message_t& msg, uint32_t period_ms, int32_t phase_ms = AUTO_PHASE);
+
+    /**
+     * @brief Replace the payload of a periodic message in place
+     * @param handle Handle returned by schedule_periodic()
+     * @param data New payload
+     * @param length Payload length (DLC)
+     * @return False if the handle is invalid
+     * @note The schedule is not changed
+     */
+    bool update_periodic(int handle, const uint8_t* data, uint8_t length);
+
+    /**
+     * @brief Stop a periodic message
+     * @param handle Handle returned by schedule_periodic()
+     * @return True if the message was scheduled
+     */
+    bool cancel_periodic(int handle);
+
+    /**
+     * @brief Get jitter and overrun statistics of a periodic message
+     * @param handle Handle returned by schedule_periodic()
+     * @param stats Destination
+     * @return False if the handle is invalid
+     */
+    bool get_periodic_stats(int handle, periodic_stats_t& stats);
+
+    /**
+     * @brief Configure the library service task
+     * @param priority FreeRTOS priority
+     * @param core Core to pin the task to (tskNO_AFFINITY for any)
+     * @pre Must be called before begin()
+     */
+    void set_service_task(UBaseType_t priority, BaseType_t core = tskNO_AFFINITY);
     
     // Filters
 
     /**
      * @brief Configure basic filter mode
      * @param acceptance_code Filter pattern value
-     * @param acceptance_mask Bitmask for pattern matching
+     * @param acceptance_mask Bitmask for pattern matching (1 = don't care,
+     * as in the TWAI acceptance mask register)
      * @param is_extended True for extended ID filtering
      * @return True if configuration succeeded
      */
@@ -110,7 +522,8 @@ public:
     /**
      * @brief Add single filter to active set
      * @param filter Filter configuration to add
-     * @return True if filter was added successfully
+     * @return True if filter was added successfully (false if the filter
+     * table is full: MAX_USER_FILTERS, or the TWAI_StaticObject capacity)
      */
     bool add_filter(const twai_user_filter_t& filter);
 
@@ -128,13 +541,67 @@ public:
      */
     bool clear_filters();
 
+    /**
+     * @brief Start a filter transaction
+     * @details Filter changes made until commit_filters() are applied with
+     * a single hardware reprogram. Transactions may be nested.
+     */
+    void begin_filter_update();
+
+    /**
+     * @brief Apply all filter changes since begin_filter_update()
+     * @return True if filters were applied (or nothing changed)
+     */
+    bool commit_filters();
+
+    /**
+     * @brief Get hardware filter selectivity
+     * @return Programmed code/mask and false-positive estimate
+     */
+    filter_stats_t get_filter_stats();
+
+    /**
+     * @brief Adapt the hardware filter to the observed traffic
+     * @param period_ms Time between tuning decisions (0 = disable)
+     * @param min_gain_percent Smallest cut in observed unwanted frames worth a reprogram
+     * @param quiet_us RX and TX silence required before reprogramming
+     *
+     * @details The RX interrupt counts, per ID, the frames that passed the
+     * hardware filter but were rejected in software. Every period the
+     * service task re-synthesizes the hardware filter (single code/mask or
+     * dual split) ranking candidates by those counts; every accepted ID
+     * still passes, so the software filters see no change. The new filter
+     * is programmed only if it blocks enough of the observed unwanted
+     * traffic, at a moment with no frame received for @p quiet_us and
+     * nothing waiting to be sent; frames already in the driver are
+     * delivered before the reinstall. Counts halve every period so the
+     * filter follows traffic changes.
+     * @pre Must be called before begin()
+     */
+    void enable_filter_tuning(uint32_t period_ms, uint8_t min_gain_percent = 25, uint32_t quiet_us = 2000);
+
+    /**
+     * @brief Run one filter tuning step now
+     * @return True if the hardware filter was reprogrammed
+     * @details Called by the service task once a period; call it directly
+     * when running on a virtual bus
+     */
+    bool tune_filters();
+
+    /**
+     * @brief Interrupt rates around the last retune
+     */
+    filter_tune_report_t get_filter_tune_report() const;
+
     // Events
 
     /**
      * @brief Get event queue handle
      * @return FreeRTOS queue handle for CAN events
      * 
-     * @details Queue contains:
+     * @details Queue items are queue_event_t (can_event_t, or
+     * can_event_packed_t when TWAI_PACKED_EVENT_QUEUE is defined; the Event
+     * parameter of a TWAI_StaticObject) and contain:
      * - Received messages (is_error = false)
      * - Error events (is_error = true)
      */
@@ -146,6 +613,242 @@ public:
      */
     void enable_error_events(bool enable);
 
+    /**
+     * @brief Select what happens when the event queue/ring is full
+     * @param policy Overflow policy (default TWAI_OVERFLOW_DROP_NEWEST)
+     */
+    void set_overflow_policy(twai_overflow_policy_t policy);
+
+    /**
+     * @brief Get RX drop counters
+     * @param reset True to clear the software counters after reading
+     * @return Drop counts per stage
+     */
+    drop_stats_t get_drop_stats(bool reset = false);
+
+    /**
+     * @brief Route events to the lock-free ring instead of the event queue
+     * @param enable True to deliver events through receive_batch()
+     *
+     * @details The ring holds TWAI_EVENT_RING_SIZE events and has a single
+     * consumer: only one task may call receive_batch().
+     */
+    void enable_event_ring(bool enable);
+
+    /**
+     * @brief Drain several events from the lock-free ring
+     * @param out Destination array
+     * @param max Capacity of @p out
+     * @param timeout Maximum wait time in ticks if the ring is empty
+     * @return Number of events copied into @p out (0 on timeout)
+     *
+     * @pre enable_event_ring(true)
+     * @note Single consumer only
+     */
+    size_t receive_batch(can_event_t* out, size_t max, TickType_t timeout = portMAX_DELAY);
+
+    /**
+     * @brief Drain several compact events from the lock-free ring
+     * @param out Destination array
+     * @param max Capacity of @p out
+     * @param timeout Maximum wait time in ticks if the ring is empty
+     * @return Number of events copied into @p out (0 on timeout)
+     *
+     * @details Same as receive_batch(can_event_t*, ...) without conversion
+     */
+    size_t receive_batch(can_event_packed_t* out, size_t max, TickType_t timeout = portMAX_DELAY);
+
+    /**
+     * @brief Coalesce wake-ups of the receive_batch() consumer
+     * @param frames Wake when this many events are pending (0 or 1 = on every interrupt)
+     * @param timeout_us Longest time an event waits for the wake-up
+     * @return False if @p frames exceeds the ring or the timer cannot be created
+     *
+     * @details The consumer blocked in receive_batch() is notified once
+     * @p frames events are pending or @p timeout_us after the first of them
+     * arrived, whichever comes first, instead of after every interrupt. The
+     * timeout is an esp_timer one-shot armed from the RX interrupt. Frames
+     * of IDs added with add_rx_priority_id() wake the consumer at once.
+     * Wake-ups are counted in stats_t::counters.rx_wakes.
+     * @note Applies to the event ring only; event queue readers are woken
+     * by the queue itself
+     */
+    bool set_rx_moderation(uint16_t frames, uint32_t timeout_us);
+
+    /**
+     * @brief Wake the receive_batch() consumer immediately for an ID
+     * @param id Frame identifier
+     * @param is_extended True for 29-bit ID
+     * @return False if MAX_RX_PRIORITY_IDS are already registered
+     */
+    bool add_rx_priority_id(uint32_t id, bool is_extended = false);
+
+    /** @brief Remove all IDs registered with add_rx_priority_id() */
+    void clear_rx_priority_ids();
+
+    /**
+     * @brief Feed a frame into the RX path as if it had been received
+     * @param msg Frame
+     *
+     * @details Runs the software filters, subscriptions and event
+     * queue/ring exactly like the RX interrupt, with the current time as
+     * timestamp. Used by trace replay and for tests without a bus.
+     * receive_frame() runs under the RX lock, so it never overlaps the RX
+     * interrupt and the single-producer event ring, mailboxes and
+     * histograms keep one producer. Subscriber callbacks then run inside
+     * that critical section; the consumer wake-up runs after it.
+     * @note Task context
+     */
+    void inject_frame(const twai_message_t& msg);
+
+    /**
+     * @brief Record RX and TX traffic into a trace
+     * @param trace Recorder, or nullptr to stop recording
+     * @note The caller keeps flushing the trace (TWAI_Trace::flush())
+     */
+    void attach_trace(TWAI_Trace* trace);
+
+    // Event conversion
+
+    /**
+     * @brief Build a compact event record
+     * @param event Source event
+     * @param timestamp_us Microsecond timestamp
+     * @param controller Controller index stored in flags_dlc
+     */
+    static can_event_packed_t pack_event(const can_event_t& event, uint64_t timestamp_us, uint8_t controller = 0);
+
+    /**
+     * @brief Expand a compact event record
+     * @param packed Source record
+     * @return Event whose timestamp is derived from timestamp_us in ticks
+     */
+    static can_event_t unpack_event(const can_event_packed_t& packed);
+
+    /**
+     * @brief Extract the CAN frame of a compact event record
+     * @param packed Source record
+     */
+    static twai_message_t to_message(const can_event_packed_t& packed);
+
+    // Subscriptions
+
+    /**
+     * @brief Route frames with the given IDs to a callback
+     * @param ids ID set (MASK, CARE_MASK, LIST = single ID, or RANGE)
+     * @param handler Callback invoked from the RX interrupt
+     * @param context User pointer passed to @p handler
+     * @return Subscription handle, or -1 if the routing tables are full
+     *
+     * @details Frames matching at least one subscription are delivered to
+     * every matching subscriber and not to the event queue/ring. Frames
+     * rejected by the acceptance filters never reach subscribers.
+     */
+    int subscribe(const twai_user_filter_t& ids, event_handler_t handler, void* context = nullptr);
+
+    /**
+     * @brief Route frames with the given IDs to a FreeRTOS queue
+     * @param ids ID set (MASK, CARE_MASK, LIST = single ID, or RANGE)
+     * @param queue Queue of can_event_t items owned by the caller
+     * @return Subscription handle, or -1 if the routing tables are full
+     */
+    int subscribe(const twai_user_filter_t& ids, QueueHandle_t queue);
+
+    /**
+     * @brief Route frames with the given IDs to a gateway
+     * @param ids ID set (MASK, CARE_MASK, LIST = single ID, or RANGE)
+     * @param gateway Gateway receiving the frames from the RX interrupt
+     * @param route Route slot passed back to TWAI_Gateway::on_frame()
+     * @return Subscription handle, or -1 if the routing tables are full
+     * @note Used by TWAI_Gateway::add_route()
+     */
+    int subscribe_gateway(const twai_user_filter_t& ids, TWAI_Gateway* gateway, void* route);
+
+    /**
+     * @brief Remove a subscription
+     * @param handle Handle returned by subscribe()
+     * @return True if the subscription existed
+     */
+    bool unsubscribe(int handle);
+
+#if TWAI_COROUTINES
+    // Coroutines (declared in TWAI_Coro.h)
+
+    /**
+     * @brief Route frames with the given IDs to a coroutine executor
+     * @param ids ID set (MASK, CARE_MASK, LIST = single ID, or RANGE)
+     * @param executor Executor matching the frames against its co_receive() waits
+     * @return Subscription handle, or -1 if the routing tables are full
+     * @note Used by TWAI_CoExecutor::listen()
+     */
+    int subscribe_executor(const twai_user_filter_t& ids, TWAI_CoExecutor* executor);
+
+    /**
+     * @brief Select the executor that runs co_receive() and co_send()
+     * @param executor Executor (nullptr to detach)
+     * @note Called by the TWAI_CoExecutor constructor and destructor
+     */
+    void attach_executor(TWAI_CoExecutor* executor);
+
+    /**
+     * @brief Wait for a frame inside a TWAI_CoTask coroutine
+     * @param ids Frames accepted (MASK, LIST = single ID, or RANGE); they
+     * must also be in an ID set passed to TWAI_CoExecutor::listen()
+     * @param timeout Longest wait in ticks (portMAX_DELAY = no limit)
+     * @return Awaitable giving a TWAI_CoExecutor::rx_result_t
+     *
+     * @details The wait is armed when co_receive() is called, so a response
+     * cannot be missed between a request and its co_await:
+     * @code{.cpp}
+     * TWAI_CoReceive reply = can.co_receive(response_ids, pdMS_TO_TICKS(50));
+     * co_await can.co_send(request);
+     * TWAI_CoExecutor::rx_result_t rx = co_await reply;
+     * @endcode
+     */
+    TWAI_CoReceive co_receive(const twai_user_filter_t& ids, TickType_t timeout = portMAX_DELAY);
+
+    /**
+     * @brief Send a frame and wait for its completion inside a TWAI_CoTask coroutine
+     * @param msg Frame to send (queued when co_send() is called)
+     * @param timeout Deadline of the frame in ticks (portMAX_DELAY = none)
+     * @return Awaitable giving the twai_tx_result_t
+     * @pre The transmit scheduler (or a virtual bus), which reports completions
+     */
+    TWAI_CoSend co_send(const twai_message_t& msg, TickType_t timeout = pdMS_TO_TICKS(100));
+#endif
+
+
+    // Mailboxes
+
+    /**
+     * @brief Keep only the latest frame of an ID in a mailbox slot
+     * @param id Frame identifier
+     * @param is_extended True for 29-bit ID
+     * @return Mailbox handle, or -1 if no slot is available
+     *
+     * @details The RX interrupt overwrites the slot in place, so memory is
+     * bounded by the number of mailboxes and stale duplicates never queue up.
+     * Frames stored in a mailbox are not posted to the event queue/ring.
+     */
+    int add_mailbox(uint32_t id, bool is_extended = false);
+
+    /**
+     * @brief Read the latest frame of a mailbox
+     * @param handle Handle returned by add_mailbox()
+     * @param event Destination for the frame (timestamp included)
+     * @param updates Optional number of frames received since add_mailbox()
+     * @return False if the handle is invalid or no frame was received yet
+     * @note Never blocks the RX interrupt; retries if a write is in progress
+     */
+    bool read_mailbox(int handle, can_event_t& event, uint32_t* updates = nullptr);
+
+    /**
+     * @brief Release a mailbox slot
+     * @param handle Handle returned by add_mailbox()
+     * @return True if the mailbox existed
+     */
+    bool remove_mailbox(int handle);
+
     // Status
 
     /**
@@ -154,6 +857,40 @@ public:
      */
     twai_status_info_t get_status();
 
+    /**
+     * @brief Get runtime statistics
+     * @param reset True to clear counters after reading (for periodic telemetry)
+     * @return Statistics snapshot
+     * @note ISR-to-consumer latency is measured by receive_batch()
+     */
+    stats_t get_stats(bool reset = false);
+
+    /**
+     * @brief Measure bus utilization from every frame received and sent
+     * @param stuffing Actual stuff bits (CRC per frame) or the constant worst case
+     * @details Frames are counted as they reach the RX path (after the
+     * hardware filter, before the software filters) and when a transmission
+     * completes (at acceptance when the TX scheduler is off). Call again to
+     * restart the windows. @see TWAI_BusLoad
+     * @note Takes effect at begin() if called before it
+     */
+    void enable_bus_load(twai_stuffing_t stuffing = TWAI_STUFFING_ACTUAL);
+
+    /**
+     * @brief Bus utilization over the 100 ms, 1 s and 10 s windows
+     * @param reset True to clear the peaks after reading
+     * @return All zero if enable_bus_load() was not called
+     */
+    TWAI_BusLoad::load_t get_bus_load(bool reset = false);
+
+    /**
+     * @brief IDs using the most bus bandwidth, busiest first
+     * @param out Destination
+     * @param max Capacity of @p out
+     * @return Entries written
+     */
+    size_t get_bus_load_ids(TWAI_BusLoad::id_share_t* out, size_t max);
+
     /**
      * @brief Check bus-off state
      * @return True if controller is in bus-off condition
@@ -166,6 +903,48 @@ public:
      */
     bool initiate_recovery();
 
+    /**
+     * @brief Recover from bus-off automatically
+     * @param enable True to run the recovery manager
+     * @param backoff_ms Delay before the second of a series of close bus-offs (doubles for each one after)
+     * @param backoff_max_ms Longest delay; a bus-off less than this after the
+     * previous recovery continues the series, a later one recovers at once
+     * @param txcvr_cycle_ms Time in recovery before the linked transceiver is
+     * cycled through standby (0 = never)
+     *
+     * @details The RX interrupt tracks the error warning, error passive and
+     * bus-off transitions and stamps the bus-off time. The service task
+     * then waits the backoff, calls initiate_recovery(), restarts the
+     * controller once the 128 recessive sequences are seen and records
+     * the downtime of the incident. Scheduled frames wait in the TX queue
+     * meanwhile; the one in the controller is reported as failed.
+     * @note On a virtual bus call poll_recovery() from the loop
+     */
+    void enable_auto_recovery(bool enable, uint32_t backoff_ms = 10, uint32_t backoff_max_ms = 1000,
+                              uint32_t txcvr_cycle_ms = 50);
+
+    /**
+     * @brief Run the recovery state machine once
+     * @return State after the step
+     * @details Called by the service task; call it directly when running on
+     * a virtual bus
+     */
+    twai_recovery_state_t poll_recovery();
+
+    /**
+     * @brief Get error transitions and recovery counters
+     * @param reset True to clear the counters after reading
+     */
+    recovery_stats_t get_recovery_stats(bool reset = false);
+
+    /**
+     * @brief Get the last bus-off incidents
+     * @param out Destination, oldest first
+     * @param max Capacity of @p out
+     * @return Entries written (at most MAX_RECOVERY_INCIDENTS)
+     */
+    size_t get_recovery_incidents(recovery_incident_t* out, size_t max);
+
     // Physical interface
 
     /**
@@ -177,16 +956,236 @@ public:
      */
     bool link_transceiver(TWAI_Txcvr& txcvr);
 
+    /**
+     * @brief Put the linked transceiver in standby while the bus is idle
+     * @param idle_ms Time without frames received or sent before standby (0 = off)
+     * @param diagnostic_ms Period of TWAI_Txcvr::start_diagnostic() while in
+     * standby, where its pin toggling cannot disturb traffic (0 = never)
+     *
+     * @details The transceiver returns to normal mode on the first frame
+     * the controller receives or the first send(); the time from that
+     * wake to the end of the first frame sent is tracked, so idle_ms can
+     * be traded against first-frame latency. The RX interrupt only records
+     * the wake: the service task, which polls every tick while the
+     * transceiver sleeps, drives the pins.
+     * @note A transceiver in standby may drop the frames that end its
+     * sleep: use it where the wake frame can be repeated
+     * @note On a virtual bus call poll_txcvr_idle() from the loop
+     */
+    void set_txcvr_idle_policy(uint32_t idle_ms, uint32_t diagnostic_ms = 0);
+
+    /**
+     * @brief Run the transceiver idle policy once
+     * @return True if the transceiver is in standby after the step
+     * @details Called by the service task; call it directly when running on
+     * a virtual bus
+     */
+    bool poll_txcvr_idle();
+
+    /**
+     * @brief Get the transceiver idle policy counters
+     * @param reset True to clear the counters after reading
+     */
+    txcvr_power_stats_t get_txcvr_power_stats(bool reset = false);
+
+    /**
+     * @brief Use a simulated bus instead of the TWAI peripheral
+     * @param bus Virtual bus (same baud rate as given to begin())
+     * @return False if already started
+     *
+     * @details begin() then joins the bus as a node instead of installing
+     * the driver: send() submits to the bus, received frames run through
+     * the same filter, subscription and event queue/ring path as the RX
+     * interrupt, and status, statistics and recovery come from the
+     * simulated controller. Timestamps and latencies use the virtual clock.
+     * @pre Must be called before begin()
+     * @note Periodic messages and the transmit scheduler are not simulated
+     * (the bus node already orders frames by priority) and no bus-off
+     * error events are posted. The hardware filter is modelled on the
+     * identifier bits: each frame it passes counts as one interrupt
+     */
+    bool attach_virtual_bus(TWAI_VirtualBus& bus);
+
+    /**
+     * @brief Current time of the active backend (esp_timer or virtual clock)
+     * @details Time base of the event timestamps (us)
+     */
+    uint64_t now_us() const;
+
+protected:
+    /**
+     * @struct storage_t
+     * @brief Caller-owned storage replacing the heap allocations
+     */
+    typedef struct {
+        twai_user_filter_t* filters;    ///< Filter table
+        uint8_t filter_capacity;        ///< Entries in filters
+        uint8_t* queue_items;           ///< Event queue item storage (queue_length items)
+        StaticQueue_t* queue;           ///< Event queue control block
+        uint16_t queue_length;          ///< Event queue depth
+        bool packed_events;             ///< Queue items are can_event_packed_t (else can_event_t)
+        StackType_t* service_stack;     ///< Service task stack (nullptr = allocate when needed)
+        uint32_t service_stack_size;    ///< Service task stack size
+        StaticTask_t* service_tcb;      ///< Service task control block
+    } storage_t;
+
+    /**
+     * @brief Build on caller-owned storage (TWAI_StaticObject)
+     * @param storage Buffers that must outlive the object
+     * @note The buffers are only recorded here, so a derived class may pass
+     * its own members before they are constructed
+     */
+    explicit TWAI_Object(const storage_t& storage);
+
 private:
     twai_general_config_t g_config;                 ///< TWAI general configuration (pins, mode)
     twai_timing_config_t t_config;                  ///< Bit timing parameters (baudrate, sampling)
-    twai_filter_config_t f_config;                  ///< Hardware filter settings
+    twai_filter_config_t f_config = TWAI_FILTER_CONFIG_ACCEPT_ALL(); ///< Hardware filter settings
     QueueHandle_t event_queue = nullptr;            ///< FreeRTOS queue for CAN events
+    uint8_t* queue_items = nullptr;                 ///< Static event queue storage (nullptr = xQueueCreate)
+    StaticQueue_t* queue_control = nullptr;         ///< Static event queue control block
+    uint16_t event_queue_length = MAX_EVENT_QUEUE_ITEMS; ///< Event queue depth
+#ifdef TWAI_PACKED_EVENT_QUEUE
+    bool packed_events = true;                      ///< Queue items are can_event_packed_t
+#else
+    bool packed_events = false;                     ///< Queue items are can_event_t
+#endif
+    TWAI_EventRing<can_event_packed_t, TWAI_EVENT_RING_SIZE> event_ring; ///< Lock-free alternative to event_queue
+    bool event_ring_enabled = false;                ///< Deliver events through event_ring
+    std::atomic<TaskHandle_t> rx_waiter{nullptr};   ///< Task blocked in receive_batch()
+    uint16_t rx_moderation_frames = 0;              ///< Pending events that wake the consumer (0 = no moderation)
+    uint32_t rx_moderation_us = 0;                  ///< Longest wait for a wake-up (us)
+    esp_timer_handle_t rx_timer = nullptr;          ///< Bounds the moderated wait
+    std::atomic<bool> rx_timer_armed{false};        ///< rx_timer is running
+    std::atomic<bool> rx_urgent{false};             ///< A priority ID is pending
+    uint32_t rx_priority_ids[MAX_RX_PRIORITY_IDS];  ///< Immediate-wake IDs (bit 31 = extended)
+    std::atomic<uint8_t> rx_priority_count{0};      ///< Valid entries in rx_priority_ids
+    twai_overflow_policy_t overflow_policy = TWAI_OVERFLOW_DROP_NEWEST; ///< Full queue/ring behaviour
+    TWAI_Stats stats;                               ///< Runtime counters
+    TWAI_BusLoad bus_load;                          ///< Bus utilization windows
+    bool bus_load_requested = false;                ///< enable_bus_load() was called
+    twai_stuffing_t bus_load_stuffing = TWAI_STUFFING_ACTUAL; ///< Stuffing mode requested
+    uint32_t bus_baud = 0;                          ///< Bus speed given to begin()
+    twai_status_info_t stats_baseline = {};         ///< Driver counters at last stats reset
+    std::atomic<uint32_t> drops_filtered{0};        ///< Frames rejected by software filters
+    std::atomic<uint32_t> drops_queue_full{0};      ///< Data frames lost at the event queue/ring
+    std::atomic<uint32_t> drops_errors{0};          ///< Error events lost
+    std::atomic<uint32_t> drops_subscriber{0};      ///< Frames lost at subscriber queues
     bool error_events_enabled = false;              ///< Error event reporting flag
     int controller_id = 0;                          ///< Controller index (for multi-CAN chips)
-    std::vector<twai_user_filter_t> active_filters; ///< Active filter configurations
+#if TWAI_MULTI_CONTROLLER
+    twai_handle_t driver_handle = nullptr;          ///< Driver instance of this controller
+#endif
+    twai_user_filter_t* active_filters;             ///< Active filter configurations
+    uint8_t filter_capacity;                        ///< Entries in active_filters
+    uint8_t filter_count = 0;                       ///< Used entries in active_filters
+    bool owns_filters;                              ///< active_filters allocated by the constructor
+    TWAI_DoubleBuffer<TWAI_FilterEngine> filter_engines;   ///< Compiled software filters (published and in rebuild)
+    TWAI_Dispatch dispatch;                         ///< Per-ID subscription routing
+    TWAI_Mailbox<can_event_t> mailboxes[MAX_MAILBOXES]; ///< Latest-value slots
+    int8_t mailbox_subscription[MAX_MAILBOXES];     ///< Dispatch handle per mailbox (-1 = free)
+    TWAI_HwFilter::plan_t hw_filter_plan;           ///< Last synthesized hardware filter
+    uint8_t filter_update_depth = 0;                ///< Open begin_filter_update() calls
+    bool filters_dirty = false;                     ///< Filter changes pending commit
+    bool driver_installed = false;                  ///< TWAI driver currently installed
+    uint32_t filter_reprograms = 0;                 ///< Driver reinstalls due to filter changes
+    uint32_t filter_reprograms_skipped = 0;         ///< Filter changes without reinstall
+    std::atomic<bool> filter_busy{false};           ///< Filters being recompiled or reprogrammed
+    TWAI_IdHistogram rejected_ids;                  ///< IDs passed by hardware but rejected in software
+    uint32_t tune_period_ms = 0;                    ///< Filter tuning period (0 = off)
+    uint8_t tune_min_gain = 25;                     ///< Minimum expected gain to reprogram (%)
+    uint32_t tune_quiet_us = 2000;                  ///< Bus silence required to reprogram
+    uint64_t tune_last_us = 0;                      ///< Time of the last tuning step (0 = not started)
+    uint32_t tune_last_irqs = 0;                    ///< irq_count at the last tuning step
+    bool tune_measuring = false;                    ///< irq_rate_after still to be measured
+    filter_tune_report_t tune_report = {};          ///< Tuning results
+    std::atomic<uint32_t> irq_count{0};             ///< RX path interrupts (virtual bus: frames past the hardware filter)
+    std::atomic<uint32_t> last_rx_stamp{0};         ///< Low 32 bits of the last reception time
     TWAI_Txcvr* connected_txcvr = nullptr;          ///< Linked transceiver instance
-    intr_handle_t ret_handle;                       ///< Handle that wiil be uesd to request details or free the interrupt
+    TWAI_CoExecutor* co_executor = nullptr;         ///< Executor of co_receive() and co_send()
+    bool recovery_enabled = false;                  ///< Automatic bus-off recovery
+    uint32_t recovery_backoff_ms = 10;              ///< First backoff of a bus-off series
+    uint32_t recovery_backoff_max_ms = 1000;        ///< Longest backoff / series window
+    uint32_t recovery_txcvr_cycle_ms = 50;          ///< Recovery time before cycling the transceiver
+    twai_recovery_state_t recovery_state = TWAI_RECOVERY_IDLE; ///< Recovery state machine
+    uint64_t recovery_deadline_us = 0;              ///< End of the backoff or standby
+    uint64_t recovering_since_us = 0;               ///< Start of the current recovery attempt
+    uint64_t incident_start_us = 0;                 ///< Bus-off time of the open incident
+    uint32_t incident_backoff_ms = 0;               ///< Backoff of the open incident
+    uint8_t incident_cycles = 0;                    ///< Transceiver cycles of the open incident
+    uint32_t bus_off_series = 0;                    ///< Close bus-offs in a row (0 = first)
+    uint64_t last_recovered_us = 0;                 ///< End of the previous incident (0 = none)
+    std::atomic<uint8_t> error_level{TWAI_ERROR_ACTIVE}; ///< Last fault confinement level seen
+    std::atomic<uint32_t> bus_off_stamp{0};         ///< Low 32 bits of the bus-off time (0 = none)
+    std::atomic<uint32_t> error_warnings{0};        ///< Entries into error warning
+    std::atomic<uint32_t> error_passives{0};        ///< Entries into error passive
+    std::atomic<uint32_t> bus_offs{0};              ///< Entries into bus-off
+    portMUX_TYPE recovery_lock = portMUX_INITIALIZER_UNLOCKED; ///< Protects the incident log and counters
+    recovery_incident_t incidents[MAX_RECOVERY_INCIDENTS] = {}; ///< Incident log (ring)
+    uint8_t incident_next = 0;                      ///< Next incidents slot
+    uint8_t incident_count = 0;                     ///< Valid incidents
+    uint32_t recoveries = 0;                        ///< Completed recoveries
+    uint32_t txcvr_cycles = 0;                      ///< Transceiver standby cycles
+    uint32_t last_downtime_us = 0;                  ///< Downtime of the last incident
+    uint32_t max_downtime_us = 0;                   ///< Longest downtime
+    uint64_t total_downtime_us = 0;                 ///< Sum of downtimes
+    uint32_t txcvr_idle_ms = 0;                     ///< Bus inactivity before standby (0 = off)
+    uint32_t txcvr_diag_ms = 0;                     ///< Diagnostic period in standby (0 = never)
+    std::atomic<bool> txcvr_asleep{false};          ///< Linked transceiver put in standby by the idle policy
+    std::atomic<bool> txcvr_wake_pending{false};    ///< Woken by a reception, pins still in standby
+    std::atomic<uint32_t> last_tx_stamp{0};         ///< Low 32 bits of the last send time
+    std::atomic<uint32_t> txcvr_sleep_stamp{0};     ///< Low 32 bits of the standby time
+    std::atomic<uint32_t> tx_wake_stamp{0};         ///< Low 32 bits of the last TX wake (0 = none open)
+    std::atomic<uint32_t> standby_us_acc{0};        ///< Standby time not yet added to standby_total_us
+    std::atomic<uint32_t> txcvr_sleeps{0};          ///< Entries into standby
+    std::atomic<uint32_t> txcvr_wakes_rx{0};        ///< Wakes by reception
+    std::atomic<uint32_t> txcvr_wakes_tx{0};        ///< Wakes by transmission
+    std::atomic<uint32_t> txcvr_diag_failed{0};     ///< Failed periodic diagnostics
+    uint64_t standby_total_us = 0;                  ///< Time in standby
+    uint64_t txcvr_last_diag_us = 0;                ///< Start of the last periodic diagnostic
+    portMUX_TYPE txcvr_lock = portMUX_INITIALIZER_UNLOCKED; ///< Protects the wake latency counters
+    uint64_t wake_latency_total_us = 0;             ///< Sum of wake latencies
+    uint32_t wake_latency_count = 0;                ///< Wake latencies measured
+    uint32_t wake_latency_max_us = 0;               ///< Longest wake latency
+    TWAI_VirtualBus* virtual_bus = nullptr;         ///< Simulated bus replacing the peripheral
+    int virtual_node = -1;                          ///< Node index on virtual_bus (-1 = not joined)
+    std::atomic<TWAI_Trace*> trace{nullptr};        ///< Traffic recorder
+    intr_handle_t ret_handle = nullptr;             ///< Handle that wiil be uesd to request details or free the interrupt
+    TWAI_TxQueue tx_pending;                        ///< Frames waiting for the transmit scheduler
+    TWAI_TxQueue::entry_t tx_current;               ///< Frame currently owned by the controller
+    portMUX_TYPE tx_lock = portMUX_INITIALIZER_UNLOCKED; ///< Protects tx_pending and tx_inflight
+    portMUX_TYPE rx_lock = portMUX_INITIALIZER_UNLOCKED; ///< One receive_frame() at a time (interrupt, inject_frame(), driver drain)
+    bool tx_scheduler_enabled = false;              ///< Order transmissions by priority
+    bool tx_inflight = false;                       ///< A scheduled frame is in the controller
+    std::atomic<uint32_t> tx_done_stamp{0};         ///< Low 32 bits of the TX interrupt time of tx_current (0 = none)
+    tx_complete_handler_t tx_complete_handler = nullptr; ///< Completion callback
+    void* tx_complete_context = nullptr;            ///< Completion callback context
+    TaskHandle_t service_handle = nullptr;          ///< Service task (alerts, TX pump, timers)
+    bool service_required = false;                  ///< A feature needs the service task
+    UBaseType_t service_priority = tskIDLE_PRIORITY + 5; ///< Service task priority
+    BaseType_t service_core = tskNO_AFFINITY;       ///< Service task core affinity
+    StackType_t* service_stack = nullptr;           ///< Static service task stack (nullptr = dynamic)
+    uint32_t service_stack_size = TWAI_SERVICE_STACK_SIZE; ///< Service task stack size
+    StaticTask_t* service_tcb = nullptr;            ///< Static service task control block
+
+    /**
+     * @struct periodic_t
+     * @brief Periodic message slot
+     */
+    typedef struct {
+        twai_message_t msg;         ///< Message to send
+        uint32_t period_ms;         ///< Period
+        uint32_t phase_ms;          ///< Due time modulo period
+        uint64_t jitter_total_us;   ///< Sum of release delays
+        periodic_stats_t stats;     ///< Timing report
+        bool active;                ///< Scheduled
+        bool in_wheel;              ///< Linked in timer_wheel
+    } periodic_t;
+
+    periodic_t periodic[MAX_PERIODIC_MSGS] = {};    ///< Periodic message slots
+    TWAI_TimerWheel timer_wheel;                    ///< Due times of periodic messages (1 ms ticks)
+    portMUX_TYPE periodic_lock = portMUX_INITIALIZER_UNLOCKED; ///< Protects periodic and timer_wheel
+    bool timer_wheel_started = false;               ///< timer_wheel time base initialized
 
     /**
      * @brief Apply hardware filter configurations
@@ -195,6 +1194,91 @@ private:
      */
     bool apply_hardware_filters();
 
+    /**
+     * @brief Program a hardware filter, reinstalling the driver if it changed
+     * @param plan Code, mask and mode to program
+     * @return True if the filter is active
+     */
+    bool program_hw_filter(const TWAI_HwFilter::plan_t& plan);
+
+    /**
+     * @brief Deliver the frames still in the driver RX queue
+     * @note Task context, with our interrupt disabled
+     */
+    void drain_driver_rx();
+
+    /**
+     * @brief Follow the fault confinement level (ISR or task)
+     * @param status Controller status
+     * @param now_us Time of the status
+     */
+    void track_error_level(const twai_status_info_t& status, uint64_t now_us);
+
+    /** @brief Close the open bus-off incident */
+    void finish_incident(uint64_t now_us);
+
+    /** @brief Put a recovered (stopped) controller back on the bus */
+    bool restart_controller();
+
+    /**
+     * @brief Return the linked transceiver to normal mode if the idle policy put it in standby
+     * @param now_us Time of the wake
+     * @param for_tx True when a frame to send caused the wake
+     * @note Task context: drives the transceiver pins, also for a wake
+     * left pending by request_txcvr_wake()
+     */
+    void wake_txcvr(uint64_t now_us, bool for_tx);
+
+    /**
+     * @brief Wake for a received frame (RX interrupt, virtual bus reception)
+     * @param now_us Reception time
+     * @details Only updates the flags and counters; the next
+     * poll_txcvr_idle() (service task) drives the pins
+     */
+    void request_txcvr_wake(uint64_t now_us);
+
+    /**
+     * @brief Leave standby in the flags and counters, without touching the pins (ISR safe)
+     * @param now_us Time of the wake
+     * @param for_tx True when a frame to send caused the wake
+     * @return True if the transceiver was asleep
+     */
+    bool mark_txcvr_awake(uint64_t now_us, bool for_tx);
+
+    /** @brief Close an open TX wake with the end of the first frame sent */
+    void record_wake_latency(uint64_t done_us);
+
+    /** @brief Diagnostic completion of the idle policy (timer task) */
+    static void txcvr_diagnostic_done(bool connected, void* context);
+
+    /** @brief True if nothing was received or sent for @p quiet_us and nothing waits to be sent */
+    bool bus_quiet(uint32_t quiet_us);
+
+    /**
+     * @brief Compile active_filters into the inactive engine and publish it
+     * @return True if every filter fit in the compiled tables
+     * @note Internal use - called by apply_hardware_filters()
+     */
+    bool compile_software_filters();
+
+    /**
+     * @name Driver calls
+     * @brief twai_* driver functions bound to this controller
+     * @details Use the _v2 handle API when TWAI_MULTI_CONTROLLER, the single
+     * instance API otherwise
+     * @{
+     */
+    esp_err_t driver_install(const twai_filter_config_t& filter);
+    esp_err_t driver_uninstall();
+    esp_err_t driver_start();
+    esp_err_t driver_stop();
+    esp_err_t driver_transmit(const twai_message_t& msg, TickType_t timeout);
+    esp_err_t driver_receive(twai_message_t* msg, TickType_t timeout);
+    esp_err_t driver_read_alerts(uint32_t* alerts, TickType_t timeout);
+    esp_err_t driver_status(twai_status_info_t* status);
+    esp_err_t driver_recover();
+    /** @} */
+
     /**
      * @brief Interrupt service routine wrapper
      * @param arg Pointer to TWAI_Object instance
@@ -207,4 +1291,166 @@ private:
      * @note Internal use - processes RX/TX interrupts
      */
     void handle_interrupt();
+
+    /**
+     * @brief Run one received frame through filters, subscriptions and the event queue/ring
+     * @param event Frame with timestamp
+     * @param timestamp_us Microsecond timestamp of the frame
+     * @param woken Set to pdTRUE if a higher priority task was woken
+     * @note Internal use - ISR context or virtual bus
+     */
+    void receive_frame(const can_event_t& event, uint64_t timestamp_us, BaseType_t* woken);
+
+    /**
+     * @brief Notify the task blocked in receive_batch() if the ring has events
+     * @param woken Set to pdTRUE if a higher priority task was woken
+     * @details With moderation the notification waits for enough events,
+     * a priority ID or rx_timer
+     */
+    void wake_rx_waiter(BaseType_t* woken);
+
+    /** @brief True if @p id was registered with add_rx_priority_id() */
+    bool is_rx_priority(uint32_t id, bool is_extended) const;
+
+    /**
+     * @brief Moderation timeout: wake the consumer with whatever is pending
+     * @param arg Pointer to TWAI_Object instance
+     */
+    static void rx_timer_callback(void* arg);
+
+    /**
+     * @brief Record a frame accepted for transmission in the trace
+     * @param msg Frame
+     */
+    void trace_tx(const twai_message_t& msg);
+
+    /**
+     * @brief Virtual bus receive callback
+     * @param context Pointer to TWAI_Object instance
+     */
+    static void virtual_rx(const twai_message_t& msg, uint64_t timestamp_us, void* context);
+
+    /**
+     * @brief Virtual bus transmit completion callback
+     * @param context Pointer to TWAI_Object instance
+     */
+    static void virtual_tx(const TWAI_TxQueue::entry_t& entry, twai_tx_result_t result, uint64_t done_us, void* context);
+
+    /**
+     * @brief Start the service task if any feature needs it
+     * @return False if the task could not be created
+     */
+    bool start_service();
+
+    /**
+     * @brief Service task entry point
+     * @param arg Pointer to TWAI_Object instance
+     */
+    static void service_task(void* arg);
+
+    /**
+     * @brief Service task body: waits for driver alerts and runs periodic work
+     */
+    void service_loop();
+
+    /**
+     * @brief Queue a frame on the active transmit path
+     * @param msg Frame
+     * @param deadline_us Absolute drop time (0 = none)
+     * @param tag User value of the completion
+     * @param timeout Maximum wait for room
+     */
+    bool submit(const twai_message_t& msg, uint64_t deadline_us, uint32_t tag, TickType_t timeout);
+
+    /**
+     * @brief Hand the highest priority pending frame to the controller if idle
+     * @details Pending frames past their deadline are dropped first
+     */
+    void pump_tx();
+
+    /**
+     * @brief Drop pending scheduled frames whose deadline has passed
+     * @param now_us Current time
+     */
+    void expire_tx(uint64_t now_us);
+
+    /**
+     * @brief Account for the completion of the in-flight scheduled frame
+     * @param now_us Alert time, used when the TX interrupt left no timestamp
+     * @param failed True on TWAI_ALERT_TX_FAILED
+     */
+    void on_tx_done(uint64_t now_us, bool failed);
+
+    /**
+     * @brief Update TX statistics and call the completion handler
+     * @param entry Finished frame
+     * @param result Outcome
+     * @param done_us Completion time
+     */
+    void complete_tx(const TWAI_TxQueue::entry_t& entry, twai_tx_result_t result, uint64_t done_us);
+
+    /**
+     * @brief Send every periodic message that is due
+     * @note Internal use - service task
+     */
+    void run_periodic();
+
+    /**
+     * @brief Milliseconds until the next periodic message is due
+     * @param limit Maximum value returned
+     */
+    uint32_t periodic_wait_ms(uint32_t limit);
+
+    /**
+     * @brief Phase with the fewest collisions with scheduled messages
+     * @param period_ms Period of the new message
+     */
+    uint32_t pick_phase(uint32_t period_ms);
+
+    /**
+     * @brief Deliver one event to the active RX path applying the overflow policy
+     * @param event Event to deliver
+     * @param timestamp_us Microsecond timestamp of the event
+     * @param woken Set to pdTRUE if a higher priority task was woken
+     * @return True if the event was stored
+     * @note Internal use - ISR context
+     */
+    bool post_event(const can_event_t& event, uint64_t timestamp_us, BaseType_t* woken);
+
+    /**
+     * @brief Feed ISR-to-consumer latency of received events into stats
+     * @param events Events just handed to the consumer
+     * @param count Number of events
+     */
+    void record_latency(const can_event_packed_t* events, size_t count);
+
+    /**
+     * @enum subscriber_kind_t
+     * @brief Delivery target stored in a dispatch slot
+     */
+    enum subscriber_kind_t : uint8_t {
+        SUBSCRIBER_CALLBACK,    ///< target is an event_handler_t
+        SUBSCRIBER_QUEUE,       ///< target is a QueueHandle_t
+        SUBSCRIBER_MAILBOX,     ///< target is a TWAI_Mailbox<can_event_t>
+        SUBSCRIBER_GATEWAY,     ///< target is a TWAI_Gateway, context its route
+        SUBSCRIBER_EXECUTOR     ///< target is a TWAI_CoExecutor
+    };
+
+    /**
+     * @brief Add a dispatch slot for a user filter description
+     * @return Subscription handle or -1
+     */
+    int add_subscription(const twai_user_filter_t& ids, subscriber_kind_t kind, void* target, void* context);
+
+    /**
+     * @brief Deliver an event to every subscriber in @p slots
+     * @param subscribers Reader that returned @p slots (keeps the slots valid)
+     * @param slots Bitmask returned by TWAI_Dispatch::reader_t::lookup()
+     * @param event Event to deliver
+     * @param timestamp_us Microsecond timestamp of the event
+     * @param woken Set to pdTRUE if a higher priority task was woken
+     * @note Internal use - ISR context
+     */
+    void deliver(const TWAI_Dispatch::reader_t& subscribers, uint32_t slots,
+                 const can_event_t& event, uint64_t timestamp_us, BaseType_t* woken);
 };
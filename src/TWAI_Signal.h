@@ -0,0 +1,275 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ratio>
+#include <tuple>
+#include <type_traits>
+#include "TWAI_Object.h"
+
+/**
+ * @enum twai_byte_order_t
+ * @brief Signal byte order (DBC convention)
+ */
+typedef enum {
+    TWAI_BYTE_ORDER_INTEL,      ///< Little endian (DBC @1), start bit is the LSB
+    TWAI_BYTE_ORDER_MOTOROLA    ///< Big endian (DBC @0), start bit is the MSB
+} twai_byte_order_t;
+
+/**
+ * @class TWAI_FrameWord
+ * @brief The 8 payload bytes of a frame as one 64-bit word
+ *
+ * @details Intel signals are contiguous bit fields of the little endian
+ * word and Motorola signals of the big endian word, so one load per byte
+ * order is enough to extract every signal of a frame with shift and mask.
+ */
+class TWAI_FrameWord {
+public:
+    /** @brief Payload as little endian word (byte 0 = bits 7..0) */
+    static uint64_t load_le(const uint8_t* data) {
+        uint64_t word;
+        memcpy(&word, data, sizeof(word));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        word = __builtin_bswap64(word);
+#endif
+        return word;
+    }
+
+    /** @brief Payload as big endian word (byte 0 = bits 63..56) */
+    static uint64_t load_be(const uint8_t* data) { return __builtin_bswap64(load_le(data)); }
+
+    /** @brief Write a little endian word back to the payload */
+    static void store_le(uint8_t* data, uint64_t word) {
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        word = __builtin_bswap64(word);
+#endif
+        memcpy(data, &word, sizeof(word));
+    }
+
+    /** @brief Write a big endian word back to the payload */
+    static void store_be(uint8_t* data, uint64_t word) { store_le(data, __builtin_bswap64(word)); }
+};
+
+/**
+ * @class TWAI_Signal
+ * @brief Compile-time description of one signal
+ *
+ * @details Every parameter is a template argument, so extraction compiles
+ * to a load, a shift, a mask and (if needed) sign extension and one
+ * multiply-add. Physical value = raw * Scale + Offset.
+ *
+ * @tparam StartBit DBC start bit (LSB for Intel, MSB for Motorola)
+ * @tparam Length Bit length (1..64)
+ * @tparam Order Byte order
+ * @tparam Signed Two's complement raw value
+ * @tparam Scale Factor as std::ratio (e.g. std::ratio<1, 10> for 0.1)
+ * @tparam Offset Offset as std::ratio (e.g. std::ratio<-40>)
+ * @tparam T Physical value type
+ *
+ * Example: @code
+ * typedef TWAI_Signal<24, 16, TWAI_BYTE_ORDER_INTEL, false, std::ratio<1, 4>> EngineSpeed;
+ * float rpm = EngineSpeed::decode(event.message.data);
+ * @endcode
+ */
+template <uint8_t StartBit, uint8_t Length,
+          twai_byte_order_t Order = TWAI_BYTE_ORDER_INTEL, bool Signed = false,
+          typename Scale = std::ratio<1>, typename Offset = std::ratio<0>, typename T = float>
+class TWAI_Signal {
+    static_assert(Length >= 1 && Length <= 64, "Signal length must be 1..64 bits");
+    static_assert(StartBit < 64, "Signal start bit must be below 64");
+
+public:
+    typedef T value_type;                           ///< Physical value type
+    static constexpr twai_byte_order_t ORDER = Order;   ///< Word the signal is read from
+
+    /** Position of the signal LSB in the word of its byte order */
+    static constexpr int SHIFT = Order == TWAI_BYTE_ORDER_INTEL
+        ? StartBit
+        : (7 - StartBit / 8) * 8 + StartBit % 8 - (Length - 1);
+    static_assert(SHIFT >= 0 && SHIFT + Length <= 64, "Signal does not fit in 8 bytes");
+
+    /** Raw value mask */
+    static constexpr uint64_t MASK = Length == 64 ? ~0ULL : (1ULL << Length) - 1;
+
+    /** @brief Raw (unscaled, unsigned) bits from a frame word */
+    static uint64_t raw(uint64_t word) { return (word >> SHIFT) & MASK; }
+
+    /** @brief Physical value of a raw value */
+    static T from_raw(uint64_t bits) {
+        return scale(Signed ? T(int64_t(bits << (64 - Length)) >> (64 - Length)) : T(bits));
+    }
+
+    /** @brief Raw value of a physical value (rounded, truncated to Length bits) */
+    static uint64_t to_raw(T value) {
+        return uint64_t(unscale(value)) & MASK;
+    }
+
+    /** @brief Decode the signal from a frame word of its byte order */
+    static T decode_word(uint64_t word) { return from_raw(raw(word)); }
+
+    /** @brief Decode the signal from 8 payload bytes */
+    static T decode(const uint8_t* data) {
+        return decode_word(Order == TWAI_BYTE_ORDER_INTEL ? TWAI_FrameWord::load_le(data)
+                                                          : TWAI_FrameWord::load_be(data));
+    }
+
+    /** @brief Insert a physical value into a frame word of its byte order */
+    static uint64_t encode_word(uint64_t word, T value) {
+        return (word & ~(MASK << SHIFT)) | (to_raw(value) << SHIFT);
+    }
+
+    /** @brief Write the signal into 8 payload bytes */
+    static void encode(uint8_t* data, T value) {
+        if (Order == TWAI_BYTE_ORDER_INTEL) {
+            TWAI_FrameWord::store_le(data, encode_word(TWAI_FrameWord::load_le(data), value));
+        } else {
+            TWAI_FrameWord::store_be(data, encode_word(TWAI_FrameWord::load_be(data), value));
+        }
+    }
+
+private:
+    static constexpr bool IDENTITY = Scale::num == Scale::den && Offset::num == 0;
+
+    static T scale(T raw_value) {
+        return IDENTITY ? raw_value
+                        : raw_value * T(Scale::num) / T(Scale::den) + T(Offset::num) / T(Offset::den);
+    }
+
+    static int64_t unscale(T value) {
+        return IDENTITY ? int64_t(value) : round((value - T(Offset::num) / T(Offset::den)) * T(Scale::den) / T(Scale::num));
+    }
+
+    template <typename V>
+    static typename std::enable_if<std::is_floating_point<V>::value, int64_t>::type round(V v) {
+        return int64_t(v < 0 ? v - V(0.5) : v + V(0.5));
+    }
+
+    template <typename V>
+    static typename std::enable_if<!std::is_floating_point<V>::value, int64_t>::type round(V v) {
+        return int64_t(v);
+    }
+};
+
+/**
+ * @class TWAI_MessageCodec
+ * @brief All signals of one frame, decoded in a single pass
+ *
+ * @details The payload is loaded once per byte order used by the signals
+ * and every signal is extracted from that register value; the loop over
+ * signals is unrolled at compile time.
+ *
+ * @tparam Signals TWAI_Signal types, in the order of values_t
+ *
+ * Example: @code
+ * typedef TWAI_MessageCodec<EngineSpeed, CoolantTemp> Engine;
+ * Engine::values_t values;
+ * Engine::decode(event.message.data, values);
+ * float rpm = std::get<0>(values);
+ * @endcode
+ */
+template <typename... Signals>
+class TWAI_MessageCodec {
+public:
+    typedef std::tuple<typename Signals::value_type...> values_t;   ///< One value per signal
+    static constexpr size_t SIGNAL_COUNT = sizeof...(Signals);          ///< Number of signals
+
+    /**
+     * @brief Decode every signal of a payload
+     * @param data 8 payload bytes
+     * @param out Destination values
+     */
+    static void decode(const uint8_t* data, values_t& out) {
+        uint64_t le = USES_INTEL ? TWAI_FrameWord::load_le(data) : 0;
+        uint64_t be = USES_MOTOROLA ? TWAI_FrameWord::load_be(data) : 0;
+        decode_each<0>(le, be, out);
+    }
+
+    /**
+     * @brief Encode every signal into a payload (other bits are kept)
+     * @param data 8 payload bytes
+     * @param in Values to write
+     */
+    static void encode(uint8_t* data, const values_t& in) {
+        if (USES_INTEL) {
+            TWAI_FrameWord::store_le(data, encode_each<0>(TWAI_FrameWord::load_le(data), TWAI_BYTE_ORDER_INTEL, in));
+        }
+        if (USES_MOTOROLA) {
+            TWAI_FrameWord::store_be(data, encode_each<0>(TWAI_FrameWord::load_be(data), TWAI_BYTE_ORDER_MOTOROLA, in));
+        }
+    }
+
+    /**
+     * @brief Decode the frames of one ID from an array of events
+     * @param events Events from the event queue or receive_batch()
+     * @param count Number of events
+     * @param id Frame identifier
+     * @param is_extended True for 29-bit ID
+     * @param out Destination, one values_t per matching frame
+     * @param max Capacity of @p out
+     * @return Frames decoded (error events and remote frames are skipped)
+     */
+    static size_t decode_batch(const TWAI_Object::can_event_t* events, size_t count,
+                               uint32_t id, bool is_extended, values_t* out, size_t max) {
+        size_t n = 0;
+        for (size_t i = 0; i < count && n < max; ++i) {
+            const twai_message_t& msg = events[i].message;
+            if (events[i].is_error || msg.rtr || msg.identifier != id || bool(msg.extd) != is_extended) continue;
+            decode(msg.data, out[n++]);
+        }
+        return n;
+    }
+
+    /**
+     * @brief Decode the frames of one ID from an array of compact events
+     * @see decode_batch(const TWAI_Object::can_event_t*, size_t, uint32_t, bool, values_t*, size_t)
+     */
+    static size_t decode_batch(const TWAI_Object::can_event_packed_t* events, size_t count,
+                               uint32_t id, bool is_extended, values_t* out, size_t max) {
+        const uint32_t skip = TWAI_Object::PACKED_ERROR | TWAI_Object::PACKED_RTR;
+        const uint32_t format = is_extended ? TWAI_Object::PACKED_EXTD : 0;
+        size_t n = 0;
+        for (size_t i = 0; i < count && n < max; ++i) {
+            const TWAI_Object::can_event_packed_t& e = events[i];
+            if ((e.flags_dlc & skip) || e.identifier != id || (e.flags_dlc & TWAI_Object::PACKED_EXTD) != format) continue;
+            decode(e.data, out[n++]);
+        }
+        return n;
+    }
+
+private:
+    typedef std::tuple<Signals...> signals_t;
+
+    /** @brief True if any signal uses byte order @p O */
+    template <twai_byte_order_t O, typename... S>
+    struct uses_order : std::false_type {};
+
+    template <twai_byte_order_t O, typename Head, typename... Tail>
+    struct uses_order<O, Head, Tail...>
+        : std::integral_constant<bool, Head::ORDER == O || uses_order<O, Tail...>::value> {};
+
+    static constexpr bool USES_INTEL = uses_order<TWAI_BYTE_ORDER_INTEL, Signals...>::value;
+    static constexpr bool USES_MOTOROLA = uses_order<TWAI_BYTE_ORDER_MOTOROLA, Signals...>::value;
+
+    template <size_t I>
+    static typename std::enable_if<(I == SIGNAL_COUNT)>::type decode_each(uint64_t, uint64_t, values_t&) {}
+
+    template <size_t I>
+    static typename std::enable_if<(I < SIGNAL_COUNT)>::type decode_each(uint64_t le, uint64_t be, values_t& out) {
+        typedef typename std::tuple_element<I, signals_t>::type S;
+        std::get<I>(out) = S::decode_word(S::ORDER == TWAI_BYTE_ORDER_INTEL ? le : be);
+        decode_each<I + 1>(le, be, out);
+    }
+
+    template <size_t I>
+    static typename std::enable_if<(I == SIGNAL_COUNT), uint64_t>::type
+    encode_each(uint64_t word, twai_byte_order_t, const values_t&) { return word; }
+
+    template <size_t I>
+    static typename std::enable_if<(I < SIGNAL_COUNT), uint64_t>::type
+    encode_each(uint64_t word, twai_byte_order_t order, const values_t& in) {
+        typedef typename std::tuple_element<I, signals_t>::type S;
+        if (S::ORDER == order) word = S::encode_word(word, std::get<I>(in));
+        return encode_each<I + 1>(word, order, in);
+    }
+};
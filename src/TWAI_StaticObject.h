@@ -0,0 +1,85 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include "TWAI_Object.h"
+
+/**
+ * @class TWAI_StaticStorage
+ * @brief Inline buffers of a TWAI_StaticObject
+ * @details Separate base so the buffers exist before TWAI_Object is built
+ * @note Internal use - see TWAI_StaticObject
+ */
+template <size_t QueueDepth, size_t FilterCapacity, typename Event, size_t ServiceStackSize>
+struct TWAI_StaticStorage {
+    alignas(Event) uint8_t queue_items[QueueDepth * sizeof(Event)];     ///< Event queue items
+    StaticQueue_t queue_control;                                        ///< Event queue control block
+    TWAI_Object::twai_user_filter_t filter_table[FilterCapacity];       ///< Logical filters
+    StackType_t service_stack[ServiceStackSize ? ServiceStackSize : 1]; ///< Service task stack
+    StaticTask_t service_tcb;                                           ///< Service task control block
+};
+
+/**
+ * @class TWAI_StaticObject
+ * @brief TWAI_Object with every buffer sized at compile time and stored inline
+ *
+ * @details The event queue is created with xQueueCreateStatic() on
+ * members of this object, the filter table is a fixed array (add_filter()
+ * fails when it is full instead of growing) and the service task, when a
+ * feature needs it, runs on an inline stack. Nothing is taken from the
+ * heap by the object itself; only the ESP-IDF driver allocates, once, in
+ * begin() (and esp_timer, if set_rx_moderation() is used). RAM use is the
+ * TWAI_Object tables (sized by the MAX_* macros) plus exactly the storage
+ * requested here, with no heap block headers.
+ *
+ * It is a TWAI_Object, so it works with TWAI_Gateway, TWAI_IsoTp, traces
+ * and every other component taking a TWAI_Object&.
+ *
+ * @tparam QueueDepth Event queue items
+ * @tparam FilterCapacity Logical filters (1..255)
+ * @tparam Event Event queue item type (TWAI_Object::can_event_packed_t or
+ * TWAI_Object::can_event_t)
+ * @tparam ServiceStackSize Service task stack size (0 = create the task
+ * dynamically if a feature needs it)
+ *
+ * Example: @code
+ * TWAI_StaticObject<16, 4> can;   // 16 packed events, 4 filters
+ * TWAI_Object::can_event_packed_t event;
+ * xQueueReceive(can.get_event_queue(), &event, portMAX_DELAY);
+ * @endcode
+ */
+template <size_t QueueDepth, size_t FilterCapacity = MAX_USER_FILTERS,
+          typename Event = TWAI_Object::can_event_packed_t,
+          size_t ServiceStackSize = TWAI_SERVICE_STACK_SIZE>
+class TWAI_StaticObject : private TWAI_StaticStorage<QueueDepth, FilterCapacity, Event, ServiceStackSize>,
+                          public TWAI_Object {
+    typedef TWAI_StaticStorage<QueueDepth, FilterCapacity, Event, ServiceStackSize> buffers_t;
+
+    static_assert(QueueDepth > 0 && QueueDepth <= UINT16_MAX, "Queue depth must be 1..65535");
+    static_assert(FilterCapacity > 0 && FilterCapacity <= 255, "Filter capacity must be 1..255");
+    static_assert(std::is_same<Event, can_event_packed_t>::value || std::is_same<Event, can_event_t>::value,
+                  "Event must be can_event_packed_t or can_event_t");
+
+public:
+    typedef Event event_type;                               ///< Item type of get_event_queue()
+    static constexpr size_t QUEUE_DEPTH = QueueDepth;       ///< Event queue items
+    static constexpr size_t FILTER_CAPACITY = FilterCapacity; ///< Logical filters
+
+    TWAI_StaticObject() : TWAI_Object(describe(*this)) {}
+
+private:
+    /** @brief Describe the inline buffers to TWAI_Object */
+    static storage_t describe(buffers_t& buffers) {
+        storage_t s;
+        s.filters = buffers.filter_table;
+        s.filter_capacity = uint8_t(FilterCapacity);
+        s.queue_items = buffers.queue_items;
+        s.queue = &buffers.queue_control;
+        s.queue_length = uint16_t(QueueDepth);
+        s.packed_events = std::is_same<Event, can_event_packed_t>::value;
+        s.service_stack = ServiceStackSize ? buffers.service_stack : nullptr;
+        s.service_stack_size = ServiceStackSize ? uint32_t(ServiceStackSize) : TWAI_SERVICE_STACK_SIZE;
+        s.service_tcb = &buffers.service_tcb;
+        return s;
+    }
+};
@@ -0,0 +1,38 @@
+#include "TWAI_Stats.h"
+
+namespace {
+
+inline uint32_t take(std::atomic<uint32_t>& counter, bool reset, uint32_t initial = 0) {
+    return reset ? counter.exchange(initial, std::memory_order_relaxed)
+                 : counter.load(std::memory_order_relaxed);
+}
+
+}  // namespace
+
+TWAI_Stats::snapshot_t TWAI_Stats::read(bool reset) {
+    snapshot_t s;
+    s.rx_frames = take(rx_frames, reset);
+    s.rx_bytes = take(rx_bytes, reset);
+    s.tx_frames = take(tx_frames, reset);
+    s.tx_bytes = take(tx_bytes, reset);
+    s.queue_peak = take(queue_peak, reset);
+    s.isr_count = take(isr_count, reset);
+    uint32_t total = take(isr_total_us, reset);
+    s.isr_min_us = take(isr_min_us, reset, UINT32_MAX);
+    s.isr_max_us = take(isr_max_us, reset);
+    s.isr_avg_us = s.isr_count ? total / s.isr_count : 0;
+    if (s.isr_count == 0) s.isr_min_us = 0;
+    s.tec_peak = take(tec_peak, reset);
+    s.rec_peak = take(rec_peak, reset);
+    s.tx_latency_max_us = take(tx_latency_max_us, reset);
+    s.latency_max_us = take(latency_max_us, reset);
+    s.rx_wakes = take(rx_wakes, reset);
+    for (int i = 0; i < TWAI_LATENCY_BUCKETS; ++i) {
+        s.latency_hist[i] = take(latency_hist[i], reset);
+    }
+    s.tx_expired = take(tx_expired, reset);
+    for (int i = 0; i < TWAI_LATENCY_BUCKETS; ++i) {
+        s.tx_latency_hist[i] = take(tx_latency_hist[i], reset);
+    }
+    return s;
+}
@@ -0,0 +1,132 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+#ifndef TWAI_LATENCY_BUCKETS
+/**Number of log2 latency histogram buckets (bucket i holds [2^(i-1), 2^i) us)*/
+#define TWAI_LATENCY_BUCKETS (16)
+#endif  // TWAI_LATENCY_BUCKETS
+
+/**
+ * @class TWAI_Stats
+ * @brief Lock-free runtime counters for a controller
+ *
+ * @details All updates are relaxed atomic operations (no locks, no output),
+ * so they can be called from the ISR and left enabled in production.
+ * Minimum/maximum values are kept with compare-and-swap loops.
+ */
+class TWAI_Stats {
+public:
+    /**
+     * @struct snapshot_t
+     * @brief Copy of all counters at one point in time
+     */
+    typedef struct {
+        uint32_t rx_frames;         ///< Frames delivered by the RX path
+        uint32_t rx_bytes;          ///< Payload bytes delivered by the RX path
+        uint32_t tx_frames;         ///< Frames accepted for transmission
+        uint32_t tx_bytes;          ///< Payload bytes accepted for transmission
+        uint32_t queue_peak;        ///< Highest event queue/ring occupancy seen
+        uint32_t isr_count;         ///< Interrupts measured
+        uint32_t isr_min_us;        ///< Shortest interrupt (us)
+        uint32_t isr_avg_us;        ///< Average interrupt (us)
+        uint32_t isr_max_us;        ///< Longest interrupt (us)
+        uint32_t tec_peak;          ///< Highest transmit error counter seen
+        uint32_t rec_peak;          ///< Highest receive error counter seen
+        uint32_t tx_latency_max_us; ///< Longest submit-to-completion time of a scheduled frame (us)
+        uint32_t latency_max_us;    ///< Longest ISR-to-consumer latency (us)
+        uint32_t rx_wakes;          ///< Notifications sent to the receive_batch() consumer
+        uint32_t latency_hist[TWAI_LATENCY_BUCKETS]; ///< ISR-to-consumer latency, log2 us buckets
+        uint32_t tx_expired;        ///< Scheduled frames dropped at their deadline
+        uint32_t tx_latency_hist[TWAI_LATENCY_BUCKETS]; ///< Submit-to-completion latency, log2 us buckets
+    } snapshot_t;
+
+    /** @brief Count one delivered RX frame */
+    void on_rx(uint8_t bytes) {
+        rx_frames.fetch_add(1, std::memory_order_relaxed);
+        rx_bytes.fetch_add(bytes, std::memory_order_relaxed);
+    }
+
+    /** @brief Count one frame accepted for transmission */
+    void on_tx(uint8_t bytes) {
+        tx_frames.fetch_add(1, std::memory_order_relaxed);
+        tx_bytes.fetch_add(bytes, std::memory_order_relaxed);
+    }
+
+    /** @brief Record the current queue occupancy */
+    void on_queue_level(uint32_t level) { update_max(queue_peak, level); }
+
+    /** @brief Record the duration of one interrupt */
+    void on_isr(uint32_t us) {
+        isr_count.fetch_add(1, std::memory_order_relaxed);
+        isr_total_us.fetch_add(us, std::memory_order_relaxed);
+        update_min(isr_min_us, us);
+        update_max(isr_max_us, us);
+    }
+
+    /** @brief Record the controller error counters */
+    void on_error_counters(uint32_t tec, uint32_t rec) {
+        update_max(tec_peak, tec);
+        update_max(rec_peak, rec);
+    }
+
+    /** @brief Record the submit-to-completion time of one scheduled frame */
+    void on_tx_latency(uint32_t us) {
+        tx_latency_hist[bucket(us)].fetch_add(1, std::memory_order_relaxed);
+        update_max(tx_latency_max_us, us);
+    }
+
+    /** @brief Count one scheduled frame dropped at its deadline */
+    void on_tx_expired() { tx_expired.fetch_add(1, std::memory_order_relaxed); }
+
+    /** @brief Record one ISR-to-consumer latency */
+    void on_latency(uint32_t us) {
+        latency_hist[bucket(us)].fetch_add(1, std::memory_order_relaxed);
+        update_max(latency_max_us, us);
+    }
+
+    /** @brief Count one wake-up of the receive_batch() consumer */
+    void on_rx_wake() { rx_wakes.fetch_add(1, std::memory_order_relaxed); }
+
+    /**
+     * @brief Copy all counters
+     * @param reset True to clear counters while reading them
+     */
+    snapshot_t read(bool reset);
+
+private:
+    std::atomic<uint32_t> rx_frames{0};                         ///< Frames delivered by the RX path
+    std::atomic<uint32_t> rx_bytes{0};                          ///< Payload bytes delivered
+    std::atomic<uint32_t> tx_frames{0};                         ///< Frames accepted for transmission
+    std::atomic<uint32_t> tx_bytes{0};                          ///< Payload bytes accepted for transmission
+    std::atomic<uint32_t> queue_peak{0};                        ///< Highest queue occupancy
+    std::atomic<uint32_t> isr_count{0};                         ///< Interrupts measured
+    std::atomic<uint32_t> isr_total_us{0};                      ///< Sum of interrupt durations (us)
+    std::atomic<uint32_t> isr_min_us{UINT32_MAX};               ///< Shortest interrupt (us)
+    std::atomic<uint32_t> isr_max_us{0};                        ///< Longest interrupt (us)
+    std::atomic<uint32_t> tec_peak{0};                          ///< Highest TEC seen
+    std::atomic<uint32_t> rec_peak{0};                          ///< Highest REC seen
+    std::atomic<uint32_t> tx_latency_max_us{0};                 ///< Longest scheduled TX latency (us)
+    std::atomic<uint32_t> latency_max_us{0};                    ///< Longest latency (us)
+    std::atomic<uint32_t> rx_wakes{0};                          ///< Consumer notifications
+    std::atomic<uint32_t> latency_hist[TWAI_LATENCY_BUCKETS] = {}; ///< Latency histogram
+    std::atomic<uint32_t> tx_expired{0};                        ///< Frames dropped at their deadline
+    std::atomic<uint32_t> tx_latency_hist[TWAI_LATENCY_BUCKETS] = {}; ///< TX latency histogram
+
+    /** @brief log2 histogram bucket of a latency */
+    static uint32_t bucket(uint32_t us) {
+        uint32_t b = 0;
+        for (uint32_t v = us; v && b < TWAI_LATENCY_BUCKETS - 1; v >>= 1) ++b;
+        return b;
+    }
+
+    static void update_max(std::atomic<uint32_t>& target, uint32_t value) {
+        uint32_t cur = target.load(std::memory_order_relaxed);
+        while (value > cur && !target.compare_exchange_weak(cur, value, std::memory_order_relaxed)) {}
+    }
+
+    static void update_min(std::atomic<uint32_t>& target, uint32_t value) {
+        uint32_t cur = target.load(std::memory_order_relaxed);
+        while (value < cur && !target.compare_exchange_weak(cur, value, std::memory_order_relaxed)) {}
+    }
+};
@@ -0,0 +1,89 @@
+#include "TWAI_TimerWheel.h"
+
+void TWAI_TimerWheel::reset(uint32_t now) {
+    for (auto& head : level0) head = NONE;
+    for (auto& head : level1) head = NONE;
+    current = now;
+}
+
+void TWAI_TimerWheel::insert(uint16_t id, uint32_t due) {
+    // Vencidos: al siguiente tick
+    if (int32_t(due - current) <= 0) due = current + 1;
+    due_tick[id] = due;
+    place(id, current);
+}
+
+void TWAI_TimerWheel::place(uint16_t id, uint32_t from) {
+    uint32_t due = due_tick[id];
+    uint32_t delta = due - from;
+    if (delta < L0_SIZE) {
+        link(level0[due & (L0_SIZE - 1)], id);
+    } else if (delta < L0_SIZE * L1_SIZE) {
+        link(level1[(due >> L0_BITS) & (L1_SIZE - 1)], id);
+    } else {
+        // Demasiado lejos: aparcar en el último hueco y volver a repartir
+        link(level1[((from >> L0_BITS) + L1_SIZE - 1) & (L1_SIZE - 1)], id);
+    }
+}
+
+size_t TWAI_TimerWheel::advance(uint32_t now, uint16_t* expired, size_t max) {
+    size_t count = 0;
+    while (int32_t(now - current) > 0) {
+        uint32_t tick = current + 1;
+
+        // Al empezar un bloque de 256, repartir el hueco de nivel 1 visto
+        // desde el tick nuevo: con current el último tick del bloque volvería aquí
+        if ((tick & (L0_SIZE - 1)) == 0) {
+            uint16_t& block = level1[(tick >> L0_BITS) & (L1_SIZE - 1)];
+            uint16_t id = block;
+            block = NONE;
+            while (id != NONE) {
+                uint16_t following = next[id];
+                place(id, tick);
+                id = following;
+            }
+        }
+
+        // Vencer lo que cabe en la salida; el resto se queda en el hueco
+        uint16_t& slot = level0[tick & (L0_SIZE - 1)];
+        uint16_t id = slot, keep = NONE;
+        bool left = false;
+        slot = NONE;
+        while (id != NONE) {
+            uint16_t following = next[id];
+            if (due_tick[id] == tick && count < max) {
+                expired[count++] = id;
+            } else {
+                left |= due_tick[id] == tick;
+                link(keep, id);
+            }
+            id = following;
+        }
+        slot = keep;
+        if (left) break;    // El tiempo sigue en este tick hasta la próxima llamada
+        current = tick;
+
+        // Entradas de vueltas posteriores: volver a repartir
+        id = slot;
+        slot = NONE;
+        while (id != NONE) {
+            uint16_t following = next[id];
+            place(id, current);
+            id = following;
+        }
+    }
+    return count;
+}
+
+uint32_t TWAI_TimerWheel::ticks_to_next(uint32_t limit) const {
+    uint32_t scan = limit < L0_SIZE ? limit : L0_SIZE;
+    for (uint32_t d = 1; d <= scan; ++d) {
+        if (level0[(current + d) & (L0_SIZE - 1)] != NONE) return d;
+    }
+    // Próximo reparto de nivel 1
+    uint32_t to_cascade = L0_SIZE - (current & (L0_SIZE - 1));
+    for (uint16_t head : level1) {
+        if (head != NONE) return to_cascade < limit ? to_cascade : limit;
+    }
+    return limit;
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+#ifndef MAX_PERIODIC_MSGS
+/**Maximum number of periodic messages (timer wheel entries)*/
+#define MAX_PERIODIC_MSGS (64)
+#endif  // MAX_PERIODIC_MSGS
+
+/**
+ * @class TWAI_TimerWheel
+ * @brief Two-level hierarchical timer wheel with 1-tick resolution
+ *
+ * @details Level 0 has 256 one-tick slots, level 1 has 64 slots of 256
+ * ticks (16384 ticks in total). Entries further away are parked in the
+ * last level 1 slot and cascaded again. Insertion and expiry are O(1);
+ * entries are identified by an index below MAX_PERIODIC_MSGS and linked
+ * through a fixed array, so nothing is allocated.
+ *
+ * @note Not synchronized: the owner serializes access
+ */
+class TWAI_TimerWheel {
+public:
+    static constexpr uint16_t NONE = 0xFFFF;    ///< Empty list marker
+
+    TWAI_TimerWheel() { reset(0); }
+
+    /**
+     * @brief Remove all entries and set the current time
+     * @param now Current tick
+     */
+    void reset(uint32_t now);
+
+    /**
+     * @brief Insert an entry
+     * @param id Entry index (< MAX_PERIODIC_MSGS), must not be in the wheel
+     * @param due Absolute expiry tick (past ticks expire on the next advance)
+     */
+    void insert(uint16_t id, uint32_t due);
+
+    /**
+     * @brief Move time forward and collect expired entries
+     * @param now Current tick
+     * @param expired Destination for expired entry indexes
+     * @param max Capacity of @p expired
+     * @return Number of expired entries. If more than @p max are due, time
+     * stops at the first tick with entries left; they expire on the next call.
+     */
+    size_t advance(uint32_t now, uint16_t* expired, size_t max);
+
+    /**
+     * @brief Ticks until the next possible expiry
+     * @param limit Maximum value returned
+     */
+    uint32_t ticks_to_next(uint32_t limit) const;
+
+    /** @brief Due tick of an entry */
+    uint32_t due(uint16_t id) const { return due_tick[id]; }
+
+    /** @brief Current tick */
+    uint32_t now() const { return current; }
+
+private:
+    static constexpr uint32_t L0_BITS = 8;
+    static constexpr uint32_t L0_SIZE = 1u << L0_BITS;
+    static constexpr uint32_t L1_SIZE = 64;
+
+    uint16_t level0[L0_SIZE];               ///< One-tick slots
+    uint16_t level1[L1_SIZE];               ///< 256-tick slots
+    uint16_t next[MAX_PERIODIC_MSGS];       ///< Slot list links
+    uint32_t due_tick[MAX_PERIODIC_MSGS];   ///< Absolute expiry per entry
+    uint32_t current = 0;                   ///< Last processed tick
+
+    /** @brief Link @p id into the slot of its due tick, as seen from tick @p from */
+    void place(uint16_t id, uint32_t from);
+
+    /** @brief Push @p id at the head of a slot list */
+    void link(uint16_t& head, uint16_t id) {
+        next[id] = head;
+        head = id;
+    }
+};
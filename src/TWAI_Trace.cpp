@@ -0,0 +1,102 @@
+#include "TWAI_Trace.h"
+#include <cstdio>
+
+TWAI_Trace::TWAI_Trace() {
+    for (uint32_t i = 0; i < TWAI_TRACE_RECORDS; ++i) {
+        cells[i].seq.store(i, std::memory_order_relaxed);
+    }
+}
+
+void TWAI_Trace::set_sink(sink_t output, void* context) {
+    sink = output;
+    sink_context = context;
+    header_pending = true;
+}
+
+size_t TWAI_Trace::flush(bool partial) {
+    if (!sink) return 0;
+
+    if (header_pending) {
+        header_t header = { TRACE_MAGIC, TRACE_VERSION, sizeof(TWAI_Object::can_event_packed_t) };
+        sink(reinterpret_cast<const uint8_t*>(&header), sizeof(header), sink_context);
+        header_pending = false;
+    }
+
+    size_t written = 0;
+    while (true) {
+        // Llenar el bloque con los registros ya publicados
+        while (block_fill < TWAI_TRACE_BLOCK_RECORDS) {
+            cell_t& cell = cells[dequeue_pos & MASK];
+            if (cell.seq.load(std::memory_order_acquire) != dequeue_pos + 1) break;
+            block[block_fill++] = cell.record;
+            cell.seq.store(dequeue_pos + TWAI_TRACE_RECORDS, std::memory_order_release);
+            ++dequeue_pos;
+        }
+
+        bool full = block_fill == TWAI_TRACE_BLOCK_RECORDS;
+        if (!full && !(partial && block_fill > 0)) break;
+
+        sink(reinterpret_cast<const uint8_t*>(block), block_fill * sizeof(block[0]), sink_context);
+        written += block_fill;
+        block_fill = 0;
+        if (!full) break;
+    }
+    return written;
+}
+
+size_t TWAI_Trace::format_candump(const TWAI_Object::can_event_packed_t& record, const char* interface,
+                                  char* out, size_t size) {
+    if (!out || size == 0) return 0;
+
+    bool extended = record.flags_dlc & TWAI_Object::PACKED_EXTD;
+    uint8_t dlc = record.flags_dlc & TWAI_Object::PACKED_DLC_MASK;
+    int n = snprintf(out, size, extended ? "(%llu.%06llu) %s %08X#" : "(%llu.%06llu) %s %03X#",
+                     (unsigned long long) (record.timestamp_us / 1000000),
+                     (unsigned long long) (record.timestamp_us % 1000000),
+                     interface, (unsigned) record.identifier);
+    if (n < 0 || size_t(n) >= size) return 0;
+
+    // Remota: "R" y la longitud pedida; datos: un par hexadecimal por byte
+    size_t len = n;
+    if (record.flags_dlc & TWAI_Object::PACKED_RTR) {
+        n = dlc ? snprintf(out + len, size - len, "R%u", dlc) : snprintf(out + len, size - len, "R");
+    } else {
+        n = 0;
+        for (uint8_t i = 0; i < dlc && i < 8 && len + n + 2 < size; ++i) {
+            n += snprintf(out + len + n, size - len - n, "%02X", record.data[i]);
+        }
+    }
+    len += n;
+    return len < size ? len : size - 1;
+}
+
+bool TWAI_Trace::read_header(source_t source, void* context) {
+    header_t header;
+    if (!source || source(reinterpret_cast<uint8_t*>(&header), sizeof(header), context) != sizeof(header)) {
+        return false;
+    }
+    return header.magic == TRACE_MAGIC && header.version == TRACE_VERSION &&
+           header.record_size == sizeof(TWAI_Object::can_event_packed_t);
+}
+
+int TWAI_Trace::export_candump(source_t source, void* source_context, sink_t sink, void* sink_context,
+                               const char* interface) {
+    if (!sink || !read_header(source, source_context)) return -1;
+
+    TWAI_Object::can_event_packed_t records[16];
+    char line[64];
+    int converted = 0;
+    size_t bytes;
+    while ((bytes = source(reinterpret_cast<uint8_t*>(records), sizeof(records), source_context)) > 0) {
+        size_t count = bytes / sizeof(records[0]);
+        for (size_t i = 0; i < count; ++i) {
+            if (records[i].flags_dlc & TWAI_Object::PACKED_ERROR) continue;
+            size_t len = format_candump(records[i], interface, line, sizeof(line) - 1);
+            line[len++] = '\n';
+            sink(reinterpret_cast<const uint8_t*>(line), len, sink_context);
+            ++converted;
+        }
+        if (bytes < sizeof(records)) break;
+    }
+    return converted;
+}
@@ -0,0 +1,163 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "TWAI_Object.h"
+
+#ifndef TWAI_TRACE_RECORDS
+/**Capacity of the trace record ring (must be a power of two)*/
+#define TWAI_TRACE_RECORDS (256)
+#endif  // TWAI_TRACE_RECORDS
+
+#ifndef TWAI_TRACE_BLOCK_RECORDS
+/**Records handed to the sink in one write*/
+#define TWAI_TRACE_BLOCK_RECORDS (64)
+#endif  // TWAI_TRACE_BLOCK_RECORDS
+
+/**
+ * @class TWAI_Trace
+ * @brief Binary recorder of RX/TX traffic
+ *
+ * @details Attached with TWAI_Object::attach_trace(), it receives every
+ * frame read from the controller (before the software filters) and every
+ * frame accepted by send() (flagged with TWAI_Object::PACKED_TX) as 24-byte
+ * can_event_packed_t records. Records go to a preallocated lock-free ring
+ * that any number of producers (RX interrupt, sending tasks) share; a
+ * task calls flush() to write them to the sink in blocks of
+ * TWAI_TRACE_BLOCK_RECORDS. Nothing is allocated per frame and producers
+ * never block: records that do not fit are counted in dropped().
+ *
+ * Stream format: a header_t followed by raw records (little endian).
+ */
+class TWAI_Trace {
+public:
+    /**
+     * @brief Output callback (file, stream...)
+     * @param data Bytes to write
+     * @param length Number of bytes
+     * @param context User context given to set_sink()
+     * @return Bytes written
+     */
+    typedef size_t (*sink_t)(const uint8_t* data, size_t length, void* context);
+
+    /**
+     * @brief Input callback for replay and export
+     * @param data Destination
+     * @param length Bytes wanted
+     * @param context User context
+     * @return Bytes read (less than @p length only at the end of the trace)
+     */
+    typedef size_t (*source_t)(uint8_t* data, size_t length, void* context);
+
+    /**
+     * @struct header_t
+     * @brief Start of a trace stream
+     */
+    typedef struct {
+        uint32_t magic;         ///< TRACE_MAGIC
+        uint16_t version;       ///< TRACE_VERSION
+        uint16_t record_size;   ///< sizeof(can_event_packed_t)
+    } header_t;
+
+    static constexpr uint32_t TRACE_MAGIC = 0x52545754;    ///< "TWTR"
+    static constexpr uint16_t TRACE_VERSION = 1;            ///< Stream format version
+
+    TWAI_Trace();
+
+    /**
+     * @brief Select the output and start a new stream
+     * @param sink Output callback
+     * @param context User pointer passed to @p sink
+     * @details The header is written with the next flush()
+     */
+    void set_sink(sink_t sink, void* context = nullptr);
+
+    /**
+     * @brief Append one record (any context, multiple producers)
+     * @param record Record to store
+     * @return False if the ring is full (record dropped)
+     */
+    bool record(const TWAI_Object::can_event_packed_t& record) {
+        uint32_t pos = enqueue_pos.load(std::memory_order_relaxed);
+        while (true) {
+            cell_t& cell = cells[pos & MASK];
+            int32_t diff = int32_t(cell.seq.load(std::memory_order_acquire) - pos);
+            if (diff == 0) {
+                // Reservar la celda; otro productor puede haberla tomado
+                if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.record = record;
+                    cell.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                dropped_records.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            } else {
+                pos = enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /**
+     * @brief Write pending records to the sink (single consumer)
+     * @param partial Also write an incomplete last block
+     * @return Records written
+     */
+    size_t flush(bool partial = true);
+
+    /** @brief Records lost because the ring was full */
+    uint32_t dropped() const { return dropped_records.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Format one record as a candump log line
+     * @param record Source record
+     * @param interface Interface name written in the line (e.g. "can0")
+     * @param out Destination buffer (64 bytes are always enough)
+     * @param size Capacity of @p out
+     * @return Characters written (without terminator)
+     */
+    static size_t format_candump(const TWAI_Object::can_event_packed_t& record, const char* interface,
+                                 char* out, size_t size);
+
+    /**
+     * @brief Convert a binary trace to candump log text
+     * @param source Binary trace input
+     * @param source_context User pointer passed to @p source
+     * @param sink Text output
+     * @param sink_context User pointer passed to @p sink
+     * @param interface Interface name written in every line
+     * @return Records converted, or -1 if the stream header is invalid
+     * @note Error events are skipped
+     */
+    static int export_candump(source_t source, void* source_context, sink_t sink, void* sink_context,
+                              const char* interface = "can0");
+
+    /**
+     * @brief Read and validate a stream header
+     * @return False if the stream is not a trace of this version
+     */
+    static bool read_header(source_t source, void* context);
+
+private:
+    static constexpr uint32_t MASK = TWAI_TRACE_RECORDS - 1;
+    static_assert((TWAI_TRACE_RECORDS & MASK) == 0, "TWAI_TRACE_RECORDS must be a power of two");
+
+    /**
+     * @struct cell_t
+     * @brief Ring slot; seq tells whose turn it is (producer or consumer)
+     */
+    typedef struct {
+        std::atomic<uint32_t> seq;              ///< Slot sequence number
+        TWAI_Object::can_event_packed_t record; ///< Stored record
+    } cell_t;
+
+    cell_t cells[TWAI_TRACE_RECORDS];           ///< Record ring
+    std::atomic<uint32_t> enqueue_pos{0};       ///< Next slot to reserve (producers)
+    uint32_t dequeue_pos = 0;                   ///< Next slot to read (consumer)
+    std::atomic<uint32_t> dropped_records{0};   ///< Records lost at a full ring
+    TWAI_Object::can_event_packed_t block[TWAI_TRACE_BLOCK_RECORDS]; ///< Staging block for the sink
+    size_t block_fill = 0;                      ///< Records waiting in block
+    sink_t sink = nullptr;                      ///< Output callback
+    void* sink_context = nullptr;               ///< Output callback context
+    bool header_pending = false;                ///< Header not written yet
+};
@@ -0,0 +1,78 @@
+#include "TWAI_TraceReplay.h"
+
+TWAI_TraceReplay::TWAI_TraceReplay(TWAI_Object& target) : target(target) {
+}
+
+bool TWAI_TraceReplay::begin(TWAI_Trace::source_t input, void* context, float time_scale,
+                             replay_mode_t replay_mode, bool replay_tx) {
+    source_done = true;
+    block_count = 0;
+    block_index = 0;
+    started = false;
+    emitted = 0;
+    if (!TWAI_Trace::read_header(input, context)) return false;
+
+    source = input;
+    source_context = context;
+    source_done = false;
+    speed = time_scale;
+    mode = replay_mode;
+    include_tx = replay_tx;
+    return true;
+}
+
+const TWAI_Object::can_event_packed_t* TWAI_TraceReplay::next() {
+    while (true) {
+        if (block_index >= block_count) {
+            if (source_done) return nullptr;
+            size_t bytes = source(reinterpret_cast<uint8_t*>(block), sizeof(block), source_context);
+            block_count = bytes / sizeof(block[0]);
+            block_index = 0;
+            if (bytes < sizeof(block)) source_done = true;
+            continue;
+        }
+
+        // Saltar errores y, si no se piden, las tramas enviadas
+        const TWAI_Object::can_event_packed_t& record = block[block_index];
+        if ((record.flags_dlc & TWAI_Object::PACKED_ERROR) ||
+            (!include_tx && (record.flags_dlc & TWAI_Object::PACKED_TX))) {
+            ++block_index;
+            continue;
+        }
+        return &record;
+    }
+}
+
+bool TWAI_TraceReplay::poll() {
+    const TWAI_Object::can_event_packed_t* record;
+    while ((record = next()) != nullptr) {
+        uint64_t now = target.now_us();     // Reloj del backend: virtual o esp_timer
+        if (!started) {
+            first_timestamp_us = record->timestamp_us;
+            start_us = now;
+            started = true;
+        }
+        // Mantener el espaciado original escalado por la velocidad
+        if (speed > 0.0f) {
+            uint64_t due = start_us + uint64_t((record->timestamp_us - first_timestamp_us) / speed);
+            if (now < due) return true;
+        }
+
+        twai_message_t msg = TWAI_Object::to_message(*record);
+        if (mode == REPLAY_AS_TX) {
+            if (!target.send(msg, 0)) return true;
+        } else {
+            target.inject_frame(msg);
+        }
+        ++emitted;
+        ++block_index;
+    }
+    return false;
+}
+
+uint32_t TWAI_TraceReplay::run() {
+    while (poll()) {
+        vTaskDelay(1);
+    }
+    return emitted;
+}
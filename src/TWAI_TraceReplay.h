@@ -0,0 +1,85 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "TWAI_Object.h"
+#include "TWAI_Trace.h"
+
+#ifndef TWAI_REPLAY_BLOCK_RECORDS
+/**Records read from the source at once during replay*/
+#define TWAI_REPLAY_BLOCK_RECORDS (32)
+#endif  // TWAI_REPLAY_BLOCK_RECORDS
+
+/**
+ * @class TWAI_TraceReplay
+ * @brief Re-emits a recorded TWAI_Trace stream into a TWAI_Object
+ *
+ * @details Records are read block by block from a TWAI_Trace::source_t
+ * and emitted when their time comes, keeping the original spacing scaled
+ * by a speed factor. Frames are either injected into the RX path (the
+ * application sees them as received, see TWAI_Object::inject_frame()) or
+ * transmitted with send(). Error events are skipped.
+ */
+class TWAI_TraceReplay {
+public:
+    /**
+     * @enum replay_mode_t
+     * @brief How replayed frames reach the target
+     */
+    typedef enum {
+        REPLAY_AS_RX,   ///< Feed frames to the RX path
+        REPLAY_AS_TX    ///< Transmit frames on the bus
+    } replay_mode_t;
+
+    /**
+     * @brief Create a replay engine
+     * @param target Controller receiving the frames
+     */
+    explicit TWAI_TraceReplay(TWAI_Object& target);
+
+    /**
+     * @brief Open a trace
+     * @param source Binary trace input (positioned at the header)
+     * @param context User pointer passed to @p source
+     * @param speed Time scale (1 = original timing, 10 = 10x faster, 0 = no delays)
+     * @param mode Injection mode
+     * @param include_tx Also replay frames recorded from send()
+     * @return False if the stream header is invalid
+     */
+    bool begin(TWAI_Trace::source_t source, void* context, float speed = 1.0f,
+               replay_mode_t mode = REPLAY_AS_RX, bool include_tx = false);
+
+    /**
+     * @brief Emit every record that is due
+     * @return False once the trace is finished
+     * @note Call often; frames not accepted by send() are retried on the next call
+     */
+    bool poll();
+
+    /**
+     * @brief Replay the whole trace, sleeping between records
+     * @return Frames emitted
+     */
+    uint32_t run();
+
+    /** @brief Frames emitted since begin() */
+    uint32_t replayed() const { return emitted; }
+
+private:
+    TWAI_Object& target;                                    ///< Destination controller
+    TWAI_Trace::source_t source = nullptr;                  ///< Trace input
+    void* source_context = nullptr;                         ///< Trace input context
+    TWAI_Object::can_event_packed_t block[TWAI_REPLAY_BLOCK_RECORDS]; ///< Records read ahead
+    size_t block_count = 0;                                 ///< Valid records in block
+    size_t block_index = 0;                                 ///< Next record to emit
+    bool source_done = true;                                ///< Source reached its end
+    float speed = 1.0f;                                     ///< Time scale
+    replay_mode_t mode = REPLAY_AS_RX;                      ///< Injection mode
+    bool include_tx = false;                                ///< Replay PACKED_TX records too
+    uint64_t start_us = 0;                                  ///< Replay start time
+    uint64_t first_timestamp_us = 0;                        ///< Timestamp of the first record
+    bool started = false;                                   ///< first_timestamp_us is valid
+    uint32_t emitted = 0;                                   ///< Frames emitted
+
+    /** @brief Next record to replay, reading ahead if needed (nullptr at the end) */
+    const TWAI_Object::can_event_packed_t* next();
+};
@@ -0,0 +1,82 @@
+#include "TWAI_TxQueue.h"
+#include <utility>
+
+bool TWAI_TxQueue::push(const twai_message_t& msg, uint64_t enqueue_us, uint64_t deadline_us, uint32_t tag) {
+    if (full()) return false;
+
+    size_t i = count++;
+    heap[i].msg = msg;
+    heap[i].enqueue_us = enqueue_us;
+    heap[i].key = arbitration_key(msg);
+    heap[i].seq = next_seq++;
+    heap[i].deadline_us = deadline_us;
+    heap[i].tag = tag;
+    if (deadline_us && deadline_us < next_expiry) next_expiry = deadline_us;
+    sift_up(i);
+    return true;
+}
+
+bool TWAI_TxQueue::requeue(const entry_t& entry) {
+    if (full()) return false;
+
+    size_t i = count++;
+    heap[i] = entry;
+    if (entry.deadline_us && entry.deadline_us < next_expiry) next_expiry = entry.deadline_us;
+    sift_up(i);
+    return true;
+}
+
+void TWAI_TxQueue::sift_up(size_t i) {
+    // Subir hasta respetar el orden del montículo
+    while (i > 0) {
+        size_t parent = (i - 1) / 2;
+        if (!before(heap[i], heap[parent])) break;
+        std::swap(heap[i], heap[parent]);
+        i = parent;
+    }
+}
+
+bool TWAI_TxQueue::pop(entry_t& out) {
+    if (count == 0) return false;
+
+    out = heap[0];
+    heap[0] = heap[--count];
+    sift_down(0);
+    return true;
+}
+
+void TWAI_TxQueue::sift_down(size_t i) {
+    // Bajar hasta respetar el orden del montículo
+    while (true) {
+        size_t left = 2 * i + 1;
+        if (left >= count) break;
+        size_t best = left;
+        if (left + 1 < count && before(heap[left + 1], heap[left])) best = left + 1;
+        if (!before(heap[best], heap[i])) break;
+        std::swap(heap[i], heap[best]);
+        i = best;
+    }
+}
+
+size_t TWAI_TxQueue::remove_expired(uint64_t now_us, entry_t* out, size_t max) {
+    if (now_us < next_expiry || max == 0) return 0;
+
+    // Compactar las que siguen vigentes y recalcular el próximo vencimiento
+    size_t removed = 0;
+    size_t kept = 0;
+    next_expiry = UINT64_MAX;
+    for (size_t i = 0; i < count; ++i) {
+        const entry_t& e = heap[i];
+        if (e.deadline_us && e.deadline_us <= now_us && removed < max) {
+            out[removed++] = e;
+            continue;
+        }
+        if (e.deadline_us && e.deadline_us < next_expiry) next_expiry = e.deadline_us;
+        heap[kept++] = e;
+    }
+    count = kept;
+
+    // Reconstruir el montículo (Floyd)
+    for (size_t i = count / 2; i-- > 0;) sift_down(i);
+    return removed;
+}
@@ -0,0 +1,125 @@
+#pragma once
+#include <driver/twai.h>
+#include <cstddef>
+#include <cstdint>
+
+#ifndef MAX_TX_PENDING
+/**Maximum number of frames waiting in the transmit scheduler*/
+#define MAX_TX_PENDING (32)
+#endif  // MAX_TX_PENDING
+
+/**
+ * @enum twai_tx_result_t
+ * @brief Outcome of one tracked transmission
+ */
+typedef enum {
+    TWAI_TX_SUCCESS,    ///< Frame acknowledged on the bus
+    TWAI_TX_FAILED,     ///< Single-shot attempt lost, or dropped at bus-off/stop
+    TWAI_TX_EXPIRED     ///< Deadline passed before the frame reached the controller
+} twai_tx_result_t;
+
+/**
+ * @class TWAI_TxQueue
+ * @brief Pending transmit frames ordered by CAN arbitration priority
+ *
+ * @details Fixed-capacity binary min-heap. The key reproduces bus
+ * arbitration: lower identifier first, standard before extended frames
+ * with the same base ID, data before remote frames. Frames with equal
+ * keys leave in submission order.
+ *
+ * @note Not synchronized: the owner serializes access
+ */
+class TWAI_TxQueue {
+public:
+    /**
+     * @struct entry_t
+     * @brief Pending frame
+     */
+    typedef struct {
+        twai_message_t msg;     ///< Frame to transmit
+        uint64_t enqueue_us;    ///< Submission time (us)
+        uint32_t key;           ///< Arbitration key (lower wins)
+        uint32_t seq;           ///< Submission order
+        uint64_t deadline_us;   ///< Abort time (0 = none)
+        uint32_t tag;           ///< User value reported with the completion
+    } entry_t;
+
+    /**
+     * @brief Arbitration key of a frame
+     * @param msg Frame
+     * @return Key where a lower value wins arbitration
+     */
+    static uint32_t arbitration_key(const twai_message_t& msg) {
+        uint32_t key;
+        if (msg.extd) {
+            uint32_t id = msg.identifier & 0x1FFFFFFF;
+            key = ((id >> 18) << 19) | (1u << 18) | (id & 0x3FFFF);
+        } else {
+            key = (msg.identifier & 0x7FF) << 19;
+        }
+        return (key << 1) | (msg.rtr ? 1 : 0);
+    }
+
+    /**
+     * @brief Add a frame
+     * @param msg Frame to transmit
+     * @param enqueue_us Submission time
+     * @param deadline_us Time after which the frame is dropped (0 = never)
+     * @param tag User value kept with the frame
+     * @return False if the queue is full
+     */
+    bool push(const twai_message_t& msg, uint64_t enqueue_us, uint64_t deadline_us = 0, uint32_t tag = 0);
+
+    /**
+     * @brief Put back a frame taken with pop(), keeping its order
+     * @param entry Entry returned by pop()
+     * @return False if the queue is full
+     */
+    bool requeue(const entry_t& entry);
+
+    /**
+     * @brief Remove the highest priority frame
+     * @param out Destination
+     * @return False if the queue is empty
+     */
+    bool pop(entry_t& out);
+
+    /**
+     * @brief Remove the frames whose deadline has passed
+     * @param now_us Current time
+     * @param out Destination of the removed entries
+     * @param max Capacity of @p out
+     * @return Entries removed (call again while it returns @p max)
+     * @details Returns at once while @p now_us is before the earliest deadline
+     */
+    size_t remove_expired(uint64_t now_us, entry_t* out, size_t max);
+
+    /** @brief Highest priority frame, nullptr if empty */
+    const entry_t* top() const { return count ? &heap[0] : nullptr; }
+
+    /** @brief Pending frames */
+    size_t size() const { return count; }
+
+    /** @brief True if nothing is pending */
+    bool empty() const { return count == 0; }
+
+    /** @brief True if no more frames fit */
+    bool full() const { return count >= MAX_TX_PENDING; }
+
+private:
+    entry_t heap[MAX_TX_PENDING];   ///< Binary heap storage
+    size_t count = 0;               ///< Used entries
+    uint32_t next_seq = 0;          ///< Submission counter
+    uint64_t next_expiry = UINT64_MAX; ///< Earliest deadline (may be stale after pop)
+
+    /** @brief Move an entry up to its place */
+    void sift_up(size_t i);
+
+    /** @brief Move an entry down to its place */
+    void sift_down(size_t i);
+
+    /** @brief True if @p a must leave before @p b */
+    static bool before(const entry_t& a, const entry_t& b) {
+        return a.key != b.key ? a.key < b.key : int32_t(a.seq - b.seq) < 0;
+    }
+};
@@ -3,19 +3,39 @@
 #include <esp_timer.h>
 #include <cstring>
 
+namespace {
+
+// Pasos del diagnóstico asíncrono
+enum : uint8_t {
+    STEP_TOGGLE,        // Invertir STBY (TJA1050)
+    STEP_TOGGLE_READ,   // Leer STBY tras 50 us y restaurar
+    STEP_PULLUP,        // Activar pull-up (MCP2551)
+    STEP_PULLUP_READ    // Leer tras 10 us y dejar flotante
+};
+
+}  // namespace
+
 TWAI_Txcvr::Config::Config(Type t, gpio_num_t stby, gpio_num_t en, const uint8_t* ci) 
             : type(t), standby_pin(stby), enable_pin(en) {
             if (ci) memcpy(custom_init, ci, 4);
             else memset(custom_init, 0, 4);
         }
 
+TWAI_Txcvr::~TWAI_Txcvr() {
+    if (diag_timer) {
+        esp_timer_stop(diag_timer);
+        esp_timer_delete(diag_timer);
+    }
+}
+
 bool TWAI_Txcvr::begin(Config& config) {
     cfg = &config;
     
     // Inicialización común
     if (cfg->standby_pin != GPIO_NUM_NC) {
         gpio_reset_pin(cfg->standby_pin);
-        gpio_set_direction(cfg->standby_pin, GPIO_MODE_OUTPUT);
+        // Entrada y salida: los diagnósticos leen el nivel que se escribe
+        gpio_set_direction(cfg->standby_pin, GPIO_MODE_INPUT_OUTPUT);
     }
     
     if (cfg->enable_pin != GPIO_NUM_NC) {
@@ -48,26 +68,29 @@ void TWAI_Txcvr::init_mcp2551() {
 }
 
 void TWAI_Txcvr::set_normal_mode() {
-    switch(cfg->type) {
-        case Type::TJA1050:
-            write_pin(cfg->standby_pin, false); // STBY = LOW (modo normal)
-            write_pin(cfg->enable_pin, true);   // EN = HIGH (habilitado)
-            break;
-        case Type::MCP2551:
-            write_pin(cfg->standby_pin, true);  // STBY = HIGH (operación normal)
-            break;
-        default:
-            break;
-    }
+    standby.store(false, std::memory_order_relaxed);
+    apply_mode();
 }
 
 void TWAI_Txcvr::set_standby_mode() {
+    standby.store(true, std::memory_order_relaxed);
+    apply_mode();
+}
+
+void TWAI_Txcvr::apply_mode() {
+    mode_changes.fetch_add(1, std::memory_order_relaxed);
+    bool stby = standby.load(std::memory_order_relaxed);
     switch(cfg->type) {
         case Type::TJA1050:
-            write_pin(cfg->standby_pin, true);  // STBY = HIGH (standby)
+            if (stby) {
+                write_pin(cfg->standby_pin, true);  // STBY = HIGH (standby)
+            } else {
+                write_pin(cfg->standby_pin, false); // STBY = LOW (modo normal)
+                write_pin(cfg->enable_pin, true);   // EN = HIGH (habilitado)
+            }
             break;
         case Type::MCP2551:
-            write_pin(cfg->standby_pin, false); // STBY = LOW (standby)
+            write_pin(cfg->standby_pin, !stby);     // STBY = HIGH normal, LOW standby
             break;
         default:
             break;
@@ -76,7 +99,8 @@ void TWAI_Txcvr::set_standby_mode() {
 
 void TWAI_Txcvr::set_silent_mode(bool silent) {
     if (cfg->type == Type::TJA1050) {
-        write_pin(cfg->standby_pin, silent);
+        standby.store(silent, std::memory_order_relaxed);
+        apply_mode();
     }
 }
 
@@ -135,3 +159,96 @@ bool TWAI_Txcvr::is_connected() const {
 
     return true; // Todas las pruebas pasaron
 }
+
+bool TWAI_Txcvr::start_diagnostic(diagnostic_handler_t handler, void* context) {
+    if (!initialized || get_diagnostic() == Diagnostic::RUNNING) return false;
+    if (!diag_timer) {
+        esp_timer_create_args_t args = {};
+        args.callback = diagnostic_step;
+        args.arg = this;
+        args.dispatch_method = ESP_TIMER_TASK;
+        args.name = "TXCVR_DIAG";
+        if (esp_timer_create(&args, &diag_timer) != ESP_OK) return false;
+    }
+    diag_handler = handler;
+    diag_context = context;
+    diag_state.store(uint8_t(Diagnostic::RUNNING), std::memory_order_release);
+
+    // 1. Verificación básica de pines
+    if (cfg->standby_pin != GPIO_NUM_NC && gpio_get_level(cfg->standby_pin) == -1) {
+        finish_diagnostic(false);
+        return true;
+    }
+    diag_step = STEP_TOGGLE;
+    diag_retries = 0;
+    diagnostic_step(this);
+    return true;
+}
+
+void TWAI_Txcvr::diagnostic_step(void* arg) {
+    TWAI_Txcvr* self = static_cast<TWAI_Txcvr*>(arg);
+    const Config& c = *self->cfg;
+    bool has_standby = c.standby_pin != GPIO_NUM_NC;
+
+    // 2. Prueba de cambio de standby del TJA1050, sin espera activa
+    if (self->diag_step == STEP_TOGGLE) {
+        if (c.type == Type::TJA1050 && has_standby) {
+            self->diag_mode_changes = self->mode_changes.load(std::memory_order_relaxed);
+            self->diag_level = gpio_get_level(c.standby_pin);
+            gpio_set_level(c.standby_pin, !self->diag_level);
+            self->diag_step = STEP_TOGGLE_READ;
+            esp_timer_start_once(self->diag_timer, 50);
+            return;
+        }
+        self->diag_step = STEP_PULLUP;
+    } else if (self->diag_step == STEP_TOGGLE_READ) {
+        int level = gpio_get_level(c.standby_pin);
+        bool disturbed = self->mode_changes.load(std::memory_order_relaxed) != self->diag_mode_changes;
+        // Restaurar el modo vigente ahora, no el de antes de la prueba
+        self->apply_mode();
+        // Un cambio de modo durante la espera invalida la lectura: repetir
+        if (disturbed && self->diag_retries < 3) {
+            ++self->diag_retries;
+            self->diag_step = STEP_TOGGLE;
+            diagnostic_step(arg);
+            return;
+        }
+        if (level == self->diag_level) {
+            self->finish_diagnostic(false);  // No hubo cambio -> transceiver no responde
+            return;
+        }
+        self->diag_step = STEP_PULLUP;
+    }
+
+    // 3. Para MCP2551 verificar pull-up interno
+    #ifdef CONFIG_IDF_TARGET_ESP32
+    if (self->diag_step == STEP_PULLUP) {
+        if (c.type == Type::MCP2551 && has_standby) {
+            // Soltar el pin para leer el pull-up también en standby (STBY = LOW)
+            gpio_set_direction(c.standby_pin, GPIO_MODE_INPUT);
+            gpio_set_pull_mode(c.standby_pin, GPIO_PULLUP_ONLY);
+            self->diag_step = STEP_PULLUP_READ;
+            esp_timer_start_once(self->diag_timer, 10);
+            return;
+        }
+    } else if (self->diag_step == STEP_PULLUP_READ) {
+        int level = gpio_get_level(c.standby_pin);
+        gpio_set_pull_mode(c.standby_pin, GPIO_FLOATING);
+        gpio_set_direction(c.standby_pin, GPIO_MODE_INPUT_OUTPUT);
+        self->apply_mode();
+        if (level == 0) {
+            self->finish_diagnostic(false);  // Pull-up no detectado
+            return;
+        }
+    }
+    #endif
+
+    self->finish_diagnostic(true);
+}
+
+void TWAI_Txcvr::finish_diagnostic(bool connected) {
+    diag_step = STEP_TOGGLE;
+    diag_state.store(uint8_t(connected ? Diagnostic::CONNECTED : Diagnostic::NOT_CONNECTED),
+                     std::memory_order_release);
+    if (diag_handler) diag_handler(connected, diag_context);
+}
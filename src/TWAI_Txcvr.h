@@ -1,5 +1,8 @@
 #pragma once
 #include <driver/gpio.h>
+#include <esp_timer.h>
+#include <atomic>
+#include <cstdint>
 
 /**
  * @class TWAI_Txcvr
@@ -41,8 +44,28 @@ public:
         uint8_t custom_init[4] = {0};           ///< Custom initialization sequence
     };
 
+    /**
+     * @enum Diagnostic
+     * @brief Result of the last start_diagnostic()
+     */
+    enum class Diagnostic {
+        NONE,           ///< No diagnostic run yet
+        RUNNING,        ///< Checks scheduled, result not known yet
+        CONNECTED,      ///< Transceiver responded
+        NOT_CONNECTED   ///< A check failed
+    };
+
+    /**
+     * @brief Diagnostic result callback
+     * @param connected True if every check passed
+     * @param context User pointer given to start_diagnostic()
+     * @note Runs in the esp_timer task
+     */
+    typedef void (*diagnostic_handler_t)(bool connected, void* context);
+
     // Constructor
     TWAI_Txcvr() = default;
+    ~TWAI_Txcvr();
     
     /**
      * @brief Initialize transceiver hardware
@@ -88,18 +111,60 @@ public:
     
     // Status
 
+    /** @brief True if the last mode set was standby (or silent) */
+    bool is_standby() const { return standby.load(std::memory_order_relaxed); }
+
     /**
      * @brief Verify transceiver connection
      * @return true if transceiver responds to commands
      * @details Performs hardware-specific checks:
      * - TJA1050: Verifies STBY pin control
      * - MCP2551: Checks internal pull-up resistance
+     * @warning Busy-waits up to 60 us and takes a TJA1050 off the bus
+     * meanwhile; use start_diagnostic() in running systems
      */
     bool is_connected() const;
 
+    /**
+     * @brief Run the is_connected() checks without blocking
+     * @param handler Called with the result (nullptr to poll get_diagnostic())
+     * @param context User pointer passed to @p handler
+     * @return False if not initialized, already running or no timer available
+     *
+     * @details Each settling delay is an esp_timer one-shot instead of a
+     * busy wait, so the call returns at once. Pins are restored to the
+     * mode in force when each step ends, so set_normal_mode() during the
+     * check is not undone. The STBY toggle still affects the bus for
+     * about 50 us: run it while the bus is idle or the transceiver is in
+     * standby (see TWAI_Object::set_txcvr_idle_policy()).
+     */
+    bool start_diagnostic(diagnostic_handler_t handler = nullptr, void* context = nullptr);
+
+    /** @brief State of the last start_diagnostic() */
+    Diagnostic get_diagnostic() const { return Diagnostic(diag_state.load(std::memory_order_acquire)); }
+
 private:
     Config *cfg = nullptr;      ///< Pointer to active configuration
     bool initialized = false;   ///< Initialization status flag
+    std::atomic<bool> standby{false};   ///< Mode requested last (true = standby/silent)
+    std::atomic<uint32_t> mode_changes{0};  ///< Mode requests, to spot one during a diagnostic
+    esp_timer_handle_t diag_timer = nullptr;    ///< Settling delay of the diagnostic steps
+    std::atomic<uint8_t> diag_state{uint8_t(Diagnostic::NONE)}; ///< Diagnostic result
+    uint8_t diag_step = 0;                      ///< Next diagnostic step
+    int diag_level = 0;                         ///< STBY level before the toggle
+    uint32_t diag_mode_changes = 0;             ///< mode_changes when the toggle was written
+    uint8_t diag_retries = 0;                   ///< Toggles repeated after a mode change
+    diagnostic_handler_t diag_handler = nullptr;    ///< Result callback
+    void* diag_context = nullptr;               ///< Result callback context
+
+    /** @brief Drive the pins for the requested mode */
+    void apply_mode();
+
+    /** @brief Run the next diagnostic step (esp_timer callback) */
+    static void diagnostic_step(void* arg);
+
+    /** @brief Publish the diagnostic result */
+    void finish_diagnostic(bool connected);
     
     /**
      * @brief TJA1050-specific initialization
@@ -0,0 +1,287 @@
+#include "TWAI_VirtualBus.h"
+#include "TWAI_FrameBits.h"
+
+TWAI_VirtualBus::TWAI_VirtualBus(uint32_t baud_rate)
+    : baud(baud_rate ? baud_rate : 500000),
+      bit_ns(1000000000u / baud) {
+}
+
+int TWAI_VirtualBus::add_node(rx_handler_t on_rx, tx_handler_t on_tx, void* context, bool listen_only) {
+    for (int i = 0; i < MAX_VIRTUAL_NODES; ++i) {
+        node_t& n = nodes[i];
+        if (n.used) continue;
+
+        n = {};
+        n.on_rx = on_rx;
+        n.on_tx = on_tx;
+        n.context = context;
+        n.listen_only = listen_only;
+        n.stats.state = TWAI_STATE_STOPPED;
+        n.used = true;
+        return i;
+    }
+    return -1;
+}
+
+void TWAI_VirtualBus::remove_node(int node) {
+    if (!valid(node)) return;
+    nodes[node] = {};
+}
+
+bool TWAI_VirtualBus::transmit(int node, const twai_message_t& msg, uint64_t deadline_us, uint32_t tag) {
+    if (!valid(node)) return false;
+    node_t& n = nodes[node];
+    if (n.listen_only || n.stats.state != TWAI_STATE_RUNNING) return false;
+    if (!n.tx.push(msg, now_us(), deadline_us, tag)) return false;
+
+    if (n.tx.size() > n.stats.tx_pending_peak) n.stats.tx_pending_peak = n.tx.size();
+    return true;
+}
+
+bool TWAI_VirtualBus::start(int node) {
+    if (!valid(node) || nodes[node].stats.state != TWAI_STATE_STOPPED) return false;
+    nodes[node].stats.state = TWAI_STATE_RUNNING;
+    return true;
+}
+
+void TWAI_VirtualBus::stop(int node) {
+    if (!valid(node)) return;
+    // Como twai_stop(): las tramas pendientes se descartan
+    flush_tx(node);
+    nodes[node].stats.state = TWAI_STATE_STOPPED;
+}
+
+bool TWAI_VirtualBus::initiate_recovery(int node) {
+    if (!valid(node) || nodes[node].stats.state != TWAI_STATE_BUS_OFF) return false;
+    nodes[node].stats.state = TWAI_STATE_RECOVERING;
+    nodes[node].recovery_left = RECOVERY_SEQUENCES;
+    return true;
+}
+
+void TWAI_VirtualBus::set_error_rate(uint32_t errors_per_million, uint32_t seed) {
+    error_ppm = errors_per_million;
+    rng = seed ? seed : 1;
+}
+
+void TWAI_VirtualBus::inject_errors(int node, uint32_t count) {
+    if (valid(node)) nodes[node].forced_errors += count;
+}
+
+void TWAI_VirtualBus::force_bus_off(int node) {
+    if (!valid(node)) return;
+    nodes[node].stats.tec = 256;
+    enter_bus_off(node);
+}
+
+uint32_t TWAI_VirtualBus::random() {
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return rng;
+}
+
+uint32_t TWAI_VirtualBus::run_until(uint64_t time_us) {
+    uint64_t end_bits = time_us * 1000 / bit_ns;
+    uint32_t done = 0;
+
+    while (now_bits < end_bits) {
+        // Arbitraje: la clave más baja entre los nodos listos para transmitir
+        int winner = -1;
+        uint32_t contenders = 0;
+        uint64_t next_ready = end_bits;
+        for (int i = 0; i < MAX_VIRTUAL_NODES; ++i) {
+            node_t& n = nodes[i];
+            if (!n.used || n.listen_only || n.stats.state != TWAI_STATE_RUNNING) continue;
+            expire_tx(i);
+            if (n.tx.empty()) continue;
+            if (n.ready_bits > now_bits) {
+                if (n.ready_bits < next_ready) next_ready = n.ready_bits;
+                continue;
+            }
+            ++contenders;
+            if (winner < 0 || n.tx.top()->key < nodes[winner].tx.top()->key) winner = i;
+        }
+
+        // Bus libre hasta el próximo nodo listo o el final
+        if (winner < 0) {
+            count_recessive(uint32_t((next_ready - now_bits) / 11));
+            now_bits = next_ready;
+            continue;
+        }
+        for (int i = 0; i < MAX_VIRTUAL_NODES && contenders > 1; ++i) {
+            node_t& n = nodes[i];
+            if (i == winner || !n.used || n.listen_only || n.stats.state != TWAI_STATE_RUNNING ||
+                n.tx.empty() || n.ready_bits > now_bits) continue;
+            ++n.stats.arb_lost;
+            if (n.tx.top()->msg.ss) fail_top(i);
+        }
+
+        node_t& sender = nodes[winner];
+        uint32_t bits = TWAI_FrameBits::frame_bits(sender.tx.top()->msg);
+
+        // ACK: algún otro nodo activo que no sea de solo escucha
+        bool acked = false;
+        for (int i = 0; i < MAX_VIRTUAL_NODES && !acked; ++i) {
+            const node_t& n = nodes[i];
+            acked = i != winner && n.used && !n.listen_only && n.stats.state == TWAI_STATE_RUNNING;
+        }
+
+        bool corrupted = false;
+        if (sender.forced_errors > 0) {
+            --sender.forced_errors;
+            corrupted = true;
+        } else if (error_ppm > 0) {
+            corrupted = random() % 1000000 < error_ppm;
+        }
+
+        uint32_t used_bits;
+        if (corrupted || !acked) {
+            // Error en un bit del campo arbitrado/datos, o en el hueco de ACK
+            uint32_t at = corrupted ? 1 + random() % (bits - TWAI_FrameBits::FIXED_TAIL_BITS)
+                                    : bits - TWAI_FrameBits::FIXED_TAIL_BITS + 2;
+            used_bits = at + ERROR_FRAME_BITS;
+            now_bits += used_bits;
+            on_error(winner, !corrupted);
+            // Un solo intento: la trama no se retransmite
+            if (sender.stats.state == TWAI_STATE_RUNNING && !sender.tx.empty() && sender.tx.top()->msg.ss) {
+                fail_top(winner);
+            }
+        } else {
+            used_bits = bits + TWAI_FrameBits::INTERMISSION_BITS;
+            now_bits += used_bits;
+            TWAI_TxQueue::entry_t entry;
+            sender.tx.pop(entry);
+            on_success(winner, entry);
+            count_recessive(1);
+            ++done;
+        }
+        busy_bits += used_bits;
+
+        // Error pasivo: suspensión de 8 bits antes de volver a transmitir
+        if (sender.stats.tec >= 128) sender.ready_bits = now_bits + SUSPEND_BITS;
+    }
+    return done;
+}
+
+void TWAI_VirtualBus::count_recessive(uint32_t sequences) {
+    if (sequences == 0) return;
+    for (int i = 0; i < MAX_VIRTUAL_NODES; ++i) {
+        node_t& n = nodes[i];
+        if (!n.used || n.stats.state != TWAI_STATE_RECOVERING) continue;
+        if (n.recovery_left > sequences) {
+            n.recovery_left -= sequences;
+            continue;
+        }
+        // Recuperado: contadores a cero y detenido hasta start()
+        n.recovery_left = 0;
+        n.stats.tec = 0;
+        n.stats.rec = 0;
+        n.stats.state = TWAI_STATE_STOPPED;
+    }
+}
+
+void TWAI_VirtualBus::on_error(int sender, bool ack_error) {
+    ++errors;
+    node_t& s = nodes[sender];
+    ++s.stats.bus_errors;
+    // Excepción: un error de ACK no sube el TEC de un nodo en error pasivo
+    if (!(ack_error && s.stats.tec >= 128)) s.stats.tec += 8;
+
+    if (!ack_error) {
+        for (int i = 0; i < MAX_VIRTUAL_NODES; ++i) {
+            node_t& n = nodes[i];
+            if (i == sender || !n.used || n.stats.state != TWAI_STATE_RUNNING) continue;
+            ++n.stats.bus_errors;
+            if (n.stats.rec < 255) ++n.stats.rec;
+        }
+    }
+    if (s.stats.tec >= 256) enter_bus_off(sender);
+}
+
+void TWAI_VirtualBus::on_success(int sender, const TWAI_TxQueue::entry_t& entry) {
+    ++frames;
+    uint64_t now = now_us();
+
+    node_t& s = nodes[sender];
+    if (s.stats.tec > 0) --s.stats.tec;
+    ++s.stats.tx_frames;
+    uint32_t latency = uint32_t(now - entry.enqueue_us);
+    s.latency_total_us += latency;
+    if (latency > s.stats.tx_latency_max_us) s.stats.tx_latency_max_us = latency;
+
+    for (int i = 0; i < MAX_VIRTUAL_NODES; ++i) {
+        node_t& n = nodes[i];
+        if (i == sender || !n.used || n.stats.state != TWAI_STATE_RUNNING) continue;
+        if (n.stats.rec > 127) n.stats.rec = 127;
+        else if (n.stats.rec > 0) --n.stats.rec;
+        ++n.stats.rx_frames;
+        if (n.on_rx) n.on_rx(entry.msg, now, n.context);
+    }
+    if (s.on_tx) s.on_tx(entry, TWAI_TX_SUCCESS, now, s.context);
+}
+
+void TWAI_VirtualBus::enter_bus_off(int node) {
+    node_t& n = nodes[node];
+    if (n.stats.state == TWAI_STATE_BUS_OFF) return;
+    flush_tx(node);
+    n.stats.state = TWAI_STATE_BUS_OFF;
+    ++n.stats.bus_off_count;
+}
+
+void TWAI_VirtualBus::flush_tx(int node) {
+    node_t& n = nodes[node];
+    uint64_t now = now_us();
+    TWAI_TxQueue::entry_t entry;
+    while (n.tx.pop(entry)) {
+        ++n.stats.tx_failed;
+        if (n.on_tx) n.on_tx(entry, TWAI_TX_FAILED, now, n.context);
+    }
+}
+
+void TWAI_VirtualBus::fail_top(int node) {
+    node_t& n = nodes[node];
+    TWAI_TxQueue::entry_t entry;
+    if (!n.tx.pop(entry)) return;
+    ++n.stats.tx_failed;
+    if (n.on_tx) n.on_tx(entry, TWAI_TX_FAILED, now_us(), n.context);
+}
+
+void TWAI_VirtualBus::expire_tx(int node) {
+    node_t& n = nodes[node];
+    uint64_t now = now_us();
+    TWAI_TxQueue::entry_t expired[8];
+    size_t count;
+    do {
+        count = n.tx.remove_expired(now, expired, 8);
+        n.stats.tx_expired += count;
+        for (size_t i = 0; i < count; ++i) {
+            if (n.on_tx) n.on_tx(expired[i], TWAI_TX_EXPIRED, now, n.context);
+        }
+    } while (count == 8);
+}
+
+bool TWAI_VirtualBus::get_node_stats(int node, node_stats_t& stats) const {
+    if (!valid(node)) return false;
+    const node_t& n = nodes[node];
+    stats = n.stats;
+    stats.tx_pending = n.tx.size();
+    stats.tx_latency_avg_us = n.stats.tx_frames ? uint32_t(n.latency_total_us / n.stats.tx_frames) : 0;
+    return true;
+}
+
+TWAI_VirtualBus::bus_stats_t TWAI_VirtualBus::get_bus_stats(bool reset) {
+    bus_stats_t stats;
+    uint64_t elapsed = now_bits - window_start_bits;
+    stats.elapsed_us = to_us(elapsed);
+    stats.busy_us = to_us(busy_bits);
+    stats.frames = frames;
+    stats.errors = errors;
+    stats.load = elapsed ? float(busy_bits) / float(elapsed) : 0.0f;
+    if (reset) {
+        window_start_bits = now_bits;
+        busy_bits = 0;
+        frames = 0;
+        errors = 0;
+    }
+    return stats;
+}
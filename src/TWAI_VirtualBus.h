@@ -0,0 +1,260 @@
+#pragma once
+#include <driver/twai.h>
+#include <cstddef>
+#include <cstdint>
+#include "TWAI_TxQueue.h"
+
+#ifndef MAX_VIRTUAL_NODES
+/**Maximum number of nodes on a virtual bus*/
+#define MAX_VIRTUAL_NODES (32)
+#endif  // MAX_VIRTUAL_NODES
+
+/**
+ * @class TWAI_VirtualBus
+ * @brief Deterministic in-process CAN bus simulator
+ *
+ * @details Nodes exchange frames over a simulated bus driven by a virtual
+ * clock counted in bit times, so a simulation runs as fast as the host
+ * allows and gives the same result on every run. The model covers:
+ * - Frame duration from TWAI_FrameBits (stuff bits and intermission)
+ * - Arbitration: the lowest TWAI_TxQueue::arbitration_key() among the
+ *   nodes with pending frames wins (equal keys: lowest node index); the
+ *   others count an arbitration loss
+ * - ACK: a frame nobody else can acknowledge is an ACK error
+ * - Error injection (random rate or per node), TEC/REC counting,
+ *   error-passive suspend time, bus-off and the 128 x 11 recessive bit
+ *   recovery sequence
+ * - Single-shot frames (twai_message_t::ss), dropped after one lost
+ *   arbitration or error, and per-frame deadlines
+ *
+ * Each node offers its highest priority pending frame, like a controller
+ * fed by the TWAI_Object transmit scheduler. Error frames are modelled as
+ * a fixed 17 bit sequence (flag, delimiter and intermission).
+ *
+ * A TWAI_Object joins the bus with attach_virtual_bus(); any other code
+ * can join with add_node() and callbacks.
+ *
+ * @note Not synchronized: run the simulation and submit frames from one task
+ */
+class TWAI_VirtualBus {
+public:
+    /**
+     * @brief Frame received by a node
+     * @param msg Frame
+     * @param timestamp_us Virtual time at the end of the frame
+     * @param context Node context given to add_node()
+     */
+    typedef void (*rx_handler_t)(const twai_message_t& msg, uint64_t timestamp_us, void* context);
+
+    /**
+     * @brief Transmission finished (sent, single-shot attempt lost, expired,
+     * or dropped at bus-off or stop())
+     * @param entry Frame with its submission time, deadline and tag
+     * @param result Outcome
+     * @param done_us Virtual time of completion
+     * @param context Node context given to add_node()
+     */
+    typedef void (*tx_handler_t)(const TWAI_TxQueue::entry_t& entry, twai_tx_result_t result, uint64_t done_us, void* context);
+
+    /**
+     * @struct node_stats_t
+     * @brief Counters of one node
+     */
+    typedef struct {
+        twai_state_t state;         ///< Controller state
+        uint32_t tec;               ///< Transmit error counter
+        uint32_t rec;               ///< Receive error counter
+        uint32_t tx_pending;        ///< Frames waiting to be sent
+        uint32_t tx_pending_peak;   ///< Highest tx_pending seen
+        uint32_t tx_frames;         ///< Frames sent
+        uint32_t tx_failed;         ///< Frames dropped at bus-off or stop(), failed single-shot attempts
+        uint32_t tx_expired;        ///< Frames dropped at their deadline
+        uint32_t rx_frames;         ///< Frames received
+        uint32_t arb_lost;          ///< Arbitration losses
+        uint32_t bus_errors;        ///< Errors seen while transmitting or receiving
+        uint32_t bus_off_count;     ///< Bus-off entries
+        uint32_t tx_latency_max_us; ///< Longest submit-to-completion time (us)
+        uint32_t tx_latency_avg_us; ///< Average submit-to-completion time (us)
+    } node_stats_t;
+
+    /**
+     * @struct bus_stats_t
+     * @brief Counters of the whole bus
+     */
+    typedef struct {
+        uint64_t elapsed_us;    ///< Virtual time since reset
+        uint64_t busy_us;       ///< Time occupied by frames and error frames
+        uint32_t frames;        ///< Frames completed
+        uint32_t errors;        ///< Error frames
+        float load;             ///< busy_us / elapsed_us
+    } bus_stats_t;
+
+    /**
+     * @brief Create an empty bus
+     * @param baud_rate Bus speed in bps (rates supported by TWAI_Object::begin())
+     */
+    explicit TWAI_VirtualBus(uint32_t baud_rate = 500000);
+
+    /** @brief Bus speed in bps */
+    uint32_t baud_rate() const { return baud; }
+
+    /**
+     * @brief Add a node (stopped until start())
+     * @param on_rx Receive callback (may be nullptr)
+     * @param on_tx Transmit completion callback (may be nullptr)
+     * @param context User pointer passed to the callbacks
+     * @param listen_only Receive without acknowledging or transmitting
+     * @return Node index, or -1 if the bus is full
+     */
+    int add_node(rx_handler_t on_rx, tx_handler_t on_tx, void* context, bool listen_only = false);
+
+    /**
+     * @brief Detach a node, discarding its pending frames
+     * @param node Node index
+     */
+    void remove_node(int node);
+
+    /**
+     * @brief Submit a frame
+     * @param node Node index
+     * @param msg Frame
+     * @param deadline_us Virtual time after which the frame is dropped if not sent (0 = never)
+     * @param tag User value reported to the transmit callback
+     * @return False if the node is not running or its queue is full
+     */
+    bool transmit(int node, const twai_message_t& msg, uint64_t deadline_us = 0, uint32_t tag = 0);
+
+    /**
+     * @brief Put a stopped node on the bus (like twai_start())
+     * @return False if the node is not stopped
+     */
+    bool start(int node);
+
+    /**
+     * @brief Take a node off the bus (like twai_stop())
+     */
+    void stop(int node);
+
+    /**
+     * @brief Begin bus-off recovery (like twai_initiate_recovery())
+     * @return False if the node is not bus-off
+     * @note The node is stopped once 128 sequences of 11 recessive bits are seen
+     */
+    bool initiate_recovery(int node);
+
+    /**
+     * @brief Corrupt frames at random
+     * @param errors_per_million Probability of an error per frame (ppm)
+     * @param seed Pseudo-random sequence seed (same seed, same run)
+     */
+    void set_error_rate(uint32_t errors_per_million, uint32_t seed = 1);
+
+    /**
+     * @brief Corrupt the next frames sent by a node
+     * @param node Node index
+     * @param count Number of transmissions to destroy
+     */
+    void inject_errors(int node, uint32_t count);
+
+    /**
+     * @brief Put a node in bus-off immediately
+     */
+    void force_bus_off(int node);
+
+    /**
+     * @brief Advance the virtual clock
+     * @param time_us Absolute virtual time to run to
+     * @return Frames completed
+     * @note A frame started before @p time_us is completed, so now_us()
+     * may end slightly past @p time_us
+     */
+    uint32_t run_until(uint64_t time_us);
+
+    /** @brief Advance the virtual clock by @p duration_us */
+    uint32_t run_for(uint64_t duration_us) { return run_until(now_us() + duration_us); }
+
+    /** @brief Current virtual time (us) */
+    uint64_t now_us() const { return now_bits * bit_ns / 1000; }
+
+    /**
+     * @brief Get the counters of a node
+     * @param node Node index
+     * @param stats Destination
+     * @return False if the node index is invalid
+     */
+    bool get_node_stats(int node, node_stats_t& stats) const;
+
+    /**
+     * @brief Get the bus counters
+     * @param reset True to restart the measurement window
+     */
+    bus_stats_t get_bus_stats(bool reset = false);
+
+private:
+    static constexpr uint32_t ERROR_FRAME_BITS = 17;        ///< Error flag, delimiter and intermission
+    static constexpr uint32_t SUSPEND_BITS = 8;             ///< Error-passive suspend transmission
+    static constexpr uint32_t RECOVERY_SEQUENCES = 128;     ///< 11-bit recessive sequences to leave bus-off
+
+    /**
+     * @struct node_t
+     * @brief Simulated controller
+     */
+    typedef struct {
+        rx_handler_t on_rx;         ///< Receive callback
+        tx_handler_t on_tx;         ///< Transmit completion callback
+        void* context;              ///< Callback context
+        TWAI_TxQueue tx;            ///< Pending frames in arbitration order
+        node_stats_t stats;         ///< Counters
+        uint64_t latency_total_us;  ///< Sum of TX latencies
+        uint64_t ready_bits;        ///< Earliest time the node may start a frame
+        uint32_t recovery_left;     ///< Recessive sequences still needed to recover
+        uint32_t forced_errors;     ///< Transmissions to destroy
+        bool listen_only;           ///< Never acknowledges nor transmits
+        bool used;                  ///< Slot in use
+    } node_t;
+
+    node_t nodes[MAX_VIRTUAL_NODES] = {};   ///< Node slots
+    uint32_t baud;                          ///< Bus speed (bps)
+    uint32_t bit_ns;                        ///< Bit time (ns)
+    uint64_t now_bits = 0;                  ///< Virtual clock (bit times)
+    uint64_t window_start_bits = 0;         ///< Start of the bus_stats_t window
+    uint64_t busy_bits = 0;                 ///< Bus time used in the window
+    uint32_t frames = 0;                    ///< Frames completed in the window
+    uint32_t errors = 0;                    ///< Error frames in the window
+    uint32_t error_ppm = 0;                 ///< Random error probability
+    uint32_t rng = 1;                       ///< xorshift32 state
+
+    /** @brief True if @p node is a used slot */
+    bool valid(int node) const { return node >= 0 && node < MAX_VIRTUAL_NODES && nodes[node].used; }
+
+    /** @brief Virtual time in us of a bit time */
+    uint64_t to_us(uint64_t bits) const { return bits * bit_ns / 1000; }
+
+    /** @brief Next pseudo-random number */
+    uint32_t random();
+
+    /** @brief Let idle or frame-end recessive time count towards bus-off recovery */
+    void count_recessive(uint32_t sequences);
+
+    /**
+     * @brief Transmission destroyed: error frame and error counters
+     * @param sender Transmitting node
+     * @param ack_error True if nobody acknowledged the frame
+     */
+    void on_error(int sender, bool ack_error);
+
+    /** @brief Frame sent: deliver to receivers and update counters */
+    void on_success(int sender, const TWAI_TxQueue::entry_t& entry);
+
+    /** @brief Enter bus-off, dropping pending frames */
+    void enter_bus_off(int node);
+
+    /** @brief Drop every pending frame of a node as failed */
+    void flush_tx(int node);
+
+    /** @brief Drop the highest priority frame of a node as failed (single-shot) */
+    void fail_top(int node);
+
+    /** @brief Drop the frames of a node whose deadline has passed */
+    void expire_tx(int node);
+};